@@ -110,7 +110,7 @@ static gboolean bar_pane_histogram_update_cb(gpointer data)
 			}
 		else
 			{
-			histmap_start_idle(phd->fd);
+			histmap_start(phd->fd);
 			}
 		}
 
@@ -288,13 +288,26 @@ static gboolean cache_maintain_home_cb(gpointer data)
 				auto fd_list = static_cast<FileData *>(work->data);
 				g_autofree gchar *path_buf = g_strdup(fd_list->path);
 
-				gchar *dot = strrchr(path_buf, '.');
+				gboolean orphan;
 
-				if (dot) *dot = '\0';
-				if ((!cm->metadata && cm->clear) ||
-				    (strlen(path_buf) > base_length && !isfile(path_buf + base_length)) )
+				if (strcmp(filename_from_path(path_buf), GQ_CACHE_SIM_DB) == 0 ||
+				    strcmp(filename_from_path(path_buf), GQ_CACHE_METADATA_INDEX) == 0)
 					{
+					/* the sim. database and metadata index of a folder are kept while the folder exists */
+					g_autofree gchar *dir = remove_level_from_path(path_buf);
+					orphan = strlen(dir) > base_length && !isdir(dir + base_length);
+					}
+				else
+					{
+					gchar *dot = strrchr(path_buf, '.');
+
+					if (dot) *dot = '\0';
+					orphan = strlen(path_buf) > base_length && !isfile(path_buf + base_length);
 					if (dot) *dot = '.';
+					}
+
+				if ((!cm->metadata && cm->clear) || orphan)
+					{
 					if (!unlink_file(path_buf)) log_printf("failed to delete:%s\n", path_buf);
 					}
 				else
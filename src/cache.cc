@@ -21,14 +21,21 @@
 
 #include "cache.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <utime.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <config.h>
 
@@ -58,6 +65,19 @@
  * All data lines should end with a new line char. \n
  * Format is very strict, data must begin with the char immediately following '='. \n
  * Currently SimilarityGrid is always assumed to be 32 x 32 RGB. \n
+ *
+ *-------------------------------------------------------------------
+ * Cache database file format:
+ *-------------------------------------------------------------------
+ *
+ * When options->thumbnails.sim_database is set, the same data is stored in
+ * one file per folder, named GQ_CACHE_SIM_DB, in the cache location of the
+ * folder. The file is a #CacheSimDbHeader followed by fixed size
+ * #CacheSimRecord entries sorted by file name, in host byte order, so the
+ * records of a whole folder are available with a single mmap. A record is
+ * valid while the modification time and size of the source file match. \n
+ * Text cache files are still read when there is no valid record, and are
+ * then added to the database.
  */
 
 namespace
@@ -151,6 +171,372 @@ gchar *cache_get_location(CacheType type, const gchar *source, gint include_name
 	return path;
 }
 
+constexpr gchar cache_sim_db_magic[8] = {'G', 'Q', 'S', 'I', 'M', 'D', 'B', '\0'};
+constexpr guint32 CACHE_SIM_DB_VERSION = 1;
+constexpr guint CACHE_SIM_DB_MAX_OPEN = 8; /**< Folders kept mapped */
+constexpr guint CACHE_SIM_DB_FLUSH_DELAY = 2; /**< Seconds to collect writes before saving */
+constexpr gsize CACHE_SIM_DB_LARGE = 1024; /**< Records from which new records are saved less often */
+constexpr gint64 CACHE_SIM_DB_REWRITE_INTERVAL = 30 * G_USEC_PER_SEC; /**< Least time between rewrites of a large file */
+
+enum CacheSimRecordFlags : guint32 {
+	CACHE_SIM_RECORD_DIMENSIONS = 1 << 0,
+	CACHE_SIM_RECORD_DATE       = 1 << 1,
+	CACHE_SIM_RECORD_MD5SUM     = 1 << 2,
+	CACHE_SIM_RECORD_SIMILARITY = 1 << 3
+};
+
+struct CacheSimDbHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 record_size;
+	guint64 count;
+};
+
+struct CacheSimRecord
+{
+	gchar name[256]; /**< File name within the folder, nul terminated */
+	gint64 mtime;
+	gint64 size;
+	guint32 flags; /**< #CacheSimRecordFlags */
+	gint32 width;
+	gint32 height;
+	guint32 reserved;
+	gint64 date;
+	guint8 md5sum[MD5_SIZE];
+	guint8 similarity[3 * 1024]; /**< RGB, as SimilarityGrid of the text format */
+};
+
+static_assert(sizeof(CacheSimDbHeader) % 8 == 0 && sizeof(CacheSimRecord) % 8 == 0, "records must stay aligned");
+
+/**
+ * @brief The database of one folder
+ *
+ * Written records are kept in \a pending and saved by flush(). Records
+ * of files already in the database are written in place, new files need
+ * the file to be rewritten, which is done less often for large folders.
+ */
+class CacheSimDb
+{
+public:
+	explicit CacheSimDb(const gchar *path) : path(path) {}
+	~CacheSimDb()
+	{
+		flush(TRUE);
+		unmap();
+	}
+
+	CacheSimDb(const CacheSimDb &) = delete;
+	CacheSimDb &operator=(const CacheSimDb &) = delete;
+
+	const CacheSimRecord *find(const gchar *name);
+	void put(const CacheSimRecord &record);
+	gboolean flush(gboolean force);
+
+	guint64 last_use = 0;
+
+private:
+	void map();
+	void unmap();
+	const CacheSimRecord *find_mapped(const gchar *name) const;
+	void patch();
+	void rewrite();
+
+	std::string path;
+	GMappedFile *mapped = nullptr;
+	const CacheSimRecord *records = nullptr;
+	gsize count = 0;
+	time_t mapped_mtime = 0;
+	off_t mapped_size = -1;
+	std::map<std::string, CacheSimRecord> pending;
+	gint64 rewrite_time = 0; /**< monotonic time of the last rewrite */
+};
+
+/**
+ * @brief Maps the file, or maps it again if it was replaced or patched
+ *
+ * The file is only ever replaced by rename, see secure_save(), or has
+ * records overwritten in place by patch(), so an existing mapping can not
+ * be truncated under us.
+ */
+void CacheSimDb::map()
+{
+	g_autofree gchar *pathl = path_from_utf8(path.c_str());
+	struct stat st;
+
+	if (stat(pathl, &st) != 0)
+		{
+		unmap();
+		return;
+		}
+
+	if (mapped && st.st_mtime == mapped_mtime && st.st_size == mapped_size) return;
+
+	unmap();
+
+	mapped = g_mapped_file_new(pathl, FALSE, nullptr);
+	if (!mapped) return;
+
+	mapped_mtime = st.st_mtime;
+	mapped_size = st.st_size;
+
+	const gsize length = g_mapped_file_get_length(mapped);
+	const gchar *contents = g_mapped_file_get_contents(mapped);
+	const auto *header = reinterpret_cast<const CacheSimDbHeader *>(contents);
+
+	if (length < sizeof(CacheSimDbHeader) ||
+	    memcmp(header->magic, cache_sim_db_magic, sizeof(cache_sim_db_magic)) != 0 ||
+	    header->version != CACHE_SIM_DB_VERSION ||
+	    header->record_size != sizeof(CacheSimRecord) ||
+	    (length - sizeof(CacheSimDbHeader)) % sizeof(CacheSimRecord) != 0 ||
+	    header->count != (length - sizeof(CacheSimDbHeader)) / sizeof(CacheSimRecord))
+		{
+		DEBUG_1("%s is not a cache database", path.c_str());
+		return;
+		}
+
+	records = reinterpret_cast<const CacheSimRecord *>(contents + sizeof(CacheSimDbHeader));
+	count = header->count;
+}
+
+void CacheSimDb::unmap()
+{
+	if (mapped) g_mapped_file_unref(mapped);
+
+	mapped = nullptr;
+	records = nullptr;
+	count = 0;
+	mapped_size = -1;
+}
+
+const CacheSimRecord *CacheSimDb::find_mapped(const gchar *name) const
+{
+	const CacheSimRecord *end = records + count;
+	const CacheSimRecord *record = std::lower_bound(records, end, name, [](const CacheSimRecord &r, const gchar *n)
+	{
+		return strcmp(r.name, n) < 0;
+	});
+
+	if (record == end || strcmp(record->name, name) != 0) return nullptr;
+
+	return record;
+}
+
+const CacheSimRecord *CacheSimDb::find(const gchar *name)
+{
+	auto it = pending.find(name);
+	if (it != pending.end()) return &it->second;
+
+	map();
+
+	return find_mapped(name);
+}
+
+void CacheSimDb::put(const CacheSimRecord &record)
+{
+	pending[record.name] = record;
+}
+
+/**
+ * @brief Overwrites the records of the file for which a pending record exists
+ *
+ * The written records are removed from \a pending. The caller must have
+ * called map().
+ */
+void CacheSimDb::patch()
+{
+	if (!records) return;
+
+	g_autofree gchar *pathl = path_from_utf8(path.c_str());
+	const int fd = open(pathl, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) return;
+
+	for (auto it = pending.begin(); it != pending.end();)
+		{
+		const CacheSimRecord *record = find_mapped(it->first.c_str());
+
+		if (record && pwrite(fd, &it->second, sizeof(CacheSimRecord),
+		                     sizeof(CacheSimDbHeader) + (record - records) * sizeof(CacheSimRecord)) == sizeof(CacheSimRecord))
+			{
+			it = pending.erase(it);
+			}
+		else
+			{
+			++it;
+			}
+		}
+
+	close(fd);
+}
+
+/**
+ * @brief Saves the pending records
+ * @param force Also rewrite a large file for new records, even if it was rewritten recently
+ * @returns TRUE if nothing is left pending
+ */
+gboolean CacheSimDb::flush(gboolean force)
+{
+	if (pending.empty()) return TRUE;
+
+	map();
+	patch();
+
+	if (pending.empty())
+		{
+		unmap();
+		return TRUE;
+		}
+
+	const gint64 now = g_get_monotonic_time();
+	if (!force && count >= CACHE_SIM_DB_LARGE && now - rewrite_time < CACHE_SIM_DB_REWRITE_INTERVAL) return FALSE;
+
+	rewrite();
+	rewrite_time = now;
+
+	return TRUE;
+}
+
+/**
+ * @brief Merges the pending records with those of the file and saves it
+ *
+ * The caller must have called map().
+ */
+void CacheSimDb::rewrite()
+{
+	std::vector<const CacheSimRecord *> merged;
+	merged.reserve(count + pending.size());
+
+	const CacheSimRecord *record = records;
+	const CacheSimRecord *end = records + count;
+	for (const auto &entry : pending)
+		{
+		while (record < end && strcmp(record->name, entry.first.c_str()) < 0)
+			{
+			merged.push_back(record++);
+			}
+		if (record < end && strcmp(record->name, entry.first.c_str()) == 0) record++;
+
+		merged.push_back(&entry.second);
+		}
+	while (record < end)
+		{
+		merged.push_back(record++);
+		}
+
+	CacheSimDbHeader header{};
+	memcpy(header.magic, cache_sim_db_magic, sizeof(header.magic));
+	header.version = CACHE_SIM_DB_VERSION;
+	header.record_size = sizeof(CacheSimRecord);
+	header.count = merged.size();
+
+	g_autoptr(GString) gstring = g_string_sized_new(sizeof(header) + merged.size() * sizeof(CacheSimRecord));
+	g_string_append_len(gstring, reinterpret_cast<const gchar *>(&header), sizeof(header));
+	for (const CacheSimRecord *r : merged)
+		{
+		g_string_append_len(gstring, reinterpret_cast<const gchar *>(r), sizeof(CacheSimRecord));
+		}
+
+	g_autofree gchar *pathl = path_from_utf8(path.c_str());
+	if (!secure_save(pathl, gstring->str, gstring->len))
+		{
+		log_printf("Failed to save cache database %s\n", path.c_str());
+		}
+
+	pending.clear();
+	unmap();
+}
+
+/**
+ * @brief The open databases, all access holds \a mutex
+ */
+struct CacheSimDbs
+{
+	std::mutex mutex;
+	std::unordered_map<std::string, std::unique_ptr<CacheSimDb>> dbs;
+	guint64 use_count = 0;
+	guint flush_id = 0;
+};
+
+CacheSimDbs &cache_sim_dbs()
+{
+	static CacheSimDbs cache_sim_dbs;
+
+	return cache_sim_dbs;
+}
+
+/**
+ * @brief Returns the database of the folder of \a source
+ * @param source
+ * @param create Create the cache folder if needed
+ *
+ * The caller must hold the \a mutex of cache_sim_dbs(). The least recently
+ * used database is closed when more than #CACHE_SIM_DB_MAX_OPEN are open.
+ */
+CacheSimDb *cache_sim_db_get(const gchar *source, gboolean create)
+{
+	g_autofree gchar *base = create ? cache_create_location(CacheType::SIM, source) : cache_get_location(CacheType::SIM, source, FALSE, nullptr);
+	if (!base) return nullptr;
+
+	g_autofree gchar *path = g_build_filename(base, GQ_CACHE_SIM_DB, nullptr);
+	CacheSimDbs &cache = cache_sim_dbs();
+
+	auto it = cache.dbs.find(path);
+	if (it == cache.dbs.end())
+		{
+		if (cache.dbs.size() >= CACHE_SIM_DB_MAX_OPEN)
+			{
+			auto oldest = std::min_element(cache.dbs.begin(), cache.dbs.end(), [](const auto &a, const auto &b)
+			{
+				return a.second->last_use < b.second->last_use;
+			});
+			cache.dbs.erase(oldest);
+			}
+
+		it = cache.dbs.emplace(path, std::make_unique<CacheSimDb>(path)).first;
+		}
+
+	it->second->last_use = ++cache.use_count;
+
+	return it->second.get();
+}
+
+gboolean cache_sim_db_flush_cb(gpointer)
+{
+	CacheSimDbs &cache = cache_sim_dbs();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	gboolean done = TRUE;
+	for (auto &entry : cache.dbs)
+		{
+		if (!entry.second->flush(FALSE)) done = FALSE;
+		}
+
+	if (!done) return G_SOURCE_CONTINUE;
+
+	cache.flush_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Sets the name, modification time and size of the record
+ * @returns false if the source can not be stored in the database
+ */
+bool cache_sim_record_key(const gchar *source, CacheSimRecord &record)
+{
+	const gchar *name = filename_from_path(source);
+	if (strlen(name) >= sizeof(record.name)) return false;
+
+	struct stat st;
+	if (!stat_utf8(source, &st)) return false;
+
+	g_strlcpy(record.name, name, sizeof(record.name));
+	record.mtime = st.st_mtime;
+	record.size = st.st_size;
+
+	return true;
+}
+
 } // namespace
 
 /*
@@ -236,6 +622,13 @@ bool CacheData::write_similarity(GString *gstring) const
 }
 
 void CacheData::save(const gchar *source) const
+{
+	if (options->thumbnails.sim_database && save_database(source)) return;
+
+	save_text(source);
+}
+
+void CacheData::save_text(const gchar *source) const
 {
 	g_autofree gchar *base = cache_create_location(CacheType::SIM, source);
 	if (!base) return;
@@ -415,6 +808,20 @@ bool CacheData::read_similarity(FILE *f, const gchar *buffer, gint s)
 }
 
 bool CacheData::load(const gchar *source)
+{
+	if (!options->thumbnails.sim_database) return load_text(source);
+
+	if (load_database(source)) return true;
+
+	if (!load_text(source)) return false;
+
+	/* migrate the text cache file */
+	save_database(source);
+
+	return true;
+}
+
+bool CacheData::load_text(const gchar *source)
 {
 	g_autofree gchar *path = cache_find_location(CacheType::SIM, source);
 	if (!path) return false;
@@ -461,6 +868,112 @@ bool CacheData::load(const gchar *source)
 	    || similarity;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * sim cache database
+ *-------------------------------------------------------------------
+ */
+
+bool CacheData::load_database(const gchar *source)
+{
+	CacheSimRecord key{};
+	if (!cache_sim_record_key(source, key)) return false;
+
+	CacheSimDbs &cache = cache_sim_dbs();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	CacheSimDb *db = cache_sim_db_get(source, FALSE);
+	if (!db) return false;
+
+	const CacheSimRecord *record = db->find(key.name);
+	if (!record || record->mtime != key.mtime || record->size != key.size) return false;
+
+	if (record->flags & CACHE_SIM_RECORD_DIMENSIONS) set_dimensions({record->width, record->height});
+	if (record->flags & CACHE_SIM_RECORD_DATE) date = record->date;
+	if (record->flags & CACHE_SIM_RECORD_MD5SUM)
+		{
+		Md5Digest digest;
+		std::copy_n(record->md5sum, digest.size(), digest.begin());
+		set_md5sum(digest);
+		}
+	if (record->flags & CACHE_SIM_RECORD_SIMILARITY)
+		{
+		ImageSimilarityData sd{};
+		for (gint i = 0; i < 1024; i++)
+			{
+			sd.avg_r[i] = record->similarity[i * 3];
+			sd.avg_g[i] = record->similarity[i * 3 + 1];
+			sd.avg_b[i] = record->similarity[i * 3 + 2];
+			}
+		sd.filled = TRUE;
+		set_similarity(sd);
+		}
+
+	return record->flags != 0;
+}
+
+bool CacheData::save_database(const gchar *source) const
+{
+	CacheSimRecord record{};
+	if (!cache_sim_record_key(source, record)) return false;
+
+	if (dimensions)
+		{
+		record.flags |= CACHE_SIM_RECORD_DIMENSIONS;
+		record.width = dimensions->width;
+		record.height = dimensions->height;
+		}
+	if (date)
+		{
+		record.flags |= CACHE_SIM_RECORD_DATE;
+		record.date = *date;
+		}
+	if (md5sum)
+		{
+		record.flags |= CACHE_SIM_RECORD_MD5SUM;
+		std::copy(md5sum->begin(), md5sum->end(), record.md5sum);
+		}
+	if (similarity && similarity->filled)
+		{
+		record.flags |= CACHE_SIM_RECORD_SIMILARITY;
+		for (gint i = 0; i < 1024; i++)
+			{
+			record.similarity[i * 3] = similarity->avg_r[i];
+			record.similarity[i * 3 + 1] = similarity->avg_g[i];
+			record.similarity[i * 3 + 2] = similarity->avg_b[i];
+			}
+		}
+
+	CacheSimDbs &cache = cache_sim_dbs();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	CacheSimDb *db = cache_sim_db_get(source, TRUE);
+	if (!db) return false;
+
+	db->put(record);
+
+	if (!cache.flush_id)
+		{
+		cache.flush_id = g_timeout_add_seconds(CACHE_SIM_DB_FLUSH_DELAY, cache_sim_db_flush_cb, nullptr);
+		}
+
+	return true;
+}
+
+/**
+ * @brief Saves and closes all cache databases
+ *
+ * Call before exit, pending records are otherwise saved by a timeout.
+ */
+void cache_sim_data_flush()
+{
+	CacheSimDbs &cache = cache_sim_dbs();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	g_clear_handle_id(&cache.flush_id, g_source_remove);
+	cache.dbs.clear();
+}
+
 /*
  *-------------------------------------------------------------------
  * sim cache setting
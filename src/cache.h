@@ -46,6 +46,9 @@ struct ImageSimilarityData;
 #define GQ_CACHE_EXT_METADATA   ".meta"
 #define GQ_CACHE_EXT_XMP_METADATA   ".gq.xmp"
 
+#define GQ_CACHE_SIM_DB         "sim.gqdb"
+#define GQ_CACHE_METADATA_INDEX "metadata.gqdb"
+
 
 enum class CacheType {
 	THUMB,
@@ -69,6 +72,11 @@ struct CacheData
 	std::unique_ptr<ImageSimilarityData> similarity;
 
 private:
+	bool load_text(const gchar *source);
+	void save_text(const gchar *source) const;
+	bool load_database(const gchar *source);
+	bool save_database(const gchar *source) const;
+
 	bool write_dimensions(GString *gstring) const;
 	bool write_date(GString *gstring) const;
 	bool write_md5sum(GString *gstring) const;
@@ -84,6 +92,7 @@ gboolean cache_time_valid(const gchar *cache, const gchar *path);
 
 CacheData *cache_sim_data_new(const gchar *path);
 void cache_sim_data_free(CacheData *cd);
+void cache_sim_data_flush();
 
 gchar *cache_create_location(CacheType cache_type, const gchar *source);
 gchar *cache_get_location(CacheType cache_type, const gchar *source);
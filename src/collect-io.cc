@@ -43,7 +43,7 @@
 #include "layout-util.h"
 #include "main-defines.h"
 #include "options.h"
-#include "thumb.h"
+#include "thumb-queue.h"
 #include "ui-fileops.h"
 
 #ifdef __NetBSD__
@@ -175,7 +175,6 @@ bool is_file_on_mounted_drive(const gchar *filename)
 
 } // namespace
 
-static void collection_load_thumb_step(CollectionData *cd);
 static gboolean collection_save_private(CollectionData *cd, const gchar *path);
 
 static void collect_manager_entry_reset(CollectManagerEntry *entry);
@@ -438,90 +437,64 @@ gboolean collection_load(CollectionData *cd, const gchar *path, CollectionLoadFl
 	return FALSE;
 }
 
-static void collection_load_thumb_do(CollectionData *cd)
+static gpointer collection_load_thumb_next_cb(FileData **fd, gpointer data)
 {
-	GdkPixbuf *pixbuf;
-
-	if (!cd->thumb_loader || !g_list_find(cd->list, cd->thumb_info)) return;
+	auto cd = static_cast<CollectionData *>(data);
 
-	pixbuf = thumb_loader_get_pixbuf(cd->thumb_loader);
-	collection_info_set_thumb(cd->thumb_info, pixbuf);
-	g_object_unref(pixbuf);
+	/* find first unloaded thumb */
+	for (GList *work = cd->list; work; work = work->next)
+		{
+		auto ci = static_cast<CollectInfo *>(work->data);
 
-	if (cd->info_updated_func) cd->info_updated_func(cd, cd->thumb_info);
-}
+		if (ci->pixbuf || thumb_queue_is_pending(cd->thumb_queue, ci)) continue;
 
-static void collection_load_thumb_error_cb(ThumbLoader *, gpointer data)
-{
-	auto cd = static_cast<CollectionData *>(data);
+		*fd = ci->fd;
+		return ci;
+		}
 
-	collection_load_thumb_do(cd);
-	collection_load_thumb_step(cd);
+	return nullptr;
 }
 
-static void collection_load_thumb_done_cb(ThumbLoader *, gpointer data)
+static void collection_load_thumb_done_cb(GList *results, gpointer data)
 {
 	auto cd = static_cast<CollectionData *>(data);
 
-	collection_load_thumb_do(cd);
-	collection_load_thumb_step(cd);
-}
+	for (GList *work = results; work; work = work->next)
+		{
+		auto result = static_cast<ThumbQueueResult *>(work->data);
+		auto ci = static_cast<CollectInfo *>(result->item);
 
-static void collection_load_thumb_step(CollectionData *cd)
-{
-	GList *work;
-	CollectInfo *ci;
+		if (!g_list_find(cd->list, ci)) continue;
 
-	if (!cd->list)
-		{
-		collection_load_stop(cd);
-		return;
-		}
+		collection_info_set_thumb(ci, result->pixbuf);
 
-	work = cd->list;
-	ci = static_cast<CollectInfo *>(work->data);
-	work = work->next;
-	/* find first unloaded thumb */
-	while (work && ci->pixbuf)
-		{
-		ci = static_cast<CollectInfo *>(work->data);
-		work = work->next;
+		if (cd->info_updated_func) cd->info_updated_func(cd, ci);
 		}
+}
 
-	if (!ci || ci->pixbuf)
-		{
-		/* done */
-		collection_load_stop(cd);
-
-		/* send a NULL CollectInfo to notify end */
-		if (cd->info_updated_func) cd->info_updated_func(cd, nullptr);
+static void collection_load_thumb_finish_cb(gpointer data)
+{
+	auto cd = static_cast<CollectionData *>(data);
 
-		return;
-		}
+	/* done */
+	collection_load_stop(cd);
 
-	/* setup loader and call it */
-	cd->thumb_info = ci;
-	thumb_loader_free(cd->thumb_loader);
-	cd->thumb_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-	thumb_loader_set_callbacks(cd->thumb_loader,
-				   collection_load_thumb_done_cb,
-				   collection_load_thumb_error_cb,
-				   nullptr,
-				   cd);
-
-	/* start it */
-	if (!thumb_loader_start(cd->thumb_loader, ci->fd))
-		{
-		/* error, handle it, do next */
-		DEBUG_1("error loading thumb for %s", ci->fd->path);
-		collection_load_thumb_do(cd);
-		collection_load_thumb_step(cd);
-		}
+	/* send a NULL CollectInfo to notify end */
+	if (cd->info_updated_func) cd->info_updated_func(cd, nullptr);
 }
 
 void collection_load_thumb_idle(CollectionData *cd)
 {
-	if (!cd->thumb_loader) collection_load_thumb_step(cd);
+	if (!cd->thumb_queue)
+		{
+		cd->thumb_queue = thumb_queue_new(options->thumbnails.max_width, options->thumbnails.max_height,
+						  collection_load_thumb_next_cb,
+						  collection_load_thumb_done_cb,
+						  collection_load_thumb_finish_cb,
+						  cd);
+		}
+
+	thumb_queue_start(cd->thumb_queue);
 }
 
 gboolean collection_load_begin(CollectionData *cd, const gchar *path, CollectionLoadFlags flags)
@@ -535,10 +508,10 @@ gboolean collection_load_begin(CollectionData *cd, const gchar *path, Collection
 
 void collection_load_stop(CollectionData *cd)
 {
-	if (!cd->thumb_loader) return;
+	if (!cd->thumb_queue) return;
 
-	thumb_loader_free(cd->thumb_loader);
-	cd->thumb_loader = nullptr;
+	thumb_queue_free(cd->thumb_queue);
+	cd->thumb_queue = nullptr;
 }
 
 static gboolean collection_save_private(CollectionData *cd, const gchar *path)
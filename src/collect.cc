@@ -45,6 +45,7 @@
 #include "options.h"
 #include "pixbuf-util.h"
 #include "print.h"
+#include "thumb-queue.h"
 #include "ui-fileops.h"
 #include "ui-misc.h"
 #include "ui-utildlg.h"
@@ -775,6 +776,7 @@ gboolean collection_remove(CollectionData *cd, FileData *fd)
 	cd->changed = TRUE;
 
 	collection_window_remove(collection_window_find(cd), ci);
+	thumb_queue_cancel_item(cd->thumb_queue, ci);
 	collection_info_free(ci);
 
 	return TRUE;
@@ -788,6 +790,7 @@ static void collection_remove_by_info(CollectionData *cd, CollectInfo *info)
 	cd->changed = (cd->list != nullptr);
 
 	collection_window_remove(collection_window_find(cd), info);
+	thumb_queue_cancel_item(cd->thumb_queue, info);
 	collection_info_free(info);
 }
 
@@ -33,7 +33,7 @@ enum SortType : gint;
 
 struct CollectTable;
 class FileData;
-struct ThumbLoader;
+struct ThumbQueue;
 
 struct CollectInfo
 {
@@ -61,8 +61,7 @@ struct CollectionData
 	GList *list;
 	SortType sort_method;
 
-	ThumbLoader *thumb_loader;
-	CollectInfo *thumb_info;
+	ThumbQueue *thumb_queue;
 
 	using InfoUpdatedFunc = std::function<void(CollectionData *, CollectInfo *)>;
 	InfoUpdatedFunc info_updated_func;
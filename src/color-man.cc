@@ -27,13 +27,19 @@
 /*** color support enabled ***/
 
 #include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 #include <glib-object.h>
 #include <lcms2.h>
 
 #include "intl.h"
-#include "layout.h"
 #include "options.h"
 #include "ui-fileops.h"
 
@@ -59,6 +65,9 @@ struct ColorMan::Cache {
 	gchar *profile_out_file;
 
 	gboolean has_alpha;
+	gint render_intent;
+
+	std::vector<guint16> lut; /**< the transform as a 3D lookup table, empty to use lcms */
 };
 
 ColorMan::Cache::~Cache()
@@ -93,16 +102,218 @@ cmsHPROFILE color_man_create_adobe_comp()
 	return cmsOpenProfileFromMem(ClayRGB1998_icc, ClayRGB1998_icc_len);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * 3D lookup table
+ *-------------------------------------------------------------------
+ */
+
+constexpr gint COLOR_LUT_SIZE = 33;     /**< grid points per axis */
+constexpr gint COLOR_LUT_SHIFT = 15;    /**< entries are 8.7 fixed point, the weights sum to 256 */
+constexpr gint COLOR_LUT_MAX_ERROR = 2; /**< largest difference from lcms accepted for a LUT */
+
+/** @brief Grid cell and position within it of an 8 bit value */
+struct ColorLutAxis
+{
+	gint index;
+	gint frac;      /**< 0 - 256 */
+};
+
+const std::array<ColorLutAxis, 256> &color_lut_axis()
+{
+	static const std::array<ColorLutAxis, 256> axis = []()
+	{
+		std::array<ColorLutAxis, 256> a{};
+
+		for (gint v = 0; v < 256; v++)
+			{
+			const gint pos = ((v * (COLOR_LUT_SIZE - 1) * 256) + 127) / 255;
+
+			a[v] = {pos >> 8, pos & 255};
+			if (a[v].index >= COLOR_LUT_SIZE - 1) a[v] = {COLOR_LUT_SIZE - 2, 256};
+			}
+
+		return a;
+	}();
+
+	return axis;
+}
+
+/** @brief The 4 corners of the grid tetrahedron containing a colour, and their weights */
+struct ColorLutTetra
+{
+	const guint16 *c[4];
+	gint w[4];
+};
+
+inline ColorLutTetra color_lut_tetra(const guint16 *lut, const std::array<ColorLutAxis, 256> &axis,
+                                     guchar r, guchar g, guchar b)
+{
+	constexpr gint dr = 4 * COLOR_LUT_SIZE * COLOR_LUT_SIZE;
+	constexpr gint dg = 4 * COLOR_LUT_SIZE;
+	constexpr gint db = 4;
+
+	const gint fr = axis[r].frac;
+	const gint fg = axis[g].frac;
+	const gint fb = axis[b].frac;
+	const guint16 *c000 = lut + (4 * ((((axis[r].index * COLOR_LUT_SIZE) + axis[g].index) * COLOR_LUT_SIZE) + axis[b].index));
+	const guint16 *c111 = c000 + dr + dg + db;
+
+	if (fr >= fg)
+		{
+		if (fg >= fb) return {{c000, c000 + dr, c000 + dr + dg, c111}, {256 - fr, fr - fg, fg - fb, fb}};
+		if (fr >= fb) return {{c000, c000 + dr, c000 + dr + db, c111}, {256 - fr, fr - fb, fb - fg, fg}};
+		return {{c000, c000 + db, c000 + dr + db, c111}, {256 - fb, fb - fr, fr - fg, fg}};
+		}
+
+	if (fb >= fg) return {{c000, c000 + db, c000 + dg + db, c111}, {256 - fb, fb - fg, fg - fr, fr}};
+	if (fb >= fr) return {{c000, c000 + dg, c000 + dg + db, c111}, {256 - fg, fg - fb, fb - fr, fr}};
+	return {{c000, c000 + dg, c000 + dr + dg, c111}, {256 - fg, fg - fr, fr - fb, fb}};
+}
+
+using ColorLutRowFunc = void (*)(const guint16 *lut, guchar *pix, gint width, gint step);
+
+void color_lut_row_scalar(const guint16 *lut, guchar *pix, gint width, gint step)
+{
+	const auto &axis = color_lut_axis();
+
+	for (gint i = 0; i < width; i++)
+		{
+		const ColorLutTetra t = color_lut_tetra(lut, axis, pix[0], pix[1], pix[2]);
+
+		for (gint c = 0; c < 3; c++)
+			{
+			const gint v = (t.w[0] * t.c[0][c]) + (t.w[1] * t.c[1][c]) + (t.w[2] * t.c[2][c]) + (t.w[3] * t.c[3][c]);
+
+			pix[c] = std::min((v + (1 << (COLOR_LUT_SHIFT - 1))) >> COLOR_LUT_SHIFT, 255);
+			}
+
+		pix += step;
+		}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 /**
- * @brief Retrieves the internal scale factor that maps from window coordinates to the actual device pixels
- * @param  -
- * @returns scale factor
+ * @brief Blends the 4 corners for all channels at once
+ *
+ * The corners are interleaved in pairs, so that one multiply-add of 16 bit
+ * values gives the sum of two weighted corners for each channel.
  */
-gint scale_factor()
+__attribute__((target("sse2")))
+void color_lut_row_sse2(const guint16 *lut, guchar *pix, gint width, gint step)
 {
-	LayoutWindow *lw = get_current_layout();
+	const auto &axis = color_lut_axis();
+	const __m128i round = _mm_set1_epi32(1 << (COLOR_LUT_SHIFT - 1));
 
-	return gtk_widget_get_scale_factor(lw->window);
+	for (gint i = 0; i < width; i++)
+		{
+		const ColorLutTetra t = color_lut_tetra(lut, axis, pix[0], pix[1], pix[2]);
+
+		const __m128i c0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.c[0]));
+		const __m128i c1 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.c[1]));
+		const __m128i c2 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.c[2]));
+		const __m128i c3 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(t.c[3]));
+		const __m128i w01 = _mm_set1_epi32((t.w[1] << 16) | t.w[0]);
+		const __m128i w23 = _mm_set1_epi32((t.w[3] << 16) | t.w[2]);
+
+		__m128i v = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(c0, c1), w01),
+		                          _mm_madd_epi16(_mm_unpacklo_epi16(c2, c3), w23));
+		v = _mm_srai_epi32(_mm_add_epi32(v, round), COLOR_LUT_SHIFT);
+		v = _mm_packs_epi32(v, v);
+		v = _mm_packus_epi16(v, v);
+
+		const guint32 rgb = _mm_cvtsi128_si32(v);
+		pix[0] = rgb & 0xff;
+		pix[1] = (rgb >> 8) & 0xff;
+		pix[2] = (rgb >> 16) & 0xff;
+
+		pix += step;
+		}
+}
+#endif
+
+ColorLutRowFunc color_lut_row_func()
+{
+	static const ColorLutRowFunc func = []()
+	{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2")) return color_lut_row_sse2;
+#endif
+		return color_lut_row_scalar;
+	}();
+
+	return func;
+}
+
+/**
+ * @brief Checks a LUT against the 8 bit lcms transform
+ *
+ * A coarse grid of colours and all greys are compared, where steep
+ * curves near black are most likely to show.
+ */
+gboolean color_lut_check(const std::vector<guint16> &lut, cmsHTRANSFORM transform)
+{
+	std::vector<guchar> expected;
+
+	for (gint r = 0; r < 256; r += 17)
+		for (gint g = 0; g < 256; g += 17)
+			for (gint b = 0; b < 256; b += 17)
+				expected.insert(expected.end(), {static_cast<guchar>(r), static_cast<guchar>(g), static_cast<guchar>(b)});
+	for (gint v = 0; v < 256; v++)
+		expected.insert(expected.end(), {static_cast<guchar>(v), static_cast<guchar>(v), static_cast<guchar>(v)});
+
+	std::vector<guchar> actual = expected;
+	const gint n = expected.size() / 3;
+
+	cmsDoTransform(transform, expected.data(), expected.data(), n);
+	color_lut_row_scalar(lut.data(), actual.data(), n, 3);
+
+	for (size_t i = 0; i < expected.size(); i++)
+		{
+		if (abs(expected[i] - actual[i]) > COLOR_LUT_MAX_ERROR) return FALSE;
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Samples a transform on a COLOR_LUT_SIZE^3 grid
+ * @returns RGBx entries in 8.7 fixed point, or nothing if the LUT would be
+ *          too far from the lcms transform, for example for curves
+ *          that are very steep near black
+ */
+std::vector<guint16> color_lut_new(cmsHPROFILE profile_in, cmsHPROFILE profile_out, gint intent)
+{
+	constexpr gint n = COLOR_LUT_SIZE;
+
+	g_auto(cmsHTRANSFORM) transform = cmsCreateTransform(profile_in, TYPE_RGB_16, profile_out, TYPE_RGB_16, intent, 0);
+	g_auto(cmsHTRANSFORM) transform8 = cmsCreateTransform(profile_in, TYPE_RGB_8, profile_out, TYPE_RGB_8, intent, 0);
+	if (!transform || !transform8) return {};
+
+	std::vector<guint16> grid;
+	grid.reserve(n * n * n * 3);
+	for (gint r = 0; r < n; r++)
+		for (gint g = 0; g < n; g++)
+			for (gint b = 0; b < n; b++)
+				grid.insert(grid.end(), {static_cast<guint16>(r * 65535 / (n - 1)),
+				                         static_cast<guint16>(g * 65535 / (n - 1)),
+				                         static_cast<guint16>(b * 65535 / (n - 1))});
+
+	cmsDoTransform(transform, grid.data(), grid.data(), n * n * n);
+
+	std::vector<guint16> lut(n * n * n * 4, 0);
+	for (gint i = 0; i < n * n * n; i++)
+		for (gint c = 0; c < 3; c++)
+			lut[(4 * i) + c] = ((grid[(3 * i) + c] * (255 * 128)) + 32767) / 65535;
+
+	if (!color_lut_check(lut, transform8))
+		{
+		DEBUG_1("color profile transform is not suitable for a lookup table");
+		return {};
+		}
+
+	return lut;
 }
 
 /*
@@ -189,6 +400,9 @@ ColorManCachePtr color_man_cache_new(ColorManProfileType in_type, const gchar *i
 	cc->profile_out_file = g_strdup(out_file);
 
 	cc->has_alpha = has_alpha;
+	cc->render_intent = options->color_profile.render_intent;
+
+	cc->lut = color_lut_new(cc->profile_in, cc->profile_out, cc->render_intent);
 
 	if (cc->profile_in_type != COLOR_PROFILE_MEM && cc->profile_out_type != COLOR_PROFILE_MEM)
 		{
@@ -211,7 +425,8 @@ ColorManCachePtr color_man_cache_find(ColorManProfileType in_type, const gchar *
 	{
 		bool match = (cc->profile_in_type == in_type &&
 		              cc->profile_out_type == out_type &&
-		              cc->has_alpha == has_alpha);
+		              cc->has_alpha == has_alpha &&
+		              cc->render_intent == options->color_profile.render_intent);
 
 		if (match && cc->profile_in_type == COLOR_PROFILE_FILE)
 			{
@@ -259,16 +474,26 @@ void ColorMan::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
 
 void ColorMan::Cache::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
 {
-	/** @FIXME: region x,y expected to be = 0. Maybe this is not the right place for scaling */
-	const gint scale = scale_factor();
-	region.width = std::min(region.width * scale, gdk_pixbuf_get_width(pixbuf) - region.x);
-	region.height = std::min(region.height * scale, gdk_pixbuf_get_height(pixbuf) - region.y);
+	/* region is in pixbuf pixels, this may run outside the main thread */
+	region.width = std::min(region.width, gdk_pixbuf_get_width(pixbuf) - region.x);
+	region.height = std::min(region.height, gdk_pixbuf_get_height(pixbuf) - region.y);
 
 	const int step = has_alpha ? 4 : 3;
 	guchar *pix = gdk_pixbuf_get_pixels(pixbuf) + (region.x * step);
 
 	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
 
+	if (!lut.empty())
+		{
+		const ColorLutRowFunc lut_row = color_lut_row_func();
+
+		for (int i = 0; i < region.height; i++)
+			{
+			lut_row(lut.data(), pix + ((region.y + i) * rs), region.width, step);
+			}
+		return;
+		}
+
 	for (int i = 0; i < region.height; i++)
 		{
 		guchar *pbuf = pix + ((region.y + i) * rs);
@@ -341,6 +566,14 @@ std::optional<ColorManStatus> ColorMan::get_status() const
 	return profile->get_status();
 }
 
+/**
+ * @returns Whether correct_region() uses the 3D lookup table instead of lcms
+ */
+bool ColorMan::uses_lut() const
+{
+	return !profile->lut.empty();
+}
+
 ColorManStatus ColorMan::Cache::get_status() const
 {
 	return {
@@ -405,6 +638,12 @@ std::optional<ColorManStatus> ColorMan::get_status() const
 	return {};
 }
 
+bool ColorMan::uses_lut() const
+{
+	/* no op */
+	return false;
+}
+
 const gchar *get_profile_name(const guchar *, guint)
 {
 	/* no op */
@@ -52,6 +52,7 @@ struct ColorMan {
 
 	void correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const;
 	std::optional<ColorManStatus> get_status() const;
+	bool uses_lut() const;
 
 private:
 	std::shared_ptr<Cache> profile;
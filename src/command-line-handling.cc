@@ -51,6 +51,7 @@
 #include "options.h"
 #include "pixbuf-renderer.h"
 #include "rcfile.h"
+#include "render-stats.h"
 #include "slideshow.h"
 #include "ui-fileops.h"
 #include "ui-misc.h"
@@ -782,6 +783,13 @@ void gq_get_render_intent(GtkApplication *, GApplicationCommandLine *app_command
 	g_application_command_line_print(app_command_line, "%s\n",  render_intent);
 }
 
+void gq_get_render_stats(GtkApplication *, GApplicationCommandLine *app_command_line, GVariantDict *, GList *)
+{
+	g_autofree gchar *render_stats = render_stats_to_json();
+
+	g_application_command_line_print(app_command_line, "%s\n", render_stats);
+}
+
 void gq_get_selection(GtkApplication *, GApplicationCommandLine *app_command_line, GVariantDict *, GList *)
 {
 	if (!layout_valid(&lw_id)) return;
@@ -1398,6 +1406,7 @@ CommandLineOptionEntry command_line_options[] =
 	{ "get-filelist-recurse",        gq_get_filelist<true>,          PRIMARY_REMOTE, GUI  },
 	{ "get-rectangle",               gq_get_rectangle,               REMOTE        , N_A  },
 	{ "get-render-intent",           gq_get_render_intent,           REMOTE        , N_A  },
+	{ "get-render-stats",            gq_get_render_stats,            REMOTE        , N_A  },
 	{ "get-selection",               gq_get_selection,               REMOTE        , N_A  },
 	{ "get-sidecars",                gq_get_sidecars,                REMOTE        , N_A  },
 	{ "get-window-list",             gq_get_window_list,             REMOTE        , N_A  },
@@ -23,11 +23,15 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
 #include <array>
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <gdk/gdk.h>
 #include <gio/gio.h>
@@ -53,7 +57,7 @@
 #include "options.h"
 #include "print.h"
 #include "similar.h"
-#include "thumb.h"
+#include "thumb-queue.h"
 #include "ui-file-chooser.h"
 #include "ui-fileops.h"
 #include "ui-menu.h"
@@ -97,6 +101,32 @@ struct DupeQueueItem
 	DupeWindow *dw;
 	GList *work; /**< pointer into \a dw->list or \a dw->second_list (#DupeItem) */
 	gint index; /**< The order items pushed onto thread pool. Used to sort returned matches */
+	gint position; /**< Position of \a needle in \a dw->list, used with \a dw->sim_index */
+};
+
+/** Used for checksum threads. One for each file read.
+ */
+struct DupeChecksumJob
+{
+	DupeItem *di; /**< NULL if the item was removed */
+	gchar *path;
+	gboolean sample; /**< Only the start and end of the file */
+	gchar *md5sum; /**< Result, set in the thread pool */
+};
+
+constexpr gsize DUPE_CHECKSUM_SAMPLE_SIZE = 64 * 1024;
+constexpr gint DUPE_CHECKSUM_CACHE_BATCH = 64; /**< Cache files read per idle call */
+
+/** Used for reading similarity data. One for each image being decoded
+ * or having its similarity data filled in the thread pool.
+ */
+struct DupeSimLoader
+{
+	DupeWindow *dw; /**< NULL if cancelled while in the thread pool */
+	DupeItem *di;
+	ImageLoader *il; /**< NULL once decoding has finished */
+	GdkPixbuf *pixbuf;
+	ImageSimilarityData *simd; /**< Filled in the thread pool */
 };
 
 /** Used for similarity checks thread. One for each pair match found.
@@ -138,9 +168,13 @@ static void dupe_match_unlink(DupeItem *a, DupeItem *b);
 static DupeItem *dupe_match_find_parent(DupeWindow *dw, DupeItem *child);
 
 static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast);
+static gdouble dupe_match_sim_threshold(DupeMatchType mask);
 
 static void dupe_thumb_step(DupeWindow *dw);
 static gint dupe_check_cb(gpointer data);
+static gboolean dupe_sim_loader_cancel(DupeWindow *dw, DupeItem *di);
+static gboolean dupe_item_sum_is_unique(const DupeItem *di);
+static void dupe_checksum_jobs_free(DupeWindow *dw);
 
 static void dupe_second_add(DupeWindow *dw, DupeItem *di);
 static void dupe_second_remove(DupeWindow *dw, DupeItem *di);
@@ -201,41 +235,70 @@ static void dupe_comparison_func(gpointer d1, gpointer d2)
 {
 	auto dqi = static_cast<DupeQueueItem *>(d1);
 	auto dw = static_cast<DupeWindow *>(d2);
-	DupeSearchMatch *dsm;
-	DupeItem *di;
 	GList *matches = nullptr;
 	gdouble rank = 0;
+	guint64 candidates = 0;
+	guint64 pairs = 0;
+
+	const auto check = [dqi, &matches, &rank](DupeItem *di)
+	{
+		if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
+			{
+			auto dsm = g_new0(DupeSearchMatch, 1);
+			dsm->a = di;
+			dsm->b = dqi->needle;
+			dsm->rank = rank;
+			matches = g_list_prepend(matches, dsm);
+			dsm->index = dqi->index;
+			}
+	};
 
 	if (!dw->abort)
 		{
-		GList *work = dqi->work;
-		while (work)
+		if (dw->sim_index)
 			{
-			di = static_cast<DupeItem *>(work->data);
+			const gint max_position = dw->second_set ? dw->sim_index->size() - 1 : dqi->position;
+			std::vector<gint> positions = dw->sim_index->candidates(dqi->needle->simd, dupe_match_sim_threshold(dw->match_mask), max_position);
 
-			/* forward for second set, back for simple compare */
-			if (dw->second_set)
-				{
-				work = work->next;
-				}
-			else
-				{
-				work = work->prev;
-				}
+			/* same order as the list walk below */
+			if (!dw->second_set) std::reverse(positions.begin(), positions.end());
 
-			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
+			for (gint position : positions)
 				{
-				dsm = g_new0(DupeSearchMatch, 1);
-				dsm->a = di;
-				dsm->b = dqi->needle;
-				dsm->rank = rank;
-				matches = g_list_prepend(matches, dsm);
-				dsm->index = dqi->index;
+				check(static_cast<DupeItem *>(dw->sim_index->data(position)));
+
+				if (dw->abort)
+					{
+					break;
+					}
 				}
 
-			if (dw->abort)
+			candidates = positions.size();
+			pairs = max_position + 1;
+			}
+		else
+			{
+			GList *work = dqi->work;
+			while (work)
 				{
-				break;
+				auto di = static_cast<DupeItem *>(work->data);
+
+				/* forward for second set, back for simple compare */
+				if (dw->second_set)
+					{
+					work = work->next;
+					}
+				else
+					{
+					work = work->prev;
+					}
+
+				check(di);
+
+				if (dw->abort)
+					{
+					break;
+					}
 				}
 			}
 
@@ -247,6 +310,8 @@ static void dupe_comparison_func(gpointer d1, gpointer d2)
 
 	g_mutex_lock(&dw->thread_count_mutex);
 	dw->thread_count++;
+	dw->sim_candidates += candidates;
+	dw->sim_pairs += pairs;
 	g_mutex_unlock(&dw->thread_count_mutex);
 	g_free(dqi);
 }
@@ -507,7 +572,7 @@ static void dupe_item_write_cache(DupeItem *di)
 	CacheData cd{};
 
 	if (di->width != 0) cd.set_dimensions({di->width, di->height});
-	if (di->md5sum)
+	if (di->md5sum && !dupe_item_sum_is_unique(di))
 		{
 		Md5Digest digest;
 		if (md5_digest_from_text(di->md5sum, digest)) cd.set_md5sum(digest);
@@ -1326,6 +1391,19 @@ static void dupe_match_rank(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
+/**
+ * @brief Returns the minimum similarity for a match, 0.0 to 1.0
+ * @param mask
+ */
+static gdouble dupe_match_sim_threshold(DupeMatchType mask)
+{
+	if (mask & DUPE_MATCH_SIM_HIGH) return 0.95;
+	if (mask & DUPE_MATCH_SIM_MED) return 0.90;
+	if (mask & DUPE_MATCH_SIM_CUSTOM) return static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
+
+	return 0.85;
+}
+
 /**
  * @brief
  * @param[in] a
@@ -1420,12 +1498,7 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 	if (mask & DUPE_MATCH_SIM)
 		{
 		gdouble f;
-		gdouble m;
-
-		if (mask & DUPE_MATCH_SIM_HIGH) m = 0.95;
-		else if (mask & DUPE_MATCH_SIM_MED) m = 0.90;
-		else if (mask & DUPE_MATCH_SIM_CUSTOM) m = static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
-		else m = 0.85;
+		const gdouble m = dupe_match_sim_threshold(mask);
 
 		if (fast)
 			{
@@ -1664,7 +1737,7 @@ static gint dupe_match_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (di1->md5sum[0] == '\0' || di2->md5sum[0] == '\0')
+		if (!di1->md5sum || !di2->md5sum || di1->md5sum[0] == '\0' || di2->md5sum[0] == '\0')
 		    {
 			return -1;
 			}
@@ -1821,14 +1894,16 @@ static void dupe_array_check(DupeWindow *dw)
  * @param dw
  * @param needle
  * @param start
+ * @param position Position of \a needle in \a dw->list
  *
  * Only used for similarity checks.\n
  * Called from dupe_check_cb.
  * Called for each entry in the list.
- * Steps through the list looking for matches against needle.
+ * Steps through the list, or the candidates from \a dw->sim_index,
+ * looking for matches against needle.
  * Pushes a #DupeQueueItem onto thread pool queue.
  */
-static void dupe_list_check_match(DupeWindow *dw, DupeItem *needle, GList *start)
+static void dupe_list_check_match(DupeWindow *dw, DupeItem *needle, GList *start, gint position)
 {
 	GList *work;
 	DupeQueueItem *dqi;
@@ -1851,6 +1926,7 @@ static void dupe_list_check_match(DupeWindow *dw, DupeItem *needle, GList *start
 	dqi->dw = dw;
 	dqi->work = work;
 	dqi->index = dw->queue_count;
+	dqi->position = position;
 	g_thread_pool_push(dw->dupe_comparison_thread_pool, dqi, nullptr);
 }
 
@@ -1877,97 +1953,111 @@ static void dupe_listview_set_thumb(DupeWindow *dw, DupeItem *di, GtkTreeIter *i
 	if (iter) gtk_list_store_set(store, iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
 }
 
-static void dupe_thumb_do(DupeWindow *dw)
+static gdouble dupe_thumb_progress(DupeWindow *dw)
 {
-	DupeItem *di;
+	GtkTreeModel *store;
+	GtkTreeIter iter;
+	gboolean valid;
+	gint row = 0;
+	gint length = 0;
 
-	if (!dw->thumb_loader || !dw->thumb_item) return;
-	di = dw->thumb_item;
+	store = gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview));
+	valid = gtk_tree_model_get_iter_first(store, &iter);
 
-	if (di->pixbuf) g_object_unref(di->pixbuf);
-	di->pixbuf = thumb_loader_get_pixbuf(dw->thumb_loader);
+	while (valid)
+		{
+		DupeItem *di;
 
-	dupe_listview_set_thumb(dw, di, nullptr);
-}
+		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, -1);
+		if (di->pixbuf) row++;
+		length++;
 
-static void dupe_thumb_error_cb(ThumbLoader *, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
+		valid = gtk_tree_model_iter_next(store, &iter);
+		}
 
-	dupe_thumb_do(dw);
-	dupe_thumb_step(dw);
+	return length == 0 ? 0.0 : static_cast<gdouble>(row) / length;
 }
 
-static void dupe_thumb_done_cb(ThumbLoader *, gpointer data)
+static gpointer dupe_thumb_next_cb(FileData **fd, gpointer data)
 {
 	auto dw = static_cast<DupeWindow *>(data);
-
-	dupe_thumb_do(dw);
-	dupe_thumb_step(dw);
-}
-
-static void dupe_thumb_step(DupeWindow *dw)
-{
 	GtkTreeModel *store;
 	GtkTreeIter iter;
-	DupeItem *di = nullptr;
 	gboolean valid;
-	gint row = 0;
-	gint length = 0;
 
 	store = gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview));
 	valid = gtk_tree_model_get_iter_first(store, &iter);
 
-	while (!di && valid)
+	while (valid)
 		{
-		GdkPixbuf *pixbuf;
+		DupeItem *di;
+		g_autoptr(GdkPixbuf) pixbuf = nullptr;
 
-		length++;
 		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, DUPE_COLUMN_THUMB, &pixbuf, -1);
-		if (pixbuf || di->pixbuf)
+		if (!pixbuf)
 			{
-			if (!pixbuf) gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
-			row++;
-			di = nullptr;
+			if (di->pixbuf)
+				{
+				gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
+				}
+			else if (!thumb_queue_is_pending(dw->thumb_queue, di))
+				{
+				*fd = di->fd;
+				return di;
+				}
 			}
 		valid = gtk_tree_model_iter_next(store, &iter);
 		}
-	if (valid)
-		{
-		while (gtk_tree_model_iter_next(store, &iter)) length++;
-		}
 
-	if (!di)
+	return nullptr;
+}
+
+static void dupe_thumb_done_cb(GList *results, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
+
+	for (GList *work = results; work; work = work->next)
 		{
-		dw->thumb_item = nullptr;
-		thumb_loader_free(dw->thumb_loader);
-		dw->thumb_loader = nullptr;
+		auto result = static_cast<ThumbQueueResult *>(work->data);
+		auto di = static_cast<DupeItem *>(result->item);
 
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		return;
+		if (di->pixbuf) g_object_unref(di->pixbuf);
+		di->pixbuf = result->pixbuf ? g_object_ref(result->pixbuf) : nullptr;
+
+		dupe_listview_set_thumb(dw, di, nullptr);
 		}
 
-	dupe_window_update_progress(dw, _("Loading thumbs…"),
-				    length == 0 ? 0.0 : static_cast<gdouble>(row) / length, FALSE);
+	dupe_window_update_progress(dw, _("Loading thumbs…"), dupe_thumb_progress(dw), FALSE);
+}
 
-	dw->thumb_item = di;
-	thumb_loader_free(dw->thumb_loader);
-	dw->thumb_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
+static void dupe_thumb_stop(DupeWindow *dw)
+{
+	thumb_queue_free(dw->thumb_queue);
+	dw->thumb_queue = nullptr;
+}
+
+static void dupe_thumb_finish_cb(gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
 
-	thumb_loader_set_callbacks(dw->thumb_loader,
-				   dupe_thumb_done_cb,
-				   dupe_thumb_error_cb,
-				   nullptr,
-				   dw);
+	dupe_thumb_stop(dw);
 
-	/* start it */
-	if (!thumb_loader_start(dw->thumb_loader, di->fd))
+	dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
+}
+
+static void dupe_thumb_step(DupeWindow *dw)
+{
+	if (!dw->thumb_queue)
 		{
-		/* error, handle it, do next */
-		DEBUG_1("error loading thumb for %s", di->fd->path);
-		dupe_thumb_do(dw);
-		dupe_thumb_step(dw);
+		dw->thumb_queue = thumb_queue_new(options->thumbnails.max_width, options->thumbnails.max_height,
+						  dupe_thumb_next_cb,
+						  dupe_thumb_done_cb,
+						  dupe_thumb_finish_cb,
+						  dw);
 		}
+
+	dupe_window_update_progress(dw, _("Loading thumbs…"), dupe_thumb_progress(dw), FALSE);
+	thumb_queue_start(dw->thumb_queue);
 }
 
 /*
@@ -1976,6 +2066,36 @@ static void dupe_thumb_step(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
+/**
+ * @brief Builds the similarity candidate index
+ * @param dw
+ *
+ * Needles are taken from \a dw->list, so the index is over the items
+ * they are compared with, \a dw->second_list if two sets are used.
+ */
+static void dupe_sim_index_build(DupeWindow *dw)
+{
+	delete dw->sim_index;
+	dw->sim_index = new ImageSimilarityIndex();
+
+	for (GList *work = dw->second_set ? dw->second_list : dw->list; work; work = work->next)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		dw->sim_index->add(di->simd, di);
+		}
+
+	dw->sim_index->build();
+	dw->sim_candidates = 0;
+	dw->sim_pairs = 0;
+}
+
+static void dupe_sim_index_free(DupeWindow *dw)
+{
+	delete dw->sim_index;
+	dw->sim_index = nullptr;
+}
+
 static void dupe_check_stop(DupeWindow *dw)
 {
 	g_clear_handle_id(&dw->idle_id, g_source_remove);
@@ -1991,7 +2111,10 @@ static void dupe_check_stop(DupeWindow *dw)
 	g_list_free(dw->search_matches);
 	dw->search_matches = nullptr;
 
-	if (dw->idle_id || dw->img_loader || dw->thumb_loader)
+	dupe_sim_index_free(dw);
+	dupe_checksum_jobs_free(dw);
+
+	if (dw->idle_id || dw->sim_loaders || dw->thumb_queue)
 		{
 		g_clear_handle_id(&dw->idle_id, g_source_remove);
 		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
@@ -2012,11 +2135,9 @@ static void dupe_check_stop(DupeWindow *dw)
 		widget_set_cursor(dw->listview, -1);
 		}
 
-	thumb_loader_free(dw->thumb_loader);
-	dw->thumb_loader = nullptr;
+	dupe_thumb_stop(dw);
 
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
+	dupe_sim_loader_cancel(dw, nullptr);
 }
 
 static void dupe_check_stop_cb(GtkWidget *, gpointer data)
@@ -2026,28 +2147,74 @@ static void dupe_check_stop_cb(GtkWidget *, gpointer data)
 	dupe_check_stop(dw);
 }
 
-static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+static void dupe_sim_loader_free(DupeSimLoader *dsl)
 {
-	auto dw = static_cast<DupeWindow *>(data);
-	GdkPixbuf *pixbuf;
+	image_loader_free(dsl->il);
+	if (dsl->pixbuf) g_object_unref(dsl->pixbuf);
+	image_sim_free(dsl->simd);
+	g_free(dsl);
+}
 
-	pixbuf = image_loader_get_pixbuf(il);
+/**
+ * @brief Cancels similarity data loads
+ * @param dw
+ * @param di The item to cancel, or NULL for all
+ * @returns TRUE if a load was cancelled
+ *
+ * Loads already in the thread pool are orphaned and freed by
+ * dupe_sim_data_done_cb(). The similarity data of the items is cleared.
+ */
+static gboolean dupe_sim_loader_cancel(DupeWindow *dw, DupeItem *di)
+{
+	gboolean cancelled = FALSE;
+	GList *work = dw->sim_loaders;
 
-	if (dw->setup_point)
+	while (work)
 		{
-		auto di = static_cast<DupeItem *>(dw->setup_point->data);
+		auto dsl = static_cast<DupeSimLoader *>(work->data);
+		GList *link = work;
+		work = work->next;
 
-		if (!di->simd)
+		if (di && dsl->di != di) continue;
+
+		dw->sim_loaders = g_list_delete_link(dw->sim_loaders, link);
+		cancelled = TRUE;
+
+		/* read again when the check is restarted */
+		image_sim_free(dsl->di->simd);
+		dsl->di->simd = nullptr;
+
+		if (dsl->il)
+			{
+			dupe_sim_loader_free(dsl);
+			}
+		else
 			{
-			di->simd = image_sim_new();
+			dsl->dw = nullptr;
 			}
+		}
+
+	return cancelled;
+}
+
+static gboolean dupe_sim_data_done_cb(gpointer data)
+{
+	auto dsl = static_cast<DupeSimLoader *>(data);
+	DupeWindow *dw = dsl->dw;
+
+	if (dw)
+		{
+		DupeItem *di = dsl->di;
 
-		di->simd->fill_data(pixbuf);
+		image_sim_free(di->simd);
+		di->simd = dsl->simd;
+		dsl->simd = nullptr;
 
-		if (di->width == 0 && di->height == 0 && pixbuf)
+		if (di->width == 0 && di->height == 0 && dsl->pixbuf)
 			{
-			di->width = gdk_pixbuf_get_width(pixbuf);
-			di->height = gdk_pixbuf_get_height(pixbuf);
+			di->width = gdk_pixbuf_get_width(dsl->pixbuf);
+			di->height = gdk_pixbuf_get_height(dsl->pixbuf);
+			di->dimensions = (di->width << 16) + di->height;
 			}
 		if (options->thumbnails.enable_caching)
 			{
@@ -2055,12 +2222,95 @@ static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
 			}
 
 		image_sim_alternate_processing(di->simd);
+
+		dw->sim_loaders = g_list_remove(dw->sim_loaders, dsl);
+		if (!dw->idle_id) dw->idle_id = g_idle_add(dupe_check_cb, dw);
 		}
 
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
+	dupe_sim_loader_free(dsl);
 
-	dw->idle_id = g_idle_add(dupe_check_cb, dw);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief The function run in threads for filling similarity data
+ * @param data #DupeSimLoader
+ *
+ * Only the decoded pixbuf and the new similarity data are used here,
+ * the result is handed back to the main thread.
+ */
+static void dupe_sim_data_func(gpointer data, gpointer)
+{
+	auto dsl = static_cast<DupeSimLoader *>(data);
+
+	dsl->simd = image_sim_new();
+	dsl->simd->fill_data(dsl->pixbuf);
+
+	g_idle_add(dupe_sim_data_done_cb, dsl);
+}
+
+static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+{
+	auto dsl = static_cast<DupeSimLoader *>(data);
+	GdkPixbuf *pixbuf;
+
+	pixbuf = image_loader_get_pixbuf(il);
+	if (pixbuf) dsl->pixbuf = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+
+	image_loader_free(dsl->il);
+	dsl->il = nullptr;
+
+	g_thread_pool_push(dsl->dw->dupe_sim_data_thread_pool, dsl, nullptr);
+}
+
+/**
+ * @brief Starts reading the similarity data of an item
+ * @param dw
+ * @param di
+ * @returns FALSE if the image could not be loaded
+ *
+ * Decoding is done by the image loader threads, filling the similarity
+ * data by \a dw->dupe_sim_data_thread_pool.
+ */
+static gboolean dupe_sim_loader_start(DupeWindow *dw, DupeItem *di)
+{
+	auto dsl = g_new0(DupeSimLoader, 1);
+
+	dsl->dw = dw;
+	dsl->di = di;
+	dsl->il = image_loader_new(di->fd);
+	image_loader_set_priority_class(dsl->il, IMAGE_LOADER_PRIORITY_BACKGROUND);
+	image_loader_set_buffer_size(dsl->il, 8);
+	g_signal_connect(G_OBJECT(dsl->il), "error", (GCallback)dupe_loader_done_cb, dsl);
+	g_signal_connect(G_OBJECT(dsl->il), "done", (GCallback)dupe_loader_done_cb, dsl);
+
+	if (!image_loader_start(dsl->il))
+		{
+		dupe_sim_loader_free(dsl);
+		return FALSE;
+		}
+
+	dw->sim_loaders = g_list_prepend(dw->sim_loaders, dsl);
+
+	return TRUE;
+}
+
+static gint dupe_sim_loader_max()
+{
+	return options->threads.duplicates_decoders > 0 ? options->threads.duplicates_decoders : get_cpu_cores();
+}
+
+/**
+ * @brief The threads reading files for checksums
+ *
+ * The reads are disk bound, so no more than one per core, also when
+ * \a options->threads.duplicates is -1 for no limit.
+ */
+static gint dupe_checksum_threads_max()
+{
+	const gint cores = get_cpu_cores();
+
+	return options->threads.duplicates > 0 ? std::min(options->threads.duplicates, cores) : cores;
 }
 
 static void dupe_setup_reset(DupeWindow *dw)
@@ -2083,52 +2333,337 @@ static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
 }
 
 /**
- * @brief Generates the sumcheck or dimensions
- * @param list Set1 or set2
+ * @brief The start of a pass over the items of set1 and set2, see dupe_setup_point_step()
+ * @param dw
+ * @returns The first item of set1, or of set2 if set1 is empty
+ */
+static GList *dupe_setup_first(DupeWindow *dw)
+{
+	if (dw->list) return dw->list;
+
+	return dw->second_set ? dw->second_list : nullptr;
+}
+
+/**
+ * @brief Checks if an item was given a placeholder instead of a checksum
+ * @param di
+ * @returns TRUE if the content of the item can not equal any other item
+ *
+ * See dupe_item_set_unique_sum()
+ */
+static gboolean dupe_item_sum_is_unique(const DupeItem *di)
+{
+	return di->md5sum && di->md5sum[0] == '-';
+}
+
+/**
+ * @brief Sets a placeholder checksum
+ * @param di
+ * @param sample The checksum of the start and end of the file, or NULL
+ *
+ * Used when the file size, or the file size and sample checksum, of
+ * the item are not shared by any other item. The placeholder can not
+ * equal any real checksum, or the placeholder of another item.
+ */
+static void dupe_item_set_unique_sum(DupeItem *di, const gchar *sample)
+{
+	if (sample)
+		{
+		di->md5sum = g_strdup_printf("-%" G_GINT64_FORMAT "-%s", di->fd->size, sample);
+		}
+	else
+		{
+		di->md5sum = g_strdup_printf("-%" G_GINT64_FORMAT, di->fd->size);
+		}
+}
+
+/**
+ * @brief The function run in threads for checksums
+ * @param d1 #DupeChecksumJob
+ * @param d2 #DupeWindow
+ *
+ * If \a dw->abort is set, just increment \a dw->checksum_job_done
+ */
+static void dupe_checksum_func(gpointer d1, gpointer d2)
+{
+	auto job = static_cast<DupeChecksumJob *>(d1);
+	auto dw = static_cast<DupeWindow *>(d2);
+
+	if (!dw->abort)
+		{
+		if (job->sample)
+			{
+			job->md5sum = md5_sample_text_from_file_utf8(job->path, DUPE_CHECKSUM_SAMPLE_SIZE, "");
+			}
+		else
+			{
+			job->md5sum = md5_text_from_file_utf8(job->path, "");
+			}
+		}
+
+	g_mutex_lock(&dw->checksum_job_mutex);
+	g_atomic_int_inc(&dw->checksum_job_done);
+	g_cond_signal(&dw->checksum_job_cond);
+	g_mutex_unlock(&dw->checksum_job_mutex);
+}
+
+static void dupe_checksum_job_free(DupeChecksumJob *job)
+{
+	g_free(job->path);
+	g_free(job->md5sum);
+	g_free(job);
+}
+
+/**
+ * @brief Waits for the checksum thread pool and frees the jobs
+ * @param dw
+ */
+static void dupe_checksum_jobs_free(DupeWindow *dw)
+{
+	g_mutex_lock(&dw->checksum_job_mutex);
+	while (g_atomic_int_get(&dw->checksum_job_done) < dw->checksum_job_count)
+		{
+		g_cond_wait(&dw->checksum_job_cond, &dw->checksum_job_mutex);
+		}
+	g_mutex_unlock(&dw->checksum_job_mutex);
+
+	g_list_free_full(dw->checksum_jobs, reinterpret_cast<GDestroyNotify>(dupe_checksum_job_free));
+	dw->checksum_jobs = nullptr;
+	dw->checksum_job_count = 0;
+	g_atomic_int_set(&dw->checksum_job_done, 0);
+}
+
+static void dupe_checksum_jobs_push(DupeWindow *dw, GList *jobs)
+{
+	dw->checksum_jobs = jobs;
+	dw->checksum_job_count = g_list_length(jobs);
+	g_atomic_int_set(&dw->checksum_job_done, 0);
+
+	for (GList *work = jobs; work; work = work->next)
+		{
+		g_thread_pool_push(dw->dupe_checksum_thread_pool, work->data, nullptr);
+		}
+}
+
+static DupeChecksumJob *dupe_checksum_job_new(DupeItem *di, gboolean sample)
+{
+	auto job = g_new0(DupeChecksumJob, 1);
+
+	job->di = di;
+	job->path = g_strdup(di->fd->path);
+	job->sample = sample;
+
+	return job;
+}
+
+/**
+ * @brief Queues checksums of the start and end of the files
+ * @param dw
+ *
+ * Only files sharing their size with another file of either set need a
+ * checksum, the others get a placeholder. If no other file of that size
+ * has a known checksum, the start and end of large files are compared first.
+ */
+static void dupe_checksum_queue_samples(DupeWindow *dw)
+{
+	GList *list = dupe_setup_first(dw);
+
+	struct SizeGroup
+	{
+		gint count;
+		gboolean known; /**< a checksum from the cache exists */
+	};
+
+	std::unordered_map<gint64, SizeGroup> groups;
+	GList *jobs = nullptr;
+
+	for (GList *work = list; work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		SizeGroup &group = groups[di->fd->size];
+
+		group.count++;
+		if (di->md5sum) group.known = TRUE;
+		}
+
+	for (GList *work = list; work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		if (di->md5sum) continue;
+
+		const SizeGroup &group = groups[di->fd->size];
+
+		if (group.count == 1)
+			{
+			dupe_item_set_unique_sum(di, nullptr);
+			}
+		else if (!group.known && di->fd->size > static_cast<gint64>(2 * DUPE_CHECKSUM_SAMPLE_SIZE))
+			{
+			jobs = g_list_prepend(jobs, dupe_checksum_job_new(di, TRUE));
+			}
+		}
+
+	dupe_checksum_jobs_push(dw, g_list_reverse(jobs));
+}
+
+/**
+ * @brief Queues full checksums of the files of both sets still without one
+ * @param dw
+ *
+ * The results of the sample stage are used first: a file whose size
+ * and sample checksum are not shared by another file gets a placeholder.
+ */
+static void dupe_checksum_queue_full(DupeWindow *dw)
+{
+	GList *list = dupe_setup_first(dw);
+
+	std::unordered_map<std::string, gint> samples;
+	GList *jobs = nullptr;
+
+	const auto sample_key = [](const DupeChecksumJob *job)
+	{
+		return std::to_string(job->di->fd->size) + job->md5sum;
+	};
+
+	for (GList *work = dw->checksum_jobs; work; work = work->next)
+		{
+		auto job = static_cast<DupeChecksumJob *>(work->data);
+		if (job->di && job->md5sum && job->md5sum[0] != '\0') samples[sample_key(job)]++;
+		}
+
+	for (GList *work = dw->checksum_jobs; work; work = work->next)
+		{
+		auto job = static_cast<DupeChecksumJob *>(work->data);
+		if (job->di && job->md5sum && job->md5sum[0] != '\0' && samples[sample_key(job)] == 1)
+			{
+			dupe_item_set_unique_sum(job->di, job->md5sum);
+			}
+		}
+
+	dupe_checksum_jobs_free(dw);
+
+	for (GList *work = list; work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		if (!di->md5sum) jobs = g_list_prepend(jobs, dupe_checksum_job_new(di, FALSE));
+		}
+
+	dupe_checksum_jobs_push(dw, g_list_reverse(jobs));
+}
+
+/**
+ * @brief Stores the results of the full checksum stage
+ * @param dw
+ */
+static void dupe_checksum_store(DupeWindow *dw)
+{
+	for (GList *work = dw->checksum_jobs; work; work = work->next)
+		{
+		auto job = static_cast<DupeChecksumJob *>(work->data);
+		if (!job->di || job->di->md5sum) continue;
+
+		job->di->md5sum = job->md5sum;
+		job->md5sum = nullptr;
+
+		if (options->thumbnails.enable_caching)
+			{
+			dupe_item_write_cache(job->di);
+			}
+		}
+
+	dupe_checksum_jobs_free(dw);
+}
+
+/**
+ * @brief Generates the checksums of set1 and set2
+ * @param dw
  * @returns TRUE/FALSE = not completed/completed
  *
- * Ensures that the DIs contain the MD5SUM or dimensions for all items in
- * the list. One item at a time. Re-enters if not completed.
+ * Reads cached checksums a batch at a time in the idle loop, then
+ * computes the missing ones in \a dw->dupe_checksum_thread_pool, see
+ * #DupeChecksumStage. Both sets are handled in one pass, so files are
+ * grouped by size across the sets. Re-enters if not completed.
  */
-static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
+static gboolean create_checksums(DupeWindow *dw)
 {
-		if ((dw->match_mask & DUPE_MATCH_SUM) ||
-			(dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
-			(dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
+	switch (dw->checksum_stage)
+		{
+		case DUPE_CHECKSUM_CACHE:
 			{
-			/* MD5SUM only */
-			if (!dw->setup_point) dw->setup_point = list; // setup_point clear on 1st entry
+			if (!dw->setup_point) dw->setup_point = dupe_setup_first(dw); // setup_point clear on 1st entry
 
-			while (dw->setup_point)
+			gint count = 0;
+			while (dw->setup_point && count < DUPE_CHECKSUM_CACHE_BATCH)
 				{
 				auto di = static_cast<DupeItem *>(dw->setup_point->data);
 
 				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
 				dw->setup_n++;
 
-				if (!di->md5sum)
+				if (!di->md5sum && options->thumbnails.enable_caching)
 					{
-					dupe_window_update_progress(dw, _("Reading checksums…"),
-						dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count, FALSE);
+					dupe_item_read_cache(di);
+					count++;
+					}
+				}
 
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_read_cache(di);
-						if (di->md5sum)
-							{
-							return TRUE;
-							}
-						}
+			dupe_window_update_progress(dw, _("Reading checksums…"),
+				dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
 
-					di->md5sum = md5_text_from_file_utf8(di->fd->path, "");
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_write_cache(di);
-						}
-					return TRUE;
-					}
+			if (dw->setup_point) return TRUE;
+
+			dupe_checksum_queue_samples(dw);
+			dw->checksum_stage = DUPE_CHECKSUM_SAMPLE;
+			return TRUE;
+			}
+		case DUPE_CHECKSUM_SAMPLE:
+		case DUPE_CHECKSUM_FULL:
+			{
+			const gint done = g_atomic_int_get(&dw->checksum_job_done);
+
+			if (done < dw->checksum_job_count)
+				{
+				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d", _("Reading checksums…"), done, dw->checksum_job_count);
+
+				dupe_window_update_progress(dw, progress_text, static_cast<gdouble>(done) / dw->checksum_job_count, FALSE);
+				return TRUE;
 				}
+
+			if (dw->checksum_stage == DUPE_CHECKSUM_SAMPLE)
+				{
+				dupe_checksum_queue_full(dw);
+				dw->checksum_stage = DUPE_CHECKSUM_FULL;
+				return TRUE;
+				}
+
+			dupe_checksum_store(dw);
+			dw->checksum_stage = DUPE_CHECKSUM_DONE;
 			dupe_setup_reset(dw);
+			return FALSE;
+			}
+		case DUPE_CHECKSUM_DONE:
+		default:
+			return FALSE;
+		}
+}
+
+/**
+ * @brief Generates the sumcheck or dimensions
+ * @param list Set1 or set2
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Ensures that the DIs contain the MD5SUM or dimensions for all items in
+ * the list. Dimensions one item at a time. Re-enters if not completed.
+ */
+static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
+{
+		if ((dw->match_mask & DUPE_MATCH_SUM) ||
+			(dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
+			(dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
+			{
+			/* MD5SUM only, of both sets on the first call */
+			if (create_checksums(dw)) return TRUE;
 			}
 
 		if ((dw->match_mask & DUPE_MATCH_DIM)  )
@@ -2224,7 +2759,10 @@ static gboolean dupe_check_cb(gpointer data)
 		if ((dw->match_mask & DUPE_MATCH_SIM) &&
 		    !(dw->setup_mask & DUPE_MATCH_SIM_MED) )
 			{
-			/* Similarity only */
+			/* Similarity only
+			 * Up to dupe_sim_loader_max() images are decoded at the same time,
+			 * items being loaded are given unfilled similarity data.
+			 */
 			if (!dw->setup_point) dw->setup_point = dw->list;
 
 			while (dw->setup_point)
@@ -2246,26 +2784,29 @@ static gboolean dupe_check_cb(gpointer data)
 							}
 						}
 
-					dw->img_loader = image_loader_new(di->fd);
-					image_loader_set_buffer_size(dw->img_loader, 8);
-					g_signal_connect(G_OBJECT(dw->img_loader), "error", (GCallback)dupe_loader_done_cb, dw);
-					g_signal_connect(G_OBJECT(dw->img_loader), "done", (GCallback)dupe_loader_done_cb, dw);
-
-					if (!image_loader_start(dw->img_loader))
+					if (static_cast<gint>(g_list_length(dw->sim_loaders)) >= dupe_sim_loader_max())
 						{
-						image_sim_free(di->simd);
-						di->simd = image_sim_new();
-						image_loader_free(dw->img_loader);
-						dw->img_loader = nullptr;
-						return G_SOURCE_CONTINUE;
+						/* restarted by dupe_sim_data_done_cb() */
+						dw->idle_id = 0;
+						return G_SOURCE_REMOVE;
 						}
-					dw->idle_id = 0;
-					return G_SOURCE_REMOVE;
+
+					image_sim_free(di->simd);
+					di->simd = image_sim_new();
+					dupe_sim_loader_start(dw, di);
+					return G_SOURCE_CONTINUE;
 					}
 
 				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
 				dw->setup_n++;
 				}
+
+			if (dw->sim_loaders)
+				{
+				/* wait for the last loads, restarted by dupe_sim_data_done_cb() */
+				dw->idle_id = 0;
+				return G_SOURCE_REMOVE;
+				}
 			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SIM_MED);
 			dupe_setup_reset(dw);
 			}
@@ -2275,6 +2816,11 @@ static gboolean dupe_check_cb(gpointer data)
 		dw->setup_done = TRUE;
 		dupe_setup_reset(dw);
 		dw->setup_count = g_list_length(dw->list);
+
+		if (dw->match_mask & DUPE_MATCH_SIM)
+			{
+			dupe_sim_index_build(dw);
+			}
 		}
 
 	/* Setup done - dw->working set to NULL below
@@ -2288,13 +2834,23 @@ static gboolean dupe_check_cb(gpointer data)
 			{
 			if( dw->thread_count < dw->queue_count)
 				{
-				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d", _("Comparing"), dw->thread_count, dw->queue_count);
+				g_mutex_lock(&dw->thread_count_mutex);
+				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d (%s %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT ")",
+				                                                  _("Comparing"), dw->thread_count, dw->queue_count,
+				                                                  _("candidates"), dw->sim_candidates, dw->sim_pairs);
+				g_mutex_unlock(&dw->thread_count_mutex);
 
 				dupe_window_update_progress(dw, progress_text, (gdouble)dw->thread_count / dw->queue_count, TRUE);
 
 				return G_SOURCE_CONTINUE;
 				}
 
+			if (dw->sim_index)
+				{
+				DEBUG_1("similarity candidates: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " pairs compared", dw->sim_candidates, dw->sim_pairs);
+				dupe_sim_index_free(dw);
+				}
+
 			if (dw->search_matches_sorted == nullptr)
 				{
 				dw->search_matches_sorted = g_list_sort(dw->search_matches, sort_func);
@@ -2355,7 +2911,7 @@ static gboolean dupe_check_cb(gpointer data)
 	if (dw->match_mask & DUPE_MATCH_SIM)
 		{
 		/* This is the similarity comparison */
-		dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working);
+		dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working, dw->setup_count - 1 - dw->setup_n);
 		dupe_window_update_progress(dw, _("Queuing…"), dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
 		dw->setup_n++;
 		dw->queue_count++;
@@ -2379,10 +2935,19 @@ static void dupe_check_start(DupeWindow *dw)
 {
 	dw->setup_done = FALSE;
 
+	/* a placeholder is only unique among the items it was set for, so added items need the size pre-filter again */
+	for (GList *work = dupe_setup_first(dw); work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		if (dupe_item_sum_is_unique(di)) g_clear_pointer(&di->md5sum, g_free);
+		}
+
 	dw->setup_count = g_list_length(dw->list);
 	if (dw->second_set) dw->setup_count += g_list_length(dw->second_list);
 
 	dw->setup_mask = DUPE_MATCH_NONE;
+	dw->checksum_stage = DUPE_CHECKSUM_CACHE;
 	dupe_setup_reset(dw);
 
 	dw->working = g_list_last(dw->list);
@@ -2416,24 +2981,28 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 {
 	if (!di) return;
 
+	/* the similarity index refers to the items, so a running comparison is restarted */
+	const gboolean restart = (dw->sim_index != nullptr);
+	if (restart) dupe_check_stop(dw);
+
 	/* handle things that may be in progress… */
 	if (dw->working && dw->working->data == di)
 		{
 		dw->working = dw->working->prev;
 		}
-	if (dw->thumb_loader && dw->thumb_item == di)
-		{
-		dupe_thumb_step(dw);
-		}
+	thumb_queue_cancel_item(dw->thumb_queue, di);
 	if (dw->setup_point && dw->setup_point->data == di)
 		{
 		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-		if (dw->img_loader)
-			{
-			image_loader_free(dw->img_loader);
-			dw->img_loader = nullptr;
-			dw->idle_id = g_idle_add(dupe_check_cb, dw);
-			}
+		}
+	if (dupe_sim_loader_cancel(dw, di) && !dw->idle_id)
+		{
+		dw->idle_id = g_idle_add(dupe_check_cb, dw);
+		}
+	for (GList *work = dw->checksum_jobs; work; work = work->next)
+		{
+		auto job = static_cast<DupeChecksumJob *>(work->data);
+		if (job->di == di) job->di = nullptr;
 		}
 
 	if (di->group && dw->dupes)
@@ -2496,6 +3065,8 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 	dupe_item_free(di);
 
 	dupe_window_update_count(dw, FALSE);
+
+	if (restart) dupe_check_start(dw);
 }
 
 static gboolean dupe_files_add_queue_cb(gpointer data)
@@ -2902,7 +3473,7 @@ static void dupe_display_stats(DupeWindow *dw, DupeItem *di)
 	g_autofree gchar *dimensions_buf = g_strdup_printf("%d x %d", di->width, di->height);
 	dupe_display_label(gd->vbox, "dimensions:", dimensions_buf);
 
-	dupe_display_label(gd->vbox, "md5sum:", (di->md5sum) ? di->md5sum : "not generated");
+	dupe_display_label(gd->vbox, "md5sum:", (di->md5sum && !dupe_item_sum_is_unique(di)) ? di->md5sum : "not generated");
 
 	dupe_display_label(gd->vbox, "thumbprint:", (di->simd) ? "" : "not generated");
 	if (di->simd)
@@ -3810,8 +4381,7 @@ static void dupe_window_show_thumb_cb(GtkWidget *widget, gpointer data)
 		GtkTreeIter iter;
 		gboolean valid;
 
-		thumb_loader_free(dw->thumb_loader);
-		dw->thumb_loader = nullptr;
+		dupe_thumb_stop(dw);
 
 		store = gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview));
 		valid = gtk_tree_model_get_iter_first(store, &iter);
@@ -4106,6 +4676,10 @@ void dupe_window_close(DupeWindow *dw)
 	file_data_unregister_notify_func(dupe_notify_cb, dw);
 
 	g_thread_pool_free(dw->dupe_comparison_thread_pool, TRUE, TRUE);
+	g_thread_pool_free(dw->dupe_sim_data_thread_pool, FALSE, TRUE);
+	g_thread_pool_free(dw->dupe_checksum_thread_pool, TRUE, TRUE);
+	g_mutex_clear(&dw->checksum_job_mutex);
+	g_cond_clear(&dw->checksum_job_cond);
 
 	g_free(dw);
 }
@@ -4522,6 +5096,10 @@ DupeWindow *dupe_window_new()
 	g_mutex_init(&dw->thread_count_mutex);
 	g_mutex_init(&dw->search_matches_mutex);
 	dw->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, dw, options->threads.duplicates, FALSE, nullptr);
+	dw->dupe_sim_data_thread_pool = g_thread_pool_new(dupe_sim_data_func, dw, dupe_sim_loader_max(), FALSE, nullptr);
+	g_mutex_init(&dw->checksum_job_mutex);
+	g_cond_init(&dw->checksum_job_cond);
+	dw->dupe_checksum_thread_pool = g_thread_pool_new(dupe_checksum_func, dw, dupe_checksum_threads_max(), FALSE, nullptr);
 
 	return dw;
 }
@@ -29,9 +29,9 @@
 struct CollectInfo;
 struct CollectionData;
 class FileData;
-struct ImageLoader;
 struct ImageSimilarityData;
-struct ThumbLoader;
+class ImageSimilarityIndex;
+struct ThumbQueue;
 
 /** @enum DupeMatchType
  *  match methods
@@ -63,6 +63,17 @@ enum DupeSelectType : guint
 	DUPE_SELECT_GROUP2
 };
 
+/** @enum DupeChecksumStage
+ *  stages of reading checksums before a check
+ */
+enum DupeChecksumStage
+{
+	DUPE_CHECKSUM_CACHE,	/**< reading cached checksums */
+	DUPE_CHECKSUM_SAMPLE,	/**< checksums of the start and end of files of equal size */
+	DUPE_CHECKSUM_FULL,	/**< checksums of the files which may be equal */
+	DUPE_CHECKSUM_DONE
+};
+
 struct DupeItem
 {
 	CollectionData *collection;	/**< NULL if from #DupeWindow->files */
@@ -126,10 +137,10 @@ struct DupeWindow
 
 	DupeItem *click_item;		/**< for popup menu */
 
-	ThumbLoader *thumb_loader;
-	DupeItem *thumb_item;
+	ThumbQueue *thumb_queue;
 
-	ImageLoader *img_loader;
+	GList *sim_loaders; /**< Similarity data being read, at most \a options->threads.duplicates_decoders (#DupeSimLoader) */
+	GThreadPool *dupe_sim_data_thread_pool; /**< Fills similarity data from the decoded images */
 
 	GtkTreeSortable *sortable;
 	gint set_count; /**< Index/counter for number of duplicate sets found */
@@ -154,7 +165,19 @@ struct DupeWindow
 	gint queue_count; /**< Incremented each time an item is pushed onto the similarity thread pool */
 	gint thread_count; /**< Incremented each time a similarity check thread item is completed */
 	GMutex thread_count_mutex;
-	gboolean abort; /**< Stop the similarity check thread queue */
+	gboolean abort; /**< Stop the similarity check and checksum thread queues */
+	ImageSimilarityIndex *sim_index; /**< Candidate pruning over \a list, or \a second_list if two sets */
+	guint64 sim_candidates; /**< Number of comparisons made via \a sim_index, protected by \a thread_count_mutex */
+	guint64 sim_pairs; /**< Number of comparisons without pruning, protected by \a thread_count_mutex */
+
+	/* required for checksum threads */
+	GThreadPool *dupe_checksum_thread_pool;
+	DupeChecksumStage checksum_stage;
+	GList *checksum_jobs; /**< Jobs of the current stage (#DupeChecksumJob) */
+	gint checksum_job_count; /**< Number of jobs pushed onto the checksum thread pool */
+	gint checksum_job_done; /**< Number of jobs completed, atomic, signalled by \a checksum_job_cond */
+	GMutex checksum_job_mutex;
+	GCond checksum_job_cond;
 };
 
 
@@ -20,27 +20,44 @@
 
 #include "filecache.h"
 
+#include <unordered_map>
+
 #include <config.h>
 
 #include "filedata.h"
 
 /* this implements a simple LRU algorithm */
 
+namespace
+{
+
+struct FileCacheEntry {
+	FileData *fd;
+	gulong size;
+	FileCacheEntry *prev; /**< more recently used */
+	FileCacheEntry *next; /**< less recently used */
+};
+
+} // namespace
+
+/**
+ * @brief The entries are indexed by FileData and kept in a doubly linked
+ * list, most recently used first, so that lookups, moves to the front and
+ * evictions do not depend on the number of entries.
+ */
 struct FileCacheData {
 	FileCacheReleaseFunc release;
-	GList *list;
+	std::unordered_map<const FileData *, FileCacheEntry *> index;
+	FileCacheEntry *head; /**< most recently used */
+	FileCacheEntry *tail; /**< least recently used */
 	gulong max_size;
 	gulong size;
+	FileCacheStats stats;
 };
 
 namespace
 {
 
-struct FileCacheEntry {
-	FileData *fd;
-	gulong size;
-};
-
 #ifdef DEBUG
 constexpr bool debug_file_cache = false; /* Set to true to add file cache dumps to the debug output */
 
@@ -48,12 +65,12 @@ void file_cache_dump(FileCacheData *fc)
 {
 	if (!debug_file_cache) return;
 
-	DEBUG_1("cache dump: fc=%p max size:%lu size:%lu", (void *)fc, fc->max_size, fc->size);
+	DEBUG_1("cache dump: fc=%p max size:%lu size:%lu hits:%" G_GUINT64_FORMAT " misses:%" G_GUINT64_FORMAT " evictions:%" G_GUINT64_FORMAT,
+	        (void *)fc, fc->max_size, fc->size, fc->stats.hits, fc->stats.misses, fc->stats.evictions);
 
 	gulong n = 0;
-	for (GList *work = fc->list; work; work = work->next)
+	for (FileCacheEntry *fe = fc->head; fe; fe = fe->next)
 		{
-		auto fe = static_cast<FileCacheEntry *>(work->data);
 		DEBUG_1("cache entry: fc=%p [%lu] %s %lu", (void *)fc, ++n, fe->fd->path, fe->size);
 		}
 }
@@ -61,18 +78,37 @@ void file_cache_dump(FileCacheData *fc)
 #  define file_cache_dump(fc)
 #endif
 
-gint file_cache_entry_compare_fd(const FileCacheEntry *fe, const FileData *fd)
+FileCacheEntry *file_cache_find(FileCacheData *fc, const FileData *fd)
+{
+	auto it = fc->index.find(fd);
+
+	return it != fc->index.end() ? it->second : nullptr;
+}
+
+void file_cache_unlink(FileCacheData *fc, FileCacheEntry *fe)
 {
-	return (fe->fd == fd) ? 0 : 1;
+	if (fe->prev) fe->prev->next = fe->next; else fc->head = fe->next;
+	if (fe->next) fe->next->prev = fe->prev; else fc->tail = fe->prev;
+
+	fe->prev = nullptr;
+	fe->next = nullptr;
 }
 
-void file_cache_remove_entry(FileCacheData *fc, GList *link)
+void file_cache_link_front(FileCacheData *fc, FileCacheEntry *fe)
 {
-	auto *fe = static_cast<FileCacheEntry *>(link->data);
+	fe->prev = nullptr;
+	fe->next = fc->head;
+
+	if (fc->head) fc->head->prev = fe; else fc->tail = fe;
+	fc->head = fe;
+}
 
+void file_cache_remove_entry(FileCacheData *fc, FileCacheEntry *fe)
+{
 	DEBUG_1("cache remove: fc=%p %s", (void *)fc, fe->fd->path);
 
-	fc->list = g_list_delete_link(fc->list, link);
+	file_cache_unlink(fc, fe);
+	fc->index.erase(fe->fd);
 	fc->size -= fe->size;
 	fc->release(fe->fd);
 	file_data_unref(fe->fd);
@@ -89,22 +125,20 @@ void file_cache_notify_cb(FileData *fd, NotifyType type, gpointer data)
 	auto *fc = static_cast<FileCacheData *>(data);
 	file_cache_dump(fc);
 
-	GList *work = g_list_find_custom(fc->list, fd, reinterpret_cast<GCompareFunc>(file_cache_entry_compare_fd));
-	if (!work) return;
+	FileCacheEntry *fe = file_cache_find(fc, fd);
+	if (!fe) return;
 
-	file_cache_remove_entry(fc, work);
+	file_cache_remove_entry(fc, fe);
 }
 
 void file_cache_shrink_to_max_size(FileCacheData *fc)
 {
 	file_cache_dump(fc);
 
-	GList *work = g_list_last(fc->list);
-	while (fc->size > fc->max_size && work)
+	while (fc->size > fc->max_size && fc->tail)
 		{
-		GList *prev = work->prev;
-		file_cache_remove_entry(fc, work);
-		work = prev;
+		fc->stats.evictions++;
+		file_cache_remove_entry(fc, fc->tail);
 		}
 }
 
@@ -112,12 +146,14 @@ void file_cache_shrink_to_max_size(FileCacheData *fc)
 
 FileCacheData *file_cache_new(FileCacheReleaseFunc release, gulong max_size)
 {
-	auto fc = g_new(FileCacheData, 1);
+	auto fc = new FileCacheData();
 
 	fc->release = release;
-	fc->list = nullptr;
+	fc->head = nullptr;
+	fc->tail = nullptr;
 	fc->max_size = max_size;
 	fc->size = 0;
+	fc->stats = {};
 
 	file_data_register_notify_func(file_cache_notify_cb, fc, NOTIFY_PRIORITY_HIGH);
 
@@ -128,10 +164,11 @@ gboolean file_cache_get(FileCacheData *fc, FileData *fd)
 {
 	g_assert(fc && fd);
 
-	GList *work = g_list_find_custom(fc->list, fd, reinterpret_cast<GCompareFunc>(file_cache_entry_compare_fd));
-	if (!work)
+	FileCacheEntry *fe = file_cache_find(fc, fd);
+	if (!fe)
 		{
 		DEBUG_2("cache miss: fc=%p %s", (void *)fc, fd->path);
+		fc->stats.misses++;
 		return FALSE;
 		}
 
@@ -139,11 +176,11 @@ gboolean file_cache_get(FileCacheData *fc, FileData *fd)
 	DEBUG_2("cache hit: fc=%p %s", (void *)fc, fd->path);
 
 	/* move it to the beginning, if needed */
-	if (work != fc->list)
+	if (fe != fc->head)
 		{
 		DEBUG_2("cache move to front: fc=%p %s", (void *)fc, fd->path);
-		fc->list = g_list_remove_link(fc->list, work);
-		fc->list = g_list_concat(work, fc->list);
+		file_cache_unlink(fc, fe);
+		file_cache_link_front(fc, fe);
 		}
 
 	if (file_data_check_changed_files(fd))
@@ -151,12 +188,14 @@ gboolean file_cache_get(FileCacheData *fc, FileData *fd)
 		/* file has been changed, cache entry is no longer valid */
 		/* note that it may have already been evicted from the cache! */
 		file_cache_dump(fc);
-		work = g_list_find_custom(fc->list, fd, reinterpret_cast<GCompareFunc>(file_cache_entry_compare_fd));
-		if (work) file_cache_remove_entry(fc, work);
+		fe = file_cache_find(fc, fd);
+		if (fe) file_cache_remove_entry(fc, fe);
 
+		fc->stats.misses++;
 		return FALSE;
 		}
 
+	fc->stats.hits++;
 	file_cache_dump(fc);
 	return TRUE;
 }
@@ -165,13 +204,14 @@ void file_cache_put(FileCacheData *fc, FileData *fd, gulong size)
 {
 	FileCacheEntry *fe;
 
-	if (file_cache_get(fc, fd)) return;
+	if (file_cache_find(fc, fd)) return;
 
 	DEBUG_2("cache add: fc=%p %s", (void *)fc, fd->path);
 	fe = g_new(FileCacheEntry, 1);
 	fe->fd = file_data_ref(fd);
 	fe->size = size;
-	fc->list = g_list_prepend(fc->list, fe);
+	file_cache_link_front(fc, fe);
+	fc->index.emplace(fe->fd, fe);
 	fc->size += size;
 
 	file_cache_shrink_to_max_size(fc);
@@ -182,4 +222,9 @@ void file_cache_set_max_size(FileCacheData *fc, gulong size)
 	fc->max_size = size;
 	file_cache_shrink_to_max_size(fc);
 }
+
+FileCacheStats file_cache_get_stats(const FileCacheData *fc)
+{
+	return fc->stats;
+}
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
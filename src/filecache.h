@@ -28,10 +28,17 @@ class FileData;
 
 using FileCacheReleaseFunc = void (*)(FileData *);
 
+struct FileCacheStats {
+	guint64 hits;
+	guint64 misses; /**< including entries found invalid */
+	guint64 evictions; /**< entries removed to stay within the max size */
+};
+
 FileCacheData *file_cache_new(FileCacheReleaseFunc release, gulong max_size);
 gboolean file_cache_get(FileCacheData *fc, FileData *fd);
 void file_cache_put(FileCacheData *fc, FileData *fd, gulong size);
 void file_cache_set_max_size(FileCacheData *fc, gulong size);
+FileCacheStats file_cache_get_stats(const FileCacheData *fc);
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <mutex>
+#include <vector>
 #include <sys/types.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -44,7 +45,6 @@ struct HistMap;
 
 #ifdef FD_VERBOSE_DEBUG
 #include <sstream>
-#include <vector>
 #endif
 
 #define FD_MAGICK 0x12345678u
@@ -86,7 +86,7 @@ enum NotifyPriority {
 enum NotifyType : gint {
 	NOTIFY_MARKS		= 1 << 1, /**< changed marks */
 	NOTIFY_PIXBUF		= 1 << 2, /**< image was read into fd->pixbuf */
-	NOTIFY_HISTMAP		= 1 << 3, /**< histmap was read into fd->histmap */
+	NOTIFY_HISTMAP		= 1 << 3, /**< more of fd->histmap was counted */
 	NOTIFY_ORIENTATION	= 1 << 4, /**< image was rotated */
 	NOTIFY_METADATA		= 1 << 5, /**< changed image metadata, not yet written */
 	NOTIFY_GROUPING		= 1 << 6, /**< change in fd->sidecar_files or fd->parent */
@@ -457,6 +457,27 @@ class FileData::FileList
 	static gint sort_compare_filedata_full(const FileData *fa, const FileData *fb, SortType method, gboolean ascend);
 	static GList *sort(GList *list, SortSettings settings);
 
+	/**
+	 * @brief A file with the start of its sort order, as sorted by sort_keys()
+	 *
+	 * Comparing the keys gives the order of sort_compare_filedata() without
+	 * following the FileData, unless the starts of the keys are equal.
+	 */
+	struct SortKey
+	{
+		guint64 primary; /**< value of the sort method, or start of its collate key, 0 if sorted by name */
+		guint64 name;    /**< start of the collate key of the name */
+		const FileData *fd;
+		gpointer data;   /**< item of the file, in the sorted order after sort_keys() */
+	};
+	using SortKeys = std::vector<SortKey>;
+	using SortFileFunc = const FileData *(*)(gconstpointer data);
+
+	static SortKey sort_key(const FileData *fd, gpointer data, const SortSettings &settings);
+	static void sort_keys(SortKeys &keys, SortSettings settings);
+	static void sort(std::vector<FileData *> &files, SortSettings settings);
+	static GList *sort_full(GList *list, SortSettings settings, SortFileFunc file_func);
+
 	static gboolean read_list(FileData *dir_fd, GList **files, GList **dirs);
 	static gboolean read_list_lstat(FileData *dir_fd, GList **files, GList **dirs);
 	static void free_list(GList *list);
@@ -471,11 +492,12 @@ class FileData::FileList
 	static GList *recursive(FileData *dir_fd);
 	static GList *recursive_full(FileData *dir_fd, SortSettings settings);
 
+	struct DirScan; // Raw directory contents, defined in filelist.cc.
+
     protected:
 	static GList *filter_out_sidecars(GList *flist);
-	static gboolean is_hidden_file(const gchar *filepath);
 	static gboolean read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks);
-	static gint sort_file_cb(gconstpointer a, gconstpointer b, gpointer data);
+	static void read_list_from_scan(const DirScan &scan, GList **files, GList **dirs);
 	static gint sort_path_cb(gconstpointer a, gconstpointer b);
 	static void recursive_append(GList **list, GList *dirs);
 	static void recursive_append_full(GList **list, GList *dirs, SortSettings settings);
@@ -27,23 +27,32 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 #include <glib-object.h>
 #include <pwd.h>
 
 #include <config.h>
 
+#if HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
+
 #include "cache.h"
 #include "exif.h"
 #include "filefilter.h"
 #include "histogram.h"
 #include "intl.h"
 #include "main-defines.h"
+#include "metadata-index.h"
 #include "metadata.h"
 #include "options.h"
 #include "trash.h"
@@ -471,6 +480,13 @@ void FileData::read_exif_time_data(FileData *file)
 		return;
 		}
 
+	MetadataIndexEntry entry;
+	if (metadata_index_get(file, entry) && (entry.fields & METADATA_INDEX_DATE))
+		{
+		file->exifdate = entry.date;
+		return;
+		}
+
 	if (!file->exif)
 		{
 		exif_read_fd(file);
@@ -488,6 +504,10 @@ void FileData::read_exif_time_data(FileData *file)
 
 			file->exifdate = mktime(&time_str);
 			}
+
+		entry.fields |= METADATA_INDEX_DATE;
+		entry.date = file->exifdate;
+		metadata_index_put(file, entry);
 		}
 }
 
@@ -499,6 +519,13 @@ void FileData::read_exif_time_digitized_data(FileData *file)
 		return;
 		}
 
+	MetadataIndexEntry entry;
+	if (metadata_index_get(file, entry) && (entry.fields & METADATA_INDEX_DATE_DIGITIZED))
+		{
+		file->exifdate_digitized = entry.date_digitized;
+		return;
+		}
+
 	if (!file->exif)
 		{
 		exif_read_fd(file);
@@ -516,11 +543,22 @@ void FileData::read_exif_time_digitized_data(FileData *file)
 
 			file->exifdate_digitized = mktime(&time_str);
 			}
+
+		entry.fields |= METADATA_INDEX_DATE_DIGITIZED;
+		entry.date_digitized = file->exifdate_digitized;
+		metadata_index_put(file, entry);
 		}
 }
 
 void FileData::read_rating_data(FileData *file)
 {
+	MetadataIndexEntry entry;
+	if (metadata_index_get(file, entry) && (entry.fields & METADATA_INDEX_RATING))
+		{
+		file->rating = entry.rating;
+		return;
+		}
+
 	g_autofree gchar *rating_str = metadata_read_string(file, RATING_KEY, METADATA_PLAIN);
 
 	if (rating_str)
@@ -531,6 +569,10 @@ void FileData::read_rating_data(FileData *file)
 		{
 		file->rating = 0;
 		}
+
+	entry.fields |= METADATA_INDEX_RATING;
+	entry.rating = file->rating;
+	metadata_index_put(file, entry);
 }
 
 FileData *FileData::file_data_new_no_grouping(const gchar *path_utf8, FileDataContext *context)
@@ -2774,9 +2816,25 @@ void FileData::file_data_send_notification(FileData *fd, NotifyType type)
 		}
 }
 
-static GHashTable *file_data_monitor_pool = nullptr;
+/*
+ *-----------------------------------------------------------------------------
+ * real time monitor
+ *
+ * With inotify the folder of each monitored FileData is watched, and the
+ * events of a short interval are collected before the FileData of the
+ * changed paths are checked, so only those send notifications. FileData
+ * which can not be watched are checked by a poll, as are those on network
+ * file systems, where changes made by other hosts are not reported, and
+ * those of a folder which was removed or moved while watched.
+ *-----------------------------------------------------------------------------
+ */
+
+static GHashTable *file_data_monitor_pool = nullptr; /**< FileData -> count of registrations */
+static GHashTable *realtime_monitor_polled = nullptr; /**< FileData of file_data_monitor_pool which are not watched */
 static guint realtime_monitor_id = 0; /* event source id */
 
+constexpr guint REALTIME_MONITOR_POLL_INTERVAL = 5000; /**< ms */
+
 static void realtime_monitor_check_cb(gpointer key, gpointer, gpointer)
 {
 	auto fd = static_cast<FileData *>(key);
@@ -2789,10 +2847,290 @@ static void realtime_monitor_check_cb(gpointer key, gpointer, gpointer)
 static gboolean realtime_monitor_cb(gpointer)
 {
 	if (options->update_on_time_change)
+		g_hash_table_foreach(realtime_monitor_polled, realtime_monitor_check_cb, nullptr);
+	return G_SOURCE_CONTINUE;
+}
+
+#if HAVE_INOTIFY
+namespace
+{
+
+constexpr guint REALTIME_MONITOR_DELAY = 200; /**< ms to collect events before checking the files */
+constexpr guint32 REALTIME_MONITOR_EVENTS = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                            IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO;
+
+struct RealtimeMonitorDir
+{
+	gint wd;
+	gint count; /**< watched FileData in or of the folder */
+};
+
+struct RealtimeMonitorWatch
+{
+	gint inotify_fd = -1;
+	guint io_id = 0; /* event source id */
+	guint check_id = 0; /* event source id */
+
+	std::unordered_map<std::string, RealtimeMonitorDir> dirs; /**< by utf8 path */
+	std::unordered_map<gint, std::string> paths; /**< utf8 path of the folder by watch descriptor */
+	std::unordered_map<FileData *, std::string> watched; /**< folder of each watched FileData, as when registered */
+
+	std::set<std::string> changed; /**< utf8 paths to check */
+	std::set<std::string> reread; /**< utf8 paths of folders with files added or removed */
+	gboolean overflow = FALSE; /**< events were lost, all FileData are checked */
+};
+
+RealtimeMonitorWatch &realtime_monitor_watch()
+{
+	static RealtimeMonitorWatch watch;
+
+	return watch;
+}
+
+gboolean realtime_monitor_check_changed_cb(gpointer)
+{
+	RealtimeMonitorWatch &watch = realtime_monitor_watch();
+
+	watch.check_id = 0;
+
+	const std::set<std::string> changed = std::move(watch.changed);
+	const std::set<std::string> reread = std::move(watch.reread);
+	const gboolean overflow = watch.overflow;
+
+	watch.changed.clear();
+	watch.reread.clear();
+	watch.overflow = FALSE;
+
+	if (!options->update_on_time_change) return G_SOURCE_REMOVE;
+
+	if (overflow)
+		{
 		g_hash_table_foreach(file_data_monitor_pool, realtime_monitor_check_cb, nullptr);
+		}
+
+	GHashTable *file_data_pool = GlobalFileDataContext::get_instance().context().file_data_pool;
+
+	for (const std::string &path : changed)
+		{
+		/* without a FileData nothing shows the file */
+		auto fd = static_cast<FileData *>(g_hash_table_lookup(file_data_pool, path.c_str()));
+		if (!fd) continue;
+
+		DEBUG_1("monitor event %s", fd->path);
+
+		/* a notification may drop the last other reference */
+		file_data_ref(fd);
+
+		/* the modification time of the folder has a resolution of a second, so it may not have changed since the last check */
+		if (!file_data_check_changed_files(fd) && reread.count(path))
+			{
+			file_data_increment_version(fd);
+			file_data_send_notification(fd, NOTIFY_REREAD);
+			}
+
+		file_data_unref(fd);
+		}
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Polls the FileData of the folder @a dir, which is no longer watched
+ */
+void realtime_monitor_dir_poll(RealtimeMonitorWatch &watch, const std::string &dir)
+{
+	for (auto it = watch.watched.begin(); it != watch.watched.end();)
+		{
+		if (it->second == dir)
+			{
+			g_hash_table_add(realtime_monitor_polled, it->first);
+			it = watch.watched.erase(it);
+			}
+		else
+			{
+			++it;
+			}
+		}
+
+	auto it = watch.dirs.find(dir);
+	if (it != watch.dirs.end())
+		{
+		watch.paths.erase(it->second.wd);
+		watch.dirs.erase(it);
+		}
+
+	if (!realtime_monitor_id)
+		{
+		realtime_monitor_id = g_timeout_add(REALTIME_MONITOR_POLL_INTERVAL, realtime_monitor_cb, nullptr);
+		}
+}
+
+void realtime_monitor_event(RealtimeMonitorWatch &watch, const struct inotify_event *event)
+{
+	if (event->mask & IN_Q_OVERFLOW)
+		{
+		watch.overflow = TRUE;
+		return;
+		}
+
+	auto it = watch.paths.find(event->wd);
+	if (it == watch.paths.end()) return;
+
+	const std::string dir = it->second;
+
+	if (event->mask & (IN_IGNORED | IN_MOVE_SELF))
+		{
+		/* the folder is gone, or its events would be reported under the old path */
+		if (event->mask & IN_MOVE_SELF) inotify_rm_watch(watch.inotify_fd, event->wd);
+
+		realtime_monitor_dir_poll(watch, dir);
+		watch.changed.insert(dir);
+		return;
+		}
+
+	if (event->len == 0 || event->name[0] == '\0')
+		{
+		watch.changed.insert(dir);
+		return;
+		}
+
+	g_autofree gchar *name = path_to_utf8(event->name);
+	g_autofree gchar *path = g_build_filename(dir.c_str(), name, nullptr);
+	watch.changed.insert(path);
+
+	/* the folder is read again, a new file has no FileData to check */
+	if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+		{
+		watch.changed.insert(dir);
+		watch.reread.insert(dir);
+		}
+}
+
+gboolean realtime_monitor_io_cb(GIOChannel *, GIOCondition, gpointer)
+{
+	RealtimeMonitorWatch &watch = realtime_monitor_watch();
+	alignas(struct inotify_event) gchar buf[4096];
+
+	ssize_t len;
+	while ((len = read(watch.inotify_fd, buf, sizeof(buf))) > 0)
+		{
+		gchar *p = buf;
+		while (p < buf + len)
+			{
+			const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+
+			realtime_monitor_event(watch, event);
+			p += sizeof(struct inotify_event) + event->len;
+			}
+		}
+
+	if ((!watch.changed.empty() || watch.overflow) && !watch.check_id)
+		{
+		watch.check_id = g_timeout_add(REALTIME_MONITOR_DELAY, realtime_monitor_check_changed_cb, nullptr);
+		}
+
+	/* the last watched folders are gone */
+	if (watch.dirs.empty())
+		{
+		close(watch.inotify_fd);
+		watch.inotify_fd = -1;
+		watch.io_id = 0;
+		return G_SOURCE_REMOVE;
+		}
+
 	return G_SOURCE_CONTINUE;
 }
 
+/**
+ * @brief Watches the folder of @a fd, or the folder @a fd is
+ * @returns FALSE if @a fd has to be polled
+ */
+gboolean realtime_monitor_watch_add(FileData *fd)
+{
+	RealtimeMonitorWatch &watch = realtime_monitor_watch();
+	g_autofree gchar *dir = S_ISDIR(fd->mode) ? g_strdup(fd->path) : remove_level_from_path(fd->path);
+
+	auto it = watch.dirs.find(dir);
+	if (it != watch.dirs.end())
+		{
+		it->second.count++;
+		watch.watched[fd] = dir;
+		return TRUE;
+		}
+
+	g_autofree gchar *dir_local = path_from_utf8(dir);
+	if (is_remote_file(dir_local)) return FALSE;
+
+	if (watch.inotify_fd == -1)
+		{
+		watch.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (watch.inotify_fd == -1)
+			{
+			log_printf("inotify is not available: %s\n", g_strerror(errno));
+			return FALSE;
+			}
+
+		GIOChannel *channel = g_io_channel_unix_new(watch.inotify_fd);
+		watch.io_id = g_io_add_watch(channel, G_IO_IN, realtime_monitor_io_cb, nullptr);
+		g_io_channel_unref(channel);
+		}
+
+	const gint wd = inotify_add_watch(watch.inotify_fd, dir_local, REALTIME_MONITOR_EVENTS);
+	if (wd == -1)
+		{
+		DEBUG_1("Cannot watch %s: %s", dir, g_strerror(errno));
+		return FALSE;
+		}
+
+	/* another path of the same folder, its events would be reported for one of them */
+	if (watch.paths.count(wd)) return FALSE;
+
+	watch.dirs[dir] = {wd, 1};
+	watch.paths[wd] = dir;
+	watch.watched[fd] = dir;
+
+	return TRUE;
+}
+
+void realtime_monitor_watch_remove(FileData *fd)
+{
+	RealtimeMonitorWatch &watch = realtime_monitor_watch();
+
+	auto watched = watch.watched.find(fd);
+	if (watched == watch.watched.end()) return;
+
+	auto it = watch.dirs.find(watched->second);
+	watch.watched.erase(watched);
+	if (it == watch.dirs.end() || --it->second.count > 0) return;
+
+	inotify_rm_watch(watch.inotify_fd, it->second.wd);
+	watch.paths.erase(it->second.wd);
+	watch.dirs.erase(it);
+
+	if (watch.dirs.empty())
+		{
+		g_clear_handle_id(&watch.io_id, g_source_remove);
+		g_clear_handle_id(&watch.check_id, g_source_remove);
+		close(watch.inotify_fd);
+		watch.inotify_fd = -1;
+		watch.changed.clear();
+		watch.reread.clear();
+		watch.overflow = FALSE;
+		}
+}
+
+} // namespace
+#else
+static gboolean realtime_monitor_watch_add(FileData *)
+{
+	return FALSE;
+}
+
+static void realtime_monitor_watch_remove(FileData *)
+{
+}
+#endif
+
 gboolean FileData::file_data_register_real_time_monitor(FileData *fd)
 {
 	gint count;
@@ -2800,7 +3138,10 @@ gboolean FileData::file_data_register_real_time_monitor(FileData *fd)
 	::file_data_ref(fd);
 
 	if (!file_data_monitor_pool)
+		{
 		file_data_monitor_pool = g_hash_table_new(g_direct_hash, g_direct_equal);
+		realtime_monitor_polled = g_hash_table_new(g_direct_hash, g_direct_equal);
+		}
 
 	count = GPOINTER_TO_INT(g_hash_table_lookup(file_data_monitor_pool, fd));
 
@@ -2809,9 +3150,14 @@ gboolean FileData::file_data_register_real_time_monitor(FileData *fd)
 	count++;
 	g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
 
-	if (!realtime_monitor_id)
+	if (count == 1 && !realtime_monitor_watch_add(fd))
 		{
-		realtime_monitor_id = g_timeout_add(5000, realtime_monitor_cb, nullptr);
+		g_hash_table_add(realtime_monitor_polled, fd);
+		}
+
+	if (!realtime_monitor_id && g_hash_table_size(realtime_monitor_polled) > 0)
+		{
+		realtime_monitor_id = g_timeout_add(REALTIME_MONITOR_POLL_INTERVAL, realtime_monitor_cb, nullptr);
 		}
 
 	return TRUE;
@@ -2832,19 +3178,23 @@ gboolean FileData::file_data_unregister_real_time_monitor(FileData *fd)
 	count--;
 
 	if (count == 0)
+		{
 		g_hash_table_remove(file_data_monitor_pool, fd);
+		if (!g_hash_table_remove(realtime_monitor_polled, fd)) realtime_monitor_watch_remove(fd);
+		}
 	else
+		{
 		g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
+		}
 
 	::file_data_unref(fd);
 
-	if (g_hash_table_size(file_data_monitor_pool) == 0)
+	if (g_hash_table_size(realtime_monitor_polled) == 0)
 		{
 		g_clear_handle_id(&realtime_monitor_id, g_source_remove);
-		return FALSE;
 		}
 
-	return TRUE;
+	return g_hash_table_size(file_data_monitor_pool) > 0;
 }
 
 /*
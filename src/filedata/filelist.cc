@@ -26,18 +26,31 @@
 #include "filedata.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <cerrno>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <glib.h>
 
 #include "cache.h"
 #include "filefilter.h"
 #include "main.h"
+#include "misc.h"
 #include "options.h"
 #include "thumb-standard.h"
 #include "ui-fileops.h"
@@ -74,145 +87,310 @@ GList *FileData::FileList::filter_out_sidecars(GList *flist)
  * the main filelist function
  *-----------------------------------------------------------------------------
  */
+
+/**
+ * @brief The entries of one directory, read without creating any FileData
+ *
+ * Scanning only makes system calls and can run in a worker thread,
+ * the FileData are created afterwards by read_list_from_scan() in the
+ * main thread.
+ */
+struct FileData::FileList::DirScan
+{
+	struct Entry
+	{
+		std::string name;
+		struct stat st;
+	};
+
+	DirScan(const gchar *pathl, gboolean follow_symlinks, gboolean want_files, gboolean want_dirs)
+		: pathl(pathl)
+		, follow_symlinks(follow_symlinks)
+		, want_files(want_files)
+		, want_dirs(want_dirs)
+	{}
+
+	std::string pathl; /**< locale encoded path of the directory */
+	gboolean follow_symlinks;
+	gboolean want_files;
+	gboolean want_dirs;
+
+	gboolean ok = FALSE;
+	std::vector<Entry> files;
+	std::vector<Entry> dirs;
+	std::vector<std::string> overflow; /**< names that failed with EOVERFLOW */
+
+	/* set when scanned in the thread pool */
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+};
+
+namespace
+{
+
+using DirScan = FileData::FileList::DirScan;
+
+/**
+ * @brief Names listed in the .hidden file of a directory
+ * @param dir_fd Open directory
+ *
+ * This is the list GIO takes into account for G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN.
+ */
+std::unordered_set<std::string> dir_hidden_names(int dir_fd)
+{
+	std::unordered_set<std::string> names;
+
+	const int fd = openat(dir_fd, ".hidden", O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return names;
+
+	std::string contents;
+	std::array<gchar, 4096> buf;
+	ssize_t n;
+	while ((n = read(fd, buf.data(), buf.size())) > 0)
+		{
+		contents.append(buf.data(), n);
+		}
+	close(fd);
+
+	g_auto(GStrv) lines = g_strsplit(contents.c_str(), "\n", -1);
+	for (gint i = 0; lines[i]; i++)
+		{
+		if (lines[i][0] != '\0') names.emplace(lines[i]);
+		}
+
+	return names;
+}
+
 /**
  * @brief File hidden status
- * @param filepath Full path to file
+ * @param name Name of the file within its directory
+ * @param hidden_names Contents of the .hidden file of the directory
  * @returns
  *
  * Takes into account the contents of a .hidden file
  * unless the dot_prefix_hidden_files override is selected,
  * in which case only the file dot_prefix is checked.
  *
+ * Only these two rules of G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN are
+ * applied, GIO may hide further names, such as those with platform
+ * specific hidden flags, which are shown here.
+ *
  * The Preferences/File Filters/Show Hidden Files Or Folders
  * option will ultimately determine if the file is displayed.
  */
-gboolean FileData::FileList::is_hidden_file(const gchar *filepath)
+gboolean is_hidden_name(const gchar *name, const std::unordered_set<std::string> &hidden_names)
 {
-	GFile *file;
-	GFileInfo *info;
-	gboolean res = FALSE;
+	if (name[0] == '.')
+		{
+		/* "." and ".." are filtered out as folders later */
+		return name[1] != '\0' && (name[1] != '.' || name[2] != '\0');
+		}
+
+	if (options->file_filter.dot_prefix_hidden_files) return FALSE;
 
-	if (filepath == nullptr)
+	return hidden_names.find(name) != hidden_names.end();
+}
+
+/**
+ * @brief File hidden status of a file given by path, see is_hidden_name()
+ * @param path Path of the folder of the file
+ * @param name Name of the file within its folder
+ * @param hidden_names Contents of the .hidden files of the folders seen so far, by folder path
+ */
+gboolean is_hidden_path(const gchar *path, const gchar *name,
+                        std::unordered_map<std::string, std::unordered_set<std::string>> &hidden_names)
+{
+	auto it = hidden_names.find(path);
+	if (it == hidden_names.end())
+		{
+		std::unordered_set<std::string> names;
+		if (!options->file_filter.dot_prefix_hidden_files)
+			{
+			g_autofree gchar *pathl = path_from_utf8(path);
+			const int dir_fd = pathl ? open(pathl, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+			if (dir_fd >= 0)
+				{
+				names = dir_hidden_names(dir_fd);
+				close(dir_fd);
+				}
+			}
+		it = hidden_names.emplace(path, std::move(names)).first;
+		}
+
+	return is_hidden_name(name, it->second);
+}
+
+/* we ignore the .thumbnails dir for cleanliness */
+gboolean is_ignored_dir_name(const gchar *name)
+{
+	return (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) ||
+	       strcmp(name, GQ_CACHE_LOCAL_THUMB) == 0 ||
+	       strcmp(name, GQ_CACHE_LOCAL_METADATA) == 0 ||
+	       strcmp(name, THUMB_FOLDER_LOCAL) == 0;
+}
+
+/**
+ * @brief Reads one directory
+ *
+ * The entries are stat'ed relative to the directory fd, so no path is built
+ * per entry, and d_type is used to drop unwanted entries without a stat.
+ * Only system calls and read-only filter lookups are made here, so this can
+ * run in any thread.
+ */
+void dir_scan_run(DirScan &scan)
+{
+	const int dir_fd = open(scan.pathl.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) return;
+
+	DIR *dp = fdopendir(dir_fd);
+	if (!dp)
 		{
-		return FALSE;
+		close(dir_fd);
+		return;
 		}
 
-	if (options->file_filter.dot_prefix_hidden_files)
+	const gboolean show_hidden = options->file_filter.show_hidden_files;
+	std::unordered_set<std::string> hidden_names;
+	if (!show_hidden && !options->file_filter.dot_prefix_hidden_files) hidden_names = dir_hidden_names(dir_fd);
+
+	const int stat_flags = scan.follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+
+	struct dirent *dir;
+	while ((dir = readdir(dp)) != nullptr)
 		{
-		const gchar *base = strrchr(filepath, G_DIR_SEPARATOR);
-		base = base ? base + 1 : filepath;
+		const gchar *name = dir->d_name;
+
+		if (!show_hidden && is_hidden_name(name, hidden_names)) continue;
 
-		if (base[0] != '.')
+#ifdef _DIRENT_HAVE_D_TYPE
+		const guchar type = dir->d_type;
+		const gboolean known_dir = (type == DT_DIR);
+		const gboolean known_other = (type != DT_UNKNOWN && type != DT_DIR && !(type == DT_LNK && scan.follow_symlinks));
+
+		if (known_dir && (!scan.want_dirs || is_ignored_dir_name(name))) continue;
+		if (known_other && (!scan.want_files || !filter_name_exists(name))) continue;
+#endif
+
+		DirScan::Entry entry{name, {}};
+		if (fstatat(dir_fd, name, &entry.st, stat_flags) < 0)
 			{
-			return FALSE;
+			if (errno == EOVERFLOW) scan.overflow.emplace_back(name);
+			continue;
 			}
 
-		if (base[1] == '\0' || (base[1] == '.' && base[2] == '\0'))
+		if (S_ISDIR(entry.st.st_mode))
 			{
-			return FALSE;
+			if (scan.want_dirs && !is_ignored_dir_name(name)) scan.dirs.push_back(std::move(entry));
+			}
+		else
+			{
+			if (scan.want_files && filter_name_exists(name)) scan.files.push_back(std::move(entry));
 			}
-
-		return TRUE;
 		}
 
-	file = g_file_new_for_path(filepath);
-	info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN, G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+	closedir(dp);
 
-	if (info)
+	scan.ok = TRUE;
+}
+
+void dir_scan_thread_cb(gpointer data, gpointer)
+{
+	auto scan = static_cast<DirScan *>(data);
+
+	dir_scan_run(*scan);
+
+	std::lock_guard<std::mutex> lock(scan->mutex);
+	scan->done = true;
+	scan->cond.notify_one();
+}
+
+/**
+ * @brief Starts scanning the folders in the thread pool
+ * @param dirs List of FileData of the folders
+ * @returns One scan per folder, in the same order
+ */
+std::vector<std::unique_ptr<DirScan>> dir_scan_push(GList *dirs)
+{
+	static GThreadPool *dir_scan_thread_pool = g_thread_pool_new(dir_scan_thread_cb, nullptr, get_cpu_cores(), FALSE, nullptr);
+
+	std::vector<std::unique_ptr<DirScan>> scans;
+
+	for (GList *work = dirs; work; work = work->next)
 		{
-		res = g_file_info_get_is_hidden(info);
+		auto fd = static_cast<FileData *>(work->data);
+		g_autofree gchar *pathl = path_from_utf8(fd->path);
 
-		g_object_unref(info);
+		scans.push_back(std::make_unique<DirScan>(pathl ? pathl : "", TRUE, TRUE, TRUE));
+		g_thread_pool_push(dir_scan_thread_pool, scans.back().get(), nullptr);
 		}
 
-	g_object_unref(file);
+	return scans;
+}
+
+gboolean dir_scan_wait(DirScan &scan)
+{
+	std::unique_lock<std::mutex> lock(scan.mutex);
+	scan.cond.wait(lock, [&scan]{ return scan.done; });
 
-	return res;
+	return scan.ok;
 }
 
-gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks)
+} // namespace
+
+void FileData::FileList::read_list_from_scan(const DirScan &scan, GList **files, GList **dirs)
 {
-	DIR *dp;
-	struct dirent *dir;
 	GList *dlist = nullptr;
 	GList *flist = nullptr;
 	GList *xmp_files = nullptr;
-	gint (*stat_func)(const gchar *path, struct stat *buf);
 	GHashTable *basename_hash = nullptr;
 
-	g_assert(files || dirs);
-
-	if (files) *files = nullptr;
-	if (dirs) *dirs = nullptr;
-
-	g_autofree gchar *pathl = path_from_utf8(dir_path);
-	if (!pathl) return FALSE;
+	/* the path buffer is reused for all entries */
+	g_autoptr(GString) filepath = g_string_new(scan.pathl.c_str());
+	if (filepath->len == 0 || filepath->str[filepath->len - 1] != G_DIR_SEPARATOR) g_string_append_c(filepath, G_DIR_SEPARATOR);
+	const gsize dir_len = filepath->len;
 
-	dp = opendir(pathl);
-	if (dp == nullptr)
+	for (const std::string &name : scan.overflow)
 		{
-		return FALSE;
+		g_string_truncate(filepath, dir_len);
+		g_string_append(filepath, name.c_str());
+		log_printf("stat(): EOVERFLOW, skip '%s'", filepath->str);
 		}
 
-	if (files) basename_hash = file_data_basename_hash_new();
+	if (dirs)
+		{
+		for (const DirScan::Entry &entry : scan.dirs)
+			{
+			g_string_truncate(filepath, dir_len);
+			g_string_append(filepath, entry.name.c_str());
 
-	if (follow_symlinks)
-		stat_func = stat;
-	else
-		stat_func = lstat;
+			auto st = entry.st;
+			dlist = g_list_prepend(dlist, file_data_new_local(filepath->str, &st, TRUE));
+			}
+		}
 
-	while ((dir = readdir(dp)) != nullptr)
+	if (files)
 		{
-		const gchar *name = dir->d_name;
-		g_autofree gchar *filepath = g_build_filename(pathl, name, NULL);
+		basename_hash = file_data_basename_hash_new();
 
-		if (!options->file_filter.show_hidden_files && is_hidden_file(filepath))
+		for (const DirScan::Entry &entry : scan.files)
 			{
-			continue;
-			}
+			g_string_truncate(filepath, dir_len);
+			g_string_append(filepath, entry.name.c_str());
 
-		struct stat ent_sbuf;
-		if (stat_func(filepath, &ent_sbuf) >= 0)
-			{
-			if (S_ISDIR(ent_sbuf.st_mode))
-				{
-				/* we ignore the .thumbnails dir for cleanliness */
-				if (dirs &&
-				    (name[0] != '.' || (name[1] != '\0' && (name[1] != '.' || name[2] != '\0'))) &&
-				    strcmp(name, GQ_CACHE_LOCAL_THUMB) != 0 &&
-				    strcmp(name, GQ_CACHE_LOCAL_METADATA) != 0 &&
-				    strcmp(name, THUMB_FOLDER_LOCAL) != 0)
-					{
-					dlist = g_list_prepend(dlist, file_data_new_local(filepath, &ent_sbuf, TRUE));
-					}
-				}
-			else
-				{
-				if (files && filter_name_exists(name))
-					{
-					FileData *fd = file_data_new_local(filepath, &ent_sbuf, FALSE);
-					flist = g_list_prepend(flist, fd);
-					if (fd->sidecar_priority && !fd->disable_grouping)
-						{
-						if (strcmp(fd->extension, ".xmp") != 0)
-							file_data_basename_hash_insert(basename_hash, fd);
-						else
-							xmp_files = g_list_append(xmp_files, fd);
-						}
-					}
-				}
-			}
-		else
-			{
-			if (errno == EOVERFLOW)
+			auto st = entry.st;
+			FileData *fd = file_data_new_local(filepath->str, &st, FALSE);
+			flist = g_list_prepend(flist, fd);
+			if (fd->sidecar_priority && !fd->disable_grouping)
 				{
-				log_printf("stat(): EOVERFLOW, skip '%s'", filepath);
+				if (strcmp(fd->extension, ".xmp") != 0)
+					file_data_basename_hash_insert(basename_hash, fd);
+				else
+					xmp_files = g_list_append(xmp_files, fd);
 				}
 			}
 		}
 
-	closedir(dp);
-
 	if (xmp_files)
 		{
 		g_list_foreach(xmp_files,file_data_basename_hash_insert_cb,basename_hash);
@@ -228,6 +406,23 @@ gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files
 		*files = filter_out_sidecars(flist);
 		}
 	if (basename_hash) file_data_basename_hash_free(basename_hash);
+}
+
+gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks)
+{
+	g_assert(files || dirs);
+
+	if (files) *files = nullptr;
+	if (dirs) *dirs = nullptr;
+
+	g_autofree gchar *pathl = path_from_utf8(dir_path);
+	if (!pathl) return FALSE;
+
+	DirScan scan(pathl, follow_symlinks, files != nullptr, dirs != nullptr);
+	dir_scan_run(scan);
+	if (!scan.ok) return FALSE;
+
+	read_list_from_scan(scan, files, dirs);
 
 	return TRUE;
 }
@@ -323,17 +518,253 @@ gint FileData::FileList::sort_compare_filedata_full(const FileData *fa, const Fi
 	return sort_compare_filedata(fa, fb, &settings);
 }
 
-gint FileData::FileList::sort_file_cb(gconstpointer a, gconstpointer b, gpointer data)
+namespace
+{
+
+using SortKey = FileData::FileList::SortKey;
+using SortSettings = FileData::FileList::SortSettings;
+
+constexpr gsize SORT_PARALLEL_MIN = 16384; /**< keys per thread below which the keys are sorted by the calling thread */
+
+/** @returns @a value mapped to an unsigned key of the same order */
+guint64 sort_key_signed(gint64 value)
+{
+	return static_cast<guint64>(value) ^ (G_GUINT64_CONSTANT(1) << 63);
+}
+
+/** @returns The first 8 bytes of @a collate_key, big endian, so the keys compare as by strcmp() */
+guint64 sort_key_prefix(const gchar *collate_key)
 {
-	return FileData::FileList::sort_compare_filedata(
-                static_cast<const FileData *>(a),
-                static_cast<const FileData *>(b),
-                static_cast<SortSettings *>(data));
+	guint64 prefix = 0;
+
+	for (gint i = 0; i < 8; i++)
+		{
+		prefix <<= 8;
+		if (*collate_key) prefix |= static_cast<guchar>(*collate_key++);
+		}
+
+	return prefix;
+}
+
+struct SortKeyLess
+{
+	explicit SortKeyLess(const SortSettings &settings)
+		: settings(settings)
+		, name_exact(settings.method != SORT_NUMBER)
+	{}
+
+	bool operator()(const SortKey &a, const SortKey &b) const
+	{
+		const SortKey &ka = settings.ascending ? a : b;
+		const SortKey &kb = settings.ascending ? b : a;
+
+		if (ka.primary != kb.primary) return ka.primary < kb.primary;
+		/* the name is only compared when the primary keys are complete */
+		if (name_exact && ka.name != kb.name) return ka.name < kb.name;
+
+		return FileData::FileList::sort_compare_filedata(a.fd, b.fd, &settings) < 0;
+	}
+
+	mutable SortSettings settings;
+	gboolean name_exact;
+};
+
+struct SortBatch
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	gsize pending;
+};
+
+struct SortTask
+{
+	std::function<void()> func;
+	SortBatch *batch;
+};
+
+void sort_thread_cb(gpointer data, gpointer)
+{
+	auto task = static_cast<SortTask *>(data);
+
+	task->func();
+
+	std::lock_guard<std::mutex> lock(task->batch->mutex);
+	if (--task->batch->pending == 0) task->batch->cond.notify_one();
+}
+
+/**
+ * @brief Runs @a funcs in the sort thread pool and waits for all of them
+ *
+ * This must not be called from the sort thread pool itself.
+ */
+void sort_run_parallel(const std::vector<std::function<void()>> &funcs)
+{
+	static GThreadPool *sort_thread_pool = g_thread_pool_new(sort_thread_cb, nullptr, get_cpu_cores(), FALSE, nullptr);
+
+	if (funcs.size() == 1)
+		{
+		funcs.front()();
+		return;
+		}
+
+	SortBatch batch;
+	batch.pending = funcs.size();
+
+	std::vector<SortTask> tasks;
+	tasks.reserve(funcs.size());
+	for (const auto &func : funcs)
+		{
+		tasks.push_back({func, &batch});
+		}
+
+	for (SortTask &task : tasks)
+		{
+		g_thread_pool_push(sort_thread_pool, &task, nullptr);
+		}
+
+	std::unique_lock<std::mutex> lock(batch.mutex);
+	batch.cond.wait(lock, [&batch]{ return batch.pending == 0; });
+}
+
+} // namespace
+
+/**
+ * @brief Computes the sort key of a file
+ * @param fd The file
+ * @param data The item sorted, returned in SortKey::data
+ * @param settings The sort order
+ */
+FileData::FileList::SortKey FileData::FileList::sort_key(const FileData *fd, gpointer data, const SortSettings &settings)
+{
+	SortKey key{0, sort_key_prefix(settings.case_sensitive ? fd->collate_key_name : fd->collate_key_name_nocase), fd, data};
+
+	switch (settings.method)
+		{
+		case SORT_SIZE:
+			key.primary = sort_key_signed(fd->size);
+			break;
+		case SORT_TIME:
+			key.primary = sort_key_signed(fd->date);
+			break;
+		case SORT_CTIME:
+			key.primary = sort_key_signed(fd->cdate);
+			break;
+		case SORT_EXIFTIME:
+			key.primary = sort_key_signed(fd->exifdate);
+			break;
+		case SORT_EXIFTIMEDIGITIZED:
+			key.primary = sort_key_signed(fd->exifdate_digitized);
+			break;
+		case SORT_RATING:
+			key.primary = sort_key_signed(fd->rating);
+			break;
+		case SORT_CLASS:
+			key.primary = sort_key_signed(fd->format_class);
+			break;
+		case SORT_NUMBER:
+			key.primary = sort_key_prefix(settings.case_sensitive ? fd->collate_key_name_natural : fd->collate_key_name_nocase_natural);
+			break;
+		default:
+			break;
+		}
+
+	return key;
+}
+
+/**
+ * @brief Sorts keys made by sort_key() in the order of sort_compare_filedata()
+ *
+ * Large lists are sorted in parts by the sort thread pool, and the parts
+ * are then merged pairwise, also in the pool.
+ */
+void FileData::FileList::sort_keys(SortKeys &keys, SortSettings settings)
+{
+	const SortKeyLess less(settings);
+	const gsize count = keys.size();
+	const gsize parts = std::min<gsize>(std::max(get_cpu_cores(), 1), count / SORT_PARALLEL_MIN);
+
+	if (parts < 2)
+		{
+		std::sort(keys.begin(), keys.end(), less);
+		return;
+		}
+
+	std::vector<gsize> bounds;
+	for (gsize i = 0; i <= parts; i++)
+		{
+		bounds.push_back(count * i / parts);
+		}
+
+	std::vector<std::function<void()>> funcs;
+	for (gsize i = 0; i < parts; i++)
+		{
+		funcs.emplace_back([&keys, &less, first = bounds[i], last = bounds[i + 1]]{
+			std::sort(keys.begin() + first, keys.begin() + last, less);
+		});
+		}
+	sort_run_parallel(funcs);
+
+	for (gsize step = 1; step < parts; step *= 2)
+		{
+		funcs.clear();
+		for (gsize i = 0; i + step < parts; i += 2 * step)
+			{
+			funcs.emplace_back([&keys, &less, first = bounds[i], middle = bounds[i + step], last = bounds[std::min(i + 2 * step, parts)]]{
+				std::inplace_merge(keys.begin() + first, keys.begin() + middle, keys.begin() + last, less);
+			});
+			}
+		sort_run_parallel(funcs);
+		}
+}
+
+void FileData::FileList::sort(std::vector<FileData *> &files, SortSettings settings)
+{
+	SortKeys keys;
+	keys.reserve(files.size());
+	for (FileData *fd : files)
+		{
+		keys.push_back(sort_key(fd, fd, settings));
+		}
+
+	sort_keys(keys, settings);
+
+	std::transform(keys.cbegin(), keys.cend(), files.begin(),
+	               [](const SortKey &key){ return static_cast<FileData *>(key.data); });
+}
+
+/**
+ * @brief Sorts a list of items by their files
+ * @param list The items, sorted in place
+ * @param settings The sort order
+ * @param file_func Returns the file of an item
+ * @returns The sorted list, which keeps the links of @a list
+ */
+GList *FileData::FileList::sort_full(GList *list, SortSettings settings, SortFileFunc file_func)
+{
+	if (!list || !list->next) return list;
+
+	SortKeys keys;
+	keys.reserve(g_list_length(list));
+	for (GList *work = list; work; work = work->next)
+		{
+		keys.push_back(sort_key(file_func(work->data), work->data, settings));
+		}
+
+	sort_keys(keys, settings);
+
+	GList *work = list;
+	for (const SortKey &key : keys)
+		{
+		work->data = key.data;
+		work = work->next;
+		}
+
+	return list;
 }
 
 GList *FileData::FileList::sort(GList *list, SortSettings settings)
 {
-	return g_list_sort_with_data(list, sort_file_cb, &settings);
+	return sort_full(list, settings, [](gconstpointer data){ return static_cast<const FileData *>(data); });
 }
 
 gboolean FileData::FileList::read_list(FileData *dir_fd, GList **files, GList **dirs)
@@ -430,16 +861,18 @@ GList *FileData::FileList::filter(GList *list, gboolean is_dir_list)
 
 	if (!is_dir_list && options->file_filter.disable && options->file_filter.show_hidden_files) return list;
 
+	std::unordered_map<std::string, std::unordered_set<std::string>> hidden_names;
+
 	work = list;
 	while (work)
 		{
 		auto fd = static_cast<FileData *>(work->data);
 		const gchar *name = fd->name;
-		const gchar *filepath = fd->path;
 		GList *link = work;
 		work = work->next;
+		g_autofree gchar *dir_path = g_path_get_dirname(fd->path);
 
-		if ((!options->file_filter.show_hidden_files && is_hidden_file(filepath)) ||
+		if ((!options->file_filter.show_hidden_files && is_hidden_path(dir_path, name, hidden_names)) ||
 		    (!is_dir_list && !filter_name_exists(name)) ||
 		    (is_dir_list && name[0] == '.' && (strcmp(name, GQ_CACHE_LOCAL_THUMB) == 0 ||
 						       strcmp(name, GQ_CACHE_LOCAL_METADATA) == 0)) )
@@ -469,57 +902,55 @@ GList *FileData::FileList::sort_path(GList *list)
 	return g_list_sort(list, sort_path_cb);
 }
 
+/*
+ * The sub folders are scanned in the thread pool ahead of the main thread,
+ * which creates the FileData and walks the tree in the usual order.
+ */
 void FileData::FileList::recursive_append(GList **list, GList *dirs)
 {
-	GList *work;
+	std::vector<std::unique_ptr<DirScan>> scans = dir_scan_push(dirs);
 
-	work = dirs;
-	while (work)
+	for (auto &scan : scans)
 		{
-		auto fd = static_cast<FileData *>(work->data);
 		GList *f;
 		GList *d;
 
-		if (read_list(fd, &f, &d))
-			{
-			f = filter(f, FALSE);
-			f = sort_path(f);
-			*list = g_list_concat(*list, f);
-
-			d = filter(d, TRUE);
-			d = sort_path(d);
-			recursive_append(list, d);
-			free_list(d);
-			}
+		if (!dir_scan_wait(*scan)) continue;
 
-		work = work->next;
+		read_list_from_scan(*scan, &f, &d);
+
+		f = filter(f, FALSE);
+		f = sort_path(f);
+		*list = g_list_concat(*list, f);
+
+		d = filter(d, TRUE);
+		d = sort_path(d);
+		recursive_append(list, d);
+		free_list(d);
 		}
 }
 
 void FileData::FileList::recursive_append_full(GList **list, GList *dirs, SortSettings settings)
 {
-	GList *work;
+	std::vector<std::unique_ptr<DirScan>> scans = dir_scan_push(dirs);
 
-	work = dirs;
-	while (work)
+	for (auto &scan : scans)
 		{
-		auto fd = static_cast<FileData *>(work->data);
 		GList *f;
 		GList *d;
 
-		if (read_list(fd, &f, &d))
-			{
-			f = filter(f, FALSE);
-			f = sort(f, settings);
-			*list = g_list_concat(*list, f);
-
-			d = filter(d, TRUE);
-			d = sort_path(d);
-			recursive_append_full(list, d, settings);
-			free_list(d);
-			}
+		if (!dir_scan_wait(*scan)) continue;
 
-		work = work->next;
+		read_list_from_scan(*scan, &f, &d);
+
+		f = filter(f, FALSE);
+		f = sort(f, settings);
+		*list = g_list_concat(*list, f);
+
+		d = filter(d, TRUE);
+		d = sort_path(d);
+		recursive_append_full(list, d, settings);
+		free_list(d);
 		}
 }
 
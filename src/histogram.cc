@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include <gdk/gdk.h>
 #include <glib-object.h>
@@ -41,6 +42,10 @@ namespace
 {
 
 constexpr gint HISTMAP_SIZE = 256;
+constexpr gint HISTMAP_PASSES = 8;      /**< interleaved row passes, each one is reported */
+constexpr gint HISTMAP_COPIES = 4;      /**< copies of the bins for consecutive pixels */
+constexpr gint HISTMAP_THREADS = 2;
+constexpr gint64 HISTMAP_SAMPLE_PIXELS = 64 * 1024 * 1024; /**< larger images are sampled */
 
 void histogram_vgrid(const Histogram::Grid &grid, GdkPixbuf *pixbuf, GdkRectangle rect)
 {
@@ -72,18 +77,25 @@ void histogram_hgrid(const Histogram::Grid &grid, GdkPixbuf *pixbuf, GdkRectangl
 
 } // namespace
 
+struct HistMapJob;
+
+/**
+ * @brief Counts of the channel values of an image
+ *
+ * The counts are made on a worker thread in HISTMAP_PASSES passes over
+ * interleaved rows, the counts of each pass are added as it finishes. So
+ * a histogram that is not complete yet is already a fair sample.
+ */
 struct HistMap {
 	gulong r[HISTMAP_SIZE];
 	gulong g[HISTMAP_SIZE];
 	gulong b[HISTMAP_SIZE];
 	gulong max[HISTMAP_SIZE];
 
-	guint idle_id; /* event source id */
-	GdkPixbuf *pixbuf;
-	gint y;
+	gint passes;            /**< passes counted so far */
+	HistMapJob *job;        /**< the job still counting, or nullptr */
 };
 
-
 void Histogram::set_channel(gint channel)
 {
 	histogram_channel = channel;
@@ -144,99 +156,288 @@ const gchar *Histogram::label() const
 	return t1;
 }
 
+/**
+ * @brief Counting of a histogram on a worker thread
+ *
+ * The job belongs to the worker until it is finished. The histogram
+ * belongs to the main thread; when it is freed first, the job is only
+ * detached from it and frees itself from the main loop later.
+ */
+struct HistMapJob {
+	HistMap *histmap;       /**< nullptr when cancelled, protected by mutex */
+	HistMapFunc func;
+	gpointer data;
+
+	GdkPixbuf *pixbuf;
+	gint step;
+
+	GMutex mutex;
+	gulong counts[HCHAN_MAX + 1][HISTMAP_SIZE]; /**< counted but not added to histmap yet */
+	gint passes;            /**< passes in counts */
+	gboolean finished;
+	guint idle_id;          /**< event source id */
+};
+
 static HistMap *histmap_new()
 {
 	auto histmap = g_new0(HistMap, 1);
 	return histmap;
 }
 
+static void histmap_job_free(HistMapJob *job)
+{
+	g_object_unref(job->pixbuf);
+	g_mutex_clear(&job->mutex);
+	g_free(job);
+}
+
 void histmap_free(HistMap *histmap)
 {
 	if (!histmap) return;
-	if (histmap->idle_id) g_source_remove(histmap->idle_id);
-	if (histmap->pixbuf) g_object_unref(histmap->pixbuf);
+
+	if (histmap->job)
+		{
+		HistMapJob *job = histmap->job;
+
+		g_mutex_lock(&job->mutex);
+		job->histmap = nullptr;
+		g_mutex_unlock(&job->mutex);
+		}
+
 	g_free(histmap);
 }
 
-static gboolean histmap_read(HistMap *histmap, gboolean whole)
+/**
+ * @brief Counts every step-th pixel of every step-th row of a pixbuf
+ *
+ * Only the rows with row % HISTMAP_PASSES == pass are read, where row
+ * counts the sampled rows. Consecutive pixels are counted in separate
+ * copies of the bins, so that increments of equal values do not wait on
+ * each other, and the copies are added at the end.
+ */
+static void histmap_count_pass(const GdkPixbuf *pixbuf, gint step, gint pass,
+                               gulong counts[HCHAN_MAX + 1][HISTMAP_SIZE])
 {
-	gint w;
-	gint h;
-	gint i;
-	gint j;
-	gint srs;
-	gint has_alpha;
-	gint step;
-	gint end_line;
-	guchar *s_pix;
-	GdkPixbuf *imgpixbuf = histmap->pixbuf;
+	const gint srs = gdk_pixbuf_get_rowstride(pixbuf);
+	const gint n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+	const guchar *s_pix = gdk_pixbuf_read_pixels(pixbuf);
+	const gint pixel_step = n_channels * step;
+	const gint columns = (gdk_pixbuf_get_width(pixbuf) + step - 1) / step;
+	const gint rows = (gdk_pixbuf_get_height(pixbuf) + step - 1) / step;
+
+	auto bins = static_cast<guint32 (*)[HCHAN_MAX + 1][HISTMAP_SIZE]>(g_malloc0(sizeof(guint32) * HISTMAP_COPIES * (HCHAN_MAX + 1) * HISTMAP_SIZE));
+
+	for (gint row = pass; row < rows; row += HISTMAP_PASSES)
+		{
+		const guchar *sp = s_pix + (row * step * srs);
+		gint j = 0;
+
+		for (; j + HISTMAP_COPIES <= columns; j += HISTMAP_COPIES)
+			{
+			for (gint k = 0; k < HISTMAP_COPIES; k++)
+				{
+				const guchar r = sp[0];
+				const guchar g = sp[1];
+				const guchar b = sp[2];
+
+				bins[k][HCHAN_R][r]++;
+				bins[k][HCHAN_G][g]++;
+				bins[k][HCHAN_B][b]++;
+				bins[k][HCHAN_MAX][std::max({r, g, b})]++;
+
+				sp += pixel_step;
+				}
+			}
+
+		for (; j < columns; j++)
+			{
+			bins[0][HCHAN_R][sp[0]]++;
+			bins[0][HCHAN_G][sp[1]]++;
+			bins[0][HCHAN_B][sp[2]]++;
+			bins[0][HCHAN_MAX][std::max({sp[0], sp[1], sp[2]})]++;
 
-	w = gdk_pixbuf_get_width(imgpixbuf);
-	h = gdk_pixbuf_get_height(imgpixbuf);
-	srs = gdk_pixbuf_get_rowstride(imgpixbuf);
-	s_pix = gdk_pixbuf_get_pixels(imgpixbuf);
-	has_alpha = gdk_pixbuf_get_has_alpha(imgpixbuf);
+			sp += pixel_step;
+			}
+		}
 
-	if (whole)
+	for (gint k = 0; k < HISTMAP_COPIES; k++)
+		for (gint c = 0; c <= HCHAN_MAX; c++)
+			for (gint i = 0; i < HISTMAP_SIZE; i++)
+				counts[c][i] += bins[k][c][i];
+
+	g_free(bins);
+}
+
+static void histmap_add_counts(HistMap *histmap, gulong counts[HCHAN_MAX + 1][HISTMAP_SIZE])
+{
+	for (gint i = 0; i < HISTMAP_SIZE; i++)
 		{
-		end_line = h;
+		histmap->r[i] += counts[HCHAN_R][i];
+		histmap->g[i] += counts[HCHAN_G][i];
+		histmap->b[i] += counts[HCHAN_B][i];
+		histmap->max[i] += counts[HCHAN_MAX][i];
 		}
-	else
+}
+
+static gboolean histmap_job_progress_cb(gpointer data)
+{
+	auto job = static_cast<HistMapJob *>(data);
+	HistMap *histmap;
+	gboolean finished;
+	gint passes;
+
+	g_mutex_lock(&job->mutex);
+	job->idle_id = 0;
+	histmap = job->histmap;
+	finished = job->finished;
+	passes = job->passes;
+	if (histmap)
 		{
-		gint lines = 1 + (16384 / w);
-		end_line = histmap->y + lines;
-		end_line = std::min(end_line, h);
+		histmap_add_counts(histmap, job->counts);
+		histmap->passes += passes;
+		if (finished) histmap->job = nullptr;
 		}
+	memset(job->counts, 0, sizeof(job->counts));
+	job->passes = 0;
+	g_mutex_unlock(&job->mutex);
 
-	step = 3 + !!(has_alpha);
-	for (i = histmap->y; i < end_line; i++)
+	/* the callback may free the histogram */
+	if (histmap && passes > 0 && job->func) job->func(histmap, histmap->passes >= HISTMAP_PASSES, job->data);
+
+	if (finished) histmap_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void histmap_job_run(gpointer data, gpointer)
+{
+	auto job = static_cast<HistMapJob *>(data);
+	gulong counts[HCHAN_MAX + 1][HISTMAP_SIZE];
+
+	/* spread the first passes over the image, so that early results are representative */
+	static constexpr gint pass_order[HISTMAP_PASSES] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+	for (gint i = 0; i < HISTMAP_PASSES; i++)
 		{
-		guchar *sp = s_pix + (i * srs); /* 8bit */
-		for (j = 0; j < w; j++)
-			{
-			guint max = std::max({sp[0], sp[1], sp[2]});
+		g_mutex_lock(&job->mutex);
+		const gboolean cancelled = !job->histmap;
+		g_mutex_unlock(&job->mutex);
+		if (cancelled) break;
+
+		memset(counts, 0, sizeof(counts));
+		histmap_count_pass(job->pixbuf, job->step, pass_order[i], counts);
+
+		g_mutex_lock(&job->mutex);
+		for (gint c = 0; c <= HCHAN_MAX; c++)
+			for (gint v = 0; v < HISTMAP_SIZE; v++)
+				job->counts[c][v] += counts[c][v];
+		job->passes++;
+		if (i < HISTMAP_PASSES - 1 && !job->idle_id) job->idle_id = g_idle_add(histmap_job_progress_cb, job);
+		g_mutex_unlock(&job->mutex);
+		}
 
-			histmap->r[sp[0]]++;
-			histmap->g[sp[1]]++;
-			histmap->b[sp[2]]++;
-			histmap->max[max]++;
+	/* done or cancelled, the main loop frees the job once finished is set,
+	 * so it is not touched after this */
+	g_mutex_lock(&job->mutex);
+	job->finished = TRUE;
+	if (!job->idle_id) job->idle_id = g_idle_add(histmap_job_progress_cb, job);
+	g_mutex_unlock(&job->mutex);
+}
 
-			sp += step;
-			}
+/**
+ * @brief Starts counting a histogram of a pixbuf in the background
+ * @param pixbuf 8 bit RGB or RGBA pixbuf, it must not change until the counting is done
+ * @param step Count only every step-th pixel of every step-th row, for very large images
+ * @param func Called from the main loop after each pass, until complete is TRUE
+ * @param data Passed to func
+ * @returns The histogram, empty until the first pass is done
+ */
+HistMap *histmap_new_async(GdkPixbuf *pixbuf, gint step, HistMapFunc func, gpointer data)
+{
+	static GThreadPool *histmap_pool = nullptr;
+
+	if (!histmap_pool) histmap_pool = g_thread_pool_new(histmap_job_run, nullptr, HISTMAP_THREADS, FALSE, nullptr);
+
+	HistMap *histmap = histmap_new();
+
+	auto job = g_new0(HistMapJob, 1);
+	job->histmap = histmap;
+	job->func = func;
+	job->data = data;
+	job->pixbuf = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+	job->step = std::max(step, 1);
+	g_mutex_init(&job->mutex);
+
+	histmap->job = job;
+
+	g_thread_pool_push(histmap_pool, job, nullptr);
+
+	return histmap;
+}
+
+/**
+ * @brief Counts a histogram of a pixbuf at once, in the calling thread
+ */
+HistMap *histmap_new_sync(const GdkPixbuf *pixbuf, gint step)
+{
+	HistMap *histmap = histmap_new();
+	gulong counts[HCHAN_MAX + 1][HISTMAP_SIZE] = {};
+
+	for (gint pass = 0; pass < HISTMAP_PASSES; pass++)
+		{
+		histmap_count_pass(pixbuf, std::max(step, 1), pass, counts);
+		}
+
+	histmap_add_counts(histmap, counts);
+	histmap->passes = HISTMAP_PASSES;
+
+	return histmap;
+}
+
+gulong histmap_get_count(const HistMap *histmap, gint channel, gint value)
+{
+	switch (channel)
+		{
+		case HCHAN_R: return histmap->r[value];
+		case HCHAN_G: return histmap->g[value];
+		case HCHAN_B: return histmap->b[value];
+		case HCHAN_MAX: return histmap->max[value];
+		default: return 0;
 		}
-	histmap->y = end_line;
-	return end_line >= h;
 }
 
+/**
+ * @brief Returns the histogram of the image of fd, it may still be counting
+ * @returns nullptr if nothing has been counted yet
+ */
 const HistMap *histmap_get(FileData *fd)
 {
-	if (fd->histmap && !fd->histmap->idle_id) return fd->histmap; /* histmap exists and is finished */
+	if (fd->histmap && fd->histmap->passes > 0) return fd->histmap;
 
 	return nullptr;
 }
 
-static gboolean histmap_idle_cb(gpointer data)
+static void histmap_file_data_cb(const HistMap *, gboolean, gpointer data)
 {
 	auto fd = static_cast<FileData *>(data);
-	if (histmap_read(fd->histmap, FALSE))
-		{
-		/* finished */
-		g_object_unref(fd->histmap->pixbuf); /*pixbuf is no longer needed */
-		fd->histmap->pixbuf = nullptr;
-		fd->histmap->idle_id = 0;
-		file_data_send_notification(fd, NOTIFY_HISTMAP);
-		return G_SOURCE_REMOVE;
-		}
-	return G_SOURCE_CONTINUE;
+
+	file_data_send_notification(fd, NOTIFY_HISTMAP);
 }
 
-gboolean histmap_start_idle(FileData *fd)
+/**
+ * @brief Starts counting the histogram of fd->pixbuf
+ *
+ * NOTIFY_HISTMAP is sent each time more of the image has been counted.
+ * Images larger than HISTMAP_SAMPLE_PIXELS are sampled.
+ */
+gboolean histmap_start(FileData *fd)
 {
 	if (fd->histmap || !fd->pixbuf) return FALSE;
 
-	fd->histmap = histmap_new();
-	fd->histmap->pixbuf = g_object_ref(fd->pixbuf);
-	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, nullptr);
+	const gint64 pixels = static_cast<gint64>(gdk_pixbuf_get_width(fd->pixbuf)) * gdk_pixbuf_get_height(fd->pixbuf);
+	const gint step = (pixels > HISTMAP_SAMPLE_PIXELS) ? static_cast<gint>(ceil(sqrt(static_cast<gdouble>(pixels) / HISTMAP_SAMPLE_PIXELS))) : 1;
+
+	fd->histmap = histmap_new_async(fd->pixbuf, step, histmap_file_data_cb, fd);
 
 	return TRUE;
 }
@@ -22,6 +22,7 @@
 #define HISTOGRAM_H
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gdk/gdk.h>
 #include <glib.h>
 
 #include "gq-color.h"
@@ -69,9 +70,15 @@ struct Histogram {
 };
 
 
+using HistMapFunc = void (*)(const HistMap *histmap, gboolean complete, gpointer data);
+
+HistMap *histmap_new_async(GdkPixbuf *pixbuf, gint step, HistMapFunc func, gpointer data);
+HistMap *histmap_new_sync(const GdkPixbuf *pixbuf, gint step);
 void histmap_free(HistMap *histmap);
+gulong histmap_get_count(const HistMap *histmap, gint channel, gint value);
+
 const HistMap *histmap_get(FileData *fd);
-gboolean histmap_start_idle(FileData *fd);
+gboolean histmap_start(FileData *fd);
 
 void histogram_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
@@ -33,6 +33,7 @@ namespace
 struct ImageLoaderCr3 : public ImageLoaderJpeg
 {
 public:
+	WriteMode get_write_mode() override { return WRITE_WHOLE; }
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
@@ -80,7 +81,8 @@ gboolean ImageLoaderCr3::write(const guchar *buf, gsize &chunk_size, gsize count
 		return FALSE;
 		}
 
-	gboolean ret = ImageLoaderJpeg::write(buf + n + 12, chunk_size, i, error);
+	gsize size = i;
+	gboolean ret = ImageLoaderJpeg::write(buf + n + 12, size, i, error);
 	if (ret)
 		{
 		chunk_size = count;
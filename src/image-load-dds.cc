@@ -33,6 +33,7 @@
 #include <glib.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -237,9 +238,7 @@ uint ddsGetDXTColor(uint c0, uint c1, uint a, uint t) {
 	return 0;
 }
 
-guchar *ddsDecodeDXT1(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsDecodeDXT1(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	uint w = (width + 3) / 4;
 	uint h = (height + 3) / 4;
@@ -263,12 +262,9 @@ guchar *ddsDecodeDXT1(uint width, uint height, const unsigned char *buffer) {
 			}
 		}
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsDecodeDXT3(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsDecodeDXT3(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	uint w = (width + 3) / 4;
 	uint h = (height + 3) / 4;
@@ -303,11 +299,10 @@ guchar *ddsDecodeDXT3(uint width, uint height, const unsigned char *buffer) {
 			}
 		}
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsDecodeDXT2(uint width, uint height, const unsigned char *buffer) {
-	return ddsDecodeDXT3(width, height, buffer);
+void ddsDecodeDXT2(uint width, uint height, const unsigned char *buffer, uint *pixels) {
+	ddsDecodeDXT3(width, height, buffer, pixels);
 }
 
 int ddsGetDXT5Alpha(uint a0, uint a1, uint t) {
@@ -338,9 +333,7 @@ int ddsGetDXT5Alpha(uint a0, uint a1, uint t) {
 	return 0;
 }
 
-guchar *ddsDecodeDXT5(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsDecodeDXT5(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	uint w = (width + 3) / 4;
 	uint h = (height + 3) / 4;
@@ -386,16 +379,13 @@ guchar *ddsDecodeDXT5(uint width, uint height, const unsigned char *buffer) {
 			}
 		}
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsDecodeDXT4(uint width, uint height, const unsigned char *buffer) {
-	return ddsDecodeDXT5(width, height, buffer);
+void ddsDecodeDXT4(uint width, uint height, const unsigned char *buffer, uint *pixels) {
+	ddsDecodeDXT5(width, height, buffer, pixels);
 }
 
-guchar *ddsReadA1R5G5B5(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadA1R5G5B5(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint rgba = (buffer[index] & 0xFF) | (buffer[index + 1] & 0xFF) << 8; index += 2;
@@ -405,12 +395,9 @@ guchar *ddsReadA1R5G5B5(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255 * ((rgba & A1R5G5B5_MASKS[3]) >> 15);
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadX1R5G5B5(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadX1R5G5B5(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint rgba = (buffer[index] & 0xFF) | (buffer[index + 1] & 0xFF) << 8; index += 2;
@@ -420,12 +407,9 @@ guchar *ddsReadX1R5G5B5(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadA4R4G4B4(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadA4R4G4B4(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint rgba = (buffer[index] & 0xFF) | (buffer[index + 1] & 0xFF) << 8; index += 2;
@@ -435,12 +419,9 @@ guchar *ddsReadA4R4G4B4(uint width, uint height, const unsigned char *buffer) {
 		uint a = 17 * ((rgba & A4R4G4B4_MASKS[3]) >> 12);
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadX4R4G4B4(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadX4R4G4B4(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint rgba = (buffer[index] & 0xFF) | (buffer[index + 1] & 0xFF) << 8; index += 2;
@@ -450,12 +431,9 @@ guchar *ddsReadX4R4G4B4(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadR5G6B5(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadR5G6B5(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint rgba = (buffer[index] & 0xFF) | (buffer[index + 1] & 0xFF) << 8; index += 2;
@@ -465,12 +443,9 @@ guchar *ddsReadR5G6B5(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadR8G8B8(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadR8G8B8(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint b = buffer[index++] & 0xFF;
@@ -479,12 +454,9 @@ guchar *ddsReadR8G8B8(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadA8B8G8R8(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadA8B8G8R8(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint r = buffer[index++] & 0xFF;
@@ -493,12 +465,9 @@ guchar *ddsReadA8B8G8R8(uint width, uint height, const unsigned char *buffer) {
 		uint a = buffer[index++] & 0xFF;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadX8B8G8R8(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadX8B8G8R8(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint r = buffer[index++] & 0xFF;
@@ -507,12 +476,9 @@ guchar *ddsReadX8B8G8R8(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255; index++;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadA8R8G8B8(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadA8R8G8B8(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint b = buffer[index++] & 0xFF;
@@ -521,12 +487,9 @@ guchar *ddsReadA8R8G8B8(uint width, uint height, const unsigned char *buffer) {
 		uint a = buffer[index++] & 0xFF;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
-guchar *ddsReadX8R8G8B8(uint width, uint height, const unsigned char *buffer) {
-	auto pixels = static_cast<uint *>(g_try_malloc(4 * width*height));
-	if (pixels == nullptr) return nullptr;
+void ddsReadX8R8G8B8(uint width, uint height, const unsigned char *buffer, uint *pixels) {
 	uint index = 128;
 	for (uint i = 0; i<height*width; i++) {
 		uint b = buffer[index++] & 0xFF;
@@ -535,7 +498,6 @@ guchar *ddsReadX8R8G8B8(uint width, uint height, const unsigned char *buffer) {
 		uint a = 255; index++;
 		pixels[i] = (a << 24) | (r << 0) | (g << 8) | (b << 16);
 	}
-	return reinterpret_cast<guchar *>(pixels);
 }
 
 gboolean ImageLoaderDDS::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
@@ -544,33 +506,34 @@ gboolean ImageLoaderDDS::write(const guchar *buf, gsize &chunk_size, gsize count
 	uint height = ddsGetHeight(buf);
 	uint type = ddsGetType(buf);
 	if (type == 0) return FALSE;
-	{
-		guchar *pixels = nullptr;
-		guint rowstride = width * 4;
-		switch (type) {
-		case DXT1: pixels = ddsDecodeDXT1(width, height, buf); break;
-		case DXT2: pixels = ddsDecodeDXT2(width, height, buf); break;
-		case DXT3: pixels = ddsDecodeDXT3(width, height, buf); break;
-		case DXT4: pixels = ddsDecodeDXT4(width, height, buf); break;
-		case DXT5: pixels = ddsDecodeDXT5(width, height, buf); break;
-		case A1R5G5B5: pixels = ddsReadA1R5G5B5(width, height, buf); break;
-		case X1R5G5B5: pixels = ddsReadX1R5G5B5(width, height, buf); break;
-		case A4R4G4B4: pixels = ddsReadA4R4G4B4(width, height, buf); break;
-		case X4R4G4B4: pixels = ddsReadX4R4G4B4(width, height, buf); break;
-		case R5G6B5: pixels = ddsReadR5G6B5(width, height, buf); break;
-		case R8G8B8: pixels = ddsReadR8G8B8(width, height, buf); break;
-		case A8B8G8R8: pixels = ddsReadA8B8G8R8(width, height, buf); break;
-		case X8B8G8R8: pixels = ddsReadX8B8G8R8(width, height, buf); break;
-		case A8R8G8B8: pixels = ddsReadA8R8G8B8(width, height, buf); break;
-		case X8R8G8B8: pixels = ddsReadX8R8G8B8(width, height, buf); break;
-		default:
-			break;
-		}
-		pixbuf = gdk_pixbuf_new_from_data (pixels, GDK_COLORSPACE_RGB, TRUE, 8, width, height, rowstride, free_pixels, nullptr);
-		area_updated_cb(nullptr, 0, 0, width, height, data);
-		chunk_size = count;
-		return TRUE;
+
+	pixbuf = pixbuf_pool_new(TRUE, width, height);
+	if (!pixbuf) return FALSE;
+
+	/* rows of four channels are not padded, the decoders write to them directly */
+	auto pixels = reinterpret_cast<uint *>(gdk_pixbuf_get_pixels(pixbuf));
+	switch (type) {
+	case DXT1: ddsDecodeDXT1(width, height, buf, pixels); break;
+	case DXT2: ddsDecodeDXT2(width, height, buf, pixels); break;
+	case DXT3: ddsDecodeDXT3(width, height, buf, pixels); break;
+	case DXT4: ddsDecodeDXT4(width, height, buf, pixels); break;
+	case DXT5: ddsDecodeDXT5(width, height, buf, pixels); break;
+	case A1R5G5B5: ddsReadA1R5G5B5(width, height, buf, pixels); break;
+	case X1R5G5B5: ddsReadX1R5G5B5(width, height, buf, pixels); break;
+	case A4R4G4B4: ddsReadA4R4G4B4(width, height, buf, pixels); break;
+	case X4R4G4B4: ddsReadX4R4G4B4(width, height, buf, pixels); break;
+	case R5G6B5: ddsReadR5G6B5(width, height, buf, pixels); break;
+	case R8G8B8: ddsReadR8G8B8(width, height, buf, pixels); break;
+	case A8B8G8R8: ddsReadA8B8G8R8(width, height, buf, pixels); break;
+	case X8B8G8R8: ddsReadX8B8G8R8(width, height, buf, pixels); break;
+	case A8R8G8B8: ddsReadA8R8G8B8(width, height, buf, pixels); break;
+	case X8R8G8B8: ddsReadX8R8G8B8(width, height, buf, pixels); break;
+	default:
+		break;
 	}
+	area_updated_cb(nullptr, 0, 0, width, height, data);
+	chunk_size = count;
+	return TRUE;
 }
 
 void ImageLoaderDDS::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -117,7 +118,11 @@ gboolean ImageLoaderEXR::write(const guchar *buffer, gsize &chunk_size, gsize co
 		file.readPixels(dw.min.y, dw.max.y);
 
 		// Convert EXR pixel data to GdkPixbuf format (8-bit RGBA)
-		auto *image_data = g_new0(guchar, width * height * 4);
+		/* EXR always has alpha, so the rows are not padded */
+		pixbuf = pixbuf_pool_new(TRUE, width, height);
+		if (!pixbuf) return false;
+
+		guchar *image_data = gdk_pixbuf_get_pixels(pixbuf);
 		for (gint y = 0; y < height; ++y)
 			{
 			for (gint x = 0; x < width; ++x)
@@ -138,10 +143,6 @@ gboolean ImageLoaderEXR::write(const guchar *buffer, gsize &chunk_size, gsize co
 				}
 			}
 
-		/* Create GdkPixbuf from raw RGBA data
-		 * EXR always has alpha */
-		pixbuf = gdk_pixbuf_new_from_data(image_data, GDK_COLORSPACE_RGB, TRUE, 8, width, height, width * 4, free_pixels, nullptr);
-
 		area_updated_cb(nullptr, 0, 0, width, height, data);
 
 		chunk_size = count;
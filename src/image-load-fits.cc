@@ -25,6 +25,7 @@
 #include <limits>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -108,7 +109,7 @@ gboolean ImageLoaderFITS::write(const guchar *buf, gsize &chunk_size, gsize coun
 	fits_close_file(fptr, &status);
 
 	/* Create a GdkPixbuf in RGB format (24-bit depth, 8 bits per channel) */
-	g_autoptr(GdkPixbuf) pixbuf_tmp = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	g_autoptr(GdkPixbuf) pixbuf_tmp = pixbuf_pool_new(FALSE, width, height);
 	if (!pixbuf_tmp)
 		{
 		log_printf("Failed to create GdkPixbuf for .fits file");
@@ -32,6 +32,7 @@
 #include "image-load.h"
 #include "intl.h"
 #include "misc.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -188,20 +189,26 @@ gboolean ImageLoaderJ2K::write(const guchar *buf, gsize &chunk_size, gsize count
 	const gint width = image->comps[0].w;
 	const gint height = image->comps[0].h;
 
-	auto *pixels = g_new0(guchar, width * bytes_per_pixel * height);
+	pixbuf = pixbuf_pool_new(FALSE, width, height);
+	if (!pixbuf)
+		{
+		log_printf("%s", _("Couldn't allocate JP2 image"));
+		return FALSE;
+		}
+
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
 	for (gint y = 0; y < height; y++)
 		{
 		for (gint b = 0; b < bytes_per_pixel; b++)
 			{
 			for (gint x = 0; x < width; x++)
 				{
-				pixels[((y * width + x) * bytes_per_pixel) + b] = image->comps[b].data[(y * width) + x];
+				pixels[(y * rowstride) + (x * bytes_per_pixel) + b] = image->comps[b].data[(y * width) + x];
 				}
 			}
 		}
 
-	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, FALSE , 8, width, height, width * bytes_per_pixel, free_pixels, nullptr);
-
 	area_updated_cb(nullptr, 0, 0, width, height, data);
 
 	chunk_size = count;
@@ -42,6 +42,7 @@
 #include "image-load.h"
 #include "intl.h"
 #include "jpeg-parser.h"
+#include "pixbuf-pool.h"
 #include "pixbuf-renderer.h"
 
 /* error handler data */
@@ -54,7 +55,7 @@ struct error_handler_data {
 /* explode gray image data from jpeg library into rgb components in pixbuf */
 static void
 explode_gray_into_buf (struct jpeg_decompress_struct *cinfo,
-		       guchar **lines)
+		       guchar **lines, gint num_lines)
 {
 	gint i;
 	gint j;
@@ -68,7 +69,7 @@ explode_gray_into_buf (struct jpeg_decompress_struct *cinfo,
 	 * memory down, so we can use the same buffer.
 	 */
 	w = cinfo->output_width;
-	for (i = cinfo->rec_outbuf_height - 1; i >= 0; i--) {
+	for (i = num_lines - 1; i >= 0; i--) {
 		guchar *from;
 		guchar *to;
 
@@ -87,7 +88,7 @@ explode_gray_into_buf (struct jpeg_decompress_struct *cinfo,
 
 static void
 convert_cmyk_to_rgb (struct jpeg_decompress_struct *cinfo,
-		     guchar **lines)
+		     guchar **lines, gint num_lines)
 {
 	gint i;
 	guint j;
@@ -96,7 +97,7 @@ convert_cmyk_to_rgb (struct jpeg_decompress_struct *cinfo,
 	g_return_if_fail (cinfo->output_components == 4);
 	g_return_if_fail (cinfo->out_color_space == JCS_CMYK);
 
-	for (i = cinfo->rec_outbuf_height - 1; i >= 0; i--) {
+	for (i = num_lines - 1; i >= 0; i--) {
 		guchar *p;
 
 		p = lines[i];
@@ -171,6 +172,24 @@ output_message_handler (j_common_ptr)
 }
 
 
+static void image_loader_jpeg_convert_lines(struct jpeg_decompress_struct *cinfo, guchar **lines, gint num_lines)
+{
+	switch (cinfo->out_color_space)
+		{
+		    case JCS_GRAYSCALE:
+		      explode_gray_into_buf (cinfo, lines, num_lines);
+		      break;
+		    case JCS_RGB:
+		      /* do nothing */
+		      break;
+		    case JCS_CMYK:
+		      convert_cmyk_to_rgb (cinfo, lines, num_lines);
+		      break;
+		    default:
+		      break;
+		}
+}
+
 static void image_loader_jpeg_read_scanline(struct jpeg_decompress_struct *cinfo, guchar **dptr, guint rowstride)
 {
 	guchar *lines[4];
@@ -184,22 +203,48 @@ static void image_loader_jpeg_read_scanline(struct jpeg_decompress_struct *cinfo
 		*dptr += rowstride;
 		}
 
-	jpeg_read_scanlines (cinfo, lines, cinfo->rec_outbuf_height);
+	const JDIMENSION num_lines = jpeg_read_scanlines (cinfo, lines, cinfo->rec_outbuf_height);
 
-	switch (cinfo->out_color_space)
+	image_loader_jpeg_convert_lines(cinfo, lines, num_lines);
+}
+
+/**
+ * @brief Reads the next scanlines into their rows of the pixbuf
+ * @returns The number of scanlines read, 0 if the decoder is suspended
+ */
+static guint image_loader_jpeg_read_scanlines(struct jpeg_decompress_struct *cinfo, GdkPixbuf *pixbuf)
+{
+	guchar *lines[4];
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf) + static_cast<gsize>(cinfo->output_scanline) * rowstride;
+	const gint max_lines = std::min<gint>(cinfo->rec_outbuf_height, cinfo->output_height - cinfo->output_scanline);
+
+	for (gint i = 0; i < max_lines; i++)
 		{
-		    case JCS_GRAYSCALE:
-		      explode_gray_into_buf (cinfo, lines);
-		      break;
-		    case JCS_RGB:
-		      /* do nothing */
-		      break;
-		    case JCS_CMYK:
-		      convert_cmyk_to_rgb (cinfo, lines);
-		      break;
-		    default:
-		      break;
+		lines[i] = pixels + static_cast<gsize>(i) * rowstride;
+		}
+
+	const JDIMENSION num_lines = jpeg_read_scanlines(cinfo, lines, max_lines);
+
+	image_loader_jpeg_convert_lines(cinfo, lines, num_lines);
+
+	return num_lines;
+}
+
+/**
+ * @brief Picks the smallest DCT scaling that still covers the requested size
+ */
+static void image_loader_jpeg_set_scale(struct jpeg_decompress_struct *cinfo, guint requested_width, guint requested_height)
+{
+	cinfo->scale_num = 1;
+	for (cinfo->scale_denom = 2; cinfo->scale_denom <= 8; cinfo->scale_denom *= 2) {
+		jpeg_calc_output_dimensions(cinfo);
+		if (cinfo->output_width < requested_width || cinfo->output_height < requested_height) {
+			cinfo->scale_denom /= 2;
+			break;
 		}
+	}
+	jpeg_calc_output_dimensions(cinfo);
 }
 
 
@@ -243,8 +288,231 @@ static void set_mem_src (j_decompress_ptr cinfo, const guchar *buffer, guint nby
 	src->next_input_byte = static_cast<const JOCTET *>(buffer);
 }
 
+enum {
+	JPEG_STREAM_HEADER_SIZE = 131072 /**< read before streaming, to find stereo MPO images */
+};
+
+enum JpegStreamStage {
+	JPEG_STREAM_HEADER,
+	JPEG_STREAM_START,
+	JPEG_STREAM_SCANLINES, /**< baseline, rows are shown as they are decoded */
+	JPEG_STREAM_SCANS,     /**< progressive, each complete scan is shown */
+	JPEG_STREAM_SCANS_OUTPUT_END, /**< progressive, a scan was shown, jpeg_finish_output() has to complete */
+	JPEG_STREAM_FINISH,
+	JPEG_STREAM_DONE
+};
+
+/* source of a file that is still being read */
+struct JpegStreamSource {
+	struct jpeg_source_mgr pub;
+	const JOCTET *end; /**< end of the data read so far */
+	gsize skip;        /**< bytes to skip that have not been read yet */
+};
+
+struct ImageLoaderJpegStream {
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+	JpegStreamSource src;
+	JpegStreamStage stage;
+	gint scan;        /**< last progressive scan read completely */
+	gint output_scan; /**< progressive scan shown in the pixbuf */
+};
+
+static boolean stream_fill_input_buffer (j_decompress_ptr)
+{
+	/* suspend the decoder until more of the file is read */
+	return FALSE;
+}
+static void stream_skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+	auto src = reinterpret_cast<JpegStreamSource *>(cinfo->src);
+
+	if (num_bytes <= 0) return;
+
+	const gsize skip = std::min<gsize>(num_bytes, src->pub.bytes_in_buffer);
+	src->pub.next_input_byte += skip;
+	src->pub.bytes_in_buffer -= skip;
+	src->skip += static_cast<gsize>(num_bytes) - skip;
+}
+static void set_stream_src (j_decompress_ptr cinfo, JpegStreamSource *src, const guchar *buffer)
+{
+	src->pub.init_source = init_source;
+	src->pub.fill_input_buffer = stream_fill_input_buffer;
+	src->pub.skip_input_data = stream_skip_input_data;
+	src->pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
+	src->pub.term_source = term_source;
+	src->pub.bytes_in_buffer = 0;
+	src->pub.next_input_byte = static_cast<const JOCTET *>(buffer);
+	src->end = static_cast<const JOCTET *>(buffer);
+	src->skip = 0;
+
+	cinfo->src = &src->pub;
+}
+static void update_stream_src (JpegStreamSource *src, const guchar *end)
+{
+	src->pub.bytes_in_buffer += static_cast<const JOCTET *>(end) - src->end;
+	src->end = static_cast<const JOCTET *>(end);
+
+	const gsize skip = std::min<gsize>(src->skip, src->pub.bytes_in_buffer);
+	src->pub.next_input_byte += skip;
+	src->pub.bytes_in_buffer -= skip;
+	src->skip -= skip;
+}
+
 
 gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize count, GError **error)
+{
+	if (!stream && chunk_size >= count)
+		{
+		if (!write_whole(buf, count, error)) return FALSE;
+
+		chunk_size = count;
+		return TRUE;
+		}
+
+	if (!stream)
+		{
+		/* a stereo image is only decoded from the whole file */
+		if (stream_whole || chunk_size < JPEG_STREAM_HEADER_SIZE) return TRUE;
+
+		JpegSegment seg;
+		if (jpeg_segment_find(buf, chunk_size, JPEG_MARKER_APP2, "MPF\x00", seg))
+			{
+			stream_whole = TRUE;
+			return TRUE;
+			}
+		}
+
+	return write_stream(buf, chunk_size, error);
+}
+
+/**
+ * @brief Decodes as much of the image as the data read so far allows
+ *
+ * The decoder suspends at the end of the data and resumes on the next call.
+ * Baseline images are shown row by row, progressive ones scan by scan.
+ */
+gboolean ImageLoaderJpeg::write_stream(const guchar *buf, gsize available, GError **error)
+{
+	if (!stream)
+		{
+		stream = new ImageLoaderJpegStream();
+		stream->cinfo.err = jpeg_std_error (&stream->jerr.pub);
+		stream->jerr.pub.error_exit = fatal_error_handler;
+		stream->jerr.pub.output_message = output_message_handler;
+		}
+
+	ImageLoaderJpegStream *s = stream;
+	s->jerr.error = error;
+
+	if (sigsetjmp(s->jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&s->cinfo);
+		delete s;
+		stream = nullptr;
+		return FALSE;
+		}
+
+	if (!s->cinfo.global_state)
+		{
+		jpeg_create_decompress(&s->cinfo);
+		set_stream_src(&s->cinfo, &s->src, buf);
+		}
+
+	update_stream_src(&s->src, buf + available);
+
+	if (s->stage == JPEG_STREAM_HEADER)
+		{
+		if (jpeg_read_header(&s->cinfo, TRUE) == JPEG_SUSPENDED) return TRUE;
+
+		requested_width = s->cinfo.image_width;
+		requested_height = s->cinfo.image_height;
+		size_prepared_cb(nullptr, requested_width, requested_height, data);
+
+		image_loader_jpeg_set_scale(&s->cinfo, requested_width, requested_height);
+		s->cinfo.buffered_image = jpeg_has_multiple_scans(&s->cinfo);
+		s->stage = JPEG_STREAM_START;
+		}
+
+	if (s->stage == JPEG_STREAM_START)
+		{
+		if (!jpeg_start_decompress(&s->cinfo)) return TRUE;
+
+		pixbuf = pixbuf_pool_new(s->cinfo.out_color_components == 4 ? TRUE : FALSE,
+		                         s->cinfo.output_width, s->cinfo.output_height);
+		if (!pixbuf) ERREXIT(&s->cinfo, JERR_OUT_OF_MEMORY);
+
+		/* blank until decoded */
+		gdk_pixbuf_fill(pixbuf, 0);
+
+		s->stage = s->cinfo.buffered_image ? JPEG_STREAM_SCANS : JPEG_STREAM_SCANLINES;
+		}
+
+	if (s->stage == JPEG_STREAM_SCANLINES)
+		{
+		while (s->cinfo.output_scanline < s->cinfo.output_height && !aborted)
+			{
+			const guint scanline = s->cinfo.output_scanline;
+			if (!image_loader_jpeg_read_scanlines(&s->cinfo, pixbuf)) return TRUE;
+			area_updated_cb(nullptr, 0, scanline, s->cinfo.output_width, s->cinfo.output_scanline - scanline, data);
+			}
+		if (aborted) return TRUE;
+
+		s->stage = JPEG_STREAM_FINISH;
+		}
+
+	while (s->stage == JPEG_STREAM_SCANS || s->stage == JPEG_STREAM_SCANS_OUTPUT_END)
+		{
+		if (s->stage == JPEG_STREAM_SCANS_OUTPUT_END)
+			{
+			/* reads on up to the next scan, so it suspends when the data ends before it */
+			if (!jpeg_finish_output(&s->cinfo)) return TRUE;
+
+			s->stage = JPEG_STREAM_SCANS;
+			}
+
+		gint ret;
+		do
+			{
+			ret = jpeg_consume_input(&s->cinfo);
+			if (ret == JPEG_SCAN_COMPLETED || ret == JPEG_REACHED_EOI) s->scan = s->cinfo.input_scan_number;
+			}
+		while (ret != JPEG_SUSPENDED && ret != JPEG_REACHED_EOI && !aborted);
+
+		if (aborted) return TRUE;
+
+		/* every output pass decodes the whole image, so show only the latest complete scan */
+		if (s->scan > s->output_scan)
+			{
+			jpeg_start_output(&s->cinfo, s->scan);
+			while (s->cinfo.output_scanline < s->cinfo.output_height)
+				{
+				if (!image_loader_jpeg_read_scanlines(&s->cinfo, pixbuf)) break;
+				}
+
+			s->output_scan = s->scan;
+			area_updated_cb(nullptr, 0, 0, s->cinfo.output_width, s->cinfo.output_height, data);
+
+			s->stage = JPEG_STREAM_SCANS_OUTPUT_END;
+			continue;
+			}
+
+		if (ret != JPEG_REACHED_EOI) return TRUE;
+
+		s->stage = JPEG_STREAM_FINISH;
+		}
+
+	if (s->stage == JPEG_STREAM_FINISH)
+		{
+		if (!jpeg_finish_decompress(&s->cinfo)) return TRUE;
+
+		s->stage = JPEG_STREAM_DONE;
+		}
+
+	return TRUE;
+}
+
+gboolean ImageLoaderJpeg::write_whole(const guchar *buf, gsize count, GError **error)
 {
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_decompress_struct cinfo2;
@@ -338,15 +606,7 @@ gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize coun
 	requested_height = cinfo.image_height;
 	size_prepared_cb(nullptr, requested_width, requested_height, data);
 
-	cinfo.scale_num = 1;
-	for (cinfo.scale_denom = 2; cinfo.scale_denom <= 8; cinfo.scale_denom *= 2) {
-		jpeg_calc_output_dimensions(&cinfo);
-		if (cinfo.output_width < (stereo ? requested_width / 2 : requested_width) || cinfo.output_height < requested_height) {
-			cinfo.scale_denom /= 2;
-			break;
-		}
-	}
-	jpeg_calc_output_dimensions(&cinfo);
+	image_loader_jpeg_set_scale(&cinfo, stereo ? requested_width / 2 : requested_width, requested_height);
 	if (stereo)
 		{
 		cinfo2.scale_num = cinfo.scale_num;
@@ -372,9 +632,8 @@ gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize coun
 		}
 
 
-	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
-				     cinfo.out_color_components == 4 ? TRUE : FALSE,
-	                 8, stereo ? cinfo.output_width * 2: cinfo.output_width, cinfo.output_height);
+	pixbuf = pixbuf_pool_new(cinfo.out_color_components == 4 ? TRUE : FALSE,
+	                         stereo ? cinfo.output_width * 2: cinfo.output_width, cinfo.output_height);
 
 	if (!pixbuf)
 		{
@@ -410,7 +669,6 @@ gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize coun
 		jpeg_destroy_decompress(&cinfo);
 		}
 
-	chunk_size = count;
 	return TRUE;
 }
 
@@ -443,6 +701,11 @@ void ImageLoaderJpeg::abort()
 
 ImageLoaderJpeg::~ImageLoaderJpeg()
 {
+	if (stream)
+		{
+		jpeg_destroy_decompress(&stream->cinfo);
+		delete stream;
+		}
 	if (pixbuf) g_object_unref(pixbuf);
 }
 
@@ -29,6 +29,8 @@
 
 #include "image-load.h"
 
+struct ImageLoaderJpegStream;
+
 struct ImageLoaderJpeg : public ImageLoaderBackend
 {
 public:
@@ -36,6 +38,8 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean has_scaled_decode() override { return TRUE; }
+	WriteMode get_write_mode() override { return WRITE_PARTIAL; }
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
@@ -43,6 +47,9 @@ public:
 	gchar **get_format_mime_types() override;
 
 private:
+	gboolean write_whole(const guchar *buf, gsize count, GError **error);
+	gboolean write_stream(const guchar *buf, gsize available, GError **error);
+
 	AreaUpdatedCb area_updated_cb;
 	SizePreparedCb size_prepared_cb;
 
@@ -54,6 +61,9 @@ private:
 
 	gboolean aborted;
 	gboolean stereo;
+
+	ImageLoaderJpegStream *stream; /**< decoder state while the file is still being read */
+	gboolean stream_whole;         /**< a stereo image is decoded once the whole file is read */
 };
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_jpeg();
@@ -52,8 +52,7 @@
 
 #include "image-load-jpegxl.h"
 
-#include <cstdint>
-#include <cstdlib>
+#include <cstddef>
 #include <memory>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -64,6 +63,7 @@
 #include <jxl/types.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -74,41 +74,84 @@ public:
 	~ImageLoaderJPEGXL() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	WriteMode get_write_mode() override { return WRITE_PARTIAL; }
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
 
 private:
+	gboolean set_out_buffer(gboolean partial);
+
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+
+	JxlDecoderPtr dec;
+	JxlBasicInfo info;
+	gsize consumed;   /**< bytes of the buffer the decoder has taken */
+	gsize flushed;    /**< bytes read when the partial image was last shown */
+	gboolean decoded; /**< the first frame is complete */
 };
 
-uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride)
+gboolean ImageLoaderJPEGXL::set_out_buffer(gboolean partial)
 {
-	JxlDecoderPtr dec = JxlDecoderMake(nullptr);
-	if (!dec)
+	JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
+	size_t buffer_size;
+
+	if (JXL_DEC_SUCCESS != JxlDecoderImageOutBufferSize(dec.get(), &format, &buffer_size))
 		{
-		log_printf("JxlDecoderCreate failed\n");
-		return nullptr;
+		log_printf("JxlDecoderImageOutBufferSize failed\n");
+		return FALSE;
 		}
-	if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE))
+
+	if (!pixbuf)
 		{
-		log_printf("JxlDecoderSubscribeEvents failed\n");
-		return nullptr;
+		pixbuf = pixbuf_pool_new(TRUE, info.xsize, info.ysize);
+		if (!pixbuf) return FALSE;
+
+		/* what is not decoded yet is shown while the rest of the file is read */
+		if (partial) gdk_pixbuf_fill(pixbuf, 0);
 		}
 
-	/* Avoid compiler warning - used uninitialized */
-	/* This file will be replaced by libjxl at some time */
-	ysize = 0;
-	stride = 0;
-	
-	std::unique_ptr<uint8_t, decltype(&free)> pixels{nullptr, free};
-	JxlBasicInfo info;
-	JxlPixelFormat format = {4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
-	JxlDecoderSetInput(dec.get(), next_in, size);
+	if (buffer_size != static_cast<size_t>(gdk_pixbuf_get_rowstride(pixbuf)) * info.ysize)
+		{
+		log_printf("Invalid out buffer size %zu\n", buffer_size);
+		return FALSE;
+		}
+
+	if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(), &format, gdk_pixbuf_get_pixels(pixbuf), buffer_size))
+		{
+		log_printf("JxlDecoderSetImageOutBuffer failed\n");
+		return FALSE;
+		}
+
+	return TRUE;
+}
+
+gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
+{
+	if (decoded) return TRUE;
+
+	if (!dec)
+		{
+		dec = JxlDecoderMake(nullptr);
+		if (!dec)
+			{
+			log_printf("JxlDecoderCreate failed\n");
+			return FALSE;
+			}
+		if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE))
+			{
+			log_printf("JxlDecoderSubscribeEvents failed\n");
+			return FALSE;
+			}
+		}
+
+	/* the buffer holds everything read so far, give the decoder what it has not seen */
+	JxlDecoderSetInput(dec.get(), buf + consumed, chunk_size - consumed);
 
 	for (;;)
 		{
@@ -118,83 +161,56 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 			{
 			case JXL_DEC_ERROR:
 				log_printf("Decoder error\n");
-				return nullptr;
+				return FALSE;
 			case JXL_DEC_NEED_MORE_INPUT:
-				log_printf("Error, already provided all input\n");
-				return nullptr;
+				consumed = chunk_size - JxlDecoderReleaseInput(dec.get());
+				if (chunk_size == count)
+					{
+					log_printf("Error, already provided all input\n");
+					return pixbuf != nullptr;
+					}
+
+				/* show the passes decoded so far, every eighth of the file */
+				if (pixbuf && chunk_size - flushed >= count / 8 &&
+				    JxlDecoderFlushImage(dec.get()) == JXL_DEC_SUCCESS)
+					{
+					flushed = chunk_size;
+					area_updated_cb(nullptr, 0, 0, info.xsize, info.ysize, data);
+					}
+				return TRUE;
 			case JXL_DEC_BASIC_INFO:
 				if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &info))
 					{
 					log_printf("JxlDecoderGetBasicInfo failed\n");
-					return nullptr;
+					return FALSE;
 					}
-				xsize = info.xsize;
-				ysize = info.ysize;
-				stride = info.xsize * 4;
+				size_prepared_cb(nullptr, info.xsize, info.ysize, data);
 				break;
 			case JXL_DEC_NEED_IMAGE_OUT_BUFFER:
-				{
-				size_t buffer_size;
-				if (JXL_DEC_SUCCESS != JxlDecoderImageOutBufferSize(dec.get(), &format, &buffer_size))
-					{
-					log_printf("JxlDecoderImageOutBufferSize failed\n");
-					return nullptr;
-					}
-				if (buffer_size != stride * ysize)
-					{
-					log_printf("Invalid out buffer size %zu %zu\n", buffer_size, stride * ysize);
-					return nullptr;
-					}
-				size_t pixels_buffer_size = buffer_size * sizeof(uint8_t);
-				pixels.reset(static_cast<uint8_t *>(malloc(pixels_buffer_size)));
-				if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(), &format, pixels.get(), pixels_buffer_size))
-					{
-					log_printf("JxlDecoderSetImageOutBuffer failed\n");
-					return nullptr;
-					}
-				}
+				if (!set_out_buffer(chunk_size < count)) return FALSE;
 				break;
 			case JXL_DEC_FULL_IMAGE:
 				// This means the decoder has decoded all pixels into the buffer.
-				return pixels.release();
+				JxlDecoderReleaseInput(dec.get());
+				decoded = TRUE;
+				area_updated_cb(nullptr, 0, 0, info.xsize, info.ysize, data);
+				return TRUE;
 			case JXL_DEC_SUCCESS:
 				log_printf("Decoding finished before receiving pixel data\n");
-				return nullptr;
+				return FALSE;
 			default:
 				log_printf("Unexpected decoder status: %d\n", status);
-				return nullptr;
+				return FALSE;
 			}
 		}
 
-	return nullptr;
-}
-
-gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
-{
-	gboolean ret = FALSE;
-	size_t xsize;
-	size_t ysize;
-	size_t stride;
-	uint8_t *pixels = nullptr;
-
-	pixels = JxlMemoryToPixels(buf, count, xsize, ysize, stride);
-
-	if (pixels)
-		{
-		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, TRUE, 8, xsize, ysize, stride, free_pixels, nullptr);
-
-		area_updated_cb(nullptr, 0, 0, xsize, ysize, data);
-
-		chunk_size = count;
-		ret = TRUE;
-		}
-
-	return ret;
+	return FALSE;
 }
 
-void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
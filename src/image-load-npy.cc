@@ -25,6 +25,7 @@
 #include <string>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -96,12 +97,21 @@ GdkPixbuf *load_npy_to_pixbuf(gchar *buf)
 		return nullptr;
 		}
 
-	const guint8 *pixel_data = reinterpret_cast<guint8*>(buf + offset);
-	GdkPixbuf *pixbuf = gdk_pixbuf_new_from_data(pixel_data, GDK_COLORSPACE_RGB, false, 8, width, height, width * channels, nullptr, nullptr);
+	GdkPixbuf *pixbuf = pixbuf_pool_new(FALSE, width, height);
 
 	if (!pixbuf)
 		{
 		log_printf("Failed to create GdkPixbuf");
+		return nullptr;
+		}
+
+	/* the rows are copied as buf is not owned */
+	const guint8 *pixel_data = reinterpret_cast<guint8*>(buf + offset);
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+	for (gint y = 0; y < height; y++)
+		{
+		memcpy(pixels + static_cast<gsize>(y) * rowstride, pixel_data + static_cast<gsize>(y) * width * channels, static_cast<gsize>(width) * channels);
 		}
 
 	return pixbuf;
@@ -109,8 +119,8 @@ GdkPixbuf *load_npy_to_pixbuf(gchar *buf)
 
 gboolean ImageLoaderNPY::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
-	g_autoptr(GdkPixbuf) pixbuf_tmp = load_npy_to_pixbuf(reinterpret_cast<gchar *>(const_cast<guchar *>(buf)));
-	if (!pixbuf_tmp)
+	pixbuf = load_npy_to_pixbuf(reinterpret_cast<gchar *>(const_cast<guchar *>(buf)));
+	if (!pixbuf)
 		{
 		log_printf("Failed to load image from buffer");
 
@@ -119,7 +129,6 @@ gboolean ImageLoaderNPY::write(const guchar *buf, gsize &chunk_size, gsize count
 		return 1;
 		}
 
-	pixbuf = gdk_pixbuf_copy(pixbuf_tmp); // A copy of buf is required since it is not owned
 	chunk_size = count;
 
 	area_updated_cb(nullptr, 0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf), data);
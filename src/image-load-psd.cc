@@ -58,6 +58,7 @@
 #include <glib.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -429,8 +430,7 @@ gboolean ImageLoaderPSD::write(const guchar *input_buf, gsize &chunk_size, gsize
 
 					/* TODO: Avoid leaking pixbuf on load failure.
 					   (Note that free_context does _not_ free ctx->pixbuf) */
-					ctx->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB,
-						FALSE, 8, ctx->width, ctx->height);
+					ctx->pixbuf = pixbuf_pool_new(FALSE, ctx->width, ctx->height);
 
 					if (ctx->lines_lengths == nullptr || ctx->buffer == nullptr ||
 						ctx->pixbuf == nullptr)
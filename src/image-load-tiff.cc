@@ -38,6 +38,7 @@
 #include <tiffio.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -228,25 +229,16 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 	requested_height = height;
 	size_prepared_cb(nullptr, requested_width, requested_height, data);
 
-	pixels = static_cast<guchar *>(g_try_malloc (bytes));
-
-	if (!pixels)
+	/* rows of four channels are not padded, so they match the raster of libtiff */
+	pixbuf = pixbuf_pool_new(TRUE, width, height);
+	if (!pixbuf)
 		{
 		DEBUG_1("Insufficient memory to open TIFF file: need %zu", bytes);
 		TIFFClose(tiff);
 		return FALSE;
 		}
 
-	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, TRUE, 8,
-	                                  width, height, rowstride,
-	                                  free_pixels, nullptr);
-	if (!pixbuf)
-		{
-		g_free (pixels);
-		DEBUG_1("Insufficient memory to open TIFF file");
-		TIFFClose(tiff);
-		return FALSE;
-		}
+	pixels = gdk_pixbuf_get_pixels(pixbuf);
 
 	if (TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip))
 		{
@@ -26,6 +26,7 @@
 #include <webp/decode.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -36,6 +37,9 @@ public:
 	~ImageLoaderWEBP() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean has_scaled_decode() override { return TRUE; }
+	WriteMode get_write_mode() override { return WRITE_PARTIAL; }
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -43,63 +47,109 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	gint requested_width;
+	gint requested_height;
+
+	WebPDecoderConfig config; /**< used by idec until it is deleted */
+	WebPIDecoder *idec;
+	gint decoded_rows;
 };
 
 gboolean ImageLoaderWEBP::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
-	guint8* pixels;
-	gint width;
-	gint height;
-	gboolean res_info;
-	WebPBitstreamFeatures features;
 	VP8StatusCode status_code;
 
-	res_info = WebPGetInfo(buf, count, &width, &height);
-	if (!res_info)
+	if (!idec)
 		{
-		log_printf("warning: webp reader error\n");
-		return FALSE;
+		gint width;
+		gint height;
+
+		if (!WebPInitDecoderConfig(&config))
+			{
+			log_printf("warning: webp reader error\n");
+			return FALSE;
+			}
+
+		status_code = WebPGetFeatures(buf, chunk_size, &config.input);
+		if (status_code == VP8_STATUS_NOT_ENOUGH_DATA && chunk_size < count) return TRUE;
+		if (status_code != VP8_STATUS_OK)
+			{
+			log_printf("warning: webp reader error\n");
+			return FALSE;
+			}
+
+		width = config.input.width;
+		height = config.input.height;
+
+		/* the loader calls set_size() from here when a smaller image is requested */
+		size_prepared_cb(nullptr, width, height, data);
+
+		if (requested_width > 0 && requested_height > 0 &&
+		    (requested_width < width || requested_height < height))
+			{
+			config.options.use_scaling = 1;
+			config.options.scaled_width = requested_width;
+			config.options.scaled_height = requested_height;
+			width = requested_width;
+			height = requested_height;
+			}
+
+		pixbuf = pixbuf_pool_new(config.input.has_alpha, width, height);
+		if (!pixbuf) return FALSE;
+
+		/* rows not decoded yet are shown while the rest of the file is read */
+		if (chunk_size < count) gdk_pixbuf_fill(pixbuf, 0);
+
+		/* decode straight into the pixbuf */
+		config.output.colorspace = config.input.has_alpha ? MODE_RGBA : MODE_RGB;
+		config.output.is_external_memory = 1;
+		config.output.u.RGBA.rgba = gdk_pixbuf_get_pixels(pixbuf);
+		config.output.u.RGBA.stride = gdk_pixbuf_get_rowstride(pixbuf);
+		config.output.u.RGBA.size = gdk_pixbuf_get_byte_length(pixbuf);
+
+		idec = WebPIDecode(nullptr, 0, &config);
+		if (!idec)
+			{
+			log_printf("warning: webp reader error\n");
+			return FALSE;
+			}
 		}
 
-	status_code = WebPGetFeatures(buf, count, &features);
-	if (status_code != VP8_STATUS_OK)
+	/* the buffer holds everything read so far */
+	status_code = WebPIUpdate(idec, buf, chunk_size);
+	if (status_code != VP8_STATUS_OK && status_code != VP8_STATUS_SUSPENDED)
 		{
 		log_printf("warning: webp reader error\n");
 		return FALSE;
 		}
 
-	if (features.has_alpha)
-		{
-		pixels = WebPDecodeRGBA(buf, count, &width, &height);
-		}
-	else
-		{
-		pixels = WebPDecodeRGB(buf, count, &width, &height);
-		}
-
-	if (pixels)
+	gint last_y = 0;
+	if (WebPIDecGetRGB(idec, &last_y, nullptr, nullptr, nullptr) && last_y > decoded_rows)
 		{
-		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, features.has_alpha, 8, width, height, width * (features.has_alpha ? 4 : 3), free_pixels, nullptr);
-
-		area_updated_cb(nullptr, 0, 0, width, height, data);
-
-		chunk_size = count;
-
-		return TRUE;
+		area_updated_cb(nullptr, 0, decoded_rows, gdk_pixbuf_get_width(pixbuf), last_y - decoded_rows, data);
+		decoded_rows = last_y;
 		}
 
-	return FALSE;
+	return TRUE;
 }
 
-void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderWEBP::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
 GdkPixbuf *ImageLoaderWEBP::get_pixbuf()
 {
 	return pixbuf;
@@ -118,6 +168,7 @@ gchar **ImageLoaderWEBP::get_format_mime_types()
 
 ImageLoaderWEBP::~ImageLoaderWEBP()
 {
+	if (idec) WebPIDelete(idec);
 	if (pixbuf) g_object_unref(pixbuf);
 }
 
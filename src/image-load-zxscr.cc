@@ -25,6 +25,7 @@
 #include <glib.h>
 
 #include "image-load.h"
+#include "pixbuf-pool.h"
 
 namespace
 {
@@ -94,22 +95,16 @@ gboolean ImageLoaderZXSCR::write(const guchar *buf, gsize &chunk_size, gsize cou
 	width = 256;
 	height = 192;
 
-	pixels = static_cast<guint8 *>(g_try_malloc(width * height * 3));
-
-	if (!pixels)
-		{
-		log_printf("Error: zxscr reader error\n");
-		return FALSE;
-		}
-
-	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, FALSE, 8, width, height, width * 3, free_pixels, nullptr);
+	/* rows of 256 pixels are not padded */
+	pixbuf = pixbuf_pool_new(FALSE, width, height);
 
 	if (!pixbuf)
 		{
-		g_free(pixels);
 		DEBUG_1("Insufficient memory to open ZXSCR file");
 		return FALSE;
 		}
+
+	pixels = gdk_pixbuf_get_pixels(pixbuf);
 	//let's decode screen
 	for (row = 0; row < 24; row++)
 		for (col = 0; col < 32; col++)
@@ -21,9 +21,15 @@
 
 #include "image-load.h"
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <deque>
 
 #include <config.h>
 
@@ -86,7 +92,8 @@ struct ExifData;
 
 enum {
 	IMAGE_LOADER_READ_BUFFER_SIZE_DEFAULT = 	4096,
-	IMAGE_LOADER_IDLE_READ_LOOP_COUNT_DEFAULT = 	1
+	IMAGE_LOADER_IDLE_READ_LOOP_COUNT_DEFAULT = 	1,
+	IMAGE_LOADER_STREAM_READ_SIZE = 		65536 /**< bytes read at a time from a remote file */
 };
 
 /* image loader class */
@@ -135,23 +142,29 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 	il->pixbuf = nullptr;
 	il->idle_id = 0;
 	il->idle_priority = G_PRIORITY_DEFAULT_IDLE;
+	il->priority_class = IMAGE_LOADER_PRIORITY_VISIBLE;
+	il->queue_time = 0;
 	il->done = FALSE;
 	il->backend.reset(nullptr);
 
 	il->bytes_read = 0;
 	il->bytes_total = 0;
+	il->bytes_available = 0;
 
 	il->idle_done_id = 0;
 
 	il->idle_read_loop_count = IMAGE_LOADER_IDLE_READ_LOOP_COUNT_DEFAULT;
 	il->read_buffer_size = IMAGE_LOADER_READ_BUFFER_SIZE_DEFAULT;
 	il->mapped_file = nullptr;
+	il->stream_fd = -1;
 	il->preview = IMAGE_LOADER_PREVIEW_NONE;
 
 	il->requested_width = 0;
 	il->requested_height = 0;
 	il->actual_width = 0;
 	il->actual_height = 0;
+	il->source_width = 0;
+	il->source_height = 0;
 	il->shrunk = FALSE;
 
 	il->can_destroy = TRUE;
@@ -534,6 +547,8 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 	g_mutex_lock(il->data_mutex);
 	il->actual_width = width;
 	il->actual_height = height;
+	il->source_width = width;
+	il->source_height = height;
 	if (il->requested_width < 1 || il->requested_height < 1)
 		{
 		g_mutex_unlock(il->data_mutex);
@@ -547,6 +562,8 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 		scale = TRUE;
 #endif
 
+	if (!scale) scale = il->backend->has_scaled_decode();
+
 	if (!scale)
 		{
 		g_auto(GStrv) mime_types = il->backend->get_format_mime_types();
@@ -802,6 +819,91 @@ static void image_loader_error(ImageLoader *il)
 	image_loader_emit_error(il);
 }
 
+/**
+ * @brief Reads more of a file that is not mapped, blocks until it is read
+ * @param size Bytes to read at most
+ * @returns FALSE on read errors, and if the file has become shorter
+ */
+static gboolean image_loader_stream_read(ImageLoader *il, gsize size)
+{
+	if (il->stream_fd == -1) return TRUE;
+
+	const gsize end = std::min(il->bytes_total, il->bytes_available + size);
+	while (il->bytes_available < end)
+		{
+		const ssize_t n = read(il->stream_fd, il->mapped_file + il->bytes_available, end - il->bytes_available);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0)
+			{
+			DEBUG_1("image loader read error at %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT ": %s", il->bytes_available, il->bytes_total, il->fd->path);
+			return FALSE;
+			}
+
+		il->bytes_available += n;
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Maps a streamed file instead, for backends that need the whole file at once
+ * @returns FALSE if the file can not be mapped
+ */
+static gboolean image_loader_stream_to_map(ImageLoader *il)
+{
+	if (il->stream_fd == -1) return TRUE;
+
+	close(il->stream_fd);
+	il->stream_fd = -1;
+	g_clear_pointer(&il->mapped_file, g_free);
+
+	g_autofree gchar *pathl = path_from_utf8(il->fd->path);
+	il->mapped_file = map_file(pathl, il->bytes_total);
+	if (!il->mapped_file) return FALSE;
+
+	il->bytes_available = il->bytes_total;
+
+	return TRUE;
+}
+
+/**
+ * @brief Hands the next part of the file to the backend, reading it first if the file is streamed
+ * @returns FALSE on errors
+ */
+static gboolean image_loader_write_next(ImageLoader *il)
+{
+	gsize b;
+
+	switch (il->backend->get_write_mode())
+		{
+		case ImageLoaderBackend::WRITE_PARTIAL:
+			if (il->bytes_available == il->bytes_read &&
+			    !image_loader_stream_read(il, IMAGE_LOADER_STREAM_READ_SIZE)) return FALSE;
+
+			b = il->bytes_available;
+			if (!il->backend->write(il->mapped_file, b, il->bytes_total, &il->error)) return FALSE;
+
+			il->bytes_read = il->bytes_available;
+			return TRUE;
+		case ImageLoaderBackend::WRITE_CHUNKS:
+			b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+			if (il->bytes_read + b > il->bytes_available &&
+			    !image_loader_stream_read(il, std::max<gsize>(b, IMAGE_LOADER_STREAM_READ_SIZE))) return FALSE;
+			break;
+		case ImageLoaderBackend::WRITE_WHOLE:
+		default:
+			/* mapped, see image_loader_stream_to_map() */
+			b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+			break;
+		}
+
+	if (!il->backend->write(il->mapped_file + il->bytes_read, b, il->bytes_total, &il->error)) return FALSE;
+
+	il->bytes_read += b;
+
+	return il->bytes_read <= il->bytes_total;
+}
+
 static gboolean image_loader_continue(ImageLoader *il)
 {
 	gint c;
@@ -817,22 +919,12 @@ static gboolean image_loader_continue(ImageLoader *il)
 			return G_SOURCE_REMOVE;
 			}
 
-		if (il->bytes_total < il->bytes_read)
+		if (!image_loader_write_next(il))
 			{
 			image_loader_error(il);
 			return G_SOURCE_REMOVE;
 			}
 
-		gsize b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
-
-		if (!il->backend->write(il->mapped_file + il->bytes_read, b, il->bytes_total, &il->error))
-			{
-			image_loader_error(il);
-			return G_SOURCE_REMOVE;
-			}
-
-		il->bytes_read += b;
-
 		c--;
 		}
 
@@ -850,12 +942,20 @@ static gboolean image_loader_begin(ImageLoader *il)
 
 	if (il->bytes_total <= il->bytes_read) return FALSE;
 
-	gsize b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+	/* a streamed file must be read far enough to recognise the format */
+	if (!image_loader_stream_read(il, IMAGE_LOADER_STREAM_READ_SIZE)) return FALSE;
 
 	image_loader_setup_loader(il);
 
+	if (il->backend->get_write_mode() == ImageLoaderBackend::WRITE_WHOLE &&
+	    !image_loader_stream_to_map(il))
+		{
+		image_loader_stop_loader(il);
+		return FALSE;
+		}
+
 	g_assert(il->bytes_read == 0);
-	if (!il->backend->write(il->mapped_file, b, il->bytes_total, &il->error))
+	if (!image_loader_write_next(il))
 		{
 		image_loader_stop_loader(il);
 		return FALSE;
@@ -863,28 +963,18 @@ static gboolean image_loader_begin(ImageLoader *il)
 
 	file_data_set_page_total(il->fd, il->backend->get_page_total());
 
-	il->bytes_read += b;
-
 	/* read until size is known */
-	while (il->backend && !il->backend->get_pixbuf() && b > 0 && !image_loader_get_stopping(il))
+	while (il->backend && !il->backend->get_pixbuf() && il->bytes_read < il->bytes_total && !image_loader_get_stopping(il))
 		{
-		if (il->bytes_total < il->bytes_read)
-			{
-			image_loader_stop_loader(il);
-			return FALSE;
-			}
-
-		b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
-		if (b > 0 && !il->backend->write(il->mapped_file + il->bytes_read, b, il->bytes_total, &il->error))
+		if (!image_loader_write_next(il))
 			{
 			image_loader_stop_loader(il);
 			return FALSE;
 			}
-		il->bytes_read += b;
 		}
 	if (!il->pixbuf) image_loader_sync_pixbuf(il);
 
-	if (il->bytes_read == il->bytes_total || b < 1)
+	if (il->bytes_read == il->bytes_total)
 		{
 		/* done, handle (broken) loaders that do not have pixbuf till close */
 		image_loader_stop_loader(il);
@@ -908,6 +998,40 @@ static gboolean image_loader_begin(ImageLoader *il)
 /* the following functions are always executed in the main thread */
 
 
+/**
+ * @brief Files on remote filesystems are not mapped but read progressively
+ * in the loader, so that the backends can show what has arrived so far
+ *
+ * Backends that take only the whole file get it mapped, see image_loader_begin().
+ */
+static gboolean image_loader_open_stream(ImageLoader *il, const gchar *path)
+{
+	const gint stream_fd = open(path, O_RDONLY);
+	if (stream_fd == -1) return FALSE;
+
+	struct stat st;
+	if (fstat(stream_fd, &st) == -1 || st.st_size <= 0)
+		{
+		close(stream_fd);
+		return FALSE;
+		}
+
+	il->mapped_file = static_cast<guchar *>(g_try_malloc(st.st_size));
+	if (!il->mapped_file)
+		{
+		close(stream_fd);
+		return FALSE;
+		}
+
+	DEBUG_1("image loader reads remote file progressively: %s", il->fd->path);
+
+	il->stream_fd = stream_fd;
+	il->bytes_total = st.st_size;
+	il->bytes_available = 0;
+
+	return TRUE;
+}
+
 static gboolean image_loader_setup_source(ImageLoader *il)
 {
 	if (!il || il->backend || il->mapped_file) return FALSE;
@@ -969,14 +1093,22 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 		/* normal file */
 		g_autofree gchar *pathl = path_from_utf8(il->fd->path);
 
+		il->preview = IMAGE_LOADER_PREVIEW_NONE;
+
+		if (is_remote_file(pathl))
+			{
+			return image_loader_open_stream(il, pathl);
+			}
+
 		il->mapped_file = map_file(pathl, il->bytes_total); // bytes_total written from fs.stsize
 		if (!il->mapped_file)
 			{
 			return FALSE;
 			}
-		il->preview = IMAGE_LOADER_PREVIEW_NONE;
 		}
 
+	il->bytes_available = il->bytes_total;
+
 	return TRUE;
 }
 
@@ -994,6 +1126,12 @@ static void image_loader_stop_source(ImageLoader *il)
 			{
 			libraw_free_preview(il->mapped_file);
 			}
+		else if (il->stream_fd != -1)
+			{
+			close(il->stream_fd);
+			il->stream_fd = -1;
+			g_free(il->mapped_file);
+			}
 		else
 			{
 			munmap(il->mapped_file, il->bytes_total);
@@ -1008,6 +1146,12 @@ static void image_loader_stop(ImageLoader *il)
 
 	g_clear_handle_id(&il->idle_id, g_source_remove);
 
+	if (il->thread && image_loader_scheduler_cancel(il))
+		{
+		/* never started, no thread uses it */
+		il->can_destroy = TRUE;
+		}
+
 	if (il->thread)
 		{
 		/* stop loader in the other thread */
@@ -1097,55 +1241,182 @@ static gboolean image_loader_start_idle(ImageLoader *il)
 /**************************************************************************************/
 /* execution via thread */
 
-static GThreadPool *image_loader_thread_pool = nullptr;
+/**
+ * @brief Scheduler of the threaded loaders
+ *
+ * Loaders are queued by #ImageLoaderPriorityClass and handed to the thread
+ * pool only when a thread is free, the highest class first. Each class has
+ * a limit of concurrent loaders, and one thread is always kept free for the
+ * visible class. Thumbnail and background loaders also pause between
+ * reads while a visible image is loading.
+ *
+ * All members are protected by \a mutex.
+ */
+struct ImageLoaderScheduler
+{
+	GThreadPool *pool;
+	GMutex mutex;
+	GCond visible_cond; /**< signalled when no visible loader runs */
+	std::deque<ImageLoader *> queue[IMAGE_LOADER_PRIORITY_COUNT];
+	gint running[IMAGE_LOADER_PRIORITY_COUNT];
+	gint limit[IMAGE_LOADER_PRIORITY_COUNT];
+	gint running_total;
+	gint max_threads;
+
+	/* counters for the debug log */
+	guint64 started[IMAGE_LOADER_PRIORITY_COUNT];
+	guint64 cancelled[IMAGE_LOADER_PRIORITY_COUNT];
+	gint64 wait_time[IMAGE_LOADER_PRIORITY_COUNT]; /**< total time queued, microseconds */
+	gsize max_queued[IMAGE_LOADER_PRIORITY_COUNT];
+};
+
+static ImageLoaderScheduler image_loader_scheduler;
 
-static GCond *image_loader_prio_cond = nullptr;
-static GMutex *image_loader_prio_mutex = nullptr;
-static gint image_loader_prio_num = 0;
+static const gchar *image_loader_priority_class_names[] = {"visible", "read-ahead", "thumbnail", "background"};
 
+static void image_loader_thread_run(gpointer data, gpointer);
 
-static void image_loader_thread_enter_high()
+static void image_loader_scheduler_init()
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num++;
-	g_mutex_unlock(image_loader_prio_mutex);
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+	if (sched.pool) return;
+
+	const gint cores = get_cpu_cores();
+
+	sched.max_threads = cores + 1;
+	sched.limit[IMAGE_LOADER_PRIORITY_VISIBLE] = sched.max_threads;
+	sched.limit[IMAGE_LOADER_PRIORITY_READ_AHEAD] = 2;
+	sched.limit[IMAGE_LOADER_PRIORITY_THUMBNAIL] = std::max(1, cores - 1);
+	sched.limit[IMAGE_LOADER_PRIORITY_BACKGROUND] = std::max(1, cores - 1);
+
+	g_mutex_init(&sched.mutex);
+	g_cond_init(&sched.visible_cond);
+
+	sched.pool = g_thread_pool_new(image_loader_thread_run, nullptr, sched.max_threads, FALSE, nullptr);
 }
 
-static void image_loader_thread_leave_high()
+static void image_loader_scheduler_log(ImageLoaderPriorityClass priority_class, gint64 waited)
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num--;
-	if (image_loader_prio_num == 0) g_cond_broadcast(image_loader_prio_cond); /* wake up all low prio threads */
-	g_mutex_unlock(image_loader_prio_mutex);
+	const ImageLoaderScheduler &sched = image_loader_scheduler;
+
+	DEBUG_1("Image loader %s waited %.1f ms, queued %" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT " running %d/%d/%d/%d, "
+	        "%s started %" G_GUINT64_FORMAT " cancelled %" G_GUINT64_FORMAT " avg wait %.1f ms max queued %" G_GSIZE_FORMAT,
+	        image_loader_priority_class_names[priority_class], waited / 1000.0,
+	        sched.queue[0].size(), sched.queue[1].size(), sched.queue[2].size(), sched.queue[3].size(),
+	        sched.running[0], sched.running[1], sched.running[2], sched.running[3],
+	        image_loader_priority_class_names[priority_class],
+	        sched.started[priority_class], sched.cancelled[priority_class],
+	        sched.started[priority_class] ? sched.wait_time[priority_class] / 1000.0 / sched.started[priority_class] : 0.0,
+	        sched.max_queued[priority_class]);
 }
 
-static void image_loader_thread_wait_high()
+/**
+ * @brief Pushes queued loaders to the thread pool while threads are free
+ *
+ * The caller must hold the scheduler mutex.
+ */
+static void image_loader_scheduler_dispatch()
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	while (image_loader_prio_num)
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+
+	for (gint c = IMAGE_LOADER_PRIORITY_VISIBLE; c < IMAGE_LOADER_PRIORITY_COUNT; c++)
 		{
-		g_cond_wait(image_loader_prio_cond, image_loader_prio_mutex);
+		const gint max_threads = (c == IMAGE_LOADER_PRIORITY_VISIBLE) ? sched.max_threads : sched.max_threads - 1;
+
+		while (!sched.queue[c].empty() && sched.running[c] < sched.limit[c] && sched.running_total < max_threads)
+			{
+			ImageLoader *il = sched.queue[c].front();
+			sched.queue[c].pop_front();
+
+			const gint64 waited = g_get_monotonic_time() - il->queue_time;
+			sched.running[c]++;
+			sched.running_total++;
+			sched.started[c]++;
+			sched.wait_time[c] += waited;
+
+			image_loader_scheduler_log(static_cast<ImageLoaderPriorityClass>(c), waited);
+
+			g_thread_pool_push(sched.pool, il, nullptr);
+			}
 		}
+}
+
+static void image_loader_scheduler_queue(ImageLoader *il)
+{
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sched.mutex);
+
+	il->queue_time = g_get_monotonic_time();
+	sched.queue[il->priority_class].push_back(il);
+	sched.max_queued[il->priority_class] = std::max<gsize>(sched.max_queued[il->priority_class], sched.queue[il->priority_class].size());
 
-	g_mutex_unlock(image_loader_prio_mutex);
+	image_loader_scheduler_dispatch();
+}
+
+/**
+ * @brief Removes a loader that has not been started by a thread yet
+ * @returns TRUE if the loader was still queued
+ */
+static gboolean image_loader_scheduler_cancel(ImageLoader *il)
+{
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+	if (!sched.pool) return FALSE;
+
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sched.mutex);
+
+	auto &queue = sched.queue[il->priority_class];
+	auto it = std::find(queue.begin(), queue.end(), il);
+	if (it == queue.end()) return FALSE;
+
+	queue.erase(it);
+	sched.cancelled[il->priority_class]++;
+
+	return TRUE;
+}
+
+static void image_loader_scheduler_done(ImageLoaderPriorityClass priority_class, gint64 run_time)
+{
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sched.mutex);
+
+	sched.running[priority_class]--;
+	sched.running_total--;
+
+	DEBUG_2("Image loader %s ran %.1f ms", image_loader_priority_class_names[priority_class], run_time / 1000.0);
+
+	if (priority_class == IMAGE_LOADER_PRIORITY_VISIBLE && sched.running[priority_class] == 0)
+		{
+		g_cond_broadcast(&sched.visible_cond); /* wake up all low prio threads */
+		}
+
+	image_loader_scheduler_dispatch();
+}
+
+static void image_loader_thread_wait_visible()
+{
+	ImageLoaderScheduler &sched = image_loader_scheduler;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sched.mutex);
+
+	while (sched.running[IMAGE_LOADER_PRIORITY_VISIBLE])
+		{
+		g_cond_wait(&sched.visible_cond, &sched.mutex);
+		}
 }
 
 
 static void image_loader_thread_run(gpointer data, gpointer)
 {
 	auto il = static_cast<ImageLoader *>(data);
+	const ImageLoaderPriorityClass priority_class = il->priority_class;
+	const gboolean low_prio = priority_class >= IMAGE_LOADER_PRIORITY_THUMBNAIL;
+	const gint64 start_time = g_get_monotonic_time();
 	gboolean cont;
 	gboolean err;
 
-	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+	if (low_prio)
 		{
 		/* low prio, wait until high prio tasks finishes */
-		image_loader_thread_wait_high();
-		}
-	else
-		{
-		/* high prio */
-		image_loader_thread_enter_high();
+		image_loader_thread_wait_visible();
 		}
 
 	err = !image_loader_begin(il);
@@ -1164,20 +1435,16 @@ static void image_loader_thread_run(gpointer data, gpointer)
 
 	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
 		{
-		if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+		if (low_prio)
 			{
 			/* low prio, wait until high prio tasks finishes */
-			image_loader_thread_wait_high();
+			image_loader_thread_wait_visible();
 			}
 		cont = image_loader_continue(il);
 		}
 	image_loader_stop_loader(il);
 
-	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
-		{
-		/* high prio */
-		image_loader_thread_leave_high();
-		}
+	image_loader_scheduler_done(priority_class, g_get_monotonic_time() - start_time);
 
 	g_mutex_lock(il->data_mutex);
 	il->can_destroy = TRUE;
@@ -1197,19 +1464,11 @@ static gboolean image_loader_start_thread(ImageLoader *il)
 
 	if (!image_loader_setup_source(il)) return FALSE;
 
-        if (!image_loader_thread_pool)
-		{
-		image_loader_thread_pool = g_thread_pool_new(image_loader_thread_run, nullptr, -1, FALSE, nullptr);
-		if (!image_loader_prio_cond) image_loader_prio_cond = g_new(GCond, 1);
-		g_cond_init(image_loader_prio_cond);
-		if (!image_loader_prio_mutex) image_loader_prio_mutex = g_new(GMutex, 1);
-		g_mutex_init(image_loader_prio_mutex);
-		}
+	image_loader_scheduler_init();
 
 	il->can_destroy = FALSE; /* ImageLoader can't be freed until image_loader_thread_run finishes */
 
-	g_thread_pool_push(image_loader_thread_pool, il, nullptr);
-	DEBUG_1("Thread pool num threads: %u", g_thread_pool_get_num_threads(image_loader_thread_pool));
+	image_loader_scheduler_queue(il);
 
 	return TRUE;
 }
@@ -1243,7 +1502,7 @@ GdkPixbuf *image_loader_get_pixbuf(ImageLoader *il)
 
 /**
  * @brief Speed up loading when you only need at most width x height size image,
- * only the jpeg GdkPixbuf loader benefits from it - so there is no
+ * only the jpeg and webp loaders benefit from it - so there is no
  * guarantee that the image will scale down to the requested size..
  */
 void image_loader_set_requested_size(ImageLoader *il, gint width, gint height)
@@ -1275,6 +1534,20 @@ void image_loader_set_priority(ImageLoader *il, gint priority)
 
 	if (il->thread) return; /* can't change prio if the thread already runs */
 	il->idle_priority = priority;
+
+	if (priority > G_PRIORITY_DEFAULT_IDLE) il->priority_class = IMAGE_LOADER_PRIORITY_THUMBNAIL;
+}
+
+/**
+ * @brief This only has effect if used before image_loader_start()
+ * default is #IMAGE_LOADER_PRIORITY_VISIBLE
+ */
+void image_loader_set_priority_class(ImageLoader *il, ImageLoaderPriorityClass priority_class)
+{
+	if (!il) return;
+
+	if (il->thread) return;
+	il->priority_class = priority_class;
 }
 
 
@@ -1331,6 +1604,29 @@ gboolean image_loader_get_shrunk(ImageLoader *il)
 	return ret;
 }
 
+/**
+ * @brief The size of the image as reported by the backend, before it was
+ * shrunk to the requested size. Zero until the size is known.
+ */
+void image_loader_get_source_size(ImageLoader *il, gint &width, gint &height)
+{
+	width = 0;
+	height = 0;
+	if (!il) return;
+
+	g_mutex_lock(il->data_mutex);
+	width = il->source_width;
+	height = il->source_height;
+	g_mutex_unlock(il->data_mutex);
+}
+
+ImageLoaderPreview image_loader_get_preview(ImageLoader *il)
+{
+	if (!il) return IMAGE_LOADER_PREVIEW_NONE;
+
+	return il->preview;
+}
+
 
 /**
  *  @FIXME this can be rather slow and blocks until the size is known
@@ -1360,6 +1656,27 @@ gboolean image_load_dimensions(FileData *fd, gint *width, gint *height)
 	return success;
 }
 
+/**
+ * @brief Loads the whole image of @a fd at full size in the calling thread
+ * @returns The pixbuf, with a reference for the caller, or NULL on errors
+ */
+GdkPixbuf *image_load_pixbuf(FileData *fd)
+{
+	ImageLoader *il = image_loader_new(fd);
+	GdkPixbuf *pixbuf = nullptr;
+
+	if (image_loader_setup_source(il) && image_loader_begin(il))
+		{
+		while (!image_loader_get_is_done(il) && image_loader_continue(il) == G_SOURCE_CONTINUE) {}
+
+		if (il->pixbuf && il->bytes_read == il->bytes_total) pixbuf = g_object_ref(il->pixbuf);
+		}
+
+	image_loader_free(il);
+
+	return pixbuf;
+}
+
 void free_pixels(guchar *pixels, gpointer)
 {
 	g_free(pixels);
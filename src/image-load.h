@@ -42,8 +42,20 @@ public:
 	using AreaUpdatedCb = void (*)(gpointer, gint, gint, gint, gint, gpointer);
 	using SizePreparedCb = void (*)(gpointer, gint, gint, gpointer);
 
+	/**
+	 * @brief How write() takes the file
+	 */
+	enum WriteMode {
+		WRITE_WHOLE,   /**< @a buf is the whole file of @a count bytes, the backend sets @a chunk_size to @a count */
+		WRITE_CHUNKS,  /**< consecutive chunks of @a chunk_size bytes, as for a GdkPixbufLoader */
+		WRITE_PARTIAL  /**< as #WRITE_WHOLE, but only the first @a chunk_size bytes have been read yet;
+		                    write() is called again with more, until @a chunk_size is @a count */
+	};
+
 	virtual void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) = 0;
 	virtual void set_size(int /*width*/, int /*height*/) {};
+	virtual gboolean has_scaled_decode() { return FALSE; }; /**< set_size() saves decode work, not only memory */
+	virtual WriteMode get_write_mode() { return WRITE_WHOLE; };
 	virtual gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) = 0;
 	virtual GdkPixbuf *get_pixbuf() = 0;
 	virtual gboolean close(GError **/*error*/) { return TRUE; };
@@ -54,6 +66,17 @@ public:
 	virtual gint get_page_total() { return 0; };
 };
 
+/**
+ * @brief Scheduling classes of threaded loaders, in order of priority
+ */
+enum ImageLoaderPriorityClass {
+	IMAGE_LOADER_PRIORITY_VISIBLE = 0, /**< the image shown */
+	IMAGE_LOADER_PRIORITY_READ_AHEAD,
+	IMAGE_LOADER_PRIORITY_THUMBNAIL, /**< thumbnails and pan view images */
+	IMAGE_LOADER_PRIORITY_BACKGROUND, /**< cache building, duplicates, search */
+	IMAGE_LOADER_PRIORITY_COUNT
+};
+
 enum ImageLoaderPreview {
 	IMAGE_LOADER_PREVIEW_NONE = 0,
 	IMAGE_LOADER_PREVIEW_EXIF = 1,
@@ -72,6 +95,7 @@ struct ImageLoader
 
 	gsize bytes_read;
 	gsize bytes_total;
+	gsize bytes_available; /**< bytes of mapped_file read so far, see stream_fd */
 
 	ImageLoaderPreview preview;
 
@@ -81,6 +105,9 @@ struct ImageLoader
 	gint actual_width;
 	gint actual_height;
 
+	gint source_width; /**< size of the image before any shrinking */
+	gint source_height;
+
 	gboolean shrunk;
 
 	gboolean done;
@@ -101,8 +128,11 @@ struct ImageLoader
 	gboolean can_destroy;
 	GCond *can_destroy_cond;
 	gboolean thread;
+	ImageLoaderPriorityClass priority_class;
+	gint64 queue_time; /**< when queued for a thread, monotonic time */
 
 	guchar *mapped_file;
+	gint stream_fd; /**< a file on a remote filesystem is read progressively into mapped_file, -1 if mapped */
 	gsize read_buffer_size;
 	guint idle_read_loop_count;
 };
@@ -132,6 +162,8 @@ void image_loader_set_buffer_size(ImageLoader *il, guint count);
 
 void image_loader_set_priority(ImageLoader *il, gint priority);
 
+void image_loader_set_priority_class(ImageLoader *il, ImageLoaderPriorityClass priority_class);
+
 gboolean image_loader_start(ImageLoader *il);
 
 
@@ -140,8 +172,11 @@ gdouble image_loader_get_percent(ImageLoader *il);
 gboolean image_loader_get_is_done(ImageLoader *il);
 FileData *image_loader_get_fd(ImageLoader *il);
 gboolean image_loader_get_shrunk(ImageLoader *il);
+void image_loader_get_source_size(ImageLoader *il, gint &width, gint &height);
+ImageLoaderPreview image_loader_get_preview(ImageLoader *il);
 
 gboolean image_load_dimensions(FileData *fd, gint *width, gint *height);
+GdkPixbuf *image_load_pixbuf(FileData *fd);
 
 void free_pixels(guchar *pixels, gpointer data);
 
@@ -343,7 +343,7 @@ static GdkPixbuf *image_osd_info_render(OverlayStateData *osd)
 		histmap = histmap_get(imd->image_fd);
 		if (!histmap)
 			{
-			histmap_start_idle(imd->image_fd);
+			histmap_start(imd->image_fd);
 			with_hist = FALSE;
 			}
 		}
@@ -21,8 +21,10 @@
 
 #include "image.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <optional>
 
 #include <cairo.h>
 #include <glib-object.h>
@@ -47,6 +49,7 @@
 #include "options.h"
 #include "pixbuf-renderer.h"
 #include "pixbuf-util.h"
+#include "render-stats.h"
 #include "ui-fileops.h"
 
 struct ExifData;
@@ -120,7 +123,10 @@ SelectionRectangle selection_rectangle;
 static GList *image_list = nullptr;
 
 static void image_read_ahead_start(ImageWindow *imd);
+static void image_read_ahead_queue_next(ImageWindow *imd);
+static void image_load_full_check(ImageWindow *imd);
 static void image_cache_set(ImageWindow *imd, FileData *fd);
+static FileCacheData *image_get_cache();
 
 /*
  *-------------------------------------------------------------------
@@ -334,6 +340,7 @@ static void image_render_complete_cb(PixbufRenderer *, gpointer data)
 	auto imd = static_cast<ImageWindow *>(data);
 
 	image_complete_util(imd, FALSE);
+	image_load_full_check(imd);
 }
 
 static void image_state_set(ImageWindow *imd, ImageState state)
@@ -362,6 +369,7 @@ static void image_zoom_cb(PixbufRenderer *, gdouble, gpointer data)
 	if (imd->title_show_zoom) image_update_title(imd);
 	image_state_set(imd, IMAGE_STATE_IMAGE);
 	image_update_util(imd);
+	image_load_full_check(imd);
 }
 
 /*
@@ -636,11 +644,15 @@ static void image_set_pixbuf_renderer_post_process_func(ImageWindow *imd)
 {
 	if (imd->cm || imd->desaturate || imd->overunderexposed)
 		{
-		const auto image_post_process_tile_color_cb = [imd](PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+		/* tiles may be post processed in other threads, so do not look at imd from there */
+		std::optional<ColorMan> cm;
+		if (imd->cm) cm = *imd->cm;
+
+		const auto image_post_process_tile_color_cb = [cm, desaturate = imd->desaturate, overunderexposed = imd->overunderexposed](PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 		{
-			if (imd->cm) imd->cm->correct_region(*pixbuf, {x, y, w, h});
-			if (imd->desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
-			if (imd->overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
+			if (cm) cm->correct_region(*pixbuf, {x, y, w, h});
+			if (desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
+			if (overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
 		};
 		pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), image_post_process_tile_color_cb, (imd->cm != nullptr) );
 		}
@@ -712,6 +724,8 @@ static void image_read_ahead_done_cb(ImageLoader *, gpointer data)
 	imd->read_ahead_il = nullptr;
 
 	image_complete_util(imd, TRUE);
+
+	image_read_ahead_queue_next(imd);
 }
 
 static void image_read_ahead_error_cb(ImageLoader *il, gpointer data)
@@ -731,6 +745,7 @@ static void image_read_ahead_start(ImageWindow *imd)
 	DEBUG_1("%s read ahead started for :%s", get_exec_time(), imd->read_ahead_fd->path);
 
 	imd->read_ahead_il = image_loader_new(imd->read_ahead_fd);
+	image_loader_set_priority_class(imd->read_ahead_il, IMAGE_LOADER_PRIORITY_READ_AHEAD);
 
 	image_loader_delay_area_ready(imd->read_ahead_il, TRUE); /* we will need the area_ready signals later */
 
@@ -757,6 +772,117 @@ static void image_read_ahead_set(ImageWindow *imd, FileData *fd)
 	image_read_ahead_start(imd);
 }
 
+/*
+ * The images after read_ahead_fd in the read ahead window are decoded one
+ * at a time into the image cache, once the image and read_ahead_fd are done.
+ */
+
+static void image_read_ahead_queue_cancel_loader(ImageWindow *imd)
+{
+	image_loader_free(imd->read_ahead_queue_il);
+	imd->read_ahead_queue_il = nullptr;
+
+	file_data_unref(imd->read_ahead_queue_fd);
+	imd->read_ahead_queue_fd = nullptr;
+}
+
+static void image_read_ahead_queue_cancel(ImageWindow *imd)
+{
+	image_read_ahead_queue_cancel_loader(imd);
+
+	file_data_list_free(imd->read_ahead_queue);
+	imd->read_ahead_queue = nullptr;
+}
+
+static void image_read_ahead_queue_done_cb(ImageLoader *, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+	FileData *fd = imd->read_ahead_queue_fd;
+
+	if (!fd || !imd->read_ahead_queue_il) return;
+
+	DEBUG_1("%s read ahead queue done for :%s", get_exec_time(), fd->path);
+
+	if (!fd->pixbuf)
+		{
+		fd->pixbuf = image_loader_get_pixbuf(imd->read_ahead_queue_il);
+		if (fd->pixbuf)
+			{
+			g_object_ref(fd->pixbuf);
+			image_cache_set(imd, fd);
+			}
+		}
+
+	image_read_ahead_queue_cancel_loader(imd);
+	image_read_ahead_queue_next(imd);
+}
+
+static void image_read_ahead_queue_next(ImageWindow *imd)
+{
+	/* still loading ?, do later */
+	if (imd->read_ahead_queue_il || imd->il || imd->read_ahead_il) return;
+
+	while (imd->read_ahead_queue)
+		{
+		auto fd = static_cast<FileData *>(imd->read_ahead_queue->data);
+		imd->read_ahead_queue = g_list_delete_link(imd->read_ahead_queue, imd->read_ahead_queue);
+
+		if (fd->pixbuf || file_cache_get(image_get_cache(), fd))
+			{
+			file_data_unref(fd);
+			continue;
+			}
+
+		DEBUG_1("%s read ahead queue started for :%s", get_exec_time(), fd->path);
+
+		imd->read_ahead_queue_fd = fd;
+		imd->read_ahead_queue_il = image_loader_new(fd);
+		image_loader_set_priority_class(imd->read_ahead_queue_il, IMAGE_LOADER_PRIORITY_READ_AHEAD);
+
+		g_signal_connect(G_OBJECT(imd->read_ahead_queue_il), "error", (GCallback)image_read_ahead_queue_done_cb, imd);
+		g_signal_connect(G_OBJECT(imd->read_ahead_queue_il), "done", (GCallback)image_read_ahead_queue_done_cb, imd);
+
+		if (image_loader_start(imd->read_ahead_queue_il)) return;
+
+		image_read_ahead_queue_cancel_loader(imd);
+		}
+}
+
+/**
+ * @brief Replaces the queue, the running load is kept if still wanted
+ */
+static void image_read_ahead_queue_set(ImageWindow *imd, GList *list)
+{
+	file_data_list_free(imd->read_ahead_queue);
+	imd->read_ahead_queue = filelist_copy(list);
+
+	if (imd->read_ahead_queue_fd && !g_list_find(list, imd->read_ahead_queue_fd))
+		{
+		DEBUG_1("%s read ahead queue cancelled for :%s", get_exec_time(), imd->read_ahead_queue_fd->path);
+		image_read_ahead_queue_cancel_loader(imd);
+		}
+
+	image_read_ahead_queue_next(imd);
+}
+
+/**
+ * @brief Counts how often an image of the read ahead window is shown
+ * @param imd
+ * @param fd The image to be shown
+ * @param hit The image was found decoded or being decoded
+ */
+static void image_read_ahead_stats_update(ImageWindow *imd, FileData *fd, gboolean hit)
+{
+	if (!g_list_find(imd->read_ahead_window, fd)) return;
+
+	imd->read_ahead_requests++;
+	if (hit) imd->read_ahead_hits++;
+
+	render_stats_count(hit ? RENDER_STAT_READ_AHEAD_HIT : RENDER_STAT_READ_AHEAD_MISS);
+
+	DEBUG_1("read ahead %s for :%s, hit rate %u/%u", hit ? "hit" : "miss", fd->path, imd->read_ahead_hits, imd->read_ahead_requests);
+}
+
 /*
  *-------------------------------------------------------------------
  * post buffering
@@ -816,6 +942,12 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	auto imd = static_cast<ImageWindow *>(data);
 	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
 
+	if (!imd->load_first_area)
+		{
+		imd->load_first_area = TRUE;
+		render_stats_add_time(RENDER_STAT_LOAD_FIRST_AREA, g_get_monotonic_time() - imd->load_begin_time);
+		}
+
 	if (imd->delay_flip &&
 	    pr->pixbuf != image_loader_get_pixbuf(il))
 		{
@@ -827,13 +959,126 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	pixbuf_renderer_area_changed(pr, *area);
 }
 
+/**
+ * @brief Records whether the loader of a display sized load had to shrink the image,
+ * either by decoding it at a smaller scale or by using a smaller embedded preview.
+ */
+static void image_load_reduced_update(ImageWindow *imd)
+{
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(imd->il);
+	gint width;
+	gint height;
+
+	imd->reduced_scale = 0.0;
+	if (!imd->load_to_fit || !pixbuf) return;
+
+	if (!image_loader_get_shrunk(imd->il) &&
+	    image_loader_get_preview(imd->il) == IMAGE_LOADER_PREVIEW_NONE) return;
+
+	image_loader_get_source_size(imd->il, width, height);
+	if (width > gdk_pixbuf_get_width(pixbuf))
+		{
+		imd->reduced_scale = static_cast<gdouble>(width) / gdk_pixbuf_get_width(pixbuf);
+		}
+	else
+		{
+		/* an embedded preview, the size of the image is not known */
+		imd->reduced_scale = 1.0;
+		}
+}
+
+static void image_load_full_done_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+
+	DEBUG_1("%s full size image done", get_exec_time());
+
+	/* the zoom of the image, converted for the full size pixbuf below */
+	const gdouble zoom = image_zoom_get(imd);
+	imd->reduced_scale = 0.0;
+
+	if (pixbuf)
+		{
+		gdouble x;
+		gdouble y;
+
+		if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf)
+			{
+			imd->image_fd->pixbuf = g_object_ref(pixbuf);
+			image_cache_set(imd, imd->image_fd);
+			}
+
+		image_get_scroll_center(imd, x, y);
+		g_object_set(imd->pr, "complete", FALSE, NULL);
+		image_change_pixbuf(imd, pixbuf, zoom, FALSE);
+		image_set_scroll_center(imd, x, y);
+		}
+
+	image_loader_free(imd->il);
+	imd->il = nullptr;
+}
+
+static void image_load_full_error_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	DEBUG_1("%s full size image error", get_exec_time());
+
+	/* keep showing the display sized image, and do not try again */
+	imd->reduced_scale = 0.0;
+
+	image_loader_free(il);
+	imd->il = nullptr;
+}
+
+/**
+ * @brief Loads the image at full size in the background when a display sized
+ * decode is shown, and it is zoomed in or the window has grown beyond it.
+ */
+static void image_load_full_check(ImageWindow *imd)
+{
+	if (imd->reduced_scale == 0.0 || imd->il || !imd->image_fd) return;
+
+	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+	const gint scale_factor = gtk_widget_get_scale_factor(imd->pr);
+
+	if (image_zoom_get(imd) == 0.0 &&
+	    (pr->image_width >= pr->viewport_width * scale_factor ||
+	     pr->image_height >= pr->viewport_height * scale_factor)) return;
+
+	DEBUG_1("%s image begin full size", get_exec_time());
+
+	imd->il = image_loader_new(imd->image_fd);
+
+	g_signal_connect(G_OBJECT(imd->il), "error", G_CALLBACK(image_load_full_error_cb), imd);
+	g_signal_connect(G_OBJECT(imd->il), "done", G_CALLBACK(image_load_full_done_cb), imd);
+
+	if (!image_loader_start(imd->il))
+		{
+		image_loader_free(imd->il);
+		imd->il = nullptr;
+		imd->reduced_scale = 0.0;
+		}
+}
+
 static void image_load_done_cb(ImageLoader *, gpointer data)
 {
 	auto imd = static_cast<ImageWindow *>(data);
 
 	DEBUG_1("%s image done", get_exec_time());
 
-	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il))
+	if (imd->load_run_time)
+		{
+		render_stats_add_time(RENDER_STAT_LOAD_DECODE, g_get_monotonic_time() - imd->load_run_time);
+		imd->load_run_time = 0;
+		}
+
+	image_load_reduced_update(imd);
+
+	/* a display sized decode must not be taken for the image by other users of the cache */
+	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il) &&
+	    imd->reduced_scale == 0.0)
 		{
 		imd->image_fd->pixbuf = g_object_ref(image_loader_get_pixbuf(imd->il));
 		image_cache_set(imd, imd->image_fd);
@@ -862,6 +1107,10 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 	imd->il = nullptr;
 
 	image_read_ahead_start(imd);
+	image_read_ahead_queue_next(imd);
+
+	/* the image might have been zoomed in while the display sized copy was loading */
+	image_load_full_check(imd);
 }
 
 static void image_load_size_prepared_cb(ImageLoader *, const GqSize *size, gpointer data)
@@ -945,27 +1194,50 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 	return FALSE;
 }
 
+/**
+ * @brief A display sized decode is enough for an image zoomed to fit,
+ * unless the window is about to be resized to the image
+ */
+static gboolean image_load_to_fit(ImageWindow *imd)
+{
+	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+
+	if (!options->image.decode_to_fit) return FALSE;
+	if (pr->zoom != 0.0) return FALSE;
+	if (pr->viewport_width < 1 || pr->viewport_height < 1) return FALSE;
+	if (imd->top_window_sync && options->image.fit_window_to_image) return FALSE;
+
+	return TRUE;
+}
+
 static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 {
 	DEBUG_1("%s image begin", get_exec_time());
 
 	if (imd->il) return FALSE;
 
+	imd->load_to_fit = FALSE;
+	imd->reduced_scale = 0.0;
+
 	imd->completed = FALSE;
 	g_object_set(imd->pr, "complete", FALSE, NULL);
 
 	if (image_cache_get(imd))
 		{
 		DEBUG_1("from cache: %s", imd->image_fd->path);
+		image_read_ahead_stats_update(imd, fd, TRUE);
 		return TRUE;
 		}
 
 	if (image_read_ahead_check(imd))
 		{
 		DEBUG_1("from read ahead buffer: %s", imd->image_fd->path);
+		image_read_ahead_stats_update(imd, fd, TRUE);
 		return TRUE;
 		}
 
+	image_read_ahead_stats_update(imd, fd, FALSE);
+
 	if (!imd->delay_flip && image_get_pixbuf(imd))
 		{
 		PixbufRenderer *pr;
@@ -977,8 +1249,22 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 
 	g_object_set(imd->pr, "loading", TRUE, NULL);
 
+	imd->load_begin_time = g_get_monotonic_time();
+	imd->load_run_time = 0;
+	imd->load_first_area = FALSE;
+
 	imd->il = image_loader_new(fd);
 
+	imd->load_to_fit = image_load_to_fit(imd);
+	if (imd->load_to_fit)
+		{
+		PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+		/* the orientation is not known yet, a square fills the window either way */
+		const gint size = std::max(pr->viewport_width, pr->viewport_height) * gtk_widget_get_scale_factor(imd->pr);
+
+		image_loader_set_requested_size(imd->il, size, size);
+		}
+
 	image_load_set_signals(imd, FALSE);
 
 	if (!image_loader_start(imd->il))
@@ -995,6 +1281,9 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 		return FALSE;
 		}
 
+	imd->load_run_time = g_get_monotonic_time();
+	render_stats_add_time(RENDER_STAT_LOAD_SETUP, imd->load_run_time - imd->load_begin_time);
+
 	image_state_set(imd, IMAGE_STATE_LOADING);
 
 /*
@@ -1016,6 +1305,7 @@ static void image_reset(ImageWindow *imd)
 
 	image_loader_free(imd->il);
 	imd->il = nullptr;
+	imd->reduced_scale = 0.0;
 
 	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
 
@@ -1307,7 +1597,16 @@ void image_change_fd(ImageWindow *imd, FileData *fd, gdouble zoom)
 
 gboolean image_get_image_size(ImageWindow *imd, gint &width, gint &height)
 {
-	return pixbuf_renderer_get_image_size(PIXBUF_RENDERER(imd->pr), width, height);
+	if (!pixbuf_renderer_get_image_size(PIXBUF_RENDERER(imd->pr), width, height)) return FALSE;
+
+	/* report the size of the image, not of the display sized decode */
+	if (imd->reduced_scale > 1.0)
+		{
+		width = lround(width * imd->reduced_scale);
+		height = lround(height * imd->reduced_scale);
+		}
+
+	return TRUE;
 }
 
 GdkPixbuf *image_get_pixbuf(ImageWindow *imd)
@@ -1315,6 +1614,29 @@ GdkPixbuf *image_get_pixbuf(ImageWindow *imd)
 	return pixbuf_renderer_get_pixbuf(PIXBUF_RENDERER(imd->pr));
 }
 
+/**
+ * @brief The image at full size, also while a display sized decode is shown
+ * @returns The pixbuf, with a reference for the caller, or NULL
+ *
+ * The full size image is loaded at once if it is not yet available.
+ */
+GdkPixbuf *image_get_pixbuf_full(ImageWindow *imd)
+{
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	if (!pixbuf) return nullptr;
+
+	if (imd->reduced_scale != 0.0 && imd->image_fd)
+		{
+		/* only a full size image is cached */
+		if (imd->image_fd->pixbuf) return g_object_ref(imd->image_fd->pixbuf);
+
+		GdkPixbuf *full = image_load_pixbuf(imd->image_fd);
+		if (full) return full;
+		}
+
+	return g_object_ref(pixbuf);
+}
+
 void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboolean lazy)
 {
 	LayoutWindow *lw;
@@ -1440,6 +1762,12 @@ static void image_loader_sync_data(ImageLoader *il, gpointer old_data, gpointer
 
 	if (g_signal_handlers_disconnect_by_func(G_OBJECT(il), (gpointer)image_load_done_cb, old_data))
 		g_signal_connect(G_OBJECT(il), "done", G_CALLBACK(image_load_done_cb), data);
+
+	if (g_signal_handlers_disconnect_by_func(G_OBJECT(il), (gpointer)image_load_full_error_cb, old_data))
+		g_signal_connect(G_OBJECT(il), "error", G_CALLBACK(image_load_full_error_cb), data);
+
+	if (g_signal_handlers_disconnect_by_func(G_OBJECT(il), (gpointer)image_load_full_done_cb, old_data))
+		g_signal_connect(G_OBJECT(il), "done", G_CALLBACK(image_load_full_done_cb), data);
 }
 
 /* this is more like a move function
@@ -1481,6 +1809,9 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	file_data_unref(imd->read_ahead_fd);
 	source->read_ahead_fd = nullptr;
 
+	imd->load_to_fit = source->load_to_fit;
+	imd->reduced_scale = source->reduced_scale;
+
 	imd->orientation = source->orientation;
 	imd->desaturate = source->desaturate;
 
@@ -1532,6 +1863,9 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->state = source->state;
 	source->state = IMAGE_STATE_NONE;
 
+	imd->load_to_fit = source->load_to_fit;
+	imd->reduced_scale = source->reduced_scale;
+
 	imd->orientation = source->orientation;
 	imd->desaturate = source->desaturate;
 
@@ -1601,13 +1935,48 @@ void image_set_scroll_center(ImageWindow *imd, gdouble x, gdouble y)
 	pixbuf_renderer_set_scroll_center(PIXBUF_RENDERER(imd->pr), x, y);
 }
 
+/**
+ * @brief Converts between a zoom of the image and a zoom of the display sized decode shown
+ * @param imd
+ * @param zoom
+ * @param factor The scale of the decode to the image, or its inverse
+ */
+static gdouble image_zoom_rescale(const ImageWindow *imd, gdouble zoom, gdouble factor)
+{
+	if (imd->reduced_scale <= 1.0 || zoom == 0.0) return zoom;
+
+	const gdouble scale = (zoom > 0.0 ? zoom : -1.0 / zoom) * factor;
+
+	return scale >= 1.0 ? scale : -1.0 / scale;
+}
+
+/** @returns The zoom of the renderer for @a zoom of the image */
+static gdouble image_zoom_to_renderer(const ImageWindow *imd, gdouble zoom)
+{
+	return image_zoom_rescale(imd, zoom, imd->reduced_scale);
+}
+
 void image_zoom_adjust(ImageWindow *imd, gdouble increment)
 {
+	if (imd->reduced_scale > 1.0)
+		{
+		image_zoom_set(imd, pixbuf_renderer_zoom_adjusted(image_zoom_get(imd), image_zoom_get_real(imd), increment));
+		return;
+		}
+
 	pixbuf_renderer_zoom_adjust(PIXBUF_RENDERER(imd->pr), increment);
 }
 
 void image_zoom_adjust_at_point(ImageWindow *imd, gdouble increment, gint x, gint y)
 {
+	if (imd->reduced_scale > 1.0)
+		{
+		const gdouble zoom = pixbuf_renderer_zoom_adjusted(image_zoom_get(imd), image_zoom_get_real(imd), increment);
+
+		pixbuf_renderer_zoom_set_at_point(PIXBUF_RENDERER(imd->pr), image_zoom_to_renderer(imd, zoom), x, y);
+		return;
+		}
+
 	pixbuf_renderer_zoom_adjust_at_point(PIXBUF_RENDERER(imd->pr), increment, x, y);
 }
 
@@ -1618,7 +1987,7 @@ void image_zoom_set_limits(ImageWindow *imd, gdouble min, gdouble max)
 
 void image_zoom_set(ImageWindow *imd, gdouble zoom)
 {
-	pixbuf_renderer_zoom_set(PIXBUF_RENDERER(imd->pr), zoom);
+	pixbuf_renderer_zoom_set(PIXBUF_RENDERER(imd->pr), image_zoom_to_renderer(imd, zoom));
 }
 
 void image_zoom_set_fill_geometry(ImageWindow *imd, gboolean vertical)
@@ -1648,14 +2017,19 @@ void image_zoom_set_fill_geometry(ImageWindow *imd, gboolean vertical)
 	pixbuf_renderer_zoom_set(pr, zoom);
 }
 
+/**
+ * @returns The zoom of the image, also while a display sized decode is shown
+ */
 gdouble image_zoom_get(ImageWindow *imd)
 {
-	return pixbuf_renderer_zoom_get(PIXBUF_RENDERER(imd->pr));
+	return image_zoom_rescale(imd, pixbuf_renderer_zoom_get(PIXBUF_RENDERER(imd->pr)), 1.0 / imd->reduced_scale);
 }
 
 gdouble image_zoom_get_real(ImageWindow *imd)
 {
-	return pixbuf_renderer_zoom_get_scale(PIXBUF_RENDERER(imd->pr));
+	const gdouble scale = pixbuf_renderer_zoom_get_scale(PIXBUF_RENDERER(imd->pr));
+
+	return imd->reduced_scale > 1.0 ? scale / imd->reduced_scale : scale;
 }
 
 gchar *image_zoom_get_as_text(ImageWindow *imd)
@@ -1737,12 +2111,16 @@ void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode)
 }
 
 /**
- * @brief Read ahead, pass NULL to cancel
+ * @brief Read ahead a list of images, the first is the most wanted
+ * @param imd
+ * @param list FileData, NULL to cancel
  */
-void image_prebuffer_set(ImageWindow *imd, FileData *fd)
+static void image_prebuffer_set_list(ImageWindow *imd, GList *list)
 {
 	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
 
+	auto fd = static_cast<FileData *>(list ? list->data : nullptr);
+
 	if (fd)
 		{
 		if (!file_cache_get(image_get_cache(), fd))
@@ -1754,6 +2132,54 @@ void image_prebuffer_set(ImageWindow *imd, FileData *fd)
 		{
 		image_read_ahead_cancel(imd);
 		}
+
+	image_read_ahead_queue_set(imd, list ? list->next : nullptr);
+
+	file_data_list_free(imd->read_ahead_window);
+	imd->read_ahead_window = filelist_copy(list);
+}
+
+/**
+ * @brief Read ahead, pass NULL to cancel
+ */
+void image_prebuffer_set(ImageWindow *imd, FileData *fd)
+{
+	g_autoptr(GList) list = fd ? g_list_append(nullptr, fd) : nullptr;
+
+	image_prebuffer_set_list(imd, list);
+}
+
+/**
+ * @brief Read ahead the images around the current one
+ * @param imd
+ * @param get_fd Returns the image \a step images away in the direction of
+ * travel, negative steps are behind, or NULL
+ *
+ * options->image.read_ahead_count images ahead are read first, then
+ * options->image.read_behind_count images behind.
+ */
+void image_prebuffer_set_window(ImageWindow *imd, const ImagePrebufferGetFunc &get_fd)
+{
+	GList *list = nullptr;
+
+	const auto add = [imd, &list](FileData *fd)
+	{
+		if (fd && fd != imd->image_fd && !g_list_find(list, fd)) list = g_list_prepend(list, fd);
+	};
+
+	for (gint step = 1; step <= options->image.read_ahead_count; step++)
+		{
+		add(get_fd(step));
+		}
+
+	for (gint step = 1; step <= options->image.read_behind_count; step++)
+		{
+		add(get_fd(-step));
+		}
+
+	list = g_list_reverse(list);
+	image_prebuffer_set_list(imd, list);
+	g_list_free(list);
 }
 
 static void image_notify_cb(FileData *fd, NotifyType type, gpointer data)
@@ -2002,6 +2428,8 @@ static void image_free(ImageWindow *imd)
 	image_reset(imd);
 
 	image_read_ahead_cancel(imd);
+	image_read_ahead_queue_cancel(imd);
+	file_data_list_free(imd->read_ahead_window);
 
 	file_data_unref(imd->image_fd);
 	g_free(imd->title);
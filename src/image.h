@@ -122,6 +122,18 @@ struct ImageWindow
 
 	FileData *read_ahead_fd;
 	ImageLoader *read_ahead_il;
+	GList *read_ahead_queue; /**< further images to read ahead after read_ahead_fd */
+	FileData *read_ahead_queue_fd;
+	ImageLoader *read_ahead_queue_il;
+	GList *read_ahead_window; /**< all images of the last read ahead request, for the hit rate */
+	guint read_ahead_requests; /**< images of the read ahead window shown */
+	guint read_ahead_hits;     /**< of those, images found decoded or being decoded */
+
+	gint64 load_begin_time; /**< when the current load began, for the render stats */
+	gint64 load_run_time;   /**< when the loader of the current load was started */
+	gboolean load_first_area;
+	gboolean load_to_fit;    /**< the current load asked for a display sized decode */
+	gdouble reduced_scale;   /**< the pixbuf shown was decoded this many times smaller than the image, 0.0 if not */
 
 	gint prev_color_row;
 
@@ -185,6 +197,7 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source);
 
 gboolean image_get_image_size(ImageWindow *imd, gint &width, gint &height);
 GdkPixbuf *image_get_pixbuf(ImageWindow *imd);
+GdkPixbuf *image_get_pixbuf_full(ImageWindow *imd);
 
 /* manipulation */
 void image_area_changed(ImageWindow *imd, gint x, gint y, gint width, gint height);
@@ -220,6 +233,9 @@ void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode);
 
 void image_prebuffer_set(ImageWindow *imd, FileData *fd);
 
+using ImagePrebufferGetFunc = std::function<FileData *(gint step)>;
+void image_prebuffer_set_window(ImageWindow *imd, const ImagePrebufferGetFunc &get_fd);
+
 void image_auto_refresh_enable(ImageWindow *imd, gboolean enable);
 
 void image_top_window_set_sync(ImageWindow *imd, gboolean allow_sync);
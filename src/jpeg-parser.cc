@@ -230,6 +230,189 @@ gint mpo_parse_Attributes_IFD_entry(const guchar *tiff, guint offset, TiffByteOr
 	return 0;
 }
 
+constexpr guint TIFF_FORMAT_ASCII = 2;
+constexpr guint TIFF_FORMAT_SHORT = 3;
+
+constexpr guint TIFF_TAG_XMP = 0x02bc;
+constexpr guint TIFF_TAG_RATING = 0x4746;
+constexpr guint TIFF_TAG_EXIF_IFD = 0x8769;
+constexpr guint EXIF_TAG_DATE_TIME_ORIGINAL = 0x9003;
+constexpr guint EXIF_TAG_DATE_TIME_DIGITIZED = 0x9004;
+
+constexpr std::string_view EXIF_MAGIC{ "Exif\0\0", 6 };
+constexpr std::string_view XMP_MAGIC{ "http://ns.adobe.com/xap/1.0/\0", 29 };
+
+/**
+ * @brief Finds the data of a tag, stored in the entry itself if it fits
+ * @returns FALSE if the data is beyond @a size
+ */
+gboolean tiff_tag_data_offset(const TiffTag &tt, guint entry_offset, guint item_size, guint size, guint &data_offset)
+{
+	const guint64 length = static_cast<guint64>(tt.count) * item_size;
+
+	data_offset = (length <= 4) ? entry_offset + TIFF_TIFD_OFFSET_DATA : tt.data_val;
+
+	return data_offset + length <= size;
+}
+
+/**
+ * @brief Finds xmp:Rating, as an attribute or as an element
+ * @returns TRUE if the packet has a rating
+ */
+gboolean quick_metadata_parse_xmp(const guchar *xmp, guint size, gint &rating)
+{
+	constexpr std::string_view key{ "xmp:Rating" };
+	const std::string_view packet(reinterpret_cast<const gchar *>(xmp), size);
+
+	for (size_t pos = packet.find(key); pos != std::string_view::npos; pos = packet.find(key, pos + 1))
+		{
+		size_t p = pos + key.size();
+
+		if (p + 1 < size && packet[p] == '=' && (packet[p + 1] == '"' || packet[p + 1] == '\''))
+			{
+			p += 2;
+			}
+		else if (p < size && packet[p] == '>')
+			{
+			p++;
+			}
+		else
+			{
+			continue;
+			}
+
+		const gboolean negative = (p < size && packet[p] == '-');
+		if (negative) p++;
+		if (p >= size || !g_ascii_isdigit(packet[p])) continue;
+
+		gint value = 0;
+		while (p < size && g_ascii_isdigit(packet[p]) && value < 1000)
+			{
+			value = (value * 10) + (packet[p++] - '0');
+			}
+
+		rating = negative ? -value : value;
+		return TRUE;
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief Reads the dates of the Exif IFD and the rating of IFD0
+ * @returns FALSE if they are beyond @a size
+ */
+gboolean quick_metadata_parse_tiff(const guchar *tiff, guint size, QuickMetadata &metadata, gboolean &xmp_rating)
+{
+	guint offset;
+	TiffByteOrder bo;
+	if (!tiff_directory_offset(tiff, size, offset, bo)) return FALSE;
+
+	gboolean complete = TRUE;
+	guint exif_offset = 0;
+	const auto parse_ifd0_entry = [&](const guchar *tiff, guint offset, TiffByteOrder bo)
+	{
+		const TiffTag tt{tiff + offset, bo};
+		guint data_offset;
+
+		switch (tt.tag)
+			{
+			case TIFF_TAG_EXIF_IFD:
+				exif_offset = tt.data_val;
+				break;
+			case TIFF_TAG_RATING:
+				if (tt.format == TIFF_FORMAT_SHORT && !xmp_rating)
+					{
+					metadata.rating = tiff_byte_get_int16(tiff + offset + TIFF_TIFD_OFFSET_DATA, bo);
+					}
+				break;
+			case TIFF_TAG_XMP:
+				if (!tiff_tag_data_offset(tt, offset, 1, size, data_offset))
+					{
+					complete = FALSE;
+					}
+				else if (quick_metadata_parse_xmp(tiff + data_offset, tt.count, metadata.rating))
+					{
+					xmp_rating = TRUE;
+					}
+				break;
+			default:
+				break;
+			}
+		return 0;
+	};
+	if (tiff_parse_IFD_table(tiff, offset, size, bo, parse_ifd0_entry) < 0 || !complete) return FALSE;
+
+	if (exif_offset == 0) return TRUE;
+
+	const auto parse_exif_entry = [&](const guchar *tiff, guint offset, TiffByteOrder bo)
+	{
+		const TiffTag tt{tiff + offset, bo};
+		guint data_offset;
+
+		if (tt.tag != EXIF_TAG_DATE_TIME_ORIGINAL && tt.tag != EXIF_TAG_DATE_TIME_DIGITIZED) return 0;
+		if (tt.format != TIFF_FORMAT_ASCII) return 0;
+
+		if (!tiff_tag_data_offset(tt, offset, 1, size, data_offset))
+			{
+			complete = FALSE;
+			return 0;
+			}
+
+		const auto *str = reinterpret_cast<const gchar *>(tiff + data_offset);
+		std::string &date = (tt.tag == EXIF_TAG_DATE_TIME_ORIGINAL) ? metadata.date_time_original : metadata.date_time_digitized;
+		date.assign(str, strnlen(str, tt.count));
+		return 0;
+	};
+	return tiff_parse_IFD_table(tiff, exif_offset, size, bo, parse_exif_entry) == 0 && complete;
+}
+
+/**
+ * @brief Reads the Exif and XMP segments, which precede the frame
+ * @returns FALSE if they are beyond @a size
+ */
+gboolean quick_metadata_parse_jpeg(const guchar *data, guint size, QuickMetadata &metadata, gboolean &xmp_rating)
+{
+	guint offset = 2;
+
+	while (TRUE)
+		{
+		if (offset + 4 > size || data[offset] != JPEG_MARKER) return FALSE;
+
+		const guchar marker = data[offset + 1];
+		if (marker == JPEG_MARKER)
+			{
+			/* fill byte */
+			offset++;
+			continue;
+			}
+		if ((marker & 0xf0) != 0xe0 && marker != JPEG_MARKER_COM) return TRUE;
+
+		const guint length = (static_cast<guint>(data[offset + 2]) << 8) + data[offset + 3];
+		if (length < 2) return FALSE;
+
+		if (marker == JPEG_MARKER_APP1)
+			{
+			if (offset + 2 + length > size) return FALSE;
+
+			const guchar *segment = data + offset + 4;
+			const guint segment_size = length - 2;
+			const std::string_view segment_view(reinterpret_cast<const gchar *>(segment), segment_size);
+
+			if (segment_view.substr(0, EXIF_MAGIC.size()) == EXIF_MAGIC)
+				{
+				if (!quick_metadata_parse_tiff(segment + EXIF_MAGIC.size(), segment_size - EXIF_MAGIC.size(), metadata, xmp_rating)) return FALSE;
+				}
+			else if (segment_view.substr(0, XMP_MAGIC.size()) == XMP_MAGIC)
+				{
+				if (quick_metadata_parse_xmp(segment + XMP_MAGIC.size(), segment_size - XMP_MAGIC.size(), metadata.rating)) xmp_rating = TRUE;
+				}
+			}
+
+		offset += 2 + length;
+		}
+}
+
 } // namespace
 
 gboolean is_jpeg_container(const guchar *data, guint size)
@@ -346,4 +529,24 @@ MPOData jpeg_get_mpo_data(const guchar *data, guint size)
 	return mpo;
 }
 
+/**
+ * @brief Reads the capture dates and the rating from the start of a JPEG or
+ * TIFF based file, without a full metadata parse
+ * @param data The start of the file
+ * @param metadata Set to what was found, empty for missing tags
+ * @returns FALSE if the format is not handled, or the metadata is not all in @a data
+ *
+ * An XMP rating takes precedence over the Exif one, as in the Exiv2 XMP sync.
+ */
+gboolean quick_metadata_parse(const guchar *data, guint size, QuickMetadata &metadata)
+{
+	gboolean xmp_rating = FALSE;
+
+	metadata = {};
+
+	if (is_jpeg_container(data, size)) return quick_metadata_parse_jpeg(data, size, metadata, xmp_rating);
+
+	return data != nullptr && quick_metadata_parse_tiff(data, size, metadata, xmp_rating);
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
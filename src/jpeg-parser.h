@@ -22,6 +22,7 @@
 #ifndef JPEG_PARSER_H
 #define JPEG_PARSER_H
 
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -32,6 +33,7 @@
 #define JPEG_MARKER_EOI		0xD9
 #define JPEG_MARKER_APP1	0xE1
 #define JPEG_MARKER_APP2	0xE2
+#define JPEG_MARKER_COM		0xFE
 
 /* jpeg container format:
      all data markers start with 0XFF
@@ -96,6 +98,15 @@ struct MPOData {
 
 MPOData jpeg_get_mpo_data(const guchar *data, guint size);
 
+struct QuickMetadata
+{
+	std::string date_time_original;  /**< Exif.Photo.DateTimeOriginal, "YYYY:MM:DD HH:MM:SS" */
+	std::string date_time_digitized; /**< Exif.Photo.DateTimeDigitized */
+	gint rating = 0;                 /**< Xmp.xmp.Rating, or Exif.Image.Rating without XMP */
+};
+
+gboolean quick_metadata_parse(const guchar *data, guint size, QuickMetadata &metadata);
+
 #endif
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -594,7 +594,7 @@ static void li_pop_menu_copy_image_cb(GtkWidget *widget, gpointer data)
 	auto lw = static_cast<LayoutWindow *>(data);
 	ImageWindow *imd = lw->image;
 
-	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	g_autoptr(GdkPixbuf) pixbuf = image_get_pixbuf_full(imd);
 	if (!pixbuf)
 		{
 		return;
@@ -1368,7 +1368,6 @@ void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_
 void layout_image_set_index(LayoutWindow *lw, gint index)
 {
 	FileData *fd;
-	FileData *read_ahead_fd;
 	gint old;
 
 	if (!layout_valid(&lw)) return;
@@ -1376,14 +1375,7 @@ void layout_image_set_index(LayoutWindow *lw, gint index)
 	old = layout_list_get_index(lw, layout_image_get_fd(lw));
 	fd = layout_list_get_fd(lw, index);
 
-	if (old > index)
-		{
-		read_ahead_fd = layout_list_get_fd(lw, index - 1);
-		}
-	else
-		{
-		read_ahead_fd = layout_list_get_fd(lw, index + 1);
-		}
+	const gint direction = (old > index) ? -1 : 1;
 
 	if (layout_selection_count(lw) > 1)
 		{
@@ -1410,11 +1402,21 @@ void layout_image_set_index(LayoutWindow *lw, gint index)
 					newindex = x.back();
 				}
 
-			read_ahead_fd = layout_list_get_fd(lw, newindex);
+			layout_image_set_with_ahead(lw, fd, layout_list_get_fd(lw, newindex));
+			return;
 			}
 		}
 
-	layout_image_set_with_ahead(lw, fd, read_ahead_fd);
+	layout_image_set_fd(lw, fd);
+	if (options->image.enable_read_ahead)
+		{
+		image_prebuffer_set_window(lw->image, [lw, index, direction](gint step) -> FileData *
+		{
+			const gint n = index + step * direction;
+
+			return n >= 0 ? layout_list_get_fd(lw, n) : nullptr;
+		});
+		}
 }
 
 static void layout_image_set_collection_real(LayoutWindow *lw, CollectionData *cd, CollectInfo *info, gboolean forward)
@@ -464,8 +464,7 @@ static void layout_menu_copy_image_cb(GtkAction *, gpointer data)
 	auto lw = static_cast<LayoutWindow *>(data);
 	ImageWindow *imd = lw->image;
 
-	GdkPixbuf *pixbuf;
-	pixbuf = image_get_pixbuf(imd);
+	g_autoptr(GdkPixbuf) pixbuf = image_get_pixbuf_full(imd);
 	if (!pixbuf) return;
 
 #if HAVE_GTK4
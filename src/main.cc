@@ -75,8 +75,10 @@
 #include "layout.h"
 #include "logwindow.h"
 #include "main-defines.h"
+#include "metadata-index.h"
 #include "metadata.h"
 #include "options.h"
+#include "pixbuf-pool.h"
 #include "pixbuf-util.h"
 #include "third-party/whereami.h"
 #include "thumb.h"
@@ -171,6 +173,7 @@ GOptionEntry command_line_options[] =
 	{ "get-filelist-recurse"      ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("get list of files and class recursive")                                       , "[<FOLDER>]" },
 	{ "get-rectangle"             ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("get rectangle coordinates")                                                   , nullptr },
 	{ "get-render-intent"         ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("get render intent")                                                           , nullptr },
+	{ "get-render-stats"          ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("get image loading and rendering statistics as JSON")                          , nullptr },
 	{ "get-selection"             ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("get list of selected files")                                                  , nullptr },
 	{ "get-sidecars"              ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("get list of sidecars of FILE")                                                , "<FILE>" },
 	{ "get-window-list"           ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("get list of windows")                                                         , nullptr },
@@ -482,6 +485,8 @@ void exit_program_final()
 	layout_editors_reload_finish();
 
 	collect_manager_flush();
+	cache_sim_data_flush();
+	metadata_index_flush();
 
 	/* Save the named windows */
 	if (layout_window_count() > 1)
@@ -505,6 +510,8 @@ void exit_program_final()
 		layout_free(lw);
 		}
 
+	pixbuf_pool_clear();
+
 	/* Delete any files/folders in /tmp that have been created by the open archive function */
 	g_autofree gchar *instance_archive_dir = g_build_filename(g_get_tmp_dir(), GQ_ARCHIVE_DIR, instance_identifier, NULL);
 	if (isdir(instance_archive_dir))
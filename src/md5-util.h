@@ -52,6 +52,8 @@ gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest);
 
 gchar *md5_get_string_from_file(const gchar *path);
 
+gchar *md5_get_sample_string_from_file(const gchar *path, gsize sample_size);
+
 gchar *md5_digest_to_text(const Md5Digest &digest);
 
 gboolean md5_digest_from_text(const gchar *text, Md5Digest &digest);
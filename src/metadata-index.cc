@@ -0,0 +1,638 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "metadata-index.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "cache.h"
+#include "debug.h"
+#include "filedata.h"
+#include "options.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Metadata index file format:
+ *-------------------------------------------------------------------
+ *
+ * One file per folder, named GQ_CACHE_METADATA_INDEX, in the metadata
+ * cache location of the folder. The file is a #MetadataIndexHeader,
+ * followed by fixed size #MetadataIndexRecord entries sorted by file name,
+ * followed by a pool of nul terminated strings, in host byte order. The
+ * records hold offsets into the pool, so the index of a whole folder is
+ * available with a single mmap and a lookup is a binary search.
+ */
+
+namespace
+{
+
+constexpr gchar metadata_index_magic[8] = {'G', 'Q', 'M', 'E', 'T', 'A', 'D', 'B'};
+constexpr guint32 METADATA_INDEX_VERSION = 1;
+constexpr guint METADATA_INDEX_MAX_OPEN = 8; /**< Folders kept mapped */
+constexpr guint METADATA_INDEX_FLUSH_DELAY = 2; /**< Seconds to collect writes before saving */
+constexpr gsize METADATA_INDEX_LARGE = 1024; /**< Entries from which the file is saved less often */
+constexpr gint64 METADATA_INDEX_REWRITE_INTERVAL = 30 * G_USEC_PER_SEC; /**< Least time between rewrites of a large file */
+
+enum MetadataIndexValue : guint32 {
+	METADATA_INDEX_HAS_COMMENT   = 1 << 0,
+	METADATA_INDEX_HAS_LATITUDE  = 1 << 1,
+	METADATA_INDEX_HAS_LONGITUDE = 1 << 2
+};
+
+struct MetadataIndexHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 record_size;
+	guint64 count;
+	guint64 pool_size;
+};
+
+/**
+ * The values of a record start at \a strings in the pool: the comment,
+ * the latitude and the longitude, empty when not present, followed by
+ * \a keyword_count keywords.
+ */
+struct MetadataIndexRecord
+{
+	gint64 mtime;
+	gint64 size;
+	gint64 stamp;
+	gint64 date;
+	gint64 date_digitized;
+	guint32 name;     /**< Offset of the file name in the pool */
+	guint32 strings;  /**< Offset of the values in the pool */
+	guint32 fields;   /**< #MetadataIndexField */
+	guint32 values;   /**< #MetadataIndexValue */
+	gint32 rating;
+	guint32 keyword_count;
+};
+
+static_assert(sizeof(MetadataIndexHeader) % 8 == 0 && sizeof(MetadataIndexRecord) % 8 == 0, "records must stay aligned");
+
+struct MetadataIndexKey
+{
+	gint64 mtime;
+	gint64 size;
+	gint64 stamp; /**< Newest modification time of the sidecars and legacy metadata files */
+
+	bool operator==(const MetadataIndexKey &other) const
+	{
+		return mtime == other.mtime && size == other.size && stamp == other.stamp;
+	}
+};
+
+struct MetadataIndexItem
+{
+	MetadataIndexKey key;
+	MetadataIndexEntry entry;
+};
+
+/**
+ * @brief The index of one folder
+ *
+ * Written and removed items are kept in \a pending and merged into the
+ * file by flush(). The records are not of fixed size, so every save
+ * rewrites the file, which is done less often for large folders.
+ */
+class MetadataIndexDb
+{
+public:
+	explicit MetadataIndexDb(const gchar *path) : path(path) {}
+	~MetadataIndexDb()
+	{
+		flush(TRUE);
+		unmap();
+	}
+
+	MetadataIndexDb(const MetadataIndexDb &) = delete;
+	MetadataIndexDb &operator=(const MetadataIndexDb &) = delete;
+
+	bool find(const gchar *name, MetadataIndexItem &item);
+	void put(const gchar *name, const MetadataIndexItem &item);
+	void remove(const gchar *name);
+	gboolean flush(gboolean force);
+
+	guint64 last_use = 0;
+
+private:
+	void map();
+	void unmap();
+	const MetadataIndexRecord *find_mapped(const gchar *name) const;
+	bool decode(const MetadataIndexRecord &record, MetadataIndexItem &item) const;
+
+	std::string path;
+	GMappedFile *mapped = nullptr;
+	const MetadataIndexRecord *records = nullptr;
+	gsize count = 0;
+	const gchar *pool = nullptr;
+	gsize pool_size = 0;
+	time_t mapped_mtime = 0;
+	off_t mapped_size = -1;
+	std::map<std::string, std::optional<MetadataIndexItem>> pending; /**< std::nullopt if removed */
+	gint64 rewrite_time = 0; /**< monotonic time of the last rewrite */
+};
+
+/**
+ * @brief Maps the file, or maps it again if it was replaced
+ *
+ * The file is only ever replaced by rename, see secure_save(), so an
+ * existing mapping can not be truncated under us.
+ */
+void MetadataIndexDb::map()
+{
+	g_autofree gchar *pathl = path_from_utf8(path.c_str());
+	struct stat st;
+
+	if (stat(pathl, &st) != 0)
+		{
+		unmap();
+		return;
+		}
+
+	if (mapped && st.st_mtime == mapped_mtime && st.st_size == mapped_size) return;
+
+	unmap();
+
+	mapped = g_mapped_file_new(pathl, FALSE, nullptr);
+	if (!mapped) return;
+
+	mapped_mtime = st.st_mtime;
+	mapped_size = st.st_size;
+
+	const gsize length = g_mapped_file_get_length(mapped);
+	const gchar *contents = g_mapped_file_get_contents(mapped);
+	const auto *header = reinterpret_cast<const MetadataIndexHeader *>(contents);
+
+	if (length < sizeof(MetadataIndexHeader) ||
+	    memcmp(header->magic, metadata_index_magic, sizeof(metadata_index_magic)) != 0 ||
+	    header->version != METADATA_INDEX_VERSION ||
+	    header->record_size != sizeof(MetadataIndexRecord) ||
+	    header->count > (length - sizeof(MetadataIndexHeader)) / sizeof(MetadataIndexRecord) ||
+	    header->pool_size != length - sizeof(MetadataIndexHeader) - header->count * sizeof(MetadataIndexRecord) ||
+	    (header->pool_size > 0 && contents[length - 1] != '\0'))
+		{
+		DEBUG_1("%s is not a metadata index", path.c_str());
+		return;
+		}
+
+	const auto *first = reinterpret_cast<const MetadataIndexRecord *>(contents + sizeof(MetadataIndexHeader));
+	const gsize n = header->count;
+
+	/* all lookups can then use the offsets as they are */
+	if (!std::all_of(first, first + n, [header](const MetadataIndexRecord &r){ return r.name < header->pool_size && r.strings < header->pool_size; }))
+		{
+		DEBUG_1("%s is not a metadata index", path.c_str());
+		return;
+		}
+
+	records = first;
+	count = n;
+	pool = reinterpret_cast<const gchar *>(first + n);
+	pool_size = header->pool_size;
+}
+
+void MetadataIndexDb::unmap()
+{
+	if (mapped) g_mapped_file_unref(mapped);
+
+	mapped = nullptr;
+	records = nullptr;
+	count = 0;
+	pool = nullptr;
+	pool_size = 0;
+	mapped_size = -1;
+}
+
+const MetadataIndexRecord *MetadataIndexDb::find_mapped(const gchar *name) const
+{
+	const MetadataIndexRecord *end = records + count;
+	const MetadataIndexRecord *record = std::lower_bound(records, end, name, [this](const MetadataIndexRecord &r, const gchar *n)
+	{
+		return strcmp(pool + r.name, n) < 0;
+	});
+
+	if (record == end || strcmp(pool + record->name, name) != 0) return nullptr;
+
+	return record;
+}
+
+bool MetadataIndexDb::decode(const MetadataIndexRecord &record, MetadataIndexItem &item) const
+{
+	const gchar *p = pool + record.strings;
+	const gchar *end = pool + pool_size;
+
+	/* the pool ends with a nul, see map() */
+	const auto next = [&p, end]() -> const gchar *
+	{
+		if (p >= end) return nullptr;
+
+		const gchar *s = p;
+		p += strlen(s) + 1;
+		return s;
+	};
+
+	const gchar *comment = next();
+	const gchar *latitude = next();
+	const gchar *longitude = next();
+	if (!longitude) return false;
+
+	item.key = {record.mtime, record.size, record.stamp};
+
+	MetadataIndexEntry &entry = item.entry;
+	entry.fields = record.fields;
+	entry.date = record.date;
+	entry.date_digitized = record.date_digitized;
+	entry.rating = record.rating;
+	if (record.values & METADATA_INDEX_HAS_COMMENT) entry.comment = comment;
+	if (record.values & METADATA_INDEX_HAS_LATITUDE) entry.latitude = latitude;
+	if (record.values & METADATA_INDEX_HAS_LONGITUDE) entry.longitude = longitude;
+
+	entry.keywords.reserve(record.keyword_count);
+	for (guint32 i = 0; i < record.keyword_count; i++)
+		{
+		const gchar *keyword = next();
+		if (!keyword) return false;
+
+		entry.keywords.emplace_back(keyword);
+		}
+
+	return true;
+}
+
+bool MetadataIndexDb::find(const gchar *name, MetadataIndexItem &item)
+{
+	auto it = pending.find(name);
+	if (it != pending.end())
+		{
+		if (!it->second) return false;
+
+		item = *it->second;
+		return true;
+		}
+
+	map();
+
+	const MetadataIndexRecord *record = find_mapped(name);
+
+	return record && decode(*record, item);
+}
+
+void MetadataIndexDb::put(const gchar *name, const MetadataIndexItem &item)
+{
+	pending[name] = item;
+}
+
+void MetadataIndexDb::remove(const gchar *name)
+{
+	auto it = pending.find(name);
+	if (it != pending.end())
+		{
+		it->second.reset();
+		return;
+		}
+
+	map();
+
+	if (find_mapped(name)) pending[name] = std::nullopt;
+}
+
+void metadata_index_encode(const std::string &name, const MetadataIndexItem &item, GString *records, GString *pool)
+{
+	const MetadataIndexEntry &entry = item.entry;
+	MetadataIndexRecord record{};
+
+	record.mtime = item.key.mtime;
+	record.size = item.key.size;
+	record.stamp = item.key.stamp;
+	record.date = entry.date;
+	record.date_digitized = entry.date_digitized;
+	record.fields = entry.fields;
+	record.rating = entry.rating;
+	record.keyword_count = entry.keywords.size();
+
+	record.name = pool->len;
+	g_string_append_len(pool, name.c_str(), name.size() + 1);
+
+	record.strings = pool->len;
+	const auto append = [pool, &record](const std::optional<std::string> &value, MetadataIndexValue flag)
+	{
+		if (value) record.values |= flag;
+		g_string_append_len(pool, value ? value->c_str() : "", value ? value->size() + 1 : 1);
+	};
+	append(entry.comment, METADATA_INDEX_HAS_COMMENT);
+	append(entry.latitude, METADATA_INDEX_HAS_LATITUDE);
+	append(entry.longitude, METADATA_INDEX_HAS_LONGITUDE);
+	for (const std::string &keyword : entry.keywords)
+		{
+		g_string_append_len(pool, keyword.c_str(), keyword.size() + 1);
+		}
+
+	g_string_append_len(records, reinterpret_cast<const gchar *>(&record), sizeof(record));
+}
+
+/**
+ * @brief Merges the pending items with those of the file and saves it
+ * @param force Also save a large file, even if it was saved recently
+ * @returns TRUE if nothing is left pending
+ */
+gboolean MetadataIndexDb::flush(gboolean force)
+{
+	if (pending.empty()) return TRUE;
+
+	map();
+
+	const gint64 now = g_get_monotonic_time();
+	if (!force && count + pending.size() >= METADATA_INDEX_LARGE && now - rewrite_time < METADATA_INDEX_REWRITE_INTERVAL) return FALSE;
+
+	rewrite_time = now;
+
+	g_autoptr(GString) out_records = g_string_sized_new((count + pending.size()) * sizeof(MetadataIndexRecord));
+	g_autoptr(GString) out_pool = g_string_sized_new(pool_size);
+	guint64 out_count = 0;
+
+	const auto copy = [this, &out_records, &out_pool, &out_count](const MetadataIndexRecord &record)
+	{
+		MetadataIndexItem item;
+		if (!decode(record, item)) return;
+
+		metadata_index_encode(pool + record.name, item, out_records, out_pool);
+		out_count++;
+	};
+
+	const MetadataIndexRecord *record = records;
+	const MetadataIndexRecord *end = records + count;
+	for (const auto &entry : pending)
+		{
+		while (record < end && strcmp(pool + record->name, entry.first.c_str()) < 0)
+			{
+			copy(*record++);
+			}
+		if (record < end && strcmp(pool + record->name, entry.first.c_str()) == 0) record++;
+
+		if (!entry.second) continue;
+
+		metadata_index_encode(entry.first, *entry.second, out_records, out_pool);
+		out_count++;
+		}
+	while (record < end)
+		{
+		copy(*record++);
+		}
+
+	pending.clear();
+
+	if (out_pool->len > G_MAXUINT32)
+		{
+		log_printf("Metadata index %s is too large\n", path.c_str());
+		return TRUE;
+		}
+
+	MetadataIndexHeader header{};
+	memcpy(header.magic, metadata_index_magic, sizeof(header.magic));
+	header.version = METADATA_INDEX_VERSION;
+	header.record_size = sizeof(MetadataIndexRecord);
+	header.count = out_count;
+	header.pool_size = out_pool->len;
+
+	g_string_prepend_len(out_records, reinterpret_cast<const gchar *>(&header), sizeof(header));
+	g_string_append_len(out_records, out_pool->str, out_pool->len);
+
+	g_autofree gchar *pathl = path_from_utf8(path.c_str());
+	if (!secure_save(pathl, out_records->str, out_records->len))
+		{
+		log_printf("Failed to save metadata index %s\n", path.c_str());
+		}
+
+	unmap();
+
+	return TRUE;
+}
+
+/**
+ * @brief The open indexes, all access holds \a mutex
+ */
+struct MetadataIndexDbs
+{
+	std::mutex mutex;
+	std::unordered_map<std::string, std::unique_ptr<MetadataIndexDb>> dbs;
+	guint64 use_count = 0;
+	guint flush_id = 0;
+};
+
+MetadataIndexDbs &metadata_index_dbs()
+{
+	static MetadataIndexDbs metadata_index_dbs;
+
+	return metadata_index_dbs;
+}
+
+/**
+ * @brief Returns the index of the folder of \a source
+ * @param source
+ * @param create Create the cache folder if needed
+ *
+ * The caller must hold the \a mutex of metadata_index_dbs(). The least
+ * recently used index is closed when more than #METADATA_INDEX_MAX_OPEN
+ * are open.
+ */
+MetadataIndexDb *metadata_index_db_get(const gchar *source, gboolean create)
+{
+	g_autofree gchar *base = nullptr;
+	if (create)
+		{
+		base = cache_create_location(CacheType::METADATA, source);
+		}
+	else
+		{
+		g_autofree gchar *location = cache_get_location(CacheType::METADATA, source);
+		if (location) base = remove_level_from_path(location);
+		}
+	if (!base) return nullptr;
+
+	g_autofree gchar *path = g_build_filename(base, GQ_CACHE_METADATA_INDEX, nullptr);
+	MetadataIndexDbs &index = metadata_index_dbs();
+
+	auto it = index.dbs.find(path);
+	if (it == index.dbs.end())
+		{
+		if (index.dbs.size() >= METADATA_INDEX_MAX_OPEN)
+			{
+			auto oldest = std::min_element(index.dbs.begin(), index.dbs.end(), [](const auto &a, const auto &b)
+			{
+				return a.second->last_use < b.second->last_use;
+			});
+			index.dbs.erase(oldest);
+			}
+
+		it = index.dbs.emplace(path, std::make_unique<MetadataIndexDb>(path)).first;
+		}
+
+	it->second->last_use = ++index.use_count;
+
+	return it->second.get();
+}
+
+gboolean metadata_index_flush_cb(gpointer)
+{
+	MetadataIndexDbs &index = metadata_index_dbs();
+	std::lock_guard<std::mutex> lock(index.mutex);
+
+	gboolean done = TRUE;
+	for (auto &entry : index.dbs)
+		{
+		if (!entry.second->flush(FALSE)) done = FALSE;
+		}
+
+	if (!done) return G_SOURCE_CONTINUE;
+
+	index.flush_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief The key an entry of \a fd is valid for
+ *
+ * Metadata is also read from XMP sidecars and from the legacy metadata
+ * files of the cache, so their modification times are part of the key.
+ * The sidecars are taken from the group, without a stat.
+ */
+MetadataIndexKey metadata_index_key(FileData *fd)
+{
+	FileData *parent = fd->parent ? fd->parent : fd;
+	gint64 stamp = (parent != fd) ? parent->date : 0;
+
+	for (GList *work = parent->sidecar_files; work; work = work->next)
+		{
+		auto sfd = static_cast<FileData *>(work->data);
+
+		if (sfd != fd) stamp = std::max<gint64>(stamp, sfd->date);
+		}
+
+	for (CacheType type : {CacheType::METADATA, CacheType::XMP_METADATA})
+		{
+		g_autofree gchar *path = cache_find_location(type, fd->path);
+
+		if (path) stamp = std::max<gint64>(stamp, filetime(path));
+		}
+
+	return {fd->date, fd->size, stamp};
+}
+
+} // namespace
+
+/**
+ * @brief Looks up the indexed metadata of \a fd
+ * @returns TRUE if a valid entry was found, \a entry is unchanged otherwise
+ *
+ * The fields of the entry which were never stored are not set in
+ * MetadataIndexEntry::fields.
+ */
+gboolean metadata_index_get(FileData *fd, MetadataIndexEntry &entry)
+{
+	if (!options->metadata.index_database || !fd || fd->modified_xmp) return FALSE;
+
+	const MetadataIndexKey key = metadata_index_key(fd);
+
+	MetadataIndexDbs &index = metadata_index_dbs();
+	std::lock_guard<std::mutex> lock(index.mutex);
+
+	MetadataIndexDb *db = metadata_index_db_get(fd->path, FALSE);
+	if (!db) return FALSE;
+
+	MetadataIndexItem item;
+	if (!db->find(filename_from_path(fd->path), item) || !(item.key == key)) return FALSE;
+
+	entry = std::move(item.entry);
+
+	return TRUE;
+}
+
+/**
+ * @brief Stores the metadata of \a fd, replacing the entry
+ *
+ * To add fields, pass the entry returned by metadata_index_get() with the
+ * new fields set.
+ */
+void metadata_index_put(FileData *fd, const MetadataIndexEntry &entry)
+{
+	if (!options->metadata.index_database || !fd || fd->modified_xmp || !entry.fields) return;
+
+	const MetadataIndexItem item{metadata_index_key(fd), entry};
+
+	MetadataIndexDbs &index = metadata_index_dbs();
+	std::lock_guard<std::mutex> lock(index.mutex);
+
+	MetadataIndexDb *db = metadata_index_db_get(fd->path, TRUE);
+	if (!db) return;
+
+	db->put(filename_from_path(fd->path), item);
+
+	if (!index.flush_id)
+		{
+		index.flush_id = g_timeout_add_seconds(METADATA_INDEX_FLUSH_DELAY, metadata_index_flush_cb, nullptr);
+		}
+}
+
+/**
+ * @brief Drops the entry of \a fd, for when its metadata has changed
+ */
+void metadata_index_remove(FileData *fd)
+{
+	if (!fd) return;
+
+	MetadataIndexDbs &index = metadata_index_dbs();
+	std::lock_guard<std::mutex> lock(index.mutex);
+
+	MetadataIndexDb *db = metadata_index_db_get(fd->path, FALSE);
+	if (!db) return;
+
+	db->remove(filename_from_path(fd->path));
+
+	if (!index.flush_id)
+		{
+		index.flush_id = g_timeout_add_seconds(METADATA_INDEX_FLUSH_DELAY, metadata_index_flush_cb, nullptr);
+		}
+}
+
+/**
+ * @brief Saves and closes all metadata indexes
+ *
+ * Call before exit, pending entries are otherwise saved by a timeout.
+ */
+void metadata_index_flush()
+{
+	MetadataIndexDbs &index = metadata_index_dbs();
+	std::lock_guard<std::mutex> lock(index.mutex);
+
+	g_clear_handle_id(&index.flush_id, g_source_remove);
+
+	index.dbs.clear();
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
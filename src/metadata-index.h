@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+class FileData;
+
+/**
+ * @file
+ * An index of the metadata used to sort, filter and search, stored in one
+ * file per folder in the metadata cache location of the folder. It lets a
+ * folder be sorted by date or rating, or searched by keywords, comment or
+ * position, without reading the image files again.
+ *
+ * An entry is valid while the modification time and size of the file, and
+ * the newest modification time of its sidecars and legacy metadata files,
+ * match those it was stored with. Files with unwritten metadata changes
+ * are never looked up nor stored.
+ */
+
+enum MetadataIndexField : guint {
+	METADATA_INDEX_DATE           = 1 << 0, /**< FileData::exifdate */
+	METADATA_INDEX_DATE_DIGITIZED = 1 << 1, /**< FileData::exifdate_digitized */
+	METADATA_INDEX_RATING         = 1 << 2, /**< FileData::rating */
+	METADATA_INDEX_KEYWORDS       = 1 << 3, /**< KEYWORD_KEY */
+	METADATA_INDEX_COMMENT        = 1 << 4, /**< COMMENT_KEY */
+	METADATA_INDEX_GPS            = 1 << 5  /**< Xmp.exif.GPSLatitude and Xmp.exif.GPSLongitude */
+};
+
+struct MetadataIndexEntry
+{
+	guint fields = 0; /**< #MetadataIndexField known */
+
+	time_t date = 0;
+	time_t date_digitized = 0;
+	gint rating = 0;
+
+	/* the keywords as returned by metadata_read_list(), the others as by metadata_read_string() */
+	std::vector<std::string> keywords;
+	std::optional<std::string> comment;
+	std::optional<std::string> latitude;
+	std::optional<std::string> longitude;
+};
+
+gboolean metadata_index_get(FileData *fd, MetadataIndexEntry &entry);
+void metadata_index_put(FileData *fd, const MetadataIndexEntry &entry);
+void metadata_index_remove(FileData *fd);
+void metadata_index_flush();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -30,6 +30,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <optional>
 #include <string>
 
 #include <glib-object.h>
@@ -47,6 +48,7 @@
 #include "intl.h"
 #include "layout-util.h"
 #include "main-defines.h"
+#include "metadata-index.h"
 #include "misc.h"
 #include "options.h"
 #include "rcfile.h"
@@ -384,6 +386,7 @@ void metadata_notify_cb(FileData *fd, NotifyType type, gpointer)
 	if (type & (NOTIFY_REREAD | NOTIFY_CHANGE))
 		{
 		metadata_cache_free(fd);
+		metadata_index_remove(fd);
 
 		if (g_list_find(metadata_write_queue, fd))
 			{
@@ -473,6 +476,7 @@ gboolean metadata_write_perform(FileData *fd)
 		file_data_unref(file_data_new_group(fd->change->dest));
 
 	if (success) metadata_legacy_delete(fd, fd->change->dest);
+	if (success) metadata_index_remove(fd);
 	return success;
 }
 
@@ -752,26 +756,13 @@ static GList *remove_duplicate_strings_from_list(GList *list)
 	return g_list_reverse(newlist);
 }
 
-GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
+/**
+ * @brief Reads \a key from the legacy metadata file or the image, see metadata_read_list()
+ */
+static GList *metadata_read_list_file(FileData *fd, const gchar *key, MetadataFormat format)
 {
 	ExifData *exif;
 	GList *list = nullptr;
-	const GList *cache_values;
-	if (!fd) return nullptr;
-
-	/* unwritten data override everything */
-	if (fd->modified_xmp && format == METADATA_PLAIN)
-		{
-		list = static_cast<GList *>(g_hash_table_lookup(fd->modified_xmp, key));
-		if (list) return string_list_copy(list);
-		}
-
-
-	if (format == METADATA_PLAIN && strcmp(key, KEYWORD_KEY) == 0
-	    && (cache_values = metadata_cache_get(fd, key)))
-		{
-		return string_list_copy(cache_values);
-		}
 
 	/*
 	    Legacy metadata file is the primary source if it exists.
@@ -820,6 +811,116 @@ GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
 	return list;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * metadata index - keep searched keys of whole dir on disk
+ *-------------------------------------------------------------------
+ */
+
+static const gchar *const METADATA_INDEX_LATITUDE_KEY = "Xmp.exif.GPSLatitude";
+static const gchar *const METADATA_INDEX_LONGITUDE_KEY = "Xmp.exif.GPSLongitude";
+
+/**
+ * @returns The #MetadataIndexField of \a key, or 0 if it is not indexed
+ */
+static guint metadata_index_field(const gchar *key)
+{
+	if (strcmp(key, KEYWORD_KEY) == 0) return METADATA_INDEX_KEYWORDS;
+	if (strcmp(key, COMMENT_KEY) == 0) return METADATA_INDEX_COMMENT;
+	if (strcmp(key, METADATA_INDEX_LATITUDE_KEY) == 0 || strcmp(key, METADATA_INDEX_LONGITUDE_KEY) == 0) return METADATA_INDEX_GPS;
+
+	return 0;
+}
+
+static std::optional<std::string> metadata_index_read_value(FileData *fd, const gchar *key)
+{
+	GList *list = metadata_read_list_file(fd, key, METADATA_PLAIN);
+	if (!list) return std::nullopt;
+
+	std::string value = list->data ? static_cast<const gchar *>(list->data) : "";
+	g_list_free_full(list, g_free);
+
+	return value;
+}
+
+/**
+ * @brief Reads \a key from the index, updating the index from the file if needed
+ *
+ * The indexed keys are read together, as the exif data of the file is
+ * loaded for any of them.
+ */
+static GList *metadata_index_read_list(FileData *fd, const gchar *key, guint field)
+{
+	MetadataIndexEntry entry;
+
+	if (!metadata_index_get(fd, entry) || !(entry.fields & field))
+		{
+		GList *keywords = metadata_read_list_file(fd, KEYWORD_KEY, METADATA_PLAIN);
+		entry.keywords.clear();
+		for (GList *work = keywords; work; work = work->next)
+			{
+			entry.keywords.emplace_back(static_cast<const gchar *>(work->data));
+			}
+		g_list_free_full(keywords, g_free);
+
+		entry.comment = metadata_index_read_value(fd, COMMENT_KEY);
+		entry.latitude = metadata_index_read_value(fd, METADATA_INDEX_LATITUDE_KEY);
+		entry.longitude = metadata_index_read_value(fd, METADATA_INDEX_LONGITUDE_KEY);
+		entry.fields |= METADATA_INDEX_KEYWORDS | METADATA_INDEX_COMMENT | METADATA_INDEX_GPS;
+
+		metadata_index_put(fd, entry);
+		}
+
+	if (field == METADATA_INDEX_KEYWORDS)
+		{
+		GList *list = nullptr;
+		for (const std::string &keyword : entry.keywords)
+			{
+			list = g_list_prepend(list, g_strdup(keyword.c_str()));
+			}
+		list = g_list_reverse(list);
+
+		metadata_cache_update(fd, key, list);
+		return list;
+		}
+
+	const std::optional<std::string> &value = (field == METADATA_INDEX_COMMENT) ? entry.comment :
+	                                          (strcmp(key, METADATA_INDEX_LATITUDE_KEY) == 0) ? entry.latitude : entry.longitude;
+	if (!value) return nullptr;
+
+	return g_list_append(nullptr, g_strdup(value->c_str()));
+}
+
+GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
+{
+	GList *list = nullptr;
+	const GList *cache_values;
+	if (!fd) return nullptr;
+
+	/* unwritten data override everything */
+	if (fd->modified_xmp && format == METADATA_PLAIN)
+		{
+		list = static_cast<GList *>(g_hash_table_lookup(fd->modified_xmp, key));
+		if (list) return string_list_copy(list);
+		}
+
+
+	if (format == METADATA_PLAIN && strcmp(key, KEYWORD_KEY) == 0
+	    && (cache_values = metadata_cache_get(fd, key)))
+		{
+		return string_list_copy(cache_values);
+		}
+
+	if (format == METADATA_PLAIN && options->metadata.index_database && !fd->modified_xmp)
+		{
+		const guint field = metadata_index_field(key);
+
+		if (field) return metadata_index_read_list(fd, key, field);
+		}
+
+	return metadata_read_list_file(fd, key, format);
+}
+
 gchar *metadata_read_string(FileData *fd, const gchar *key, MetadataFormat format)
 {
 	GList *string_list = metadata_read_list(fd, key, format);
@@ -129,6 +129,9 @@ ConfOptions *init_options(ConfOptions *options)
 	options->image.alpha_color_2.green = static_cast<gdouble>(0x006666) / 65535;
 	options->image.alpha_color_2.blue = static_cast<gdouble>(0x006666) / 65535;
 	options->image.enable_read_ahead = TRUE;
+	options->image.read_ahead_count = 2;
+	options->image.read_behind_count = 1;
+	options->image.decode_to_fit = TRUE;
 	options->image.exif_rotate_enable = TRUE;
 	options->image.fit_window_to_image = FALSE;
 	options->image.limit_autofit_size = FALSE;
@@ -184,6 +187,7 @@ ConfOptions *init_options(ConfOptions *options)
 	options->metadata.write_orientation = TRUE;
 	options->metadata.sidecar_extended_name = FALSE;
 	options->metadata.check_spelling = TRUE;
+	options->metadata.index_database = TRUE;
 
 	options->show_icon_names = TRUE;
 	options->show_star_rating = FALSE;
@@ -198,6 +202,7 @@ ConfOptions *init_options(ConfOptions *options)
 
 	options->thumbnails.cache_into_dirs = FALSE;
 	options->thumbnails.enable_caching = TRUE;
+	options->thumbnails.sim_database = FALSE;
 	options->thumbnails.max_width = DEFAULT_THUMB_WIDTH;
 	options->thumbnails.max_height = DEFAULT_THUMB_HEIGHT;
 	options->thumbnails.quality = GDK_INTERP_TILES;
@@ -236,6 +241,9 @@ ConfOptions *init_options(ConfOptions *options)
 	options->printer.page_text_position = HEADER_1;
 
 	options->threads.duplicates = get_cpu_cores() - 1;
+	options->threads.duplicates_decoders = get_cpu_cores();
+	options->threads.thumbnails = get_cpu_cores();
+	options->threads.tile_render = get_cpu_cores();
 
 	options->disabled_plugins.clear();
 
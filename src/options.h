@@ -215,6 +215,9 @@ struct ConfOptions
 		gint tile_cache_max;	/**< in megabytes */
 		gint image_cache_max;   /**< in megabytes */
 		gboolean enable_read_ahead;
+		gint read_ahead_count; /**< images read ahead in the direction of travel */
+		gint read_behind_count; /**< images read ahead behind the direction of travel */
+		gboolean decode_to_fit; /**< decode at display size first when zoomed to fit */
 
 		ZoomMode zoom_mode;
 		gboolean zoom_2pass;
@@ -238,6 +241,7 @@ struct ConfOptions
 		gint max_height;
 		gboolean enable_caching;
 		gboolean cache_into_dirs;
+		gboolean sim_database; /**< sim. data in one file per folder, see cache.cc */
 		gboolean use_xvpics;
 		gboolean spec_standard;
 		GdkInterpType quality;
@@ -339,6 +343,7 @@ struct ConfOptions
 		gboolean sidecar_extended_name;
 
 		gboolean check_spelling;
+		gboolean index_database; /**< index of sort and search metadata per folder, see metadata-index.cc */
 	} metadata;
 
 	/* Stereo */
@@ -412,6 +417,9 @@ struct ConfOptions
 	/* Threads */
 	struct {
 		gint duplicates;
+		gint duplicates_decoders;
+		gint thumbnails;
+		gint tile_render;
 	} threads;
 
 	/* Selectable bars */
@@ -295,6 +295,7 @@ static gboolean pan_queue_step(PanWindow *pw)
 	if (pi->is_type(PAN_ITEM_IMAGE))
 		{
 		pw->il = image_loader_new(pi->fd);
+		image_loader_set_priority_class(pw->il, IMAGE_LOADER_PRIORITY_THUMBNAIL);
 
 		if (pw->size != PAN_IMAGE_SIZE_100)
 			{
@@ -493,17 +494,14 @@ static void pan_window_zoom_limit(PanWindow *pw)
  *-----------------------------------------------------------------------------
  */
 
-static gint pan_cache_sort_file_cb(gconstpointer a, gconstpointer b, gpointer data)
+static const FileData *pan_cache_sort_file_cb(gconstpointer data)
 {
-	auto pca = static_cast<const PanCacheData *>(a);
-	auto pcb = static_cast<const PanCacheData *>(b);
-	auto settings = static_cast<FileData::FileList::SortSettings *>(data);
-	return filelist_sort_compare_filedata(pca->fd, pcb->fd, settings);
+	return static_cast<const PanCacheData *>(data)->fd;
 }
 
 static void pan_cache_sort(PanWindow *pw, FileData::FileList::SortSettings settings)
 {
-	pw->cache_list = g_list_sort_with_data(pw->cache_list, pan_cache_sort_file_cb, &settings);
+	pw->cache_list = FileData::FileList::sort_full(pw->cache_list, settings, pan_cache_sort_file_cb);
 }
 
 static void pan_cache_free(PanWindow *pw)
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pixbuf-pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+
+#include "render-stats.h"
+
+namespace
+{
+
+constexpr gsize PIXBUF_POOL_ALIGN = 64;                         /**< of the first row, for vector code */
+constexpr guint PIXBUF_POOL_MAX_IDLE = 4;                       /**< buffers kept for reuse */
+constexpr gsize PIXBUF_POOL_MAX_IDLE_BYTES = 256 * 1024 * 1024; /**< bytes kept for reuse */
+
+struct PixbufPoolBuffer
+{
+	guchar *pixels;
+	gsize size;
+};
+
+GMutex pool_mutex;
+std::deque<PixbufPoolBuffer> pool_idle; /**< most recently released first */
+gsize pool_idle_bytes = 0;
+
+/** @returns The bytes of a row, as by gdk_pixbuf_new() */
+gsize pixbuf_pool_rowstride(gboolean has_alpha, gint width)
+{
+	const gsize channels = has_alpha ? 4 : 3;
+
+	return (channels * width + 3) & ~static_cast<gsize>(3);
+}
+
+/** @returns The size allocated for the rows, rounded up as std::aligned_alloc() requires */
+gsize pixbuf_pool_size(gsize rowstride, gint height)
+{
+	const gsize size = rowstride * height;
+
+	return (size + PIXBUF_POOL_ALIGN - 1) & ~(PIXBUF_POOL_ALIGN - 1);
+}
+
+/** @brief Drops the least recently released buffers beyond the limits, with pool_mutex held */
+void pixbuf_pool_trim()
+{
+	while (pool_idle.size() > PIXBUF_POOL_MAX_IDLE || pool_idle_bytes > PIXBUF_POOL_MAX_IDLE_BYTES)
+		{
+		const PixbufPoolBuffer &buffer = pool_idle.back();
+
+		pool_idle_bytes -= buffer.size;
+		std::free(buffer.pixels);
+		pool_idle.pop_back();
+		}
+}
+
+/** @brief The destroy notify of the pixbufs, @a data is the size of the buffer */
+void pixbuf_pool_release(guchar *pixels, gpointer data)
+{
+	const gsize size = GPOINTER_TO_SIZE(data);
+
+	g_mutex_lock(&pool_mutex);
+	pool_idle.push_front({pixels, size});
+	pool_idle_bytes += size;
+	pixbuf_pool_trim();
+	g_mutex_unlock(&pool_mutex);
+}
+
+guchar *pixbuf_pool_take(gsize size)
+{
+	g_mutex_lock(&pool_mutex);
+
+	auto it = std::find_if(pool_idle.begin(), pool_idle.end(),
+	                       [size](const PixbufPoolBuffer &buffer){ return buffer.size == size; });
+	guchar *pixels = nullptr;
+	if (it != pool_idle.end())
+		{
+		pixels = it->pixels;
+		pool_idle_bytes -= size;
+		pool_idle.erase(it);
+		}
+
+	g_mutex_unlock(&pool_mutex);
+
+	return pixels;
+}
+
+} // namespace
+
+/**
+ * @brief Creates a pixbuf with the layout of gdk_pixbuf_new(), taking its
+ * pixels from the pool if a buffer of the same size is free
+ * @returns The pixbuf, or nullptr if it cannot be allocated
+ *
+ * Like gdk_pixbuf_new(), the content of the pixels is undefined. Rows of
+ * four channels are not padded, so such pixbufs can be written to as one
+ * packed array.
+ */
+GdkPixbuf *pixbuf_pool_new(gboolean has_alpha, gint width, gint height)
+{
+	if (width <= 0 || height <= 0) return nullptr;
+
+	const gsize rowstride = pixbuf_pool_rowstride(has_alpha, width);
+	if (rowstride > G_MAXINT || static_cast<gsize>(height) > (G_MAXSIZE - PIXBUF_POOL_ALIGN) / rowstride) return nullptr;
+
+	const gsize size = pixbuf_pool_size(rowstride, height);
+
+	guchar *pixels = pixbuf_pool_take(size);
+	if (pixels)
+		{
+		render_stats_count(RENDER_STAT_PIXBUF_POOL_HIT);
+		}
+	else
+		{
+		render_stats_count(RENDER_STAT_PIXBUF_POOL_MISS);
+		pixels = static_cast<guchar *>(std::aligned_alloc(PIXBUF_POOL_ALIGN, size));
+		if (!pixels) return nullptr;
+		}
+
+	return gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, has_alpha, 8, width, height, rowstride,
+	                                pixbuf_pool_release, GSIZE_TO_POINTER(size));
+}
+
+/**
+ * @brief Frees the buffers kept for reuse
+ */
+void pixbuf_pool_clear()
+{
+	g_mutex_lock(&pool_mutex);
+	for (const PixbufPoolBuffer &buffer : pool_idle)
+		{
+		std::free(buffer.pixels);
+		}
+	pool_idle.clear();
+	pool_idle_bytes = 0;
+	g_mutex_unlock(&pool_mutex);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
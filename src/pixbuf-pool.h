@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PIXBUF_POOL_H
+#define PIXBUF_POOL_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+/**
+ * @file
+ * Pixel buffers for decoded images. Loader backends decode straight into
+ * a pixbuf from the pool, which is handed on to the renderer as it is.
+ * When the last reference to it is dropped its buffer is kept for the
+ * next image of the same size, instead of allocating and faulting in a
+ * new frame for every image of a series. All functions can be called
+ * from any thread.
+ */
+
+GdkPixbuf *pixbuf_pool_new(gboolean has_alpha, gint width, gint height);
+void pixbuf_pool_clear();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -32,6 +32,7 @@
 #include "misc.h"
 #include "options.h"
 #include "renderer-tiles.h"
+#include "tile-index.h"
 #include "ui-misc.h"
 
 /* comment this out if not using this from within Geeqie
@@ -134,6 +135,7 @@ static void pr_scroller_timer_set(PixbufRenderer *pr, gboolean start);
 
 
 static void pr_source_tile_free_all(PixbufRenderer *pr);
+static void pr_pyramid_clear(PixbufRenderer *pr);
 
 static void pr_zoom_sync(PixbufRenderer *pr, gdouble zoom,
 			 PrZoomFlags flags, gint px, gint py);
@@ -431,7 +433,9 @@ static void pixbuf_renderer_init(PixbufRenderer *pr)
 	pr->mouse = { -1, -1 };
 
 	pr->source_tiles_enabled = FALSE;
-	pr->source_tiles = nullptr;
+	pr->source_tiles = new TileIndex<SourceTile>();
+
+	pr->pyramid = g_ptr_array_new_with_free_func(g_object_unref);
 
 	pr->orientation = 1;
 
@@ -468,9 +472,13 @@ static void pixbuf_renderer_finalize(GObject *object)
 
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
 
+	pr_pyramid_clear(pr);
+	g_ptr_array_unref(pr->pyramid);
+
 	pr_scroller_timer_set(pr, FALSE);
 
 	pr_source_tile_free_all(pr);
+	delete pr->source_tiles;
 }
 
 PixbufRenderer *pixbuf_renderer_new()
@@ -905,8 +913,15 @@ static void pr_source_tile_free(SourceTile *st)
 
 static void pr_source_tile_free_all(PixbufRenderer *pr)
 {
-	g_list_free_full(pr->source_tiles, reinterpret_cast<GDestroyNotify>(pr_source_tile_free));
-	pr->source_tiles = nullptr;
+	SourceTile *st = pr->source_tiles->first();
+	while (st)
+		{
+		SourceTile *next = st->lru_next;
+		pr_source_tile_free(st);
+		st = next;
+		}
+
+	pr->source_tiles->clear();
 }
 
 static void pr_source_tile_unset(PixbufRenderer *pr)
@@ -944,22 +959,19 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 
 	pr->source_tiles_cache_size = std::max(pr->source_tiles_cache_size, 4);
 
-	count = g_list_length(pr->source_tiles);
+	count = pr->source_tiles->size();
 	if (count >= pr->source_tiles_cache_size)
 		{
-		GList *work;
+		SourceTile *needle;
 
-		work = g_list_last(pr->source_tiles);
-		while (work && count >= pr->source_tiles_cache_size)
+		needle = pr->source_tiles->last();
+		while (needle && count >= pr->source_tiles_cache_size)
 			{
-			SourceTile *needle;
-
-			needle = static_cast<SourceTile *>(work->data);
-			work = work->prev;
+			SourceTile *prev = needle->lru_prev;
 
 			if (!pr_source_tile_visible(pr, needle))
 				{
-				pr->source_tiles = g_list_remove(pr->source_tiles, needle);
+				pr->source_tiles->remove(needle);
 
 				if (pr->func_tile_dispose)
 					{
@@ -979,6 +991,8 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 
 				count--;
 				}
+
+			needle = prev;
 			}
 		}
 
@@ -993,7 +1007,7 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 	st->y = ROUND_DOWN(y, pr->source_tile_height);
 	st->blank = TRUE;
 
-	pr->source_tiles = g_list_prepend(pr->source_tiles, st);
+	pr->source_tiles->insert(st);
 
 	return st;
 }
@@ -1021,28 +1035,12 @@ static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
 
 static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y)
 {
-	GList *work;
-
-	work = pr->source_tiles;
-	while (work)
-		{
-		auto st = static_cast<SourceTile *>(work->data);
-
-		if (x >= st->x && x < st->x + pr->source_tile_width &&
-		    y >= st->y && y < st->y + pr->source_tile_height)
-			{
-			if (work != pr->source_tiles)
-				{
-				pr->source_tiles = g_list_remove_link(pr->source_tiles, work);
-				pr->source_tiles = g_list_concat(work, pr->source_tiles);
-				}
-			return st;
-			}
+	SourceTile *st;
 
-		work = work->next;
-		}
+	st = pr->source_tiles->find(ROUND_DOWN(x, pr->source_tile_width), ROUND_DOWN(y, pr->source_tile_height));
+	if (st) pr->source_tiles->touch(st);
 
-	return nullptr;
+	return st;
 }
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request)
@@ -1084,10 +1082,8 @@ static void pr_source_tile_changed(PixbufRenderer *pr, GdkRectangle request_rect
 	GdkRectangle st_rect{0, 0, pr->source_tile_width, pr->source_tile_height};
 	GdkRectangle r;
 
-	for (GList *work = pr->source_tiles; work; work = work->next)
+	for (SourceTile *st = pr->source_tiles->first(); st; st = st->lru_next)
 		{
-		auto *st = static_cast<SourceTile *>(work->data);
-
 		st_rect.x = st->x;
 		st_rect.y = st->y;
 
@@ -1124,6 +1120,7 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
 	pr->pixbuf = nullptr;
+	pr_pyramid_clear(pr);
 
 	pr_source_tile_unset(pr);
 
@@ -1163,19 +1160,23 @@ gint pixbuf_renderer_get_tiles(PixbufRenderer *pr)
 	return pr->source_tiles_enabled;
 }
 
-static gdouble pr_zoom_adjust(const PixbufRenderer *pr, gdouble increment)
+/**
+ * @brief The zoom after a step of @a increment from @a zoom
+ * @param zoom The zoom, 0.0 when zoomed to fit
+ * @param scale The scale shown, used when zoomed to fit
+ * @param increment
+ */
+gdouble pixbuf_renderer_zoom_adjusted(gdouble zoom, gdouble scale, gdouble increment)
 {
-	gdouble zoom = pr->zoom;
-
 	if (zoom == 0.0)
 		{
-		if (pr->scale < 1.0)
+		if (scale < 1.0)
 			{
-			zoom = 0.0 - 1.0 / pr->scale;
+			zoom = 0.0 - 1.0 / scale;
 			}
 		else
 			{
-			zoom = pr->scale;
+			zoom = scale;
 			}
 		}
 
@@ -1247,6 +1248,144 @@ static gdouble pr_zoom_adjust(const PixbufRenderer *pr, gdouble increment)
 	return zoom;
 }
 
+static gdouble pr_zoom_adjust(const PixbufRenderer *pr, gdouble increment)
+{
+	return pixbuf_renderer_zoom_adjusted(pr->zoom, pr->scale, increment);
+}
+
+
+/*
+ *-------------------------------------------------------------------
+ * image pyramid
+ *-------------------------------------------------------------------
+ */
+
+/** Smaller images are always scaled from pr->pixbuf */
+constexpr gint64 PR_PYRAMID_MIN_PIXELS = 2048 * 2048;
+
+struct PrPyramidBuild
+{
+	PixbufRenderer *pr;	/**< holds a reference */
+	GdkPixbuf *src;		/**< holds a reference */
+	GdkPixbuf *level;
+};
+
+static void pr_pyramid_build_free(PrPyramidBuild *build)
+{
+	g_object_unref(build->src);
+	if (build->level) g_object_unref(build->level);
+	g_object_unref(build->pr);
+	g_free(build);
+}
+
+static void pr_pyramid_clear(PixbufRenderer *pr)
+{
+	g_ptr_array_set_size(pr->pyramid, 0);
+
+	/* a level in the making is dropped when it is done */
+	pr->pyramid_build = nullptr;
+}
+
+static gboolean pr_pyramid_wants_level(PixbufRenderer *pr)
+{
+	const gint next_factor = 1 << (pr->pyramid->len + 1);
+
+	return pr->pyramid_scale * next_factor <= 1.0;
+}
+
+static void pr_pyramid_build_next(PixbufRenderer *pr);
+
+static gboolean pr_pyramid_build_done_cb(gpointer data)
+{
+	auto build = static_cast<PrPyramidBuild *>(data);
+	PixbufRenderer *pr = build->pr;
+
+	if (pr->pyramid_build == build)
+		{
+		pr->pyramid_build = nullptr;
+
+		if (build->level)
+			{
+			DEBUG_1("pyramid level %u: %dx%d", pr->pyramid->len + 1,
+			        gdk_pixbuf_get_width(build->level), gdk_pixbuf_get_height(build->level));
+
+			g_ptr_array_add(pr->pyramid, g_steal_pointer(&build->level));
+
+			if (pr_pyramid_wants_level(pr)) pr_pyramid_build_next(pr);
+			}
+		}
+
+	pr_pyramid_build_free(build);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void pr_pyramid_build_func(gpointer data, gpointer)
+{
+	auto build = static_cast<PrPyramidBuild *>(data);
+
+	build->level = pixbuf_scale_half(build->src);
+
+	g_idle_add(pr_pyramid_build_done_cb, build);
+}
+
+/**
+ * @brief Starts making the next level of the pyramid in the background
+ *
+ * The pixbuf is only read, so this waits until it is completely loaded.
+ */
+static void pr_pyramid_build_next(PixbufRenderer *pr)
+{
+	static GThreadPool *pyramid_pool = nullptr;
+	GdkPixbuf *src;
+
+	if (pr->pyramid_build || pr->loading || !pr->pixbuf) return;
+
+	src = pr->pyramid->len > 0 ? static_cast<GdkPixbuf *>(g_ptr_array_index(pr->pyramid, pr->pyramid->len - 1)) : pr->pixbuf;
+	if (gdk_pixbuf_get_width(src) < 2 || gdk_pixbuf_get_height(src) < 2) return;
+
+	if (!pyramid_pool) pyramid_pool = g_thread_pool_new(pr_pyramid_build_func, nullptr, 1, FALSE, nullptr);
+
+	auto build = g_new0(PrPyramidBuild, 1);
+	build->pr = static_cast<PixbufRenderer *>(g_object_ref(pr));
+	build->src = static_cast<GdkPixbuf *>(g_object_ref(src));
+
+	pr->pyramid_build = build;
+
+	g_thread_pool_push(pyramid_pool, build, nullptr);
+}
+
+/**
+ * @brief Finds the smallest copy of pr->pixbuf that is still not smaller than needed
+ * @param pr
+ * @param scale The scale pr->pixbuf is drawn at
+ * @param[out] factor How many times smaller than pr->pixbuf the result is
+ * @returns pr->pixbuf or a pyramid level, not referenced
+ *
+ * The levels are made in the background, the first time a large image is
+ * drawn at half its size or less, so until then a larger level is returned.
+ */
+GdkPixbuf *pr_pyramid_get(PixbufRenderer *pr, gdouble scale, gint &factor)
+{
+	GdkPixbuf *level = pr->pixbuf;
+
+	factor = 1;
+
+	if (!pr->pixbuf || scale > 0.5) return level;
+	if (static_cast<gint64>(gdk_pixbuf_get_width(pr->pixbuf)) * gdk_pixbuf_get_height(pr->pixbuf) < PR_PYRAMID_MIN_PIXELS) return level;
+
+	for (guint i = 0; i < pr->pyramid->len && scale * factor * 2 <= 1.0; i++)
+		{
+		level = static_cast<GdkPixbuf *>(g_ptr_array_index(pr->pyramid, i));
+		factor *= 2;
+		}
+
+	pr->pyramid_scale = scale;
+	if (pr_pyramid_wants_level(pr)) pr_pyramid_build_next(pr);
+
+	return level;
+}
+
 
 /*
  *-------------------------------------------------------------------
@@ -2416,6 +2555,7 @@ static void pr_set_pixbuf(PixbufRenderer *pr, GdkPixbuf *pixbuf, gdouble zoom, P
 	if (pixbuf) g_object_ref(pixbuf);
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
 	pr->pixbuf = pixbuf;
+	pr_pyramid_clear(pr);
 
 	if (!pr->pixbuf)
 		{
@@ -2564,8 +2704,8 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->func_tile_request = source->func_tile_request;
 		pr->func_tile_dispose = source->func_tile_dispose;
 
-		pr->source_tiles = source->source_tiles;
-		source->source_tiles = nullptr;
+		pr_source_tile_free_all(pr);
+		std::swap(pr->source_tiles, source->source_tiles);
 
 		pr_zoom_sync(pr, source->zoom, static_cast<PrZoomFlags>(PR_ZOOM_FORCE | PR_ZOOM_NEW), 0, 0);
 		}
@@ -2616,8 +2756,8 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->func_tile_request = source->func_tile_request;
 		pr->func_tile_dispose = source->func_tile_dispose;
 
-		pr->source_tiles = source->source_tiles;
-		source->source_tiles = nullptr;
+		pr_source_tile_free_all(pr);
+		std::swap(pr->source_tiles, source->source_tiles);
 
 		pr_zoom_sync(pr, source->zoom, static_cast<PrZoomFlags>(PR_ZOOM_FORCE | PR_ZOOM_NEW), 0, 0);
 		}
@@ -2640,6 +2780,10 @@ void pixbuf_renderer_area_changed(PixbufRenderer *pr, GdkRectangle area)
 		{
 		pr_source_tile_changed(pr, area);
 		}
+	else
+		{
+		pr_pyramid_clear(pr);
+		}
 
 	pr->renderer->area_changed(pr->renderer, area);
 	if (pr->renderer2) pr->renderer2->area_changed(pr->renderer2, area);
@@ -2666,6 +2810,13 @@ void pixbuf_renderer_zoom_set(PixbufRenderer *pr, gdouble zoom)
 	pr_zoom_sync(pr, zoom, PR_ZOOM_NONE, 0, 0);
 }
 
+void pixbuf_renderer_zoom_set_at_point(PixbufRenderer *pr, gdouble zoom, gint x, gint y)
+{
+	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
+
+	pr_zoom_sync(pr, zoom, PR_ZOOM_CENTER, x, y);
+}
+
 gdouble pixbuf_renderer_zoom_get(PixbufRenderer *pr)
 {
 	g_return_val_if_fail(IS_PIXBUF_RENDERER(pr), 1.0);
@@ -35,6 +35,9 @@
 
 struct GqColor;
 struct PixbufRenderer;
+struct PrPyramidBuild;
+struct SourceTile;
+template<typename T> class TileIndex;
 
 #define TYPE_PIXBUF_RENDERER		(pixbuf_renderer_get_type())
 #define PIXBUF_RENDERER(obj)		(G_TYPE_CHECK_INSTANCE_CAST((obj), TYPE_PIXBUF_RENDERER, PixbufRenderer))
@@ -163,6 +166,10 @@ struct PixbufRenderer
 
 	GdkPixbuf *pixbuf;
 
+	GPtrArray *pyramid;	/**< pixbuf halved again and again, level i is 2^(i+1) times smaller, see pr_pyramid_get() */
+	PrPyramidBuild *pyramid_build;	/**< next level, made in the background */
+	gdouble pyramid_scale;	/**< scale last asked of pr_pyramid_get() */
+
 	gint window_width;	/**< allocated size of window (drawing area) */
 	gint window_height;
 
@@ -225,7 +232,7 @@ struct PixbufRenderer
 	gboolean source_tiles_enabled;
 	gint source_tiles_cache_size;
 
-	GList *source_tiles;	/**< list of active source tiles */
+	TileIndex<SourceTile> *source_tiles;	/**< active source tiles by position, most recently used first */
 	gint source_tile_width;
 	gint source_tile_height;
 
@@ -234,6 +241,10 @@ struct PixbufRenderer
 	using TileDisposeFunc = std::function<void(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *)>;
 	TileDisposeFunc func_tile_dispose;
 
+	/**
+	 * Called with an area of a tile pixbuf in pixels, possibly from a
+	 * rendering thread, so it must not touch the widget or shared state.
+	 */
 	using PostProcessFunc = std::function<void(PixbufRenderer *, GdkPixbuf **, gint, gint, gint, gint)>;
 	PostProcessFunc func_post_process;
 	gint post_process_slow;
@@ -330,6 +341,8 @@ void pixbuf_renderer_zoom_adjust(PixbufRenderer *pr, gdouble increment);
 void pixbuf_renderer_zoom_adjust_at_point(PixbufRenderer *pr, gdouble increment, gint x, gint y);
 
 void pixbuf_renderer_zoom_set(PixbufRenderer *pr, gdouble zoom);
+void pixbuf_renderer_zoom_set_at_point(PixbufRenderer *pr, gdouble zoom, gint x, gint y);
+gdouble pixbuf_renderer_zoom_adjusted(gdouble zoom, gdouble scale, gdouble increment);
 gdouble pixbuf_renderer_zoom_get(PixbufRenderer *pr);
 gdouble pixbuf_renderer_zoom_get_scale(PixbufRenderer *pr);
 
@@ -370,6 +383,9 @@ struct SourceTile
 	gint y;
 	GdkPixbuf *pixbuf;
 	gboolean blank;
+
+	SourceTile *lru_prev; /**< more recently used */
+	SourceTile *lru_next; /**< less recently used */
 };
 
 
@@ -390,6 +406,8 @@ void pr_scale_region(GdkRectangle &region, gdouble scale);
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request);
 
+GdkPixbuf *pr_pyramid_get(PixbufRenderer *pr, gdouble scale, gint &factor);
+
 void pr_create_anaglyph(guint mode, GdkPixbuf *pixbuf, GdkPixbuf *right, gint x, gint y, gint w, gint h);
 
 void pixbuf_renderer_set_ignore_alpha(PixbufRenderer *pr, gint ignore_alpha);
@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -31,6 +32,10 @@
 #include <utility>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
 #include <cairo.h>
 #include <gio/gio.h>
 #include <glib-object.h>
@@ -408,47 +413,326 @@ GdkPixbuf *pixbuf_fallback(FileData *fd, gint requested_width, gint requested_he
  *-----------------------------------------------------------------------------
  */
 
-GdkPixbuf *pixbuf_apply_orientation(GdkPixbuf *pixbuf, gint orientation)
+namespace
+{
+
+constexpr gint ORIENTATION_BLOCK = 16; /**< pixels, a block of 16 rows of 16 RGBA pixels is 1 KiB */
+
+/**
+ * @brief Where the pixels of the source go in the destination
+ *
+ * The destination of source pixel (x, y) is start + x * step_x + y * step_y,
+ * the steps are in bytes and can be negative.
+ */
+struct OrientationMap
 {
-	GdkPixbuf *dest = nullptr;
-	g_autoptr(GdkPixbuf) flipped = nullptr;
+	guchar *start;
+	ptrdiff_t step_x;
+	ptrdiff_t step_y;
+
+	guchar *at(gint x, gint y) const
+	{
+		return start + (x * step_x) + (y * step_y);
+	}
+};
+
+OrientationMap orientation_map(guchar *dest, gint dest_rowstride, gint n_channels, gint width, gint height, gint orientation)
+{
+	const ptrdiff_t c = n_channels;
+	const ptrdiff_t drs = dest_rowstride;
+	const ptrdiff_t last_x = width - 1;
+	const ptrdiff_t last_y = height - 1;
 
 	switch (orientation)
 		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			dest = gdk_pixbuf_copy(pixbuf);
-			break;
 		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			dest = gdk_pixbuf_flip(pixbuf, TRUE);
-			break;
+			return {dest + (last_x * c), -c, drs};
 		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_UPSIDEDOWN);
-			break;
+			return {dest + (last_y * drs) + (last_x * c), -c, -drs};
 		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			dest = gdk_pixbuf_flip(pixbuf, FALSE);
-			break;
+			return {dest + (last_y * drs), c, -drs};
 		case EXIF_ORIENTATION_LEFT_TOP:
-			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
-			dest = gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_CLOCKWISE);
-			break;
+			return {dest, drs, c};
 		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_CLOCKWISE);
-			break;
+			return {dest + (last_y * c), drs, -c};
 		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
-			dest = gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
-			break;
+			return {dest + (last_x * drs) + (last_y * c), -drs, -c};
 		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			dest = gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
-			break;
+			return {dest + (last_x * drs), -drs, c};
+		case EXIF_ORIENTATION_TOP_LEFT:
 		default:
-			dest = gdk_pixbuf_copy(pixbuf);
-			break;
+			return {dest, c, drs};
+		}
+}
+
+template<gint n_channels>
+void orientation_copy_block_scalar(const guchar *src, gint src_rowstride, const OrientationMap &map,
+                                   gint x, gint y, gint w, gint h)
+{
+	for (gint i = y; i < y + h; i++)
+		{
+		const guchar *sp = src + (i * src_rowstride) + (x * n_channels);
+		guchar *dp = map.at(x, i);
+
+		for (gint j = 0; j < w; j++)
+			{
+			memcpy(dp, sp, n_channels);
+			sp += n_channels;
+			dp += map.step_x;
+			}
+		}
+}
+
+using OrientationBlockFunc = void (*)(const guchar *src, gint src_rowstride, const OrientationMap &map,
+                                      gint x, gint y, gint w, gint h);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/**
+ * @brief Copies a block of 4 channel pixels to a transposed map
+ *
+ * Each 4x4 group of pixels is loaded as 4 rows and stored as 4 columns
+ * with a 32 bit transpose in registers. What does not fit into
+ * groups of 4 is copied by the scalar code.
+ */
+__attribute__((target("sse2")))
+void orientation_copy_block_transposed_rgba_sse2(const guchar *src, gint src_rowstride, const OrientationMap &map,
+                                                 gint x, gint y, gint w, gint h)
+{
+	const gint w4 = w & ~3;
+	const gint h4 = h & ~3;
+	/* the columns are stored downwards or upwards in the destination rows */
+	const gboolean reverse = map.step_y < 0;
+
+	for (gint i = y; i < y + h4; i += 4)
+		{
+		const guchar *sp = src + (i * src_rowstride) + (x * 4);
+
+		for (gint j = 0; j < w4; j += 4)
+			{
+			const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp));
+			const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp + src_rowstride));
+			const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp + (2 * src_rowstride)));
+			const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp + (3 * src_rowstride)));
+
+			const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+			const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+			const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+			const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+			__m128i c[4] = {
+				_mm_unpacklo_epi64(t0, t1),
+				_mm_unpackhi_epi64(t0, t1),
+				_mm_unpacklo_epi64(t2, t3),
+				_mm_unpackhi_epi64(t2, t3)
+			};
+
+			for (gint k = 0; k < 4; k++)
+				{
+				guchar *dp;
+
+				if (reverse)
+					{
+					c[k] = _mm_shuffle_epi32(c[k], _MM_SHUFFLE(0, 1, 2, 3));
+					dp = map.at(x + j + k, i + 3);
+					}
+				else
+					{
+					dp = map.at(x + j + k, i);
+					}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dp), c[k]);
+				}
+
+			sp += 16;
+			}
+		}
+
+	if (w4 < w) orientation_copy_block_scalar<4>(src, src_rowstride, map, x + w4, y, w - w4, h4);
+	if (h4 < h) orientation_copy_block_scalar<4>(src, src_rowstride, map, x, y + h4, w, h - h4);
+}
+#endif
+
+OrientationBlockFunc orientation_copy_block_transposed_rgba_func()
+{
+	static const OrientationBlockFunc func = []()
+	{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2")) return orientation_copy_block_transposed_rgba_sse2;
+#endif
+		return orientation_copy_block_scalar<4>;
+	}();
+
+	return func;
+}
+
+} // namespace
+
+/**
+ * @brief Copies an area of an image to another buffer, applying an EXIF orientation
+ * @param src Pixels of the source image
+ * @param src_rowstride
+ * @param dest Pixels of the destination image, which is @p width x @p height,
+ *             or @p height x @p width for the orientations that swap the axes
+ * @param dest_rowstride
+ * @param n_channels 3 or 4 bytes per pixel
+ * @param width,height Size of the source image
+ * @param area The area of the source image to copy
+ * @param orientation One of the EXIF orientations
+ *
+ * Rows that stay rows are copied as whole rows. The orientations that swap
+ * the axes walk the area in square blocks, so that both the rows read and
+ * the rows written stay in the cache; 4 channel blocks are transposed with
+ * SSE2 where available. Does not use GDK and can be called from any thread.
+ */
+void pixbuf_copy_area_oriented(const guchar *src, gint src_rowstride,
+                               guchar *dest, gint dest_rowstride,
+                               gint n_channels, gint width, gint height,
+                               GdkRectangle area, gint orientation)
+{
+	const OrientationMap map = orientation_map(dest, dest_rowstride, n_channels, width, height, orientation);
+	const gint x2 = area.x + area.width;
+	const gint y2 = area.y + area.height;
+
+	if (orientation < EXIF_ORIENTATION_LEFT_TOP)
+		{
+		if (map.step_x > 0)
+			{
+			/* rows stay rows in the same order of pixels */
+			for (gint i = area.y; i < y2; i++)
+				{
+				memcpy(map.at(area.x, i), src + (i * src_rowstride) + (area.x * n_channels), area.width * n_channels);
+				}
+			}
+		else if (n_channels == 4)
+			{
+			orientation_copy_block_scalar<4>(src, src_rowstride, map, area.x, area.y, area.width, area.height);
+			}
+		else
+			{
+			orientation_copy_block_scalar<3>(src, src_rowstride, map, area.x, area.y, area.width, area.height);
+			}
+		return;
+		}
+
+	const OrientationBlockFunc copy_block = (n_channels == 4) ? orientation_copy_block_transposed_rgba_func() : orientation_copy_block_scalar<3>;
+
+	for (gint by = area.y; by < y2; by += ORIENTATION_BLOCK)
+		{
+		const gint bh = std::min(ORIENTATION_BLOCK, y2 - by);
+
+		for (gint bx = area.x; bx < x2; bx += ORIENTATION_BLOCK)
+			{
+			copy_block(src, src_rowstride, map, bx, by, std::min(ORIENTATION_BLOCK, x2 - bx), bh);
+			}
+		}
+}
+
+/**
+ * @brief Returns a copy of a pixbuf with an EXIF orientation applied
+ */
+GdkPixbuf *pixbuf_apply_orientation(GdkPixbuf *pixbuf, gint orientation)
+{
+	if (orientation < EXIF_ORIENTATION_TOP_RIGHT || orientation > EXIF_ORIENTATION_LEFT_BOTTOM)
+		{
+		return gdk_pixbuf_copy(pixbuf);
+		}
+
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	const gint height = gdk_pixbuf_get_height(pixbuf);
+	const gint n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+
+	if (gdk_pixbuf_get_bits_per_sample(pixbuf) != 8 || n_channels != (has_alpha ? 4 : 3))
+		{
+		g_autoptr(GdkPixbuf) flipped = nullptr;
+
+		switch (orientation)
+			{
+			case EXIF_ORIENTATION_TOP_RIGHT:
+				return gdk_pixbuf_flip(pixbuf, TRUE);
+			case EXIF_ORIENTATION_BOTTOM_RIGHT:
+				return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_UPSIDEDOWN);
+			case EXIF_ORIENTATION_BOTTOM_LEFT:
+				return gdk_pixbuf_flip(pixbuf, FALSE);
+			case EXIF_ORIENTATION_LEFT_TOP:
+				flipped = gdk_pixbuf_flip(pixbuf, FALSE);
+				return gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_CLOCKWISE);
+			case EXIF_ORIENTATION_RIGHT_TOP:
+				return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_CLOCKWISE);
+			case EXIF_ORIENTATION_RIGHT_BOTTOM:
+				flipped = gdk_pixbuf_flip(pixbuf, FALSE);
+				return gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
+			default:
+				return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
+			}
+		}
+
+	const gboolean swap = (orientation >= EXIF_ORIENTATION_LEFT_TOP);
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8,
+	                                 swap ? height : width, swap ? width : height);
+	if (!dest) return nullptr;
+
+	pixbuf_copy_area_oriented(gdk_pixbuf_read_pixels(pixbuf), gdk_pixbuf_get_rowstride(pixbuf),
+	                          gdk_pixbuf_get_pixels(dest), gdk_pixbuf_get_rowstride(dest),
+	                          n_channels, width, height, {0, 0, width, height}, orientation);
+
+	return dest;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * pixbuf scaling
+ *-----------------------------------------------------------------------------
+ */
+
+/**
+ * @brief Halves a pixbuf in both directions, averaging each 2x2 block of pixels
+ * @param src 8 bit RGB or RGBA pixbuf
+ * @returns A new pixbuf, an odd last row or column is averaged on its own
+ *
+ * This is a box filter. It reads every source pixel once, so it is much
+ * cheaper than gdk_pixbuf_scale() for large reductions. It does not use
+ * GDK and can be called from any thread.
+ */
+GdkPixbuf *pixbuf_scale_half(const GdkPixbuf *src)
+{
+	const gint sw = gdk_pixbuf_get_width(src);
+	const gint sh = gdk_pixbuf_get_height(src);
+	const gint srs = gdk_pixbuf_get_rowstride(src);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(src);
+	const gint step = has_alpha ? 4 : 3;
+	const guchar *s_pix = gdk_pixbuf_read_pixels(src);
+
+	const gint dw = (sw + 1) / 2;
+	const gint dh = (sh + 1) / 2;
+
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, dw, dh);
+	if (!dest) return nullptr;
+
+	const gint drs = gdk_pixbuf_get_rowstride(dest);
+	guchar *d_pix = gdk_pixbuf_get_pixels(dest);
+
+	for (gint y = 0; y < dh; y++)
+		{
+		const guchar *s0 = s_pix + (2 * y * srs);
+		const guchar *s1 = (2 * y + 1 < sh) ? s0 + srs : s0;
+		guchar *dp = d_pix + (y * drs);
+
+		for (gint x = 0; x < dw; x++)
+			{
+			const gint right = (2 * x + 1 < sw) ? step : 0;
+
+			for (gint c = 0; c < step; c++)
+				{
+				dp[c] = (s0[c] + s0[c + right] + s1[c] + s1[c + right] + 2) / 4;
+				}
+
+			s0 += 2 * step;
+			s1 += 2 * step;
+			dp += step;
+			}
 		}
 
 	return dest;
@@ -81,8 +81,14 @@ gboolean pixbuf_scale_aspect(gint req_w, gint req_h, gint old_w, gint old_h, gin
 #define PIXBUF_INLINE_UNKNOWN               "gq-icon-unknown"
 #define PIXBUF_INLINE_VIDEO                 "gq-icon-video"
 
+void pixbuf_copy_area_oriented(const guchar *src, gint src_rowstride,
+                               guchar *dest, gint dest_rowstride,
+                               gint n_channels, gint width, gint height,
+                               GdkRectangle area, gint orientation);
 GdkPixbuf* pixbuf_apply_orientation(GdkPixbuf *pixbuf, gint orientation);
 
+GdkPixbuf *pixbuf_scale_half(const GdkPixbuf *src);
+
 void pixbuf_draw_rect_fill(GdkPixbuf *pb, GdkRectangle rect, GqColor color);
 
 void pixbuf_set_rect_fill(GdkPixbuf *pb,
@@ -354,6 +354,7 @@ static void config_window_apply()
 		}
 	options->thumbnails.enable_caching = c_options->thumbnails.enable_caching;
 	options->thumbnails.cache_into_dirs = c_options->thumbnails.cache_into_dirs;
+	options->thumbnails.sim_database = c_options->thumbnails.sim_database;
 	options->thumbnails.use_exif = c_options->thumbnails.use_exif;
 	options->thumbnails.use_color_management = c_options->thumbnails.use_color_management;
 	options->thumbnails.collection_preview = c_options->thumbnails.collection_preview;
@@ -387,6 +388,9 @@ static void config_window_apply()
 	options->image.zoom_style = c_options->image.zoom_style;
 
 	options->image.enable_read_ahead = c_options->image.enable_read_ahead;
+	options->image.read_ahead_count = c_options->image.read_ahead_count;
+	options->image.read_behind_count = c_options->image.read_behind_count;
+	options->image.decode_to_fit = c_options->image.decode_to_fit;
 
 	options->appimage_notifications = c_options->appimage_notifications;
 
@@ -488,6 +492,9 @@ static void config_window_apply()
 	options->star_rating = c_options->star_rating;
 
 	options->threads.duplicates = c_options->threads.duplicates > 0 ? c_options->threads.duplicates : -1;
+	options->threads.duplicates_decoders = c_options->threads.duplicates_decoders;
+	options->threads.thumbnails = c_options->threads.thumbnails;
+	options->threads.tile_render = c_options->threads.tile_render;
 
 	options->alternate_similarity_algorithm = c_options->alternate_similarity_algorithm;
 
@@ -1897,6 +1904,9 @@ static void config_tab_general(GtkWidget *notebook)
 							options->thumbnails.spec_standard && !options->thumbnails.cache_into_dirs,
 							G_CALLBACK(cache_standard_cb), nullptr);
 
+	pref_checkbox_new_int(subgroup, _("Store sim. files of a folder in a single file"),
+			      options->thumbnails.sim_database, &c_options->thumbnails.sim_database);
+
 	pref_checkbox_new_int(group, _("Use EXIF thumbnails when available (EXIF thumbnails may be outdated)"),
 			      options->thumbnails.use_exif, &c_options->thumbnails.use_exif);
 
@@ -1962,8 +1972,18 @@ static void config_tab_general(GtkWidget *notebook)
 
 	pref_spin_new_int(group, _("Decoded image cache size (MiB):"), nullptr,
 			  0, 99999, 1, options->image.image_cache_max, &c_options->image.image_cache_max);
-	pref_checkbox_new_int(group, _("Preload next image"),
-			      options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+	ct_button = pref_checkbox_new_int(group, _("Preload next image"),
+					  options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+
+	hbox = pref_box_new(group, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
+	pref_checkbox_link_sensitivity(ct_button, hbox);
+	pref_spin_new_int(hbox, _("Images ahead:"), nullptr,
+			  1, 16, 1, options->image.read_ahead_count, &c_options->image.read_ahead_count);
+	pref_spin_new_int(hbox, _("Images behind:"), nullptr,
+			  0, 16, 1, options->image.read_behind_count, &c_options->image.read_behind_count);
+
+	pref_checkbox_new_int(group, _("Decode to display size when zoomed to fit"),
+			      options->image.decode_to_fit, &c_options->image.decode_to_fit);
 
 	pref_checkbox_new_int(group, _("Refresh on file change"),
 			      options->update_on_time_change, &c_options->update_on_time_change);
@@ -2801,6 +2821,9 @@ static void config_tab_metadata(GtkWidget *notebook)
 
 	ct_button = pref_checkbox_new_int(group, _("Read metadata in background"), options->read_metadata_in_idle, &c_options->read_metadata_in_idle);
 	gtk_widget_set_tooltip_text(ct_button,_("On folder change, read DateTimeOriginal, DateTimeDigitized and Star Rating in the idle loop.\nIf this is not selected, initial loading of the folder will be faster but sorting on these items will be slower"));
+
+	ct_button = pref_checkbox_new_int(group, _("Keep an index of the metadata of each folder"), options->metadata.index_database, &c_options->metadata.index_database);
+	gtk_widget_set_tooltip_text(ct_button,_("Dates, star ratings, keywords, comments and GPS positions are stored in the metadata cache.\nSorting, filtering and searching a folder again then does not read the image files"));
 }
 
 /* keywords tab */
@@ -3608,6 +3631,9 @@ static void config_tab_advanced(GtkWidget *notebook)
 {
 	GtkWidget *alternate_checkbox;
 	GtkWidget *dupes_threads_spin;
+	GtkWidget *dupes_decoders_spin;
+	GtkWidget *thumbs_loaders_spin;
+	GtkWidget *tile_render_spin;
 	GtkWidget *group;
 	GtkWidget *subgroup;
 	GtkWidget *threads_string_label;
@@ -3656,6 +3682,15 @@ static void config_tab_advanced(GtkWidget *notebook)
 	dupes_threads_spin = pref_spin_new_int(vbox, _("Duplicate check:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.duplicates, &c_options->threads.duplicates);
 	gtk_widget_set_tooltip_markup(dupes_threads_spin, _("Set to 0 for unlimited"));
 
+	dupes_decoders_spin = pref_spin_new_int(vbox, _("Duplicate check:"), _("max. images decoded at once"), 0, get_cpu_cores() * 2, 1, options->threads.duplicates_decoders, &c_options->threads.duplicates_decoders);
+	gtk_widget_set_tooltip_markup(dupes_decoders_spin, _("Set to 0 to use all cores"));
+
+	thumbs_loaders_spin = pref_spin_new_int(vbox, _("Thumbnails:"), _("max. thumbnails generated at once"), 0, get_cpu_cores() * 2, 1, options->threads.thumbnails, &c_options->threads.thumbnails);
+	gtk_widget_set_tooltip_markup(thumbs_loaders_spin, _("Set to 0 to use all cores"));
+
+	tile_render_spin = pref_spin_new_int(vbox, _("Image display:"), _("max. threads for high quality zoom"), 0, get_cpu_cores(), 1, options->threads.tile_render, &c_options->threads.tile_render);
+	gtk_widget_set_tooltip_markup(tile_render_spin, _("Set to 0 to use all cores"));
+
 	pref_spacer(group, PREF_PAD_GROUP);
 
 	pref_line(vbox, PREF_PAD_SPACE);
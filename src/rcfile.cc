@@ -494,6 +494,9 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT(*options, image.tile_cache_max);
 	WRITE_NL(); WRITE_INT(*options, image.image_cache_max);
 	WRITE_NL(); WRITE_BOOL(*options, image.enable_read_ahead);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_count);
+	WRITE_NL(); WRITE_INT(*options, image.read_behind_count);
+	WRITE_NL(); WRITE_BOOL(*options, image.decode_to_fit);
 	WRITE_NL(); WRITE_BOOL(*options, image.exif_rotate_enable);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color_in_fullscreen);
@@ -507,6 +510,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT(*options, thumbnails.max_height);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.enable_caching);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.cache_into_dirs);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.sim_database);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_xvpics);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.spec_standard);
 	WRITE_NL(); WRITE_UINT(*options, thumbnails.quality);
@@ -581,6 +585,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_BOOL(*options, metadata.keywords_case_sensitive);
 	WRITE_NL(); WRITE_BOOL(*options, metadata.write_orientation);
 	WRITE_NL(); WRITE_BOOL(*options, metadata.check_spelling);
+	WRITE_NL(); WRITE_BOOL(*options, metadata.index_database);
 
 	WRITE_NL(); WRITE_INT(*options, stereo.mode);
 	WRITE_NL(); WRITE_INT(*options, stereo.fsmode);
@@ -618,6 +623,9 @@ static void write_global_attributes(GString *outstr, gint indent)
 
 	/* Threads */
 	WRITE_NL(); WRITE_INT(*options, threads.duplicates);
+	WRITE_NL(); WRITE_INT(*options, threads.duplicates_decoders);
+	WRITE_NL(); WRITE_INT(*options, threads.thumbnails);
+	WRITE_NL(); WRITE_INT(*options, threads.tile_render);
 	WRITE_SEPARATOR();
 
 	/* user-definable mouse buttons */
@@ -977,6 +985,9 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, image.zoom_quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_INT(*options, image.zoom_increment)) continue;
 		if (READ_BOOL(*options, image.enable_read_ahead)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_count, 1, 16)) continue;
+		if (READ_INT_CLAMP(*options, image.read_behind_count, 0, 16)) continue;
+		if (READ_BOOL(*options, image.decode_to_fit)) continue;
 		if (READ_BOOL(*options, image.exif_rotate_enable)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color_in_fullscreen)) continue;
@@ -991,6 +1002,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		if (READ_BOOL(*options, thumbnails.enable_caching)) continue;
 		if (READ_BOOL(*options, thumbnails.cache_into_dirs)) continue;
+		if (READ_BOOL(*options, thumbnails.sim_database)) continue;
 		if (READ_BOOL(*options, thumbnails.use_xvpics)) continue;
 		if (READ_BOOL(*options, thumbnails.spec_standard)) continue;
 		if (READ_UINT_ENUM_CLAMP(*options, thumbnails.quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
@@ -1072,6 +1084,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_BOOL(*options, metadata.keywords_case_sensitive)) continue;
 		if (READ_BOOL(*options, metadata.write_orientation)) continue;
 		if (READ_BOOL(*options, metadata.check_spelling)) continue;
+		if (READ_BOOL(*options, metadata.index_database)) continue;
 
 		if (READ_INT(*options, stereo.mode)) continue;
 		if (READ_INT(*options, stereo.fsmode)) continue;
@@ -1106,6 +1119,9 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		/* Threads */
 		if (READ_INT(*options, threads.duplicates)) continue;
+		if (READ_INT(*options, threads.duplicates_decoders)) continue;
+		if (READ_INT(*options, threads.thumbnails)) continue;
+		if (READ_INT(*options, threads.tile_render)) continue;
 
 		/* user-definable mouse buttons */
 		if (READ_CHAR(*options, mouse_button_8)) continue;
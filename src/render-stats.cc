@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render-stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+/** Bucket i counts the times in [2^i, 2^(i+1)) microseconds, the last one everything above */
+constexpr gint RENDER_STAT_BUCKETS = 25;
+
+struct RenderStatTimerData
+{
+	guint64 count;
+	guint64 total_us;
+	guint64 max_us;
+	guint64 buckets[RENDER_STAT_BUCKETS];
+};
+
+struct RenderStatQueueData
+{
+	guint64 samples;
+	guint64 total;
+	guint last;
+	guint max;
+};
+
+struct RenderStats
+{
+	RenderStatTimerData timers[RENDER_STAT_TIMER_COUNT];
+	guint64 counters[RENDER_STAT_COUNTER_COUNT];
+	RenderStatQueueData queues[RENDER_STAT_QUEUE_COUNT];
+	gint64 since;   /**< monotonic time of the last reset */
+};
+
+GMutex stats_mutex;
+RenderStats stats{{}, {}, {}, g_get_monotonic_time()};
+
+const gchar *timer_names[RENDER_STAT_TIMER_COUNT] = {
+	"load_setup",
+	"load_decode",
+	"load_first_area",
+	"tile_render",
+	"tile_render_async",
+};
+
+const gchar *queue_names[RENDER_STAT_QUEUE_COUNT] = {
+	"draw_queue",
+	"draw_queue_2pass",
+};
+
+gint render_stats_bucket(gint64 us)
+{
+	gint bucket = 0;
+
+	while (us > 1 && bucket < RENDER_STAT_BUCKETS - 1)
+		{
+		us >>= 1;
+		bucket++;
+		}
+
+	return bucket;
+}
+
+/** @returns hits / (hits + misses), or -1 if there were none */
+gdouble render_stats_rate(guint64 hits, guint64 misses)
+{
+	return (hits + misses > 0) ? static_cast<gdouble>(hits) / (hits + misses) : -1.0;
+}
+
+/** @returns @a value formatted by @a format in the C locale, as JSON requires */
+std::string render_stats_json_double(const gchar *format, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	return g_ascii_formatd(buf, sizeof(buf), format, value);
+}
+
+} // namespace
+
+void render_stats_add_time(RenderStatTimer timer, gint64 us)
+{
+	us = std::max<gint64>(us, 0);
+
+	g_mutex_lock(&stats_mutex);
+	RenderStatTimerData &t = stats.timers[timer];
+	t.count++;
+	t.total_us += us;
+	t.max_us = std::max<guint64>(t.max_us, us);
+	t.buckets[render_stats_bucket(us)]++;
+	g_mutex_unlock(&stats_mutex);
+}
+
+void render_stats_count(RenderStatCounter counter)
+{
+	g_mutex_lock(&stats_mutex);
+	stats.counters[counter]++;
+	g_mutex_unlock(&stats_mutex);
+}
+
+/**
+ * @brief Records the length of a queue, sampled each time it is added to
+ */
+void render_stats_queue_depth(RenderStatQueue queue, guint depth)
+{
+	g_mutex_lock(&stats_mutex);
+	RenderStatQueueData &q = stats.queues[queue];
+	q.samples++;
+	q.total += depth;
+	q.last = depth;
+	q.max = std::max(q.max, depth);
+	g_mutex_unlock(&stats_mutex);
+}
+
+void render_stats_reset()
+{
+	g_mutex_lock(&stats_mutex);
+	memset(&stats, 0, sizeof(stats));
+	stats.since = g_get_monotonic_time();
+	g_mutex_unlock(&stats_mutex);
+}
+
+/**
+ * @brief Returns all statistics as a JSON object
+ *
+ * Times are in microseconds. The histogram of a timer lists the number of
+ * times in [2^i, 2^(i+1)) us for i = 0, 1, ..., with trailing zeros omitted.
+ * Rates are -1 when nothing was counted.
+ */
+gchar *render_stats_to_json()
+{
+	g_mutex_lock(&stats_mutex);
+	const RenderStats s = stats;
+	g_mutex_unlock(&stats_mutex);
+
+	GString *json = g_string_new("{\n");
+
+	g_string_append_printf(json, "  \"seconds\": %s,\n", render_stats_json_double("%.1f", (g_get_monotonic_time() - s.since) / 1e6).c_str());
+
+	g_string_append(json, "  \"timers\": {\n");
+	for (gint i = 0; i < RENDER_STAT_TIMER_COUNT; i++)
+		{
+		const RenderStatTimerData &t = s.timers[i];
+		gint last = RENDER_STAT_BUCKETS - 1;
+
+		while (last >= 0 && t.buckets[last] == 0) last--;
+
+		g_string_append_printf(json, "    \"%s\": {\"count\": %" G_GUINT64_FORMAT ", \"total_us\": %" G_GUINT64_FORMAT
+		                       ", \"mean_us\": %" G_GUINT64_FORMAT ", \"max_us\": %" G_GUINT64_FORMAT ", \"histogram\": [",
+		                       timer_names[i], t.count, t.total_us, t.count ? t.total_us / t.count : 0, t.max_us);
+		for (gint b = 0; b <= last; b++)
+			{
+			g_string_append_printf(json, "%s%" G_GUINT64_FORMAT, b ? ", " : "", t.buckets[b]);
+			}
+		g_string_append_printf(json, "]}%s\n", (i < RENDER_STAT_TIMER_COUNT - 1) ? "," : "");
+		}
+	g_string_append(json, "  },\n");
+
+	g_string_append(json, "  \"queues\": {\n");
+	for (gint i = 0; i < RENDER_STAT_QUEUE_COUNT; i++)
+		{
+		const RenderStatQueueData &q = s.queues[i];
+
+		g_string_append_printf(json, "    \"%s\": {\"samples\": %" G_GUINT64_FORMAT ", \"last\": %u, \"max\": %u, \"mean\": %s}%s\n",
+		                       queue_names[i], q.samples, q.last, q.max,
+		                       render_stats_json_double("%.2f", q.samples ? static_cast<gdouble>(q.total) / q.samples : 0.0).c_str(),
+		                       (i < RENDER_STAT_QUEUE_COUNT - 1) ? "," : "");
+		}
+	g_string_append(json, "  },\n");
+
+	g_string_append_printf(json, "  \"tile_cache\": {\"hits\": %" G_GUINT64_FORMAT ", \"misses\": %" G_GUINT64_FORMAT ", \"hit_rate\": %s},\n",
+	                       s.counters[RENDER_STAT_TILE_HIT], s.counters[RENDER_STAT_TILE_MISS],
+	                       render_stats_json_double("%.3f", render_stats_rate(s.counters[RENDER_STAT_TILE_HIT], s.counters[RENDER_STAT_TILE_MISS])).c_str());
+	g_string_append_printf(json, "  \"read_ahead\": {\"hits\": %" G_GUINT64_FORMAT ", \"misses\": %" G_GUINT64_FORMAT ", \"hit_rate\": %s},\n",
+	                       s.counters[RENDER_STAT_READ_AHEAD_HIT], s.counters[RENDER_STAT_READ_AHEAD_MISS],
+	                       render_stats_json_double("%.3f", render_stats_rate(s.counters[RENDER_STAT_READ_AHEAD_HIT], s.counters[RENDER_STAT_READ_AHEAD_MISS])).c_str());
+	g_string_append_printf(json, "  \"pixbuf_pool\": {\"hits\": %" G_GUINT64_FORMAT ", \"misses\": %" G_GUINT64_FORMAT ", \"hit_rate\": %s}\n",
+	                       s.counters[RENDER_STAT_PIXBUF_POOL_HIT], s.counters[RENDER_STAT_PIXBUF_POOL_MISS],
+	                       render_stats_json_double("%.3f", render_stats_rate(s.counters[RENDER_STAT_PIXBUF_POOL_HIT], s.counters[RENDER_STAT_PIXBUF_POOL_MISS])).c_str());
+
+	g_string_append(json, "}");
+
+	return g_string_free(json, FALSE);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <glib.h>
+
+/**
+ * @file
+ * Counters and timing histograms of the image loading and rendering
+ * pipeline, for diagnosing stutter. They can be read with the remote
+ * command --get-render-stats. All functions can be called from any thread.
+ */
+
+enum RenderStatTimer {
+	RENDER_STAT_LOAD_SETUP,         /**< from the start of a load until the loader runs */
+	RENDER_STAT_LOAD_DECODE,        /**< from the loader running until the image is done */
+	RENDER_STAT_LOAD_FIRST_AREA,    /**< from the start of a load until the first area is ready */
+	RENDER_STAT_TILE_RENDER,        /**< rendering an area of a tile in the main thread */
+	RENDER_STAT_TILE_RENDER_ASYNC,  /**< rendering an area of a tile in the render pool */
+	RENDER_STAT_TIMER_COUNT
+};
+
+enum RenderStatCounter {
+	RENDER_STAT_TILE_HIT,           /**< a tile was found in the tile cache */
+	RENDER_STAT_TILE_MISS,          /**< a tile had to be created */
+	RENDER_STAT_READ_AHEAD_HIT,     /**< an image of the read ahead window was already decoded */
+	RENDER_STAT_READ_AHEAD_MISS,
+	RENDER_STAT_PIXBUF_POOL_HIT,    /**< a decoded image reused the pixels of a released one */
+	RENDER_STAT_PIXBUF_POOL_MISS,
+	RENDER_STAT_COUNTER_COUNT
+};
+
+enum RenderStatQueue {
+	RENDER_STAT_DRAW_QUEUE,
+	RENDER_STAT_DRAW_QUEUE_2PASS,
+	RENDER_STAT_QUEUE_COUNT
+};
+
+void render_stats_add_time(RenderStatTimer timer, gint64 us);
+void render_stats_count(RenderStatCounter counter);
+void render_stats_queue_depth(RenderStatQueue queue, guint depth);
+
+void render_stats_reset();
+gchar *render_stats_to_json();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -35,8 +35,11 @@
 #include <glib.h>
 #include <gtk/gtk.h>
 
+#include "misc.h"
 #include "options.h"
 #include "pixbuf-renderer.h"
+#include "render-stats.h"
+#include "tile-index.h"
 
 /* comment this out if not using this from within Geeqie
  * defining GQ_BUILD does these things:
@@ -65,6 +68,7 @@ namespace
 {
 
 struct QueueData;
+struct TileJob;
 
 enum class TileRender {
 	NONE = 0, /**< do nothing */
@@ -92,8 +96,12 @@ struct ImageTile
 
 	QueueData *qd;
 	QueueData *qd2;
+	TileJob *job;		/* high quality render in the render pool */
 
 	guint size;		/* est. memory used by pixmap and pixbuf */
+
+	ImageTile *lru_prev;	/* more recently used */
+	ImageTile *lru_next;	/* less recently used */
 };
 
 struct QueueData
@@ -106,6 +114,63 @@ struct QueueData
 	gboolean new_data;
 };
 
+/**
+ * @brief The pixbufs a tile is rendered into, the orientation transforms swap them
+ */
+struct TileBuffers
+{
+	gint tile_width;
+	gint tile_height;
+	gint hidpi_scale;
+
+	GdkPixbuf *pixbuf;	/* rendered tile */
+	GdkPixbuf *spare;	/* same size, created when needed */
+};
+
+/**
+ * @brief Everything needed to render an area of a tile from pr->pixbuf,
+ *        so that it can be done in any thread
+ */
+struct TileRenderParams
+{
+	GdkPixbuf *src;
+	gboolean has_alpha;
+	gboolean ignore_alpha;
+	GdkRectangle pb_rect;	/* area of the tile pixbuf, in pixels */
+	gdouble offset_x;
+	gdouble offset_y;
+	gdouble scale_x;
+	gdouble scale_y;
+	GdkInterpType interp_type;
+	gint check_x;
+	gint check_y;
+	gboolean wide_image;
+	gint orientation;
+
+	gboolean anaglyph;
+	gint stereo_mode;
+	gdouble anaglyph_offset_x;	/* offset of the other view */
+};
+
+/**
+ * @brief A high quality render of an area of a tile, done by RendererTiles::render_pool
+ */
+struct TileJob
+{
+	ImageTile *it;		/* nullptr once cancelled, main thread only */
+	gint x;			/* area of the tile */
+	gint y;
+	gint w;
+	gint h;
+
+	TileRenderParams params;	/* holds a reference to params.src */
+	PixbufRenderer::PostProcessFunc post_process;
+	PixbufRenderer *pr;
+	TileBuffers buffers;	/* filled by the worker */
+
+	gboolean cancelled;	/* protected by RendererTiles::render_mutex */
+};
+
 struct OverlayData
 {
 	gint id;
@@ -128,10 +193,12 @@ struct RendererTiles
 
 	gint tile_width;
 	gint tile_height;
-	GList *tiles;		/* list of buffer tiles */
+	TileIndex<ImageTile> *tiles;	/* buffer tiles by position, most recently used first */
 	gint tile_cache_size;	/* allocated size of pixmaps/pixbufs */
 	GList *draw_queue;	/* list of areas to redraw */
 	GList *draw_queue_2pass;/* list when 2 pass is enabled */
+	guint draw_queue_length;	/* items in draw_queue */
+	guint draw_queue_2pass_length;	/* items in draw_queue_2pass */
 
 	GList *overlay_list;
 	cairo_surface_t *overlay_buffer;
@@ -139,6 +206,12 @@ struct RendererTiles
 
 	guint draw_idle_id; /* event source id */
 
+	GThreadPool *render_pool;	/* renders tiles in high quality, see TileJob */
+	GList *render_jobs;		/* TileJob not collected yet, main thread only */
+	GMutex render_mutex;
+	GList *render_done;		/* TileJob done by the pool, protected by render_mutex */
+	guint render_done_id;		/* event source id, protected by render_mutex */
+
 	GdkPixbuf *spare_tile;
 
 	gint stereo_mode;
@@ -175,6 +248,8 @@ void rt_queue(RendererTiles *rt, gint x, gint y, gint w, gint h,
 
 gboolean rt_queue_draw_idle_cb(gpointer data);
 
+void rt_render_job_cancel(RendererTiles *rt, TileJob *job);
+
 
 void rt_sync_scroll(RendererTiles *rt)
 {
@@ -297,8 +372,16 @@ void rt_tile_free(ImageTile *it)
 
 void rt_tile_free_all(RendererTiles *rt)
 {
-	g_list_free_full(rt->tiles, reinterpret_cast<GDestroyNotify>(rt_tile_free));
-	rt->tiles = nullptr;
+	ImageTile *it = rt->tiles->first();
+	while (it)
+		{
+		ImageTile *next = it->lru_next;
+		if (it->job) rt_render_job_cancel(rt, it->job);
+		rt_tile_free(it);
+		it = next;
+		}
+
+	rt->tiles->clear();
 	rt->tile_cache_size = 0;
 }
 
@@ -312,7 +395,7 @@ ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
 	if (it->x + it->w > pr->width) it->w = pr->width - it->x;
 	if (it->y + it->h > pr->height) it->h = pr->height - it->y;
 
-	rt->tiles = g_list_prepend(rt->tiles, it);
+	rt->tiles->insert(it);
 	rt->tile_cache_size += it->size;
 
 	return it;
@@ -326,6 +409,7 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 
 		it->qd = nullptr;
 		rt->draw_queue = g_list_remove(rt->draw_queue, qd);
+		rt->draw_queue_length--;
 		g_free(qd);
 		}
 
@@ -335,10 +419,13 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 
 		it->qd2 = nullptr;
 		rt->draw_queue_2pass = g_list_remove(rt->draw_queue_2pass, qd);
+		rt->draw_queue_2pass_length--;
 		g_free(qd);
 		}
 
-	rt->tiles = g_list_remove(rt->tiles, it);
+	if (it->job) rt_render_job_cancel(rt, it->job);
+
+	rt->tiles->remove(it);
 	rt->tile_cache_size -= it->size;
 
 	rt_tile_free(it);
@@ -347,10 +434,10 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
+	ImageTile *needle;
 	guint tile_max;
 
-	work = g_list_last(rt->tiles);
+	needle = rt->tiles->last();
 
 	if (pr->source_tiles_enabled && pr->scale < 1.0)
 		{
@@ -365,29 +452,23 @@ void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
 		tile_max = rt->tile_cache_max * 1048576;
 		}
 
-	while (work && rt->tile_cache_size + space > tile_max)
+	while (needle && rt->tile_cache_size + space > tile_max)
 		{
-		ImageTile *needle;
+		ImageTile *prev = needle->lru_prev;
 
-		needle = static_cast<ImageTile *>(work->data);
-		work = work->prev;
 		if (needle != it &&
-		    ((!needle->qd && !needle->qd2) || !rt_tile_is_visible(rt, needle))) rt_tile_remove(rt, needle);
+		    ((!needle->qd && !needle->qd2 && !needle->job) || !rt_tile_is_visible(rt, needle))) rt_tile_remove(rt, needle);
+		needle = prev;
 		}
 }
 
 void rt_tile_invalidate_all(RendererTiles *rt)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
 
-	work = rt->tiles;
-	while (work)
+	for (ImageTile *it = rt->tiles->first(); it; it = it->lru_next)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		work = work->next;
+		if (it->job) rt_render_job_cancel(rt, it->job);
 
 		it->render_done = TileRender::NONE;
 		it->render_todo = TileRender::ALL;
@@ -400,26 +481,17 @@ void rt_tile_invalidate_all(RendererTiles *rt)
 
 ImageTile *rt_tile_get(RendererTiles *rt, gint x, gint y, gboolean only_existing)
 {
-	GList *work;
-
-	work = rt->tiles;
-	while (work)
+	ImageTile *it = rt->tiles->find(x, y);
+	if (it)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		if (it->x == x && it->y == y)
-			{
-			rt->tiles = g_list_delete_link(rt->tiles, work);
-			rt->tiles = g_list_prepend(rt->tiles, it);
-			return it;
-			}
-
-		work = work->next;
+		rt->tiles->touch(it);
+		render_stats_count(RENDER_STAT_TILE_HIT);
+		return it;
 		}
 
 	if (only_existing) return nullptr;
 
+	render_stats_count(RENDER_STAT_TILE_MISS);
 	return rt_tile_add(rt, x, y);
 }
 
@@ -762,266 +834,39 @@ void rt_hierarchy_changed_cb(GtkWidget *, GtkWidget *, gpointer data)
  *-------------------------------------------------------------------
  */
 
-GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
-{
-	if (!rt->spare_tile) rt->spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width * rt->hidpi_scale, rt->tile_height * rt->hidpi_scale);
-	return rt->spare_tile;
-}
-
-void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
-{
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + (tw - 1) * COLOR_BYTES;
-
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		ip = dpi - (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
-			{
-			dp = ip + (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			}
-		}
-
-	rt->spare_tile = src;
-	*tile = dest;
-}
-
-void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
-{
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint th = rt->tile_height * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + (th - 1) * drs;
-
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		ip = dpi + (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
-			{
-			dp = ip - (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			}
-		}
-
-	rt->spare_tile = src;
-	*tile = dest;
-}
-
-void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+GdkPixbuf *tile_buffers_get_spare(TileBuffers &buffers)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-
-	gint tw = rt->tile_width * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi =  d_pix + (tw - x - 1) * COLOR_BYTES;
-
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		dp = dpi + (i * drs);
-		for (j = 0; j < w; j++)
-			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
-			}
-		}
-
-	rt->spare_tile = src;
-	*tile = dest;
+	if (!buffers.spare) buffers.spare = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, buffers.tile_width * buffers.hidpi_scale, buffers.tile_height * buffers.hidpi_scale);
+	return buffers.spare;
 }
 
-void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief Applies the orientation to a region of the tile
+ *
+ * The region is copied to where the orientation puts it in the spare
+ * buffer, which then becomes the tile buffer.
+ */
+void rt_tile_apply_orientation(TileBuffers &buffers, gint orientation, gint x, gint y, gint w, gint h)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width * rt->hidpi_scale;
-	gint th = rt->tile_height * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + (th - 1) * drs + (tw - 1) * COLOR_BYTES;
-
-	for (i = y; i < y + h; i++)
+	if (orientation < EXIF_ORIENTATION_TOP_RIGHT || orientation > EXIF_ORIENTATION_LEFT_BOTTOM)
 		{
-		sp = s_pix + (i * srs) + (x * COLOR_BYTES);
-		dp = dpi - (i * drs) - (x * COLOR_BYTES);
-		for (j = 0; j < w; j++)
-			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
-			}
+		/* normal, or out of range -- nothing to do */
+		return;
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
-}
+	GdkPixbuf *src = buffers.pixbuf;
+	GdkPixbuf *dest = tile_buffers_get_spare(buffers);
 
-void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
-{
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint th = rt->tile_height * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
-
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + (th - 1) * drs + (x * COLOR_BYTES);
-
-	for (i = y; i < y + h; i++)
-		{
-		sp = spi + (i * srs);
-		dp = dpi - (i * drs);
-		memcpy(dp, sp, w * COLOR_BYTES);
-		}
+	/* the tiles are square, the swapped axes fit */
+	pixbuf_copy_area_oriented(gdk_pixbuf_read_pixels(src), gdk_pixbuf_get_rowstride(src),
+	                          gdk_pixbuf_get_pixels(dest), gdk_pixbuf_get_rowstride(dest),
+	                          COLOR_BYTES,
+	                          buffers.tile_width * buffers.hidpi_scale,
+	                          buffers.tile_height * buffers.hidpi_scale,
+	                          {x, y, w, h}, orientation);
 
-	rt->spare_tile = src;
-	*tile = dest;
-}
-
-void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
-{
-	switch (orientation)
-		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			/* normal -- nothing to do */
-			break;
-		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_TOP:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		default:
-			/* The other values are out of range */
-			break;
-		}
+	buffers.spare = src;
+	buffers.pixbuf = dest;
 }
 
 /**
@@ -1271,17 +1116,14 @@ gint rt_get_orientation(RendererTiles *rt)
 }
 
 
-void rt_tile_render(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Works out which area of a tile needs rendering and updates its render state
+ * @retval FALSE Nothing needs rendering
+ */
+gboolean rt_tile_render_area(ImageTile *it, gint &x, gint &y, gint &w, gint &h,
+                             gboolean new_data, gboolean fast)
 {
-	PixbufRenderer *pr = rt->pr;
-	gboolean has_alpha;
-	gboolean draw = FALSE;
-	gint orientation = rt_get_orientation(rt);
-	gboolean wide_image = FALSE;
-
-	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return;
+	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return FALSE;
 
 	if (it->render_done != TileRender::ALL)
 		{
@@ -1294,15 +1136,163 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 	else if (it->render_todo != TileRender::AREA)
 		{
 		if (!fast) it->render_todo = TileRender::NONE;
-		return;
+		return FALSE;
 		}
 
 	if (!fast) it->render_todo = TileRender::NONE;
 
 	if (new_data) it->blank = FALSE;
 
+	return TRUE;
+}
+
+/**
+ * @brief Sets up the rendering of an area of a tile from pr->pixbuf
+ * @param fast Set to TRUE when the image is too small for anything but GDK_INTERP_NEAREST
+ * @retval FALSE There is no image to render
+ */
+gboolean rt_tile_render_params(RendererTiles *rt, ImageTile *it,
+                               gint x, gint y, gint w, gint h,
+                               gboolean &fast, TileRenderParams &params)
+{
+	PixbufRenderer *pr = rt->pr;
+	gint orientation = rt_get_orientation(rt);
+	gdouble scale_x;
+	gdouble scale_y;
+	gdouble src_x;
+	gdouble src_y;
+
+	if (!pr->pixbuf || pr->image_width == 0 || pr->image_height == 0) return FALSE;
+
+	scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
+	scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
+
+	pr_tile_coords_map_orientation(orientation, it->x, it->y,
+	                               pr->width, pr->height,
+	                               rt->tile_width, rt->tile_height,
+	                               src_x, src_y);
+	GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
+	                                                      {x, y, w, h},
+	                                                      rt->tile_width,
+	                                                      rt->tile_height);
+
+	src_x *= rt->hidpi_scale;
+	src_y *= rt->hidpi_scale;
+	pr_scale_region(pb_rect, rt->hidpi_scale);
+
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_LEFT_TOP:
+		case EXIF_ORIENTATION_RIGHT_TOP:
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			std::swap(scale_x, scale_y);
+			break;
+		default:
+			/* nothing to do */
+			break;
+		}
+
+	/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
+	 * small sizes for anything but GDK_INTERP_NEAREST
+	 */
+	if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
+
+	/* large reductions start from a smaller copy of the image,
+	 * the offsets are in tile pixels and do not change */
+	gint factor;
+	params.src = pr_pyramid_get(pr, std::max(scale_x, scale_y), factor);
+
+	params.has_alpha = gdk_pixbuf_get_has_alpha(params.src);
+	params.ignore_alpha = pr->ignore_alpha;
+	params.pb_rect = pb_rect;
+	params.offset_x = static_cast<gdouble>(0.0) - src_x - (get_right_pixbuf_offset(rt) * scale_x);
+	params.offset_y = static_cast<gdouble>(0.0) - src_y;
+	params.scale_x = scale_x * factor;
+	params.scale_y = scale_y * factor;
+	params.interp_type = (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality;
+	params.check_x = it->x + pb_rect.x;
+	params.check_y = it->y + pb_rect.y;
+	params.wide_image = pr->image_width / factor > 32767;
+	params.orientation = orientation;
+
+	params.anaglyph = (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
+	                   (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0));
+	params.stereo_mode = rt->stereo_mode;
+	params.anaglyph_offset_x = static_cast<gdouble>(0.0) - src_x - (get_left_pixbuf_offset(rt) * scale_x);
+
+	return TRUE;
+}
+
+/**
+ * @brief Renders an area of a tile into buffers.pixbuf, does not touch the renderer
+ */
+void rt_tile_render_pixbuf(const TileRenderParams &params, TileBuffers &buffers)
+{
+	const GdkRectangle &pb_rect = params.pb_rect;
+
+	rt_tile_get_region(params.has_alpha, params.ignore_alpha,
+	                   params.src, buffers.pixbuf, pb_rect,
+	                   params.offset_x, params.offset_y,
+	                   params.scale_x, params.scale_y,
+	                   params.interp_type,
+	                   params.check_x, params.check_y, params.wide_image);
+	if (params.anaglyph)
+		{
+		GdkPixbuf *right_pb = tile_buffers_get_spare(buffers);
+		rt_tile_get_region(params.has_alpha, params.ignore_alpha,
+		                   params.src, right_pb, pb_rect,
+		                   params.anaglyph_offset_x, params.offset_y,
+		                   params.scale_x, params.scale_y,
+		                   params.interp_type,
+		                   params.check_x, params.check_y, params.wide_image);
+		pr_create_anaglyph(params.stereo_mode, buffers.pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+		}
+	rt_tile_apply_orientation(buffers, params.orientation, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+}
+
+/**
+ * @brief Applies pr->func_post_process to an area of a rendered tile pixbuf
+ * @param x,y,w,h The area of the tile, in widget pixels
+ */
+void rt_tile_post_process(const PixbufRenderer::PostProcessFunc &post_process, PixbufRenderer *pr,
+                          GdkPixbuf **pixbuf, gint hidpi_scale, gint x, gint y, gint w, gint h)
+{
+	GdkRectangle rect{x, y, w, h};
+
+	pr_scale_region(rect, hidpi_scale);
+	post_process(pr, pixbuf, rect.x, rect.y, rect.width, rect.height);
+}
+
+/**
+ * @brief Paints an area of a rendered tile pixbuf onto the tile surface
+ */
+void rt_tile_draw_pixbuf(RendererTiles *rt, ImageTile *it, GdkPixbuf *pixbuf,
+                         gint x, gint y, gint w, gint h)
+{
+	cairo_t *cr = cairo_create(it->surface);
+	cairo_rectangle (cr, x, y, w, h);
+
+	cairo_surface_t *surface = gdk_cairo_surface_create_from_pixbuf(pixbuf, rt->hidpi_scale, nullptr);
+	cairo_set_source_surface(cr, surface, 0, 0);
+	cairo_fill(cr);
+
+	cairo_surface_destroy(surface);
+	cairo_destroy (cr);
+}
+
+void rt_tile_render(RendererTiles *rt, ImageTile *it,
+                    gint x, gint y, gint w, gint h,
+                    gboolean new_data, gboolean fast)
+{
+	PixbufRenderer *pr = rt->pr;
+	gboolean draw = FALSE;
+
+	if (!rt_tile_render_area(it, x, y, w, h, new_data, fast)) return;
+
+	const gint64 start = g_get_monotonic_time();
+
 	rt_tile_prepare(rt, it);
-	has_alpha = (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf));
 
 	/** @FIXME checker colors for alpha should be configurable,
 	 * also should be drawn for blank = TRUE
@@ -1324,99 +1314,36 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		}
 	else
 		{
-		gdouble scale_x;
-		gdouble scale_y;
-		gdouble src_x;
-		gdouble src_y;
-
-		if (pr->image_width == 0 || pr->image_height == 0) return;
-
-		scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
-		scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
+		TileRenderParams params;
 
-		pr_tile_coords_map_orientation(orientation, it->x, it->y,
-		                               pr->width, pr->height,
-		                               rt->tile_width, rt->tile_height,
-		                               src_x, src_y);
-		GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
-		                                                      {x, y, w, h},
-		                                                      rt->tile_width,
-		                                                      rt->tile_height);
+		if (!rt_tile_render_params(rt, it, x, y, w, h, fast, params)) return;
 
-		src_x *= rt->hidpi_scale;
-		src_y *= rt->hidpi_scale;
-		pr_scale_region(pb_rect, rt->hidpi_scale);
-
-		switch (orientation)
-			{
-			case EXIF_ORIENTATION_LEFT_TOP:
-			case EXIF_ORIENTATION_RIGHT_TOP:
-			case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			case EXIF_ORIENTATION_LEFT_BOTTOM:
-				std::swap(scale_x, scale_y);
-				break;
-			default:
-				/* nothing to do */
-				break;
-			}
-
-		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
-		 * small sizes for anything but GDK_INTERP_NEAREST
-		 */
-		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
-		if (pr->image_width > 32767) wide_image = TRUE;
-
-		rt_tile_get_region(has_alpha, pr->ignore_alpha,
-		                   pr->pixbuf, it->pixbuf, pb_rect,
-		                   static_cast<gdouble>(0.0) - src_x - (get_right_pixbuf_offset(rt) * scale_x),
-		                   static_cast<gdouble>(0.0) - src_y,
-		                   scale_x, scale_y,
-		                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
-		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
-			{
-			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
-			rt_tile_get_region(has_alpha, pr->ignore_alpha,
-			                   pr->pixbuf, right_pb, pb_rect,
-			                   static_cast<gdouble>(0.0) - src_x - (get_left_pixbuf_offset(rt) * scale_x),
-			                   static_cast<gdouble>(0.0) - src_y,
-			                   scale_x, scale_y,
-			                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-			                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-			/* do not care about freeing spare_tile, it will be reused */
-			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+		TileBuffers buffers{rt->tile_width, rt->tile_height, rt->hidpi_scale, it->pixbuf, rt->spare_tile};
+		rt_tile_render_pixbuf(params, buffers);
+		it->pixbuf = buffers.pixbuf;
+		rt->spare_tile = buffers.spare;
 		draw = TRUE;
 		}
 
 	if (draw && it->pixbuf && !it->blank)
 		{
 		if (pr->func_post_process && (!pr->post_process_slow || !fast))
-			pr->func_post_process(pr, &it->pixbuf, x, y, w, h);
-
-		cairo_t *cr = cairo_create(it->surface);
-		cairo_rectangle (cr, x, y, w, h);
+			rt_tile_post_process(pr->func_post_process, pr, &it->pixbuf, rt->hidpi_scale, x, y, w, h);
 
-		cairo_surface_t *surface = gdk_cairo_surface_create_from_pixbuf(it->pixbuf, rt->hidpi_scale, nullptr);
-		cairo_set_source_surface(cr, surface, 0, 0);
-		cairo_fill(cr);
+		rt_tile_draw_pixbuf(rt, it, it->pixbuf, x, y, w, h);
 
-		cairo_surface_destroy(surface);
-		cairo_destroy (cr);
+		render_stats_add_time(RENDER_STAT_TILE_RENDER, g_get_monotonic_time() - start);
 		}
 }
 
-
-void rt_tile_expose(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Clamps an area of a tile to the visible part of the image
+ * @retval FALSE No part of the area is visible
+ */
+gboolean rt_tile_clamp_to_visible(RendererTiles *rt, ImageTile *it, gint &x, gint &y, gint &w, gint &h)
 {
 	PixbufRenderer *pr = rt->pr;
-	cairo_t *cr;
 
-	/* clamp to visible */
 	if (it->x + x < rt->x_scroll)
 		{
 		w -= rt->x_scroll - it->x - x;
@@ -1426,7 +1353,7 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		w = rt->x_scroll + pr->vis_width - it->x - x;
 		}
-	if (w < 1) return;
+	if (w < 1) return FALSE;
 	if (it->y + y < rt->y_scroll)
 		{
 		h -= rt->y_scroll - it->y - y;
@@ -1436,9 +1363,18 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		h = rt->y_scroll + pr->vis_height - it->y - y;
 		}
-	if (h < 1) return;
+	if (h < 1) return FALSE;
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+	return TRUE;
+}
+
+/**
+ * @brief Copies a visible area of a tile surface to the window
+ */
+void rt_tile_blit(RendererTiles *rt, ImageTile *it, gint x, gint y, gint w, gint h)
+{
+	PixbufRenderer *pr = rt->pr;
+	cairo_t *cr;
 
 	cr = cairo_create(rt->surface);
 	cairo_set_source_surface(cr, it->surface, pr->x_offset + (it->x - rt->x_scroll) + rt->stereo_off_x, pr->y_offset + (it->y - rt->y_scroll) + rt->stereo_off_y);
@@ -1458,6 +1394,17 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 	gtk_widget_queue_draw(GTK_WIDGET(rt->pr));
 }
 
+void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+                    gint x, gint y, gint w, gint h,
+                    gboolean new_data, gboolean fast)
+{
+	if (!rt_tile_clamp_to_visible(rt, it, x, y, w, h)) return;
+
+	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+
+	rt_tile_blit(rt, it, x, y, w, h);
+}
+
 
 gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 {
@@ -1466,6 +1413,195 @@ gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 		it->y + it->h >= rt->y_scroll && it->y < rt->y_scroll + pr->vis_height);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * render pool
+ *-------------------------------------------------------------------
+ */
+
+gint rt_render_threads()
+{
+	return options->threads.tile_render > 0 ? options->threads.tile_render : get_cpu_cores();
+}
+
+void rt_render_job_free(TileJob *job)
+{
+	g_object_unref(job->params.src);
+	if (job->buffers.pixbuf) g_object_unref(job->buffers.pixbuf);
+	if (job->buffers.spare) g_object_unref(job->buffers.spare);
+	delete job;
+}
+
+/**
+ * @brief Drops a job, whatever the pool makes of it is thrown away
+ *
+ * The tile was marked as rendered when the job was queued, so it is
+ * marked to be rendered again in full.
+ */
+void rt_render_job_cancel(RendererTiles *rt, TileJob *job)
+{
+	g_mutex_lock(&rt->render_mutex);
+	job->cancelled = TRUE;
+	g_mutex_unlock(&rt->render_mutex);
+
+	job->it->render_done = TileRender::NONE;
+	job->it->render_todo = TileRender::ALL;
+
+	job->it->job = nullptr;
+	job->it = nullptr;
+}
+
+void rt_render_cancel_all(RendererTiles *rt)
+{
+	for (GList *work = rt->render_jobs; work; work = work->next)
+		{
+		auto job = static_cast<TileJob *>(work->data);
+
+		if (job->it) rt_render_job_cancel(rt, job);
+		}
+}
+
+/**
+ * @brief Paints the tiles finished by the render pool, in the main thread
+ */
+gboolean rt_render_done_cb(gpointer data)
+{
+	auto rt = static_cast<RendererTiles *>(data);
+	PixbufRenderer *pr = rt->pr;
+	GList *done;
+
+	g_mutex_lock(&rt->render_mutex);
+	done = rt->render_done;
+	rt->render_done = nullptr;
+	rt->render_done_id = 0;
+	g_mutex_unlock(&rt->render_mutex);
+
+	const gboolean realized = gtk_widget_get_realized(GTK_WIDGET(pr));
+
+	for (GList *work = done; work; work = work->next)
+		{
+		auto job = static_cast<TileJob *>(work->data);
+		ImageTile *it = job->it;
+
+		rt->render_jobs = g_list_remove(rt->render_jobs, job);
+
+		/* not cancelled, so the worker has rendered it */
+		if (it)
+			{
+			it->job = nullptr;
+			rt_tile_draw_pixbuf(rt, it, job->buffers.pixbuf, job->x, job->y, job->w, job->h);
+
+			gint x = job->x;
+			gint y = job->y;
+			gint w = job->w;
+			gint h = job->h;
+			if (realized && rt_tile_is_visible(rt, it) &&
+			    rt_tile_clamp_to_visible(rt, it, x, y, w, h))
+				{
+				rt_tile_blit(rt, it, x, y, w, h);
+				}
+			}
+
+		rt_render_job_free(job);
+		}
+
+	g_list_free(done);
+
+	if (!rt->render_jobs && !rt->draw_queue && !rt->draw_queue_2pass) pr_render_complete_signal(pr);
+
+	return G_SOURCE_REMOVE;
+}
+
+void rt_render_job_run(gpointer data, gpointer user_data)
+{
+	auto job = static_cast<TileJob *>(data);
+	auto rt = static_cast<RendererTiles *>(user_data);
+	gboolean cancelled;
+
+	g_mutex_lock(&rt->render_mutex);
+	cancelled = job->cancelled;
+	g_mutex_unlock(&rt->render_mutex);
+
+	if (!cancelled)
+		{
+		TileBuffers &buffers = job->buffers;
+		const gint64 start = g_get_monotonic_time();
+
+		buffers.pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, buffers.hidpi_scale * buffers.tile_width, buffers.hidpi_scale * buffers.tile_height);
+		rt_tile_render_pixbuf(job->params, buffers);
+
+		if (job->post_process)
+			rt_tile_post_process(job->post_process, job->pr, &buffers.pixbuf, buffers.hidpi_scale, job->x, job->y, job->w, job->h);
+
+		g_clear_object(&buffers.spare);
+
+		render_stats_add_time(RENDER_STAT_TILE_RENDER_ASYNC, g_get_monotonic_time() - start);
+		}
+
+	g_mutex_lock(&rt->render_mutex);
+	rt->render_done = g_list_prepend(rt->render_done, job);
+	if (!rt->render_done_id)
+		{
+		rt->render_done_id = g_idle_add_full(GDK_PRIORITY_REDRAW, rt_render_done_cb, rt, nullptr);
+		}
+	g_mutex_unlock(&rt->render_mutex);
+}
+
+/**
+ * @brief Hands a high quality render of an area of a tile to the render pool
+ * @retval FALSE The tile has to be rendered in the main thread, as before
+ *
+ * Only tiles rendered from pr->pixbuf go to the pool, source tiles are
+ * managed by the PixbufRenderer in the main thread.
+ */
+gboolean rt_tile_render_async(RendererTiles *rt, ImageTile *it,
+                              gint x, gint y, gint w, gint h, gboolean new_data)
+{
+	PixbufRenderer *pr = rt->pr;
+	TileRenderParams params;
+	gboolean fast = FALSE;
+
+	if (!pr->pixbuf || pr->source_tiles_enabled ||
+	    pr->image_width == 0 || pr->image_height == 0 ||
+	    (it->blank && !new_data)) return FALSE;
+
+	/* a newer render of the same tile, which then covers the whole tile */
+	if (it->job) rt_render_job_cancel(rt, it->job);
+
+	if (!rt_tile_render_area(it, x, y, w, h, new_data, FALSE)) return FALSE;
+
+	rt_tile_prepare(rt, it);
+	rt_tile_render_params(rt, it, x, y, w, h, fast, params);
+
+	auto job = new TileJob();
+	job->it = it;
+	job->x = x;
+	job->y = y;
+	job->w = w;
+	job->h = h;
+	job->params = params;
+	g_object_ref(job->params.src);
+	if (pr->func_post_process && (!pr->post_process_slow || !fast)) job->post_process = pr->func_post_process;
+	job->pr = pr;
+	job->buffers = {rt->tile_width, rt->tile_height, rt->hidpi_scale, nullptr, nullptr};
+
+	it->job = job;
+	rt->render_jobs = g_list_prepend(rt->render_jobs, job);
+
+	if (!rt->render_pool)
+		{
+		rt->render_pool = g_thread_pool_new(rt_render_job_run, rt, rt_render_threads(), FALSE, nullptr);
+		}
+	else if (g_thread_pool_get_max_threads(rt->render_pool) != rt_render_threads())
+		{
+		g_thread_pool_set_max_threads(rt->render_pool, rt_render_threads(), nullptr);
+		}
+
+	g_thread_pool_push(rt->render_pool, job, nullptr);
+
+	return TRUE;
+}
+
 /*
  *-------------------------------------------------------------------
  * draw queue
@@ -1559,7 +1695,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 	    (!rt->draw_queue && !rt->draw_queue_2pass) ||
 	    !rt->draw_idle_id)
 		{
-		pr_render_complete_signal(pr);
+		if (!rt->render_jobs) pr_render_complete_signal(pr);
 
 		rt->draw_idle_id = 0;
 		return G_SOURCE_REMOVE;
@@ -1587,13 +1723,24 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		{
 		if (rt_tile_is_visible(rt, qd->it))
 			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+			gint x = qd->x;
+			gint y = qd->y;
+			gint w = qd->w;
+			gint h = qd->h;
+
+			/* high quality renders go to the render pool, the result is painted when it is done */
+			if (fast || !rt_tile_clamp_to_visible(rt, qd->it, x, y, w, h) ||
+			    !rt_tile_render_async(rt, qd->it, x, y, w, h, qd->new_data))
+				{
+				rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+				}
 			}
 		else if (qd->new_data)
 			{
 			/* if new pixel data, and we already have a pixmap, update the tile */
 			qd->it->blank = FALSE;
-			if (qd->it->surface && qd->it->render_done == TileRender::ALL)
+			if (qd->it->surface && qd->it->render_done == TileRender::ALL &&
+			    (fast || !rt_tile_render_async(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data)))
 				{
 				rt_tile_render(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
 				}
@@ -1604,6 +1751,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		{
 		qd->it->qd = nullptr;
 		rt->draw_queue = g_list_remove(rt->draw_queue, qd);
+		rt->draw_queue_length--;
 		if (fast)
 			{
 			if (qd->it->qd2)
@@ -1615,6 +1763,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 				{
 				qd->it->qd2 = qd;
 				rt->draw_queue_2pass = g_list_append(rt->draw_queue_2pass, qd);
+				rt->draw_queue_2pass_length++;
 				}
 			}
 		else
@@ -1626,12 +1775,13 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		{
 		qd->it->qd2 = nullptr;
 		rt->draw_queue_2pass = g_list_remove(rt->draw_queue_2pass, qd);
+		rt->draw_queue_2pass_length--;
 		g_free(qd);
 		}
 
 	if (!rt->draw_queue && !rt->draw_queue_2pass)
 		{
-		pr_render_complete_signal(pr);
+		if (!rt->render_jobs) pr_render_complete_signal(pr);
 
 		rt->draw_idle_id = 0;
 		return G_SOURCE_REMOVE;
@@ -1653,12 +1803,16 @@ void rt_queue_clear(RendererTiles *rt)
 {
 	g_list_free_full(rt->draw_queue, rt_queue_data_free);
 	rt->draw_queue = nullptr;
+	rt->draw_queue_length = 0;
 
 	g_list_free_full(rt->draw_queue_2pass, rt_queue_data_free);
 	rt->draw_queue_2pass = nullptr;
+	rt->draw_queue_2pass_length = 0;
 
 	g_clear_handle_id(&rt->draw_idle_id, g_source_remove);
 
+	rt_render_cancel_all(rt);
+
 	rt_sync_scroll(rt);
 }
 
@@ -1710,6 +1864,9 @@ void rt_queue_to_tiles(RendererTiles *rt, gint x, gint y, gint w, gint h,
 					   j > rt->y_scroll + pr->vis_height)));
 			if (it)
 				{
+				/* the pool would paint over the new pixel data */
+				if (new_data && it->job) rt_render_job_cancel(rt, it->job);
+
 				if ((render == TileRender::ALL && it->render_done != TileRender::ALL) ||
 				    (render == TileRender::AREA && it->render_todo != TileRender::ALL))
 					{
@@ -1742,6 +1899,7 @@ void rt_queue_to_tiles(RendererTiles *rt, gint x, gint y, gint w, gint h,
 					{
 					it->qd = qd;
 					rt->draw_queue = g_list_append(rt->draw_queue, qd);
+					rt->draw_queue_length++;
 					}
 				}
 			}
@@ -1769,6 +1927,9 @@ void rt_queue(RendererTiles *rt, gint x, gint y, gint w, gint h,
 
 	rt_queue_to_tiles(rt, nx, ny, w, h, render, new_data, only_existing);
 
+	render_stats_queue_depth(RENDER_STAT_DRAW_QUEUE, rt->draw_queue_length);
+	render_stats_queue_depth(RENDER_STAT_DRAW_QUEUE_2PASS, rt->draw_queue_2pass_length);
+
 	if ((rt->draw_queue || rt->draw_queue_2pass) && rt->draw_idle_id) return;
 
 	g_clear_handle_id(&rt->draw_idle_id, g_source_remove);
@@ -1914,15 +2075,34 @@ void renderer_invalidate_region(void *renderer, GdkRectangle region)
 	const gint y1 = ROUND_DOWN(region.y, rt->tile_height);
 	const gint y2 = ROUND_UP(region.y + region.height, rt->tile_height);
 
-	for (GList *work = rt->tiles; work; work = work->next)
+	const auto invalidate = [rt](ImageTile *it)
+	{
+		if (it->job) rt_render_job_cancel(rt, it->job);
+		it->render_done = TileRender::NONE;
+		it->render_todo = TileRender::ALL;
+	};
+
+	/* look up the grid cells of the region, unless there are fewer tiles than cells */
+	const gint64 cells = static_cast<gint64>((x2 - x1) / rt->tile_width) * ((y2 - y1) / rt->tile_height);
+	if (cells <= static_cast<gint64>(rt->tiles->size()))
 		{
-		auto *it = static_cast<ImageTile *>(work->data);
+		for (gint y = y1; y < y2; y += rt->tile_height)
+			{
+			for (gint x = x1; x < x2; x += rt->tile_width)
+				{
+				ImageTile *it = rt->tiles->find(x, y);
+				if (it) invalidate(it);
+				}
+			}
+		return;
+		}
 
+	for (ImageTile *it = rt->tiles->first(); it; it = it->lru_next)
+		{
 		if (it->x < x2 && it->x + it->w > x1 &&
 		    it->y < y2 && it->y + it->h > y1)
 			{
-			it->render_done = TileRender::NONE;
-			it->render_todo = TileRender::ALL;
+			invalidate(it);
 			}
 		}
 }
@@ -1976,6 +2156,15 @@ void renderer_free(void *renderer)
 	auto rt = static_cast<RendererTiles *>(renderer);
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
+	delete rt->tiles;
+
+	/* all jobs are cancelled, wait for the ones in progress */
+	if (rt->render_pool) g_thread_pool_free(rt->render_pool, FALSE, TRUE);
+	g_clear_handle_id(&rt->render_done_id, g_source_remove);
+	g_list_free(rt->render_done);
+	g_list_free_full(rt->render_jobs, reinterpret_cast<GDestroyNotify>(rt_render_job_free));
+	g_mutex_clear(&rt->render_mutex);
+
 	if (rt->spare_tile) g_object_unref(rt->spare_tile);
 	g_list_free_full(rt->overlay_list, reinterpret_cast<GDestroyNotify>(overlay_data_free));
 	g_clear_pointer(&rt->overlay_buffer, cairo_surface_destroy);
@@ -2101,13 +2290,15 @@ RendererFuncs *renderer_tiles_new(PixbufRenderer *pr)
 	rt->tile_width = options->image.tile_size;
 	rt->tile_height = options->image.tile_size;
 
-	rt->tiles = nullptr;
+	rt->tiles = new TileIndex<ImageTile>();
 	rt->tile_cache_size = 0;
 
 	rt->tile_cache_max = PR_CACHE_SIZE_DEFAULT;
 
 	rt->draw_idle_id = 0;
 
+	g_mutex_init(&rt->render_mutex);
+
 	rt->stereo_mode = 0;
 	rt->stereo_off_x = 0;
 	rt->stereo_off_y = 0;
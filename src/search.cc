@@ -54,7 +54,7 @@
 #include "options.h"
 #include "print.h"
 #include "similar.h"
-#include "thumb.h"
+#include "thumb-queue.h"
 #include "ui-bookmark.h"
 #include "ui-file-chooser.h"
 #include "ui-fileops.h"
@@ -320,9 +320,8 @@ struct SearchData
 
 	FileData *click_fd;
 
-	ThumbLoader *thumb_loader;
+	ThumbQueue *thumb_queue;
 	gboolean thumb_enable;
-	FileData *thumb_fd;
 };
 
 struct MatchFileData
@@ -768,9 +767,8 @@ static void search_result_clear(SearchData *sd)
 
 	sd->click_fd = nullptr;
 
-	thumb_loader_free(sd->thumb_loader);
-	sd->thumb_loader = nullptr;
-	sd->thumb_fd = nullptr;
+	thumb_queue_free(sd->thumb_queue);
+	sd->thumb_queue = nullptr;
 
 	search_status_update(sd);
 }
@@ -785,7 +783,7 @@ static void search_result_remove_item(SearchData *sd, MatchFileData *mfd, GtkTre
 
 	gtk_list_store_remove(GTK_LIST_STORE(store), iter);
 	if (sd->click_fd == mfd->fd) sd->click_fd = nullptr;
-	if (sd->thumb_fd == mfd->fd) sd->thumb_fd = nullptr;
+	thumb_queue_cancel_item(sd->thumb_queue, mfd->fd);
 	file_data_unref(mfd->fd);
 	g_free(mfd);
 }
@@ -883,9 +881,6 @@ static gboolean search_result_select_cb(GtkTreeSelection *, GtkTreeModel *, GtkT
  *-------------------------------------------------------------------
  */
 
-static void search_result_thumb_step(SearchData *sd);
-
-
 static void search_result_thumb_set(SearchData *sd, FileData *fd, GtkTreeIter *iter)
 {
 	GtkTreeIter iter_n;
@@ -899,89 +894,113 @@ static void search_result_thumb_set(SearchData *sd, FileData *fd, GtkTreeIter *i
 	if (iter) gtk_list_store_set(store, iter, SEARCH_COLUMN_THUMB, fd->thumb_pixbuf, -1);
 }
 
-static void search_result_thumb_do(SearchData *sd)
+static gdouble search_result_thumb_progress(SearchData *sd)
 {
-	FileData *fd;
+	GtkTreeIter iter;
+	gboolean valid;
+	gint row = 0;
+	gint length = 0;
 
-	if (!sd->thumb_loader || !sd->thumb_fd) return;
-	fd = sd->thumb_fd;
+	GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(sd->ui.result_view));
+	valid = gtk_tree_model_get_iter_first(store, &iter);
+	while (valid)
+		{
+		MatchFileData *mfd;
 
-	search_result_thumb_set(sd, fd, nullptr);
-}
+		gtk_tree_model_get(store, &iter, SEARCH_COLUMN_POINTER, &mfd, -1);
+		if (mfd->fd->thumb_pixbuf) row++;
+		length++;
 
-static void search_result_thumb_done_cb(ThumbLoader *, gpointer data)
-{
-	auto sd = static_cast<SearchData *>(data);
+		valid = gtk_tree_model_iter_next(store, &iter);
+		}
 
-	search_result_thumb_do(sd);
-	search_result_thumb_step(sd);
+	return length > 0 ? static_cast<gdouble>(row) / length : 1.0;
 }
 
-static void search_result_thumb_step(SearchData *sd)
+static gpointer search_result_thumb_next_cb(FileData **fd, gpointer data)
 {
+	auto sd = static_cast<SearchData *>(data);
 	GtkTreeIter iter;
-	MatchFileData *mfd = nullptr;
 	gboolean valid;
-	gint row = 0;
-	gint length = 0;
 
 	GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(sd->ui.result_view));
 	valid = gtk_tree_model_get_iter_first(store, &iter);
-	if (!sd->thumb_enable)
-		{
-		while (valid)
-			{
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter, SEARCH_COLUMN_THUMB, NULL, -1);
-			valid = gtk_tree_model_iter_next(store, &iter);
-			}
-		return;
-		}
-
-	while (!mfd && valid)
+	while (valid)
 		{
-		GdkPixbuf *pixbuf;
+		MatchFileData *mfd;
+		g_autoptr(GdkPixbuf) pixbuf = nullptr;
 
-		length++;
 		gtk_tree_model_get(store, &iter, SEARCH_COLUMN_POINTER, &mfd, SEARCH_COLUMN_THUMB, &pixbuf, -1);
-		if (pixbuf || mfd->fd->thumb_pixbuf)
+		if (!pixbuf)
 			{
-			if (!pixbuf) gtk_list_store_set(GTK_LIST_STORE(store), &iter, SEARCH_COLUMN_THUMB, mfd->fd->thumb_pixbuf, -1);
-			row++;
-			mfd = nullptr;
+			if (mfd->fd->thumb_pixbuf)
+				{
+				gtk_list_store_set(GTK_LIST_STORE(store), &iter, SEARCH_COLUMN_THUMB, mfd->fd->thumb_pixbuf, -1);
+				}
+			else if (!thumb_queue_is_pending(sd->thumb_queue, mfd->fd))
+				{
+				*fd = mfd->fd;
+				return mfd->fd;
+				}
 			}
 		valid = gtk_tree_model_iter_next(store, &iter);
 		}
-	if (valid)
+
+	return nullptr;
+}
+
+static void search_result_thumb_done_cb(GList *results, gpointer data)
+{
+	auto sd = static_cast<SearchData *>(data);
+
+	for (GList *work = results; work; work = work->next)
 		{
-		while (gtk_tree_model_iter_next(store, &iter)) length++;
+		auto result = static_cast<ThumbQueueResult *>(work->data);
+
+		search_result_thumb_set(sd, result->fd, nullptr);
 		}
 
-	if (!mfd)
+	search_progress_update(sd, FALSE, search_result_thumb_progress(sd));
+}
+
+static void search_result_thumb_finish_cb(gpointer data)
+{
+	auto sd = static_cast<SearchData *>(data);
+
+	thumb_queue_free(sd->thumb_queue);
+	sd->thumb_queue = nullptr;
+
+	search_progress_update(sd, TRUE, -1.0);
+}
+
+static void search_result_thumb_step(SearchData *sd)
+{
+	if (!sd->thumb_enable)
 		{
-		sd->thumb_fd = nullptr;
-		thumb_loader_free(sd->thumb_loader);
-		sd->thumb_loader = nullptr;
+		GtkTreeIter iter;
+		gboolean valid;
 
-		search_progress_update(sd, TRUE, -1.0);
+		GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(sd->ui.result_view));
+		valid = gtk_tree_model_get_iter_first(store, &iter);
+		while (valid)
+			{
+			gtk_list_store_set(GTK_LIST_STORE(store), &iter, SEARCH_COLUMN_THUMB, NULL, -1);
+			valid = gtk_tree_model_iter_next(store, &iter);
+			}
 		return;
 		}
 
-	search_progress_update(sd, FALSE, static_cast<gdouble>(row)/length);
-
-	sd->thumb_fd = mfd->fd;
-	thumb_loader_free(sd->thumb_loader);
-	sd->thumb_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-
-	thumb_loader_set_callbacks(sd->thumb_loader,
-				   search_result_thumb_done_cb,
-				   search_result_thumb_done_cb,
-				   nullptr,
-				   sd);
-	if (!thumb_loader_start(sd->thumb_loader, mfd->fd))
+	if (!sd->thumb_queue)
 		{
-		search_result_thumb_do(sd);
-		search_result_thumb_step(sd);
+		sd->thumb_queue = thumb_queue_new(options->thumbnails.max_width, options->thumbnails.max_height,
+						  search_result_thumb_next_cb,
+						  search_result_thumb_done_cb,
+						  search_result_thumb_finish_cb,
+						  sd);
 		}
+
+	search_progress_update(sd, FALSE, search_result_thumb_progress(sd));
+	thumb_queue_start(sd->thumb_queue);
 }
 
 static void search_result_thumb_height(SearchData *sd)
@@ -1012,8 +1031,8 @@ static void search_result_thumb_enable(SearchData *sd, gboolean enable)
 		GtkTreeIter iter;
 		gboolean valid;
 
-		thumb_loader_free(sd->thumb_loader);
-		sd->thumb_loader = nullptr;
+		thumb_queue_free(sd->thumb_queue);
+		sd->thumb_queue = nullptr;
 
 		GtkTreeModel *store = gtk_tree_view_get_model(GTK_TREE_VIEW(sd->ui.result_view));
 		valid = gtk_tree_model_get_iter_first(store, &iter);
@@ -1783,6 +1802,7 @@ static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolea
 		    sd->match_broken_enable)
 			{
 			sd->img_loader = image_loader_new(mfd.fd);
+			image_loader_set_priority_class(sd->img_loader, IMAGE_LOADER_PRIORITY_BACKGROUND);
 			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_file_load_done_cb, sd);
 			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_file_load_done_cb, sd);
 			if (image_loader_start(sd->img_loader))
@@ -2115,9 +2135,9 @@ static gboolean search_file_next(SearchData *sd)
 		{
 		tested = TRUE;
 		match = FALSE;
-		gint rating;
+		read_rating_data(fd);
+		const gint rating = fd->rating;
 
-		rating = metadata_read_int(fd, RATING_KEY, 0);
 		if (sd->match_rating == SEARCH_MATCH_EQUAL)
 			{
 			match = (rating == sd->search_rating);
@@ -2430,6 +2450,7 @@ static void search_start(SearchData *sd)
 		if (!sd->search_similarity_cd->similarity)
 			{
 			sd->img_loader = image_loader_new(file_data_new_group(sd->search_similarity_path));
+			image_loader_set_priority_class(sd->img_loader, IMAGE_LOADER_PRIORITY_BACKGROUND);
 			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_similarity_load_done_cb, sd);
 			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_similarity_load_done_cb, sd);
 			if (image_loader_start(sd->img_loader))
@@ -24,9 +24,12 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
-#include <functional>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
 #include "options.h"
 
 /**
@@ -58,7 +61,221 @@
 namespace
 {
 
-using ImageSimilarityCheckAbort = std::function<bool(gdouble)>;
+/* The 32 x 32 grid is compared one row block at a time. The early-abort
+ * threshold is checked after each block, which gives the same result as
+ * checking after each cell because the partial sums only ever grow.
+ */
+constexpr gint SIM_GRID = 32;
+constexpr gint SIM_ROW_BLOCK = 4;
+constexpr gdouble SIM_MAX_DIFF = 255.0 * 1024.0 * 3.0;
+
+using ImageSimilarityRows = std::array<const guint8 *, 3>;
+
+/**
+ * @brief Returns the sum of absolute differences of \a rows grid rows
+ * @param x Start row of each channel, successive rows are \a x_stride bytes apart
+ * @param x_stride SIM_GRID, or -SIM_GRID to walk the rows of \a x upwards
+ * @param y Start row of each channel, successive rows are SIM_GRID bytes apart
+ * @param rows
+ */
+using ImageSimilaritySadFunc = guint (*)(const ImageSimilarityRows &x, gint x_stride, const ImageSimilarityRows &y, gint rows);
+
+guint image_sim_sad_rows_scalar(const ImageSimilarityRows &x, gint x_stride, const ImageSimilarityRows &y, gint rows)
+{
+	guint sad = 0;
+
+	for (gint c = 0; c < 3; c++)
+		{
+		const guint8 *xr = x[c];
+		const guint8 *yr = y[c];
+
+		for (gint r = 0; r < rows; r++)
+			{
+			for (gint i = 0; i < SIM_GRID; i++)
+				{
+				sad += abs(xr[i] - yr[i]);
+				}
+			xr += x_stride;
+			yr += SIM_GRID;
+			}
+		}
+
+	return sad;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+__attribute__((target("sse2")))
+guint image_sim_sad_rows_sse2(const ImageSimilarityRows &x, gint x_stride, const ImageSimilarityRows &y, gint rows)
+{
+	__m128i acc = _mm_setzero_si128();
+
+	for (gint c = 0; c < 3; c++)
+		{
+		const guint8 *xr = x[c];
+		const guint8 *yr = y[c];
+
+		for (gint r = 0; r < rows; r++)
+			{
+			const __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(xr));
+			const __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(xr + 16));
+			const __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yr));
+			const __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yr + 16));
+
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(x0, y0));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(x1, y1));
+			xr += x_stride;
+			yr += SIM_GRID;
+			}
+		}
+
+	return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+__attribute__((target("avx2")))
+guint image_sim_sad_rows_avx2(const ImageSimilarityRows &x, gint x_stride, const ImageSimilarityRows &y, gint rows)
+{
+	__m256i acc = _mm256_setzero_si256();
+
+	for (gint c = 0; c < 3; c++)
+		{
+		const guint8 *xr = x[c];
+		const guint8 *yr = y[c];
+
+		for (gint r = 0; r < rows; r++)
+			{
+			const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xr));
+			const __m256i yv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(yr));
+
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(xv, yv));
+			xr += x_stride;
+			yr += SIM_GRID;
+			}
+		}
+
+	const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+
+	return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+#endif
+
+ImageSimilaritySadFunc image_sim_sad_rows_func()
+{
+	static const ImageSimilaritySadFunc func = []()
+	{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return image_sim_sad_rows_avx2;
+		if (__builtin_cpu_supports("sse2")) return image_sim_sad_rows_sse2;
+#endif
+		return image_sim_sad_rows_scalar;
+	}();
+
+	return func;
+}
+
+/**
+ * @brief The grids of an image needed to compare it with all 8 isometric
+ * transformations of another image.
+ *
+ * Flipping the rows is done by walking a plane upwards, so only the
+ * plain, mirrored, transposed and transposed-mirrored planes are stored.
+ * Comparing T(a) with b gives the same set of results as comparing a with T(b),
+ * so only one of the two images needs the extra planes.
+ */
+struct ImageSimilarityPlanes
+{
+	enum {
+		PLANE_PLAIN,
+		PLANE_MIRROR,
+		PLANE_TRANSPOSE,
+		PLANE_TRANSPOSE_MIRROR,
+		PLANE_COUNT
+	};
+
+	void fill(const ImageSimilarityData *sd);
+	bool holds(const ImageSimilarityData *sd) const;
+
+	const ImageSimilarityData *owner = nullptr;
+	std::array<std::array<ImageSimilarityData::Avg, 3>, PLANE_COUNT> planes;
+};
+
+void ImageSimilarityPlanes::fill(const ImageSimilarityData *sd)
+{
+	const std::array<const ImageSimilarityData::Avg *, 3> src{&sd->avg_r, &sd->avg_g, &sd->avg_b};
+
+	owner = sd;
+
+	for (gint c = 0; c < 3; c++)
+		{
+		const ImageSimilarityData::Avg &s = *src[c];
+
+		for (gint r = 0; r < SIM_GRID; r++)
+			{
+			for (gint i = 0; i < SIM_GRID; i++)
+				{
+				const guint8 n = s[(r * SIM_GRID) + i];
+
+				planes[PLANE_PLAIN][c][(r * SIM_GRID) + i] = n;
+				planes[PLANE_MIRROR][c][(r * SIM_GRID) + (SIM_GRID - 1 - i)] = n;
+				planes[PLANE_TRANSPOSE][c][(i * SIM_GRID) + r] = n;
+				planes[PLANE_TRANSPOSE_MIRROR][c][(i * SIM_GRID) + (SIM_GRID - 1 - r)] = n;
+				}
+			}
+		}
+}
+
+/* The data is compared as well as the pointer, an ImageSimilarityData
+ * may have been freed and its address reused, or refilled in place.
+ */
+bool ImageSimilarityPlanes::holds(const ImageSimilarityData *sd) const
+{
+	return owner == sd &&
+	       planes[PLANE_PLAIN][0] == sd->avg_r &&
+	       planes[PLANE_PLAIN][1] == sd->avg_g &&
+	       planes[PLANE_PLAIN][2] == sd->avg_b;
+}
+
+/**
+ * @brief Returns the transformed planes of either \a a or \a b
+ * @param a
+ * @param b
+ * @param[out] other The image which is not transformed
+ *
+ * Callers compare one image (the needle) with many others, with the
+ * needle as \a b in dupe.cc and as \a a in search.cc. The planes of the
+ * last needle are kept per thread, and the needle is recognised as the
+ * argument which was repeated from the previous call.
+ */
+const ImageSimilarityPlanes &image_sim_planes_get(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityData *&other)
+{
+	static thread_local ImageSimilarityPlanes cache;
+	static thread_local const ImageSimilarityData *last_a = nullptr;
+	static thread_local const ImageSimilarityData *last_b = nullptr;
+
+	if (cache.holds(b))
+		{
+		other = a;
+		}
+	else if (cache.holds(a))
+		{
+		other = b;
+		}
+	else if (a == last_a && b != last_b)
+		{
+		cache.fill(a);
+		other = b;
+		}
+	else
+		{
+		cache.fill(b);
+		other = a;
+		}
+
+	last_a = a;
+	last_b = b;
+
+	return cache;
+}
 
 void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 {
@@ -91,46 +308,94 @@ void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
  * generate all possible isometric transformations
  * = 8 tests
  * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+ *
+ * All transformations are compared in a single pass over the rows,
+ * a transformation is dropped as soon as its difference exceeds \a max_diff.
  */
-gdouble image_sim_data_compare_transfo(const ImageSimilarityData *a, const ImageSimilarityData *b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
+gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, gdouble max_diff)
 {
 	if (!a || !b || !a->filled || !b->filled) return 0.0;
 
-	gint sim = 0.0;
-	gint i2;
-	gint *i;
-	gint j2;
-	gint *j;
+	struct Variant
+	{
+		const ImageSimilarityData::Avg *plane; /**< 3 channels */
+		gboolean flip_rows;
+		guint sim;
+		gboolean alive;
+	};
+
+	std::array<Variant, 8> variants;
+	gint variant_count;
+	const ImageSimilarityData *other;
 
-	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
-	for (gint j1 = 0; j1 < 32; j1++)
+	if (options->rot_invariant_sim)
 		{
-		if (transfo & 2) *j = 31-j1; else *j = j1;
-		for (gint i1 = 0; i1 < 32; i1++)
+		const ImageSimilarityPlanes &planes = image_sim_planes_get(a, b, other);
+
+		for (gint p = 0; p < ImageSimilarityPlanes::PLANE_COUNT; p++)
 			{
-			if (transfo & 4) *i = 31-i1; else *i = i1;
-			sim += abs(a->avg_r[(i1*32)+j1] - b->avg_r[(i2*32)+j2]);
-			sim += abs(a->avg_g[(i1*32)+j1] - b->avg_g[(i2*32)+j2]);
-			sim += abs(a->avg_b[(i1*32)+j1] - b->avg_b[(i2*32)+j2]);
-			/* check for abort, if so return 0.0 */
-			if (check_abort(sim)) return 0.0;
+			variants[(p * 2)] = {planes.planes[p].data(), FALSE, 0, TRUE};
+			variants[(p * 2) + 1] = {planes.planes[p].data(), TRUE, 0, TRUE};
 			}
+		variant_count = 8;
+		}
+	else
+		{
+		/* avg_r, avg_g and avg_b are not contiguous, only the plain plane is needed */
+		variants[0] = {nullptr, FALSE, 0, TRUE};
+		variant_count = 1;
+		other = b;
 		}
 
-	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
-}
+	const ImageSimilaritySadFunc sad_rows = image_sim_sad_rows_func();
+	gint alive_count = variant_count;
 
-gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityCheckAbort &check_abort)
-{
-	gchar max_t = (options->rot_invariant_sim ? 8 : 1);
-	gdouble max_score = 0;
+	for (gint row = 0; row < SIM_GRID; row += SIM_ROW_BLOCK)
+		{
+		const ImageSimilarityRows y{other->avg_r.data() + (row * SIM_GRID),
+		                            other->avg_g.data() + (row * SIM_GRID),
+		                            other->avg_b.data() + (row * SIM_GRID)};
 
-	for (gchar t = 0; t < max_t; t++)
-	{
-		max_score = std::max(image_sim_data_compare_transfo(a, b, t, check_abort), max_score);
-	}
+		for (gint v = 0; v < variant_count; v++)
+			{
+			Variant &var = variants[v];
+			if (!var.alive) continue;
+
+			std::array<const guint8 *, 3> x_channels;
+			if (var.plane)
+				{
+				x_channels = {var.plane[0].data(), var.plane[1].data(), var.plane[2].data()};
+				}
+			else
+				{
+				x_channels = {a->avg_r.data(), a->avg_g.data(), a->avg_b.data()};
+				}
+
+			const gint x_row = var.flip_rows ? SIM_GRID - 1 - row : row;
+			const ImageSimilarityRows x{x_channels[0] + (x_row * SIM_GRID),
+			                            x_channels[1] + (x_row * SIM_GRID),
+			                            x_channels[2] + (x_row * SIM_GRID)};
+
+			var.sim += sad_rows(x, var.flip_rows ? -SIM_GRID : SIM_GRID, y, SIM_ROW_BLOCK);
+
+			/* check for abort, if so drop this transformation */
+			if (static_cast<gdouble>(var.sim) / SIM_MAX_DIFF > max_diff)
+				{
+				var.alive = FALSE;
+				alive_count--;
+				}
+			}
 
-	return max_score;
+		if (alive_count == 0) return 0.0;
+		}
+
+	guint best = G_MAXUINT;
+	for (gint v = 0; v < variant_count; v++)
+		{
+		if (variants[v].alive) best = std::min(best, variants[v].sim);
+		}
+
+	return 1.0 - (static_cast<gdouble>(best) / SIM_MAX_DIFF);
 }
 
 } // namespace
@@ -310,7 +575,7 @@ static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, co
 
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
 {
-	return image_sim_data_compare(a, b, [](gdouble){ return false; });
+	return image_sim_data_compare(a, b, 1.0);
 }
 
 /* this uses a cutoff point so that it can abort early when it gets to
@@ -325,7 +590,7 @@ gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, g
 		return alternate_image_sim_compare_fast(a, b, min);
 		}
 
-	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / (255.0 * 1024.0 * 3.0)) > min; });
+	return image_sim_data_compare(a, b, min);
 }
 
 gboolean image_sim_filled(const ImageSimilarityData *sd)
@@ -333,4 +598,221 @@ gboolean image_sim_filled(const ImageSimilarityData *sd)
 	if (!sd) return FALSE;
 	return sd->filled;
 }
+
+/*
+ * ------------------------------------------------------------------
+ * Candidate index
+ * ------------------------------------------------------------------
+ */
+
+namespace
+{
+
+constexpr gint SIM_INDEX_GRID = 4;
+constexpr gint SIM_INDEX_BLOCK = SIM_GRID / SIM_INDEX_GRID;
+constexpr gint SIM_INDEX_LEAF_SIZE = 16;
+
+} // namespace
+
+ImageSimilarityIndex::Key ImageSimilarityIndex::key_new(const ImageSimilarityData *sd)
+{
+	const std::array<const ImageSimilarityData::Avg *, 3> src{&sd->avg_r, &sd->avg_g, &sd->avg_b};
+	Key key{};
+
+	for (gint c = 0; c < 3; c++)
+		{
+		for (gint r = 0; r < SIM_GRID; r++)
+			{
+			for (gint i = 0; i < SIM_GRID; i++)
+				{
+				const gint block = ((r / SIM_INDEX_BLOCK) * SIM_INDEX_GRID) + (i / SIM_INDEX_BLOCK);
+
+				key[(c * SIM_INDEX_GRID * SIM_INDEX_GRID) + block] += (*src[c])[(r * SIM_GRID) + i];
+				}
+			}
+		}
+
+	return key;
+}
+
+/* Same transformations as the cells in image_sim_data_compare(), the blocks
+ * are aligned to the grid so each transformation maps whole blocks to blocks.
+ */
+ImageSimilarityIndex::Key ImageSimilarityIndex::key_transform(const Key &key, gint transfo)
+{
+	constexpr gint n = SIM_INDEX_GRID;
+	Key out;
+
+	for (gint c = 0; c < 3; c++)
+		{
+		for (gint r = 0; r < n; r++)
+			{
+			for (gint i = 0; i < n; i++)
+				{
+				gint tr = (transfo & 1) ? i : r;
+				gint ti = (transfo & 1) ? r : i;
+
+				if (transfo & 2) tr = n - 1 - tr;
+				if (transfo & 4) ti = n - 1 - ti;
+
+				out[(c * n * n) + (tr * n) + ti] = key[(c * n * n) + (r * n) + i];
+				}
+			}
+		}
+
+	return out;
+}
+
+gint ImageSimilarityIndex::key_distance(const Key &a, const Key &b)
+{
+	gint d = 0;
+
+	for (gsize i = 0; i < a.size(); i++)
+		{
+		d += abs(a[i] - b[i]);
+		}
+
+	return d;
+}
+
+/**
+ * @brief Adds an image to the index
+ * @param sd May be NULL or not filled, such images are always returned as candidates
+ * @param data
+ * @returns The position of the image, in order of addition
+ */
+gint ImageSimilarityIndex::add(const ImageSimilarityData *sd, gpointer data)
+{
+	const gint position = size();
+
+	if (image_sim_filled(sd))
+		{
+		items.push_back({key_new(sd), TRUE, data});
+		order.push_back(position);
+		}
+	else
+		{
+		items.push_back({{}, FALSE, data});
+		unfilled.push_back(position);
+		}
+
+	return position;
+}
+
+void ImageSimilarityIndex::build()
+{
+	nodes.clear();
+	root = order.empty() ? -1 : build_node(0, order.size());
+}
+
+gint ImageSimilarityIndex::build_node(gint begin, gint end)
+{
+	const gint index = nodes.size();
+
+	nodes.push_back({-1, 0, -1, -1, begin, end});
+	if (end - begin <= SIM_INDEX_LEAF_SIZE) return index;
+
+	/* The first item is the vantage point, the rest is split at the median distance */
+	const Key &vantage = items[order[begin]].key;
+	std::vector<std::pair<gint, gint>> dist;
+
+	dist.reserve(end - begin - 1);
+	for (gint i = begin + 1; i < end; i++)
+		{
+		dist.emplace_back(key_distance(vantage, items[order[i]].key), order[i]);
+		}
+
+	const gsize median = dist.size() / 2;
+	std::nth_element(dist.begin(), dist.begin() + median, dist.end());
+
+	for (gsize i = 0; i < dist.size(); i++)
+		{
+		order[begin + 1 + i] = dist[i].second;
+		}
+
+	const gint split = begin + 1 + median;
+	const gint inside = build_node(begin + 1, split);
+	const gint outside = build_node(split, end);
+
+	Node &node = nodes[index];
+	node.vantage = order[begin];
+	node.radius = dist[median].first;
+	node.inside = inside;
+	node.outside = outside;
+
+	return index;
+}
+
+void ImageSimilarityIndex::search(gint node_index, const Key &key, gint radius, std::vector<gint> &found) const
+{
+	const Node &node = nodes[node_index];
+
+	if (node.vantage < 0)
+		{
+		for (gint i = node.begin; i < node.end; i++)
+			{
+			if (key_distance(key, items[order[i]].key) <= radius) found.push_back(order[i]);
+			}
+		return;
+		}
+
+	const gint d = key_distance(key, items[node.vantage].key);
+
+	if (d <= radius) found.push_back(node.vantage);
+
+	/* Triangle inequality: the inside items are at least d - node.radius away,
+	 * the outside items at least node.radius - d.
+	 */
+	if (d - radius < node.radius) search(node.inside, key, radius, found);
+	if (d + radius >= node.radius) search(node.outside, key, radius, found);
+}
+
+/**
+ * @brief Returns the positions of images which may be at least \a min similar to \a sd
+ * @param sd
+ * @param min The threshold as passed to image_sim_compare_fast()
+ * @param max_position Only positions up to and including this are returned
+ * @returns Positions in ascending order
+ *
+ * The result always includes every image that image_sim_compare_fast() would
+ * match, it may include others.
+ */
+std::vector<gint> ImageSimilarityIndex::candidates(const ImageSimilarityData *sd, gdouble min, gint max_position) const
+{
+	std::vector<gint> found;
+
+	if (!image_sim_filled(sd) || min <= 0.0)
+		{
+		for (gint i = 0; i <= max_position && i < size(); i++)
+			{
+			found.push_back(i);
+			}
+		return found;
+		}
+
+	/* The same normalisation as the abort check of the matching compare function,
+	 * rounded up so that the pruning never drops a match.
+	 */
+	const gboolean alternate = options->alternate_similarity_algorithm.enabled;
+	const gdouble max_diff = alternate ? 255.0 * 1024.0 * 4.0 : SIM_MAX_DIFF;
+	const gint radius = static_cast<gint>(std::min((1.0 - min) * max_diff, max_diff)) + 1;
+	const gint transfo_count = (options->rot_invariant_sim && !alternate) ? 8 : 1;
+	const Key key = key_new(sd);
+
+	if (root >= 0)
+		{
+		for (gint t = 0; t < transfo_count; t++)
+			{
+			search(root, key_transform(key, t), radius, found);
+			}
+		}
+
+	found.insert(found.end(), unfilled.begin(), unfilled.end());
+	found.erase(std::remove_if(found.begin(), found.end(), [max_position](gint i){ return i > max_position; }), found.end());
+
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	return found;
+}
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -23,6 +23,7 @@
 #define SIMILAR_H
 
 #include <array>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib.h>
@@ -51,6 +52,59 @@ gboolean image_sim_filled(const ImageSimilarityData *sd);
 void image_sim_alternate_set(gboolean enable);
 void image_sim_alternate_processing(ImageSimilarityData *sd);
 
+/**
+ * @brief Candidate pruning for image_sim_compare_fast()
+ *
+ * Each image is reduced to the sums of its 4 x 4 blocks of 8 x 8 cells. The L1
+ * distance between two block sum keys is a lower bound of the difference computed
+ * by image_sim_compare_fast(), so images whose keys are too far apart can never
+ * reach the threshold and are not returned. Keys are held in a vantage-point tree
+ * so that a query does not visit every image.
+ */
+class ImageSimilarityIndex
+{
+public:
+	gint add(const ImageSimilarityData *sd, gpointer data);
+	void build();
+
+	std::vector<gint> candidates(const ImageSimilarityData *sd, gdouble min, gint max_position) const;
+	gpointer data(gint position) const { return items[position].data; }
+	gint size() const { return static_cast<gint>(items.size()); }
+
+private:
+	using Key = std::array<gint, 4 * 4 * 3>;
+
+	struct Item
+	{
+		Key key;
+		gboolean filled;
+		gpointer data;
+	};
+
+	struct Node
+	{
+		gint vantage;	/**< position of the vantage point, -1 for a leaf */
+		gint radius;	/**< median distance from the vantage point */
+		gint inside;	/**< node index of items closer than radius */
+		gint outside;	/**< node index of the other items */
+		gint begin;	/**< leaf items, range of order */
+		gint end;
+	};
+
+	static Key key_new(const ImageSimilarityData *sd);
+	static Key key_transform(const Key &key, gint transfo);
+	static gint key_distance(const Key &a, const Key &b);
+
+	gint build_node(gint begin, gint end);
+	void search(gint node, const Key &key, gint radius, std::vector<gint> &found) const;
+
+	std::vector<Item> items;
+	std::vector<gint> order;	/**< positions of filled items, in tree order */
+	std::vector<gint> unfilled;	/**< positions of items without similarity data */
+	std::vector<Node> nodes;
+	gint root = -1;
+};
+
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -22,6 +22,7 @@
 #include "slideshow.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <numeric>
 #include <random>
 
@@ -175,31 +176,35 @@ static gboolean slideshow_step(SlideShow *ss, gboolean forward)
 	/* read ahead */
 	if (options->image.enable_read_ahead && (!ss->lw || ss->from_selection))
 		{
-		gint r;
-		if (forward)
-			{
-			r = ss->list.front();
-			}
-		else
-			{
-			if (ss->list_done.size() <= 1) return TRUE;
-			r = ss->list_done[1];
-			}
+		/* ahead are the next in list when going forward, list_done[0] is the current image */
+		const auto get_fd = [ss, forward](gint step) -> FileData *
+		{
+			const std::deque<gint> &from = ((step > 0) == forward) ? ss->list : ss->list_done;
+			const gsize n = ((step > 0) == forward) ? std::abs(step) - 1 : std::abs(step);
+			if (n >= from.size()) return nullptr;
 
-		if (ss->filelist)
-			{
-			image_prebuffer_set(ss->imd, static_cast<FileData *>(g_list_nth_data(ss->filelist, r)));
-			}
-		else if (ss->cd)
-			{
-			CollectInfo *info;
-			info = static_cast<CollectInfo *>(g_list_nth_data(ss->cd->list, r));
-			if (info) image_prebuffer_set(ss->imd, info->fd);
-			}
-		else if (ss->from_selection)
-			{
-			image_prebuffer_set(ss->lw->image, layout_list_get_fd(ss->lw, r));
-			}
+			const gint r = from[n];
+
+			if (ss->filelist)
+				{
+				return static_cast<FileData *>(g_list_nth_data(ss->filelist, r));
+				}
+
+			if (ss->cd)
+				{
+				auto info = static_cast<CollectInfo *>(g_list_nth_data(ss->cd->list, r));
+				return info ? info->fd : nullptr;
+				}
+
+			if (ss->from_selection)
+				{
+				return layout_list_get_fd(ss->lw, r);
+				}
+
+			return nullptr;
+		};
+
+		image_prebuffer_set_window((ss->filelist || ss->cd || !ss->lw) ? ss->imd : ss->lw->image, get_fd);
 		}
 
 	return TRUE;
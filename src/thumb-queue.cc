@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "thumb-queue.h"
+
+#include <glib-object.h>
+
+#include <config.h>
+
+#include "debug.h"
+#include "filedata.h"
+#include "misc.h"
+#include "options.h"
+#include "thumb.h"
+
+namespace
+{
+
+constexpr guint THUMB_QUEUE_FLUSH_INTERVAL = 16; /**< ms, about one frame */
+
+struct ThumbQueueSlot
+{
+	ThumbQueue *tq;
+	ThumbLoader *tl;
+	gpointer item;
+	FileData *fd;
+};
+
+void thumb_queue_slot_free(ThumbQueueSlot *slot)
+{
+	thumb_loader_free(slot->tl);
+	file_data_unref(slot->fd);
+	g_free(slot);
+}
+
+void thumb_queue_result_free(ThumbQueueResult *result)
+{
+	if (result->pixbuf) g_object_unref(result->pixbuf);
+	file_data_unref(result->fd);
+	g_free(result);
+}
+
+gboolean thumb_queue_flush_cb(gpointer data);
+
+void thumb_queue_schedule_flush(ThumbQueue *tq)
+{
+	if (!tq->flush_id) tq->flush_id = g_timeout_add(THUMB_QUEUE_FLUSH_INTERVAL, thumb_queue_flush_cb, tq);
+}
+
+/**
+ * @brief Moves a loader that has finished (or failed to start) to the results
+ *
+ * The loader itself is not freed here, as this is usually called from
+ * within one of its own callbacks.
+ */
+void thumb_queue_slot_complete(ThumbQueueSlot *slot)
+{
+	ThumbQueue *tq = slot->tq;
+	ThumbQueueResult *result;
+
+	result = g_new0(ThumbQueueResult, 1);
+	result->item = slot->item;
+	result->fd = slot->fd;
+	result->pixbuf = thumb_loader_get_pixbuf(slot->tl);
+	slot->fd = nullptr;
+
+	tq->results = g_list_prepend(tq->results, result);
+
+	tq->loaders = g_list_remove(tq->loaders, slot);
+	tq->finished = g_list_prepend(tq->finished, slot);
+
+	thumb_queue_schedule_flush(tq);
+}
+
+void thumb_queue_fill(ThumbQueue *tq);
+
+void thumb_queue_slot_done_cb(ThumbLoader *, gpointer data)
+{
+	auto slot = static_cast<ThumbQueueSlot *>(data);
+	ThumbQueue *tq = slot->tq;
+
+	thumb_queue_slot_complete(slot);
+	thumb_queue_fill(tq);
+}
+
+/**
+ * @brief Starts loaders until all slots are busy or the owner has no more work
+ */
+void thumb_queue_fill(ThumbQueue *tq)
+{
+	/* a loader may finish from within thumb_loader_start() */
+	if (tq->filling) return;
+	tq->filling = TRUE;
+
+	while (static_cast<gint>(g_list_length(tq->loaders)) < tq->max_loaders)
+		{
+		FileData *fd = nullptr;
+		gpointer item;
+		ThumbQueueSlot *slot;
+
+		item = tq->func_next(&fd, tq->data);
+		if (!item || !fd) break;
+
+		if (g_hash_table_contains(tq->pending, item))
+			{
+			/* the owner did not skip a pending item, avoid spinning on it */
+			DEBUG_1("thumb queue: %s is already pending", fd->path);
+			break;
+			}
+
+		g_hash_table_add(tq->pending, item);
+
+		slot = g_new0(ThumbQueueSlot, 1);
+		slot->tq = tq;
+		slot->item = item;
+		slot->fd = file_data_ref(fd);
+		slot->tl = thumb_loader_new(tq->max_w, tq->max_h);
+		thumb_loader_set_callbacks(slot->tl,
+					   thumb_queue_slot_done_cb,
+					   thumb_queue_slot_done_cb,
+					   nullptr,
+					   slot);
+
+		tq->loaders = g_list_prepend(tq->loaders, slot);
+
+		if (!thumb_loader_start(slot->tl, fd))
+			{
+			/* the fallback icon is set, continue */
+			DEBUG_1("thumb loader start failed %s", fd->path);
+			thumb_queue_slot_complete(slot);
+			}
+		}
+
+	tq->filling = FALSE;
+}
+
+gboolean thumb_queue_flush_cb(gpointer data)
+{
+	auto tq = static_cast<ThumbQueue *>(data);
+	GList *results;
+
+	tq->flush_id = 0;
+
+	g_list_free_full(tq->finished, reinterpret_cast<GDestroyNotify>(thumb_queue_slot_free));
+	tq->finished = nullptr;
+
+	results = g_list_reverse(tq->results);
+	tq->results = nullptr;
+
+	for (GList *work = results; work; work = work->next)
+		{
+		auto result = static_cast<ThumbQueueResult *>(work->data);
+		g_hash_table_remove(tq->pending, result->item);
+		}
+
+	DEBUG_1("thumb queue: %u delivered, %u in flight", g_list_length(results), g_list_length(tq->loaders));
+
+	if (results && tq->func_done) tq->func_done(results, tq->data);
+	g_list_free_full(results, reinterpret_cast<GDestroyNotify>(thumb_queue_result_free));
+
+	thumb_queue_fill(tq);
+
+	if (!tq->loaders && !tq->results)
+		{
+		/* the owner may free the queue, do not touch it afterwards */
+		if (tq->func_finish) tq->func_finish(tq->data);
+		}
+
+	return G_SOURCE_REMOVE;
+}
+
+} // namespace
+
+/**
+ * @brief Creates a thumbnail queue
+ * @param max_w Thumbnail width
+ * @param max_h Thumbnail height
+ * @param func_next Returns the next item to load and its FileData, or nullptr when done
+ * @param func_done Receives a batch of ThumbQueueResult
+ * @param func_finish Called when all work is done
+ * @param data Passed to the callbacks
+ *
+ * The number of loaders in flight is set by options->threads.thumbnails.
+ */
+ThumbQueue *thumb_queue_new(gint max_w, gint max_h,
+			    ThumbQueue::NextFunc func_next,
+			    ThumbQueue::DoneFunc func_done,
+			    ThumbQueue::FinishFunc func_finish,
+			    gpointer data)
+{
+	ThumbQueue *tq;
+
+	tq = g_new0(ThumbQueue, 1);
+
+	tq->max_w = max_w;
+	tq->max_h = max_h;
+	tq->max_loaders = options->threads.thumbnails > 0 ? options->threads.thumbnails : get_cpu_cores();
+	tq->pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	tq->func_next = func_next;
+	tq->func_done = func_done;
+	tq->func_finish = func_finish;
+	tq->data = data;
+
+	return tq;
+}
+
+void thumb_queue_free(ThumbQueue *tq)
+{
+	if (!tq) return;
+
+	g_clear_handle_id(&tq->flush_id, g_source_remove);
+
+	g_list_free_full(tq->loaders, reinterpret_cast<GDestroyNotify>(thumb_queue_slot_free));
+	g_list_free_full(tq->finished, reinterpret_cast<GDestroyNotify>(thumb_queue_slot_free));
+	g_list_free_full(tq->results, reinterpret_cast<GDestroyNotify>(thumb_queue_result_free));
+	g_hash_table_destroy(tq->pending);
+
+	g_free(tq);
+}
+
+/**
+ * @brief Starts as many loaders as allowed
+ *
+ * Can be called again at any time, for example when the list or the
+ * visible area has changed.
+ */
+void thumb_queue_start(ThumbQueue *tq)
+{
+	if (!tq) return;
+
+	thumb_queue_fill(tq);
+
+	/* nothing to do, report it from the main loop as usual */
+	if (!tq->loaders) thumb_queue_schedule_flush(tq);
+}
+
+/**
+ * @brief Drops an item that is in flight or not yet delivered
+ *
+ * For items that are about to be freed by the owner, the slot is refilled
+ * from the main loop.
+ */
+void thumb_queue_cancel_item(ThumbQueue *tq, gconstpointer item)
+{
+	GList *work;
+
+	if (!tq || !g_hash_table_contains(tq->pending, item)) return;
+
+	work = tq->loaders;
+	while (work)
+		{
+		auto slot = static_cast<ThumbQueueSlot *>(work->data);
+		work = work->next;
+
+		if (slot->item != item) continue;
+
+		tq->loaders = g_list_remove(tq->loaders, slot);
+		thumb_queue_slot_free(slot);
+		}
+
+	work = tq->results;
+	while (work)
+		{
+		auto result = static_cast<ThumbQueueResult *>(work->data);
+		work = work->next;
+
+		if (result->item != item) continue;
+
+		tq->results = g_list_remove(tq->results, result);
+		thumb_queue_result_free(result);
+		}
+
+	g_hash_table_remove(tq->pending, item);
+
+	thumb_queue_schedule_flush(tq);
+}
+
+gboolean thumb_queue_is_pending(ThumbQueue *tq, gconstpointer item)
+{
+	return tq && g_hash_table_contains(tq->pending, item);
+}
+
+gboolean thumb_queue_is_running(ThumbQueue *tq)
+{
+	return tq && (tq->loaders || tq->results || tq->flush_id);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
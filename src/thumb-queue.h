@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef THUMB_QUEUE_H
+#define THUMB_QUEUE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+class FileData;
+struct ThumbQueue;
+
+/**
+ * @brief A finished thumbnail, as handed to ThumbQueue::DoneFunc
+ */
+struct ThumbQueueResult
+{
+	gpointer item;          /**< the item returned by ThumbQueue::NextFunc */
+	FileData *fd;
+	GdkPixbuf *pixbuf;      /**< thumbnail or fallback icon, owned by the queue */
+};
+
+/**
+ * @brief Keeps several thumbnail loaders busy for a list of items
+ *
+ * The owner supplies the work one item at a time through a NextFunc, which
+ * should return the most urgent item first (usually the visible rows) and
+ * must skip items for which thumb_queue_is_pending() is TRUE.
+ * Finished thumbnails are collected and handed over in one DoneFunc call
+ * per frame, so the owner updates its view once per batch instead of once
+ * per thumbnail. FinishFunc is called once nothing is left to do, it may
+ * free the queue.
+ */
+struct ThumbQueue
+{
+	using NextFunc = gpointer (*)(FileData **fd, gpointer data);
+	using DoneFunc = void (*)(GList *results, gpointer data);
+	using FinishFunc = void (*)(gpointer data);
+
+	gint max_w;
+	gint max_h;
+	gint max_loaders;
+
+	GList *loaders;         /**< ThumbQueueSlot of the loaders in flight */
+	GList *finished;        /**< ThumbQueueSlot of the loaders waiting to be freed */
+	GList *results;         /**< ThumbQueueResult not delivered yet, newest first */
+	GHashTable *pending;    /**< items in flight or not delivered yet */
+	gboolean filling;
+
+	NextFunc func_next;
+	DoneFunc func_done;
+	FinishFunc func_finish;
+	gpointer data;
+
+	guint flush_id; /**< event source id */
+};
+
+ThumbQueue *thumb_queue_new(gint max_w, gint max_h,
+			    ThumbQueue::NextFunc func_next,
+			    ThumbQueue::DoneFunc func_done,
+			    ThumbQueue::FinishFunc func_finish,
+			    gpointer data);
+void thumb_queue_free(ThumbQueue *tq);
+
+void thumb_queue_start(ThumbQueue *tq);
+void thumb_queue_cancel_item(ThumbQueue *tq, gconstpointer item);
+
+gboolean thumb_queue_is_pending(ThumbQueue *tq, gconstpointer item);
+gboolean thumb_queue_is_running(ThumbQueue *tq);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TILE_INDEX_H
+#define TILE_INDEX_H
+
+#include <unordered_map>
+
+#include <glib.h>
+
+/**
+ * @brief Tiles keyed by their grid position, kept in most recently used order
+ *
+ * The tiles are owned by the caller. T must provide gint x and y (the
+ * position of the tile, aligned to the tile size) and T *lru_prev and
+ * T *lru_next, which link the tiles from the most recently used (first())
+ * to the least recently used (last()).
+ * Lookup, insertion, use and removal are O(1).
+ */
+template<typename T>
+class TileIndex
+{
+public:
+	T *find(gint x, gint y) const
+	{
+		auto it = index.find(key(x, y));
+		return it != index.end() ? it->second : nullptr;
+	}
+
+	/** @brief Adds a tile as the most recently used one, its position must be unique */
+	void insert(T *tile)
+	{
+		index[key(tile->x, tile->y)] = tile;
+		link_front(tile);
+	}
+
+	void remove(T *tile)
+	{
+		index.erase(key(tile->x, tile->y));
+		unlink(tile);
+	}
+
+	/** @brief Marks a tile as the most recently used one */
+	void touch(T *tile)
+	{
+		if (tile == head) return;
+
+		unlink(tile);
+		link_front(tile);
+	}
+
+	/** @brief Forgets all tiles, they must have been freed by the caller */
+	void clear()
+	{
+		index.clear();
+		head = nullptr;
+		tail = nullptr;
+	}
+
+	T *first() const { return head; }
+	T *last() const { return tail; }
+	guint size() const { return index.size(); }
+
+private:
+	static guint64 key(gint x, gint y)
+	{
+		return (static_cast<guint64>(static_cast<guint32>(x)) << 32) | static_cast<guint32>(y);
+	}
+
+	void link_front(T *tile)
+	{
+		tile->lru_prev = nullptr;
+		tile->lru_next = head;
+		if (head) head->lru_prev = tile;
+		head = tile;
+		if (!tail) tail = tile;
+	}
+
+	void unlink(T *tile)
+	{
+		if (tile->lru_prev) tile->lru_prev->lru_next = tile->lru_next;
+		else head = tile->lru_next;
+
+		if (tile->lru_next) tile->lru_next->lru_prev = tile->lru_prev;
+		else tail = tile->lru_prev;
+
+		tile->lru_prev = nullptr;
+		tile->lru_next = nullptr;
+	}
+
+	std::unordered_map<guint64, T *> index;
+	T *head = nullptr;
+	T *tail = nullptr;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -833,6 +833,19 @@ gchar *md5_text_from_file_utf8(const gchar *path, const gchar *error_text)
 	return md5_text ? md5_text : g_strdup(error_text);
 }
 
+/**
+ * @brief Generate md5 string from the start and end of a file,
+ * on failure returns newly allocated copy of error_text, error_text may be NULL
+ */
+gchar *md5_sample_text_from_file_utf8(const gchar *path, gsize sample_size, const gchar *error_text)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	auto md5_text = md5_get_sample_string_from_file(pathl, sample_size);
+
+	return md5_text ? md5_text : g_strdup(error_text);
+}
+
 /* Download web file
  */
 struct WebData
@@ -987,6 +1000,19 @@ guchar *map_file(const gchar *path, gsize &map_len)
 	return map_data;
 }
 
+/**
+ * @brief Whether the file lives on a network filesystem, where reading it can be slow
+ * @param path In the local file system encoding
+ */
+gboolean is_remote_file(const gchar *path)
+{
+	g_autoptr(GFile) file = g_file_new_for_path(path);
+	g_autoptr(GFileInfo) info = g_file_query_filesystem_info(file, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, nullptr, nullptr);
+	if (!info) return FALSE;
+
+	return g_file_info_get_attribute_boolean(info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+}
+
 /**
  * @brief Get list of file extensions supported by gdk_pixbuf_loader
  * @returns List of gchar
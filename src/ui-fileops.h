@@ -101,12 +101,14 @@ gboolean file_in_path(const gchar *name);
 gboolean recursive_mkdir_if_not_exists(const gchar *path, mode_t mode);
 
 gchar *md5_text_from_file_utf8(const gchar *path, const gchar *error_text);
+gchar *md5_sample_text_from_file_utf8(const gchar *path, gsize sample_size, const gchar *error_text);
 gboolean md5_get_digest_from_file_utf8(const gchar *path, Md5Digest &digest);
 
 gchar *download_web_file(const gchar *text, gboolean minimized, gpointer data);
 gboolean rmdir_recursive(GFile *file, GCancellable *cancellable, GError **error);
 
 guchar *map_file(const gchar *path, gsize &map_len);
+gboolean is_remote_file(const gchar *path);
 
 GList *pixbuf_gdk_known_extensions();
 
@@ -23,6 +23,7 @@
 
 #include <ctime>
 #include <functional>
+#include <vector>
 
 #include <glib.h>
 #include <gtk/gtk.h>
@@ -31,7 +32,26 @@
 #include "main-defines.h"
 
 struct LayoutWindow;
-struct ThumbLoader;
+struct ThumbQueue;
+struct ViewFileMetadataRead;
+
+enum ViewFileEditType : guint {
+	VF_EDIT_REMOVE, /**< the row of @a fd at @a index is removed */
+	VF_EDIT_INSERT, /**< a row of @a fd is inserted at @a index */
+	VF_EDIT_UPDATE  /**< the row of @a fd at @a index is set again */
+};
+
+/**
+ * @brief One step of an incremental update, see vf_notify_cb()
+ *
+ * The index refers to vf->list as left by the previous edits.
+ */
+struct ViewFileEdit
+{
+	ViewFileEditType type;
+	gint index;
+	FileData *fd;
+};
 
 enum FileViewType : guint {
 	FILEVIEW_LIST,
@@ -80,8 +100,7 @@ struct ViewFile
 
 	/* thumbs updates*/
 	gboolean thumbs_running;
-	ThumbLoader *thumbs_loader;
-	FileData *thumbs_filedata;
+	ThumbQueue *thumbs_queue;
 
 	/* marks */
 	gboolean marks_enabled;
@@ -96,9 +115,16 @@ struct ViewFile
 	guint refresh_idle_id; /**< event source id */
 	time_t time_refresh_set; /**< time when refresh_idle_id was set */
 
+	/* incremental updates */
+	GHashTable *update_pending; /**< FileData changed since the last update, with a reference */
+	gboolean update_read_dir; /**< files may have been added to or removed from the folder */
+	guint update_idle_id; /**< event source id */
+	time_t time_update_set; /**< time when update_idle_id was set */
+
 	GList *editmenu_fd_list; /**< file list for edit menu */
 
 	guint read_metadata_in_idle_id;
+	ViewFileMetadataRead *read_metadata; /**< dates and ratings being read in the background */
 
 	using SelectionCallback = std::function<void(FileData *)>;
 };
@@ -155,6 +181,7 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data);
 void vf_thumb_update(ViewFile *vf);
 void vf_thumb_cleanup(ViewFile *vf);
 void vf_thumb_stop(ViewFile *vf);
+gboolean vf_thumb_is_needed(ViewFile *vf, FileData *fd);
 void vf_read_metadata_in_idle(ViewFile *vf);
 void vf_file_filter_set(ViewFile *vf, gboolean enable);
 GRegex *vf_file_filter_get_filter(ViewFile *vf);
@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <unordered_set>
 #include <utility>
 
 #include <glib-object.h>
@@ -1357,15 +1358,76 @@ static GList *vficon_add_row(ViewFile *vf, GtkTreeIter *iter)
 	return list;
 }
 
-static void vficon_populate(ViewFile *vf, gboolean resize, gboolean keep_position)
+/**
+ * @brief Sets the rows from @a start_row on to the files of vf->list, adding and removing rows as needed
+ */
+static void vficon_populate_rows(ViewFile *vf, gint start_row)
 {
 	GtkTreeModel *store;
 	GList *work;
-	FileData *visible_fd = nullptr;
 	gint r;
 	gboolean valid;
 	GtkTreeIter iter;
 
+	store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
+
+	r = start_row - 1;
+
+	valid = gtk_tree_model_iter_nth_child(store, &iter, nullptr, start_row);
+
+	work = g_list_nth(vf->list, start_row * VFICON(vf)->columns);
+	while (work)
+		{
+		GList *list;
+		r++;
+		if (valid)
+			{
+			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+			gtk_list_store_set(GTK_LIST_STORE(store), &iter, FILE_COLUMN_POINTER, list, -1);
+			}
+		else
+			{
+			list = vficon_add_row(vf, &iter);
+			}
+
+		while (list)
+			{
+			FileData *fd;
+
+			if (work)
+				{
+				fd = static_cast<FileData *>(work->data);
+				work = work->next;
+				}
+			else
+				{
+				fd = nullptr;
+				}
+
+			list->data = fd;
+			list = list->next;
+			}
+		if (valid) valid = gtk_tree_model_iter_next(store, &iter);
+		}
+
+	r++;
+	while (valid)
+		{
+		GList *list;
+
+		gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+		valid = gtk_list_store_remove(GTK_LIST_STORE(store), &iter);
+		g_list_free(list);
+		}
+
+	VFICON(vf)->rows = r;
+}
+
+static void vficon_populate(ViewFile *vf, gboolean resize, gboolean keep_position)
+{
+	GtkTreeModel *store;
+	FileData *visible_fd = nullptr;
+
 	vficon_verify_selections(vf);
 
 	store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
@@ -1421,56 +1483,7 @@ static void vficon_populate(ViewFile *vf, gboolean resize, gboolean keep_positio
 		if (gtk_widget_get_realized(vf->listview)) gtk_tree_view_columns_autosize(GTK_TREE_VIEW(vf->listview));
 		}
 
-	r = -1;
-
-	valid = gtk_tree_model_iter_children(store, &iter, nullptr);
-
-	work = vf->list;
-	while (work)
-		{
-		GList *list;
-		r++;
-		if (valid)
-			{
-			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter, FILE_COLUMN_POINTER, list, -1);
-			}
-		else
-			{
-			list = vficon_add_row(vf, &iter);
-			}
-
-		while (list)
-			{
-			FileData *fd;
-
-			if (work)
-				{
-				fd = static_cast<FileData *>(work->data);
-				work = work->next;
-				}
-			else
-				{
-				fd = nullptr;
-				}
-
-			list->data = fd;
-			list = list->next;
-			}
-		if (valid) valid = gtk_tree_model_iter_next(store, &iter);
-		}
-
-	r++;
-	while (valid)
-		{
-		GList *list;
-
-		gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
-		valid = gtk_list_store_remove(GTK_LIST_STORE(store), &iter);
-		g_list_free(list);
-		}
-
-	VFICON(vf)->rows = r;
+	vficon_populate_rows(vf, 0);
 
 	if (g_autoptr(GtkTreePath) tpath = nullptr;
 	    visible_fd &&
@@ -1555,17 +1568,6 @@ void vficon_thumb_progress_count(const GList *list, gint &count, gint &done)
 		}
 }
 
-void vficon_read_metadata_progress_count(const GList *list, gint &count, gint &done)
-{
-	for (const GList *work = list; work; work = work->next)
-		{
-		auto fd = static_cast<FileData *>(work->data);
-
-		if (fd->metadata_in_idle_loaded) done++;
-		count++;
-		}
-}
-
 void vficon_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeModel *store;
@@ -1604,7 +1606,7 @@ FileData *vficon_thumb_next_fd(ViewFile *vf)
 			for (; list; list = list->next)
 				{
 				auto fd = static_cast<FileData *>(list->data);
-				if (fd && !fd->thumb_pixbuf) return fd;
+				if (fd && vf_thumb_is_needed(vf, fd)) return fd;
 				}
 
 			valid = gtk_tree_model_iter_next(store, &iter);
@@ -1619,7 +1621,7 @@ FileData *vficon_thumb_next_fd(ViewFile *vf)
 
 		// Note: This implementation differs from view-file-list.cc because sidecar files are not
 		// distinct list elements here, as they are in the list view.
-		if (!fd->thumb_pixbuf) return fd;
+		if (vf_thumb_is_needed(vf, fd)) return fd;
 		}
 
 	return nullptr;
@@ -1872,6 +1874,58 @@ gboolean vficon_refresh(ViewFile *vf)
 	return vficon_refresh_real(vf, TRUE);
 }
 
+/**
+ * @brief Applies the edits of vf->list to the rows from the first changed one on
+ *
+ * Moved files keep their selection.
+ */
+void vficon_update(ViewFile *vf, const std::vector<ViewFileEdit> &edits)
+{
+	std::unordered_set<FileData *> removed;
+	std::unordered_set<FileData *> inserted;
+	gint first = G_MAXINT;
+
+	for (const ViewFileEdit &edit : edits)
+		{
+		if (edit.type == VF_EDIT_REMOVE) removed.insert(edit.fd);
+		if (edit.type == VF_EDIT_INSERT) inserted.insert(edit.fd);
+		first = std::min(first, edit.index);
+		}
+
+	FileData *first_selected = nullptr;
+	for (FileData *fd : removed)
+		{
+		if (inserted.count(fd)) continue;
+
+		GList *link = g_list_find(VFICON(vf)->selection, fd);
+		if (link)
+			{
+			if (!first_selected) first_selected = fd;
+			VFICON(vf)->selection = g_list_delete_link(VFICON(vf)->selection, link);
+			}
+		if (fd == VFICON(vf)->prev_selection) VFICON(vf)->prev_selection = nullptr;
+		}
+	for (FileData *fd : inserted)
+		{
+		if (!removed.count(fd)) fd->selected = SELECTION_NONE;
+		}
+
+	vf_thumb_stop(vf);
+	vf_star_stop(vf);
+
+	vficon_populate_rows(vf, first / VFICON(vf)->columns);
+
+	if (first_selected && !VFICON(vf)->selection)
+		{
+		/* all selected files disappeared */
+		vficon_select_closest(vf, first_selected);
+		}
+
+	vf_send_update(vf);
+	vf_thumb_update(vf);
+	vf_star_update(vf);
+}
+
 /*
  *-----------------------------------------------------------------------------
  * draw, etc.
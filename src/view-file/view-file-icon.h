@@ -68,6 +68,7 @@ ViewFile *vficon_new(ViewFile *vf);
 
 gboolean vficon_set_fd(ViewFile *vf, FileData *dir_fd);
 gboolean vficon_refresh(ViewFile *vf);
+void vficon_update(ViewFile *vf, const std::vector<ViewFileEdit> &edits);
 
 
 void vficon_marks_set(ViewFile *vf, gboolean enable);
@@ -99,7 +100,6 @@ void vficon_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 
 
 void vficon_thumb_progress_count(const GList *list, gint &count, gint &done);
-void vficon_read_metadata_progress_count(const GList *list, gint &count, gint &done);
 void vficon_set_thumb_fd(ViewFile *vf, FileData *fd);
 FileData *vficon_thumb_next_fd(ViewFile *vf);
 
@@ -21,6 +21,7 @@
 
 #include "view-file-list.h"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -967,22 +968,6 @@ void vflist_thumb_progress_count(const GList *list, gint &count, gint &done)
 		}
 }
 
-void vflist_read_metadata_progress_count(const GList *list, gint &count, gint &done)
-{
-	for (const GList *work = list; work; work = work->next)
-		{
-		auto fd = static_cast<FileData *>(work->data);
-
-		if (fd->metadata_in_idle_loaded) done++;
-
-		if (fd->sidecar_files)
-			{
-			vflist_read_metadata_progress_count(fd->sidecar_files, count, done);
-			}
-		count++;
-		}
-}
-
 void vflist_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeStore *store;
@@ -1016,7 +1001,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 
 			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
 
-			if (!nfd->thumb_pixbuf) fd = nfd;
+			if (vf_thumb_is_needed(vf, nfd)) fd = nfd;
 
 			valid = gtk_tree_model_iter_next(store, &iter);
 			}
@@ -1030,7 +1015,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 		while (work && !fd)
 			{
 			auto fd_p = static_cast<FileData *>(work->data);
-			if (!fd_p->thumb_pixbuf)
+			if (vf_thumb_is_needed(vf, fd_p))
 				fd = fd_p;
 			else
 				{
@@ -1039,7 +1024,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 				while (work2 && !fd)
 					{
 					fd_p = static_cast<FileData *>(work2->data);
-					if (!fd_p->thumb_pixbuf) fd = fd_p;
+					if (vf_thumb_is_needed(vf, fd_p)) fd = fd_p;
 					work2 = work2->next;
 					}
 				}
@@ -1650,6 +1635,88 @@ gboolean vflist_refresh(ViewFile *vf)
 }
 
 
+static void vflist_row_remove(GtkTreeStore *store, GtkTreeIter *iter)
+{
+	GtkTreeIter child;
+	FileData *fd;
+	gboolean valid;
+
+	valid = gtk_tree_model_iter_children(GTK_TREE_MODEL(store), &child, iter);
+	while (valid)
+		{
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &child, FILE_COLUMN_POINTER, &fd, -1);
+		file_data_unref(fd);
+		valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store), &child);
+		}
+
+	gtk_tree_model_get(GTK_TREE_MODEL(store), iter, FILE_COLUMN_POINTER, &fd, -1);
+	file_data_unref(fd);
+
+	gtk_tree_store_remove(store, iter);
+}
+
+/**
+ * @brief Applies the edits of vf->list to the rows, instead of comparing all of them
+ *
+ * Moved files are removed and inserted again, and stay selected.
+ */
+void vflist_update(ViewFile *vf, const std::vector<ViewFileEdit> &edits)
+{
+	GtkTreeStore *store = GTK_TREE_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview)));
+	GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(vf->listview));
+	std::vector<FileData *> selected; /* removed while selected */
+	GtkTreeIter iter;
+
+	vf_thumb_stop(vf);
+	vf_star_stop(vf);
+
+	for (const ViewFileEdit &edit : edits)
+		{
+		switch (edit.type)
+			{
+			case VF_EDIT_REMOVE:
+				if (!gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(store), &iter, nullptr, edit.index)) break;
+
+				if (gtk_tree_selection_iter_is_selected(selection, &iter)) selected.push_back(edit.fd);
+				vflist_row_remove(store, &iter);
+				break;
+			case VF_EDIT_INSERT:
+				{
+				gtk_tree_store_insert(store, &iter, nullptr, edit.index);
+				vflist_setup_iter(vf, store, &iter, file_data_ref(edit.fd));
+				vflist_setup_iter_recursive(vf, store, &iter, edit.fd->sidecar_files, nullptr, TRUE);
+
+				if (vf->marks_enabled) file_data_lock(edit.fd);
+
+				auto it = std::find(selected.begin(), selected.end(), edit.fd);
+				if (it != selected.end())
+					{
+					gtk_tree_selection_select_iter(selection, &iter);
+					selected.erase(it);
+					}
+				break;
+				}
+			case VF_EDIT_UPDATE:
+				if (!gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(store), &iter, nullptr, edit.index)) break;
+
+				vflist_setup_iter(vf, store, &iter, edit.fd);
+				vflist_setup_iter_recursive(vf, store, &iter, edit.fd->sidecar_files, nullptr, TRUE);
+				break;
+			}
+		}
+
+	if (!selected.empty() && vflist_selection_count(vf) == 0)
+		{
+		/* all selected files disappeared */
+		vflist_select_closest(vf, selected.front());
+		}
+
+	vf_send_update(vf);
+	vf_thumb_update(vf);
+	vf_star_update(vf);
+}
+
+
 static GdkRGBA *vflist_listview_color_shifted(GtkWidget *widget)
 {
 #if HAVE_GTK4
@@ -20,12 +20,22 @@
 
 #include "view-file.h"
 
+#include <config.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <array>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <gdk/gdk.h>
 #include <glib-object.h>
 
 #include "archives.h"
+#include "cache.h"
 #include "collect.h"
 #include "compat.h"
 #include "dnd.h"
@@ -35,14 +45,16 @@
 #include "history-list.h"
 #include "img-view.h"
 #include "intl.h"
+#include "jpeg-parser.h"
 #include "layout.h"
 #include "main-defines.h"
 #include "main.h"
 #include "menu.h"
+#include "metadata-index.h"
 #include "metadata.h"
 #include "misc.h"
 #include "options.h"
-#include "thumb.h"
+#include "thumb-queue.h"
 #include "ui-fileops.h"
 #include "ui-menu.h"
 #include "ui-misc.h"
@@ -53,6 +65,34 @@
 #include "view-file/view-file-list.h"
 #include "window.h"
 
+enum {
+	VF_METADATA_READ_SIZE = 65536,     /**< bytes of a file parsed for the dates and the rating */
+	VF_METADATA_WAIT_INTERVAL = 20     /**< ms between checks while the workers are reading */
+};
+
+constexpr gint64 VF_METADATA_APPLY_TIME = 10000; /**< us of metadata storing per main loop iteration */
+constexpr gsize VF_UPDATE_MAX_EDITS = 256; /**< more changed files are shown by a full refresh */
+
+struct ViewFileMetadataItem
+{
+	FileData *fd;
+	gchar *path;             /**< locale path of fd, for the workers */
+	QuickMetadata metadata;
+	gboolean parsed;         /**< the quick read found everything */
+	gint done;               /**< set atomically by the worker */
+};
+
+struct ViewFileMetadataRead
+{
+	GThreadPool *pool;
+	std::vector<ViewFileMetadataItem> items;
+	guint cursor;            /**< next item to store */
+	gboolean waiting;        /**< polled with a timeout rather than in idle */
+};
+
+static void vf_read_metadata_stop(ViewFile *vf);
+static void vf_update_cancel(ViewFile *vf);
+
 /*
  *-----------------------------------------------------------------------------
  * signals
@@ -842,6 +882,8 @@ gboolean vf_refresh(ViewFile *vf)
 {
 	gboolean ret;
 
+	vf_update_cancel(vf);
+
 	switch (vf->type)
 	{
 	case FILEVIEW_LIST: ret = vflist_refresh(vf); break;
@@ -856,6 +898,8 @@ gboolean vf_set_fd(ViewFile *vf, FileData *dir_fd)
 {
 	gboolean ret;
 
+	vf_update_cancel(vf);
+
 	switch (vf->type)
 	{
 	case FILEVIEW_LIST: ret = vflist_set_fd(vf, dir_fd); break;
@@ -883,10 +927,9 @@ static void vf_destroy_cb(GtkWidget *, gpointer data)
 		gq_gtk_widget_destroy(vf->popup);
 		}
 
-	if (vf->read_metadata_in_idle_id)
-		{
-		g_idle_remove_by_data(vf);
-		}
+	vf_read_metadata_stop(vf);
+	vf_update_cancel(vf);
+	if (vf->update_pending) g_hash_table_destroy(vf->update_pending);
 	file_data_unref(vf->dir_fd);
 	g_free(vf->info);
 	g_free(vf);
@@ -1405,8 +1448,6 @@ void vf_thumb_set(ViewFile *vf, gboolean enable)
 }
 
 
-static gboolean vf_thumb_next(ViewFile *vf);
-
 static gdouble vf_thumb_progress(ViewFile *vf)
 {
 	gint count = 0;
@@ -1422,20 +1463,6 @@ static gdouble vf_thumb_progress(ViewFile *vf)
 	return static_cast<gdouble>(done) / count;
 }
 
-static gdouble vf_read_metadata_in_idle_progress(ViewFile *vf)
-{
-	gint count = 0;
-	gint done = 0;
-
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: vflist_read_metadata_progress_count(vf->list, count, done); break;
-	case FILEVIEW_ICON: vficon_read_metadata_progress_count(vf->list, count, done); break;
-	}
-
-	return static_cast<gdouble>(done) / count;
-}
-
 static void vf_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	switch (vf->type)
@@ -1453,12 +1480,12 @@ static void vf_thumb_status(ViewFile *vf, gdouble val, const gchar *text)
 		}
 }
 
-static void vf_thumb_do(ViewFile *vf, FileData *fd)
+/**
+ * @brief Returns TRUE if fd has no thumbnail and none is being generated
+ */
+gboolean vf_thumb_is_needed(ViewFile *vf, FileData *fd)
 {
-	if (!fd) return;
-
-	vf_set_thumb_fd(vf, fd);
-	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs…"));
+	return !fd->thumb_pixbuf && !thumb_queue_is_pending(vf->thumbs_queue, fd);
 }
 
 void vf_thumb_cleanup(ViewFile *vf)
@@ -1467,10 +1494,8 @@ void vf_thumb_cleanup(ViewFile *vf)
 
 	vf->thumbs_running = FALSE;
 
-	thumb_loader_free(vf->thumbs_loader);
-	vf->thumbs_loader = nullptr;
-
-	vf->thumbs_filedata = nullptr;
+	thumb_queue_free(vf->thumbs_queue);
+	vf->thumbs_queue = nullptr;
 }
 
 void vf_thumb_stop(ViewFile *vf)
@@ -1478,72 +1503,41 @@ void vf_thumb_stop(ViewFile *vf)
 	if (vf->thumbs_running) vf_thumb_cleanup(vf);
 }
 
-static void vf_thumb_common_cb(ThumbLoader *tl, gpointer data)
+static gpointer vf_thumb_next_cb(FileData **fd, gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
 
-	if (vf->thumbs_filedata && vf->thumbs_loader == tl)
-		{
-		vf_thumb_do(vf, vf->thumbs_filedata);
-		}
+	if (!gtk_widget_get_realized(vf->listview)) return nullptr;
 
-	while (vf_thumb_next(vf));
-}
-
-static void vf_thumb_error_cb(ThumbLoader *tl, gpointer data)
-{
-	vf_thumb_common_cb(tl, data);
-}
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: *fd = vflist_thumb_next_fd(vf); break;
+	case FILEVIEW_ICON: *fd = vficon_thumb_next_fd(vf); break;
+	}
 
-static void vf_thumb_done_cb(ThumbLoader *tl, gpointer data)
-{
-	vf_thumb_common_cb(tl, data);
+	return *fd;
 }
 
-static gboolean vf_thumb_next(ViewFile *vf)
+static void vf_thumb_done_cb(GList *results, gpointer data)
 {
-	FileData *fd = nullptr;
+	auto vf = static_cast<ViewFile *>(data);
 
-	if (!gtk_widget_get_realized(vf->listview))
+	for (GList *work = results; work; work = work->next)
 		{
-		vf_thumb_status(vf, 0.0, nullptr);
-		return FALSE;
-		}
+		auto result = static_cast<ThumbQueueResult *>(work->data);
 
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: fd = vflist_thumb_next_fd(vf); break;
-	case FILEVIEW_ICON: fd = vficon_thumb_next_fd(vf); break;
-	}
-
-	if (!fd)
-		{
-		/* done */
-		vf_thumb_cleanup(vf);
-		return FALSE;
+		vf_set_thumb_fd(vf, result->fd);
 		}
 
-	vf->thumbs_filedata = fd;
-
-	thumb_loader_free(vf->thumbs_loader);
-
-	vf->thumbs_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-	thumb_loader_set_callbacks(vf->thumbs_loader,
-				   vf_thumb_done_cb,
-				   vf_thumb_error_cb,
-				   nullptr,
-				   vf);
-
-	if (!thumb_loader_start(vf->thumbs_loader, fd))
-		{
-		/* set icon to unknown, continue */
-		DEBUG_1("thumb loader start failed %s", fd->path);
-		vf_thumb_do(vf, fd);
+	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs…"));
+}
 
-		return TRUE;
-		}
+static void vf_thumb_finish_cb(gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
 
-	return FALSE;
+	/* done */
+	vf_thumb_cleanup(vf);
 }
 
 static void vf_thumb_reset_all(ViewFile *vf)
@@ -1576,7 +1570,9 @@ void vf_thumb_update(ViewFile *vf)
 		thumb_format_changed = FALSE;
 		}
 
-	while (vf_thumb_next(vf));
+	vf->thumbs_queue = thumb_queue_new(options->thumbnails.max_width, options->thumbnails.max_height,
+					   vf_thumb_next_cb, vf_thumb_done_cb, vf_thumb_finish_cb, vf);
+	thumb_queue_start(vf->thumbs_queue);
 }
 
 void vf_star_cleanup(ViewFile *vf)
@@ -1787,6 +1783,334 @@ void vf_refresh_idle(ViewFile *vf)
 		}
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * incremental updates
+ *
+ * The files reported by notifications are collected and, once the main
+ * loop is idle, removed from or inserted into the sorted vf->list at the
+ * position found by a binary search. The views apply the same edits to
+ * their rows, so neither the whole list is sorted again nor all rows are
+ * compared. The folder is read again only when files may have been added
+ * or removed, and a full refresh is done for changes of the grouping or
+ * when too many files changed.
+ *-----------------------------------------------------------------------------
+ */
+
+static GList *vf_update_filter_list(ViewFile *vf, GList *list)
+{
+	list = file_data_filter_marks_list(list, vf_marks_get_filter(vf));
+
+	g_autoptr(GRegex) filter = vf_file_filter_get_filter(vf);
+	list = g_list_first(list);
+	list = file_data_filter_file_filter_list(list, filter);
+
+	list = g_list_first(list);
+	list = file_data_filter_class_list(list, vf_class_get_filter(vf));
+
+	list = g_list_first(list);
+	list = file_data_filter_rating_list(list, options->rating_filter);
+
+	return list;
+}
+
+/**
+ * @brief Checks that a file of the view is still in the folder and passes the filters
+ */
+static gboolean vf_update_keep(ViewFile *vf, FileData *fd)
+{
+	if (fd->parent || !isfile(fd->path)) return FALSE;
+
+	g_autofree gchar *base = remove_level_from_path(fd->path);
+	if (g_strcmp0(base, vf->dir_fd->path) != 0) return FALSE;
+
+	GList *list = vf_update_filter_list(vf, g_list_prepend(nullptr, file_data_ref(fd)));
+	const gboolean keep = (list != nullptr);
+	file_data_list_free(list);
+
+	return keep;
+}
+
+static void vf_update_cancel(ViewFile *vf)
+{
+	g_clear_handle_id(&vf->update_idle_id, g_source_remove);
+	vf->update_read_dir = FALSE;
+
+	if (!vf->update_pending) return;
+
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init(&iter, vf->update_pending);
+	while (g_hash_table_iter_next(&iter, &key, nullptr))
+		{
+		file_data_unref(static_cast<FileData *>(key));
+		}
+	g_hash_table_remove_all(vf->update_pending);
+}
+
+/**
+ * @brief Removes @a removed from vf->list, moves those of @a changed which
+ * are out of order and inserts @a added, then lets the view do the same
+ * @param vf
+ * @param removed Files of vf->list, their references are released
+ * @param added Files with a reference, which is taken by vf->list
+ * @param changed Files of vf->list whose rows have to be set again
+ */
+static void vf_update_edit(ViewFile *vf, const std::vector<FileData *> &removed, const std::vector<FileData *> &added, std::unordered_set<FileData *> &changed)
+{
+	auto compare = [vf](FileData *a, FileData *b)
+	{
+		return filelist_sort_compare_filedata(a, b, &vf->sort) < 0;
+	};
+
+	std::vector<FileData *> files;
+	for (GList *work = vf->list; work; work = work->next)
+		{
+		files.push_back(static_cast<FileData *>(work->data));
+		}
+
+	std::vector<ViewFileEdit> edits;
+	const auto remove = [&files, &edits](std::vector<FileData *>::iterator it)
+	{
+		edits.push_back({VF_EDIT_REMOVE, static_cast<gint>(it - files.begin()), *it});
+		files.erase(it);
+	};
+
+	for (FileData *fd : removed)
+		{
+		auto it = std::find(files.begin(), files.end(), fd);
+		if (it != files.end()) remove(it);
+		}
+
+	/* the other files are sorted, so the list is once each changed file is in order with its neighbours */
+	std::vector<FileData *> moved;
+	for (gsize i = 0; i < files.size(); )
+		{
+		FileData *fd = files[i];
+
+		if (!changed.count(fd) ||
+		    ((i == 0 || compare(files[i - 1], fd)) && (i + 1 == files.size() || compare(fd, files[i + 1]))))
+			{
+			i++;
+			continue;
+			}
+
+		changed.erase(fd);
+		moved.push_back(fd);
+		remove(files.begin() + i);
+
+		/* the previous file has a new neighbour */
+		if (i > 0) i--;
+		}
+
+	for (auto it = files.begin(); it != files.end(); ++it)
+		{
+		if (changed.count(*it)) edits.push_back({VF_EDIT_UPDATE, static_cast<gint>(it - files.begin()), *it});
+		}
+
+	for (const std::vector<FileData *> *list : {&moved, &added})
+		{
+		for (FileData *fd : *list)
+			{
+			auto it = std::lower_bound(files.begin(), files.end(), fd, compare);
+			edits.push_back({VF_EDIT_INSERT, static_cast<gint>(it - files.begin()), fd});
+			files.insert(it, fd);
+			}
+		}
+
+	GList *list = nullptr;
+	for (auto it = files.rbegin(); it != files.rend(); ++it)
+		{
+		list = g_list_prepend(list, *it);
+		}
+	g_list_free(vf->list);
+	vf->list = list;
+
+	for (FileData *fd : removed)
+		{
+		if (fd == vf->click_fd) vf->click_fd = nullptr;
+		}
+
+	DEBUG_1("%s vf_update_edit: %zu edits", get_exec_time(), edits.size());
+
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: vflist_update(vf, edits); break;
+	case FILEVIEW_ICON: vficon_update(vf, edits); break;
+	}
+
+	for (FileData *fd : removed)
+		{
+		file_data_unref(fd);
+		}
+}
+
+/**
+ * @brief Applies the collected changes to vf->list and to the view
+ */
+static void vf_update_apply(ViewFile *vf)
+{
+	std::unordered_set<FileData *> shown;
+	for (GList *work = vf->list; work; work = work->next)
+		{
+		shown.insert(static_cast<FileData *>(work->data));
+		}
+
+	/* the pending files keep their reference until the end */
+	std::vector<FileData *> pending;
+	if (vf->update_pending)
+		{
+		GHashTableIter iter;
+		gpointer key;
+		g_hash_table_iter_init(&iter, vf->update_pending);
+		while (g_hash_table_iter_next(&iter, &key, nullptr))
+			{
+			pending.push_back(static_cast<FileData *>(key));
+			}
+		g_hash_table_remove_all(vf->update_pending);
+		}
+
+	gboolean read_dir = vf->update_read_dir;
+	vf->update_read_dir = FALSE;
+	for (FileData *fd : pending)
+		{
+		/* a file may now pass the filters */
+		if (!shown.count(fd)) read_dir = TRUE;
+		}
+
+	std::vector<FileData *> removed;
+	std::vector<FileData *> added;
+	std::unordered_set<FileData *> changed;
+
+	if (read_dir)
+		{
+		GList *list = nullptr;
+
+		file_data_unregister_notify_func(vf_notify_cb, vf); /* we don't need the notification of changes detected by filelist_read */
+		filelist_read(vf->dir_fd, &list, nullptr);
+		file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+
+		list = vf_update_filter_list(vf, list);
+
+		std::unordered_set<FileData *> listed;
+		for (GList *work = list; work; work = work->next)
+			{
+			auto fd = static_cast<FileData *>(work->data);
+
+			listed.insert(fd);
+			if (!shown.count(fd)) added.push_back(file_data_ref(fd));
+			}
+		file_data_list_free(list);
+
+		for (GList *work = vf->list; work; work = work->next)
+			{
+			auto fd = static_cast<FileData *>(work->data);
+
+			if (!listed.count(fd)) removed.push_back(fd);
+			}
+		for (FileData *fd : pending)
+			{
+			if (shown.count(fd) && listed.count(fd)) changed.insert(fd);
+			}
+		}
+	else
+		{
+		for (FileData *fd : pending)
+			{
+			if (vf_update_keep(vf, fd))
+				changed.insert(fd);
+			else
+				removed.push_back(fd);
+			}
+		}
+
+	/* when reading the folder changed the grouping, a full refresh follows anyway */
+	if (!vf->refresh_idle_id)
+		{
+		if (removed.size() + added.size() + changed.size() > VF_UPDATE_MAX_EDITS)
+			{
+			vf_refresh(vf);
+			}
+		else if (!removed.empty() || !added.empty() || !changed.empty())
+			{
+			vf_update_edit(vf, removed, added, changed);
+			added.clear();
+			}
+		}
+
+	for (FileData *fd : added)
+		{
+		file_data_unref(fd);
+		}
+	for (FileData *fd : pending)
+		{
+		file_data_unref(fd);
+		}
+}
+
+static gboolean vf_update_idle_cb(gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	vf->update_idle_id = 0;
+	vf_update_apply(vf);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Collects a change of @a fd, in or of the folder, for the next update
+ */
+static void vf_update_queue(ViewFile *vf, FileData *fd, NotifyType type)
+{
+	if ((type & NOTIFY_GROUPING) || (fd == vf->dir_fd && type != NOTIFY_REREAD))
+		{
+		vf_update_cancel(vf);
+		vf_refresh_idle(vf);
+		return;
+		}
+
+	if (fd == vf->dir_fd)
+		{
+		vf->update_read_dir = TRUE;
+		}
+	else
+		{
+		/* moved, renamed or copied files may appear with another name */
+		if ((type & NOTIFY_CHANGE) && fd->change &&
+		    fd->change->type != FILEDATA_CHANGE_DELETE && fd->change->type != FILEDATA_CHANGE_WRITE_METADATA)
+			{
+			vf->update_read_dir = TRUE;
+			}
+
+		/* sidecars are shown with their group */
+		if (fd->parent) fd = fd->parent;
+
+		if (!vf->update_pending)
+			{
+			vf->update_pending = g_hash_table_new(nullptr, nullptr);
+			}
+		if (!g_hash_table_contains(vf->update_pending, fd))
+			{
+			g_hash_table_add(vf->update_pending, file_data_ref(fd));
+			}
+		}
+
+	if (!vf->update_idle_id)
+		{
+		vf->time_update_set = time(nullptr);
+		/* file operations run with G_PRIORITY_DEFAULT_IDLE */
+		vf->update_idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE + 50, vf_update_idle_cb, vf, nullptr);
+		}
+	else if (time(nullptr) - vf->time_update_set > 1)
+		{
+		/* more than 1 sec since the first change - increase priority */
+		g_source_remove(vf->update_idle_id);
+		vf->time_update_set = time(nullptr);
+		vf->update_idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE - 50, vf_update_idle_cb, vf, nullptr);
+		}
+}
+
 void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
@@ -1828,72 +2152,231 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
 	if (refresh)
 		{
 		DEBUG_1("Notify vf: %s %04x", fd->path, type);
-		vf_refresh_idle(vf);
+		vf_update_queue(vf, fd, type);
+		}
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * metadata for sorting and star ratings
+ *-----------------------------------------------------------------------------
+ */
+
+/**
+ * @brief Reads the start of a file on a worker thread, without touching the FileData
+ */
+static void vf_read_metadata_run(gpointer data, gpointer user_data)
+{
+	auto vmr = static_cast<ViewFileMetadataRead *>(user_data);
+	ViewFileMetadataItem &item = vmr->items[GPOINTER_TO_UINT(data) - 1];
+
+	const gint file = open(item.path, O_RDONLY);
+	if (file != -1)
+		{
+		std::vector<guchar> buf(VF_METADATA_READ_SIZE);
+		const ssize_t n = read(file, buf.data(), buf.size());
+		close(file);
+
+		if (n > 0) item.parsed = quick_metadata_parse(buf.data(), n, item.metadata);
+		}
+
+	g_atomic_int_set(&item.done, TRUE);
+}
+
+static time_t vf_read_metadata_time(const std::string &text)
+{
+	if (text.empty()) return 0;
+
+	std::tm time_str{};
+	strptime(text.c_str(), "%Y:%m:%d %H:%M:%S", &time_str);
+
+	return mktime(&time_str);
+}
+
+/**
+ * @brief XMP sidecars take precedence over the file, as in exif_read_fd()
+ */
+static gboolean vf_read_metadata_has_xmp_sidecar(FileData *fd)
+{
+#if HAVE_EXIV2
+	g_autofree gchar *sidecar_path = cache_find_location(CacheType::XMP_METADATA, fd->path);
+
+	if (!sidecar_path) sidecar_path = file_data_get_sidecar_path(fd, TRUE);
+
+	return sidecar_path != nullptr;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * @brief Stores what a worker has read, or reads it with the full metadata
+ * stack if the quick read is not enough
+ */
+static void vf_read_metadata_apply(const ViewFileMetadataItem &item)
+{
+	FileData *fd = item.fd;
+
+	if (fd->metadata_in_idle_loaded) return;
+
+	if (item.parsed && !fd->modified_xmp && !vf_read_metadata_has_xmp_sidecar(fd))
+		{
+		if (!fd->exifdate) fd->exifdate = vf_read_metadata_time(item.metadata.date_time_original);
+		if (!fd->exifdate_digitized) fd->exifdate_digitized = vf_read_metadata_time(item.metadata.date_time_digitized);
+		if (fd->rating == STAR_RATING_NOT_READ) fd->rating = item.metadata.rating;
+
+		MetadataIndexEntry entry;
+		metadata_index_get(fd, entry);
+		entry.fields |= METADATA_INDEX_DATE | METADATA_INDEX_DATE_DIGITIZED | METADATA_INDEX_RATING;
+		entry.date = vf_read_metadata_time(item.metadata.date_time_original);
+		entry.date_digitized = vf_read_metadata_time(item.metadata.date_time_digitized);
+		entry.rating = item.metadata.rating;
+		metadata_index_put(fd, entry);
+		}
+	else
+		{
+		if (!fd->exifdate)
+			{
+			read_exif_time_data(fd);
+			}
+		if (!fd->exifdate_digitized)
+			{
+			read_exif_time_digitized_data(fd);
+			}
+		if (fd->rating == STAR_RATING_NOT_READ)
+			{
+			read_rating_data(fd);
+			}
 		}
+
+	fd->metadata_in_idle_loaded = TRUE;
+}
+
+/**
+ * @brief Takes the dates and rating from the metadata index, if it has them all
+ */
+static gboolean vf_read_metadata_from_index(FileData *fd)
+{
+	constexpr guint fields = METADATA_INDEX_DATE | METADATA_INDEX_DATE_DIGITIZED | METADATA_INDEX_RATING;
+	MetadataIndexEntry entry;
+
+	if (!metadata_index_get(fd, entry) || (entry.fields & fields) != fields) return FALSE;
+
+	if (!fd->exifdate) fd->exifdate = entry.date;
+	if (!fd->exifdate_digitized) fd->exifdate_digitized = entry.date_digitized;
+	if (fd->rating == STAR_RATING_NOT_READ) fd->rating = entry.rating;
+
+	fd->metadata_in_idle_loaded = TRUE;
+
+	return TRUE;
 }
 
 static gboolean vf_read_metadata_in_idle_cb(gpointer data)
 {
-	FileData *fd;
 	auto vf = static_cast<ViewFile *>(data);
-	GList *work;
+	ViewFileMetadataRead *vmr = vf->read_metadata;
+	const gint64 end_time = g_get_monotonic_time() + VF_METADATA_APPLY_TIME;
 
-	vf_thumb_status(vf, vf_read_metadata_in_idle_progress(vf), _("Loading meta…"));
+	vf_thumb_status(vf, vmr->items.empty() ? 1.0 : static_cast<gdouble>(vmr->cursor) / vmr->items.size(), _("Loading meta…"));
 
-	work = vf->list;
-
-	while (work)
+	while (vmr->cursor < vmr->items.size())
 		{
-		fd = static_cast<FileData *>(work->data);
+		const ViewFileMetadataItem &item = vmr->items[vmr->cursor];
 
-		if (fd && !fd->metadata_in_idle_loaded)
+		if (!g_atomic_int_get(&item.done))
 			{
-			if (!fd->exifdate)
-				{
-				read_exif_time_data(fd);
-				}
-			if (!fd->exifdate_digitized)
-				{
-				read_exif_time_digitized_data(fd);
-				}
-			if (fd->rating == STAR_RATING_NOT_READ)
-				{
-				read_rating_data(fd);
-				}
-			fd->metadata_in_idle_loaded = TRUE;
-			return G_SOURCE_CONTINUE;
+			/* wait for the workers without spinning */
+			if (vmr->waiting) return G_SOURCE_CONTINUE;
+
+			vmr->waiting = TRUE;
+			vf->read_metadata_in_idle_id = g_timeout_add_full(G_PRIORITY_LOW, VF_METADATA_WAIT_INTERVAL, vf_read_metadata_in_idle_cb, vf, nullptr);
+			return G_SOURCE_REMOVE;
 			}
-		work = work->next;
+
+		vf_read_metadata_apply(item);
+		vmr->cursor++;
+
+		if (g_get_monotonic_time() >= end_time) break;
+		}
+
+	if (vmr->cursor < vmr->items.size())
+		{
+		if (!vmr->waiting) return G_SOURCE_CONTINUE;
+
+		vmr->waiting = FALSE;
+		vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, nullptr);
+		return G_SOURCE_REMOVE;
 		}
 
-	vf_thumb_status(vf, 0.0, nullptr);
 	vf->read_metadata_in_idle_id = 0;
+	vf_read_metadata_stop(vf);
+	vf_thumb_status(vf, 0.0, nullptr);
 	vf_refresh(vf);
 	return G_SOURCE_REMOVE;
 }
 
-static void vf_read_metadata_in_idle_finished_cb(gpointer data)
+/**
+ * @brief Stops reading metadata, the files already read keep their data
+ */
+static void vf_read_metadata_stop(ViewFile *vf)
 {
-	auto vf = static_cast<ViewFile *>(data);
+	if (vf->read_metadata_in_idle_id)
+		{
+		g_source_remove(vf->read_metadata_in_idle_id);
+		vf->read_metadata_in_idle_id = 0;
+		}
 
-	vf_thumb_status(vf, 0.0, _("Loading meta…"));
-	vf->read_metadata_in_idle_id = 0;
+	ViewFileMetadataRead *vmr = vf->read_metadata;
+	if (!vmr) return;
+
+	/* drop the queued files and wait for those being read */
+	g_thread_pool_free(vmr->pool, TRUE, TRUE);
+
+	for (ViewFileMetadataItem &item : vmr->items)
+		{
+		file_data_unref(item.fd);
+		g_free(item.path);
+		}
+
+	delete vmr;
+	vf->read_metadata = nullptr;
 }
 
+/**
+ * @brief Reads the dates and ratings of the files of the view in the background
+ *
+ * Files with a valid entry in the metadata index are not read. The start
+ * of the others is parsed on worker threads. The results are stored in
+ * the main loop in the order of the list, falling back to the full
+ * metadata read for formats the quick read does not handle.
+ */
 void vf_read_metadata_in_idle(ViewFile *vf)
 {
 	if (!vf) return;
 
-	if (vf->read_metadata_in_idle_id)
+	vf_read_metadata_stop(vf);
+
+	if (!vf->list) return;
+
+	auto vmr = new ViewFileMetadataRead();
+
+	for (GList *work = vf->list; work; work = work->next)
 		{
-		g_idle_remove_by_data(vf);
+		auto fd = static_cast<FileData *>(work->data);
+
+		if (!fd || fd->metadata_in_idle_loaded || vf_read_metadata_from_index(fd)) continue;
+
+		vmr->items.push_back({file_data_ref(fd), path_from_utf8(fd->path), {}, FALSE, FALSE});
 		}
-	vf->read_metadata_in_idle_id = 0;
 
-	if (vf->list)
+	vmr->pool = g_thread_pool_new(vf_read_metadata_run, vmr, get_cpu_cores(), FALSE, nullptr);
+	for (guint i = 0; i < vmr->items.size(); i++)
 		{
-		vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, vf_read_metadata_in_idle_finished_cb);
+		g_thread_pool_push(vmr->pool, GUINT_TO_POINTER(i + 1), nullptr);
 		}
+
+	vf->read_metadata = vmr;
+	vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, nullptr);
 }
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for color-man.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <config.h>
+
+#if HAVE_LCMS
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <lcms2.h>
+
+#include "color-man.h"
+#include "options.h"
+
+namespace {
+
+/**
+ * @brief A wide gamut display: Rec. 2020 primaries with the sRGB curve
+ */
+cmsHPROFILE wide_gamut_profile_new()
+{
+	const cmsFloat64Number srgb_curve[5] = {2.4, 1.0 / 1.055, 0.055 / 1.055, 1.0 / 12.92, 0.04045};
+	const cmsCIExyYTRIPLE primaries = {{0.708, 0.292, 1.0}, {0.170, 0.797, 1.0}, {0.131, 0.046, 1.0}};
+	cmsCIExyY white;
+	cmsWhitePointFromTemp(6504, &white);
+
+	cmsToneCurve *curve = cmsBuildParametricToneCurve(nullptr, 4, srgb_curve);
+	cmsToneCurve *curves[3] = {curve, curve, curve};
+	cmsHPROFILE profile = cmsCreateRGBProfile(&white, &primaries, curves);
+	cmsFreeToneCurve(curve);
+
+	return profile;
+}
+
+ColorManMemData profile_save_to_mem(cmsHPROFILE profile)
+{
+	ColorManMemData data;
+	cmsUInt32Number len = 0;
+
+	cmsSaveProfileToMem(profile, nullptr, &len);
+	data.ptr.reset(static_cast<guchar *>(g_malloc(len)));
+	cmsSaveProfileToMem(profile, data.ptr.get(), &len);
+	data.len = len;
+
+	return data;
+}
+
+GdkPixbuf *pixbuf_new_noise(gint width, gint height)
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pix = gdk_pixbuf_get_pixels(pixbuf);
+	guint32 seed = 12345;
+
+	for (gint y = 0; y < height; y++)
+		for (gint x = 0; x < width * 3; x++)
+			{
+			seed = (seed * 1103515245) + 12345;
+			pix[(y * rs) + x] = seed >> 24;
+			}
+
+	return pixbuf;
+}
+
+struct ColorManTest : public ::testing::Test
+{
+	void SetUp() override
+	{
+		if (!options) options = init_options(nullptr);
+
+		cmsHPROFILE wide = wide_gamut_profile_new();
+		screen_data = profile_save_to_mem(wide);
+
+		cmsHPROFILE srgb = cmsCreate_sRGBProfile();
+		transform = cmsCreateTransform(srgb, TYPE_RGB_8, wide, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
+
+		cmsCloseProfile(srgb);
+		cmsCloseProfile(wide);
+	}
+
+	void TearDown() override
+	{
+		cmsDeleteTransform(transform);
+	}
+
+	ColorMan *color_man_new_for(const GdkPixbuf *pixbuf) const
+	{
+		return color_man_new(pixbuf, COLOR_PROFILE_SRGB, nullptr, COLOR_PROFILE_MEM, nullptr, screen_data);
+	}
+
+	static void lcms_correct(cmsHTRANSFORM transform, GdkPixbuf *pixbuf)
+	{
+		const gint w = gdk_pixbuf_get_width(pixbuf);
+		const gint h = gdk_pixbuf_get_height(pixbuf);
+		const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
+		guchar *pix = gdk_pixbuf_get_pixels(pixbuf);
+
+		for (gint y = 0; y < h; y++) cmsDoTransform(transform, pix + (y * rs), pix + (y * rs), w);
+	}
+
+	ColorManMemData screen_data;
+	cmsHTRANSFORM transform = nullptr;
+};
+
+TEST_F(ColorManTest, CorrectRegionIsCloseToLcms)
+{
+	g_autoptr(GdkPixbuf) expected = pixbuf_new_noise(256, 256);
+	g_autoptr(GdkPixbuf) actual = gdk_pixbuf_copy(expected);
+
+	std::unique_ptr<ColorMan> cm(color_man_new_for(actual));
+	ASSERT_NE(nullptr, cm);
+	ASSERT_TRUE(cm->uses_lut());
+
+	lcms_correct(transform, expected);
+	cm->correct_region(actual, {0, 0, 256, 256});
+
+	const guchar *e = gdk_pixbuf_read_pixels(expected);
+	const guchar *a = gdk_pixbuf_read_pixels(actual);
+	const gint rs = gdk_pixbuf_get_rowstride(expected);
+	gint max_error = 0;
+
+	for (gint y = 0; y < 256; y++)
+		for (gint x = 0; x < 256 * 3; x++)
+			max_error = std::max(max_error, abs(e[(y * rs) + x] - a[(y * rs) + x]));
+
+	EXPECT_LE(max_error, 2);
+}
+
+TEST_F(ColorManTest, CorrectRegionLeavesTheRest)
+{
+	g_autoptr(GdkPixbuf) pixbuf = pixbuf_new_noise(64, 64);
+	g_autoptr(GdkPixbuf) original = gdk_pixbuf_copy(pixbuf);
+
+	std::unique_ptr<ColorMan> cm(color_man_new_for(pixbuf));
+	ASSERT_NE(nullptr, cm);
+
+	cm->correct_region(pixbuf, {8, 8, 16, 16});
+
+	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
+	EXPECT_EQ(0, memcmp(gdk_pixbuf_read_pixels(pixbuf), gdk_pixbuf_read_pixels(original), 8 * rs));
+	EXPECT_EQ(0, memcmp(gdk_pixbuf_read_pixels(pixbuf) + (24 * rs), gdk_pixbuf_read_pixels(original) + (24 * rs), 40 * rs));
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST_F(ColorManTest, DISABLED_BenchmarkLcmsAndLut)
+{
+	constexpr gint width = 6000;
+	constexpr gint height = 4000;
+
+	g_autoptr(GdkPixbuf) lcms_pixbuf = pixbuf_new_noise(width, height);
+	g_autoptr(GdkPixbuf) lut_pixbuf = gdk_pixbuf_copy(lcms_pixbuf);
+
+	std::unique_ptr<ColorMan> cm(color_man_new_for(lut_pixbuf));
+	ASSERT_NE(nullptr, cm);
+	ASSERT_TRUE(cm->uses_lut());
+
+	gint64 start = g_get_monotonic_time();
+	lcms_correct(transform, lcms_pixbuf);
+	const gint64 lcms_time = g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	cm->correct_region(lut_pixbuf, {0, 0, width, height});
+	const gint64 lut_time = g_get_monotonic_time() - start;
+
+	const gdouble mp = width * height / 1e6;
+	std::cerr << "lcms: " << mp / (lcms_time / 1e6) << " MP/s, "
+	          << "LUT: " << mp / (lut_time / 1e6) << " MP/s\n";
+}
+
+}  // anonymous namespace
+
+#endif /* HAVE_LCMS */
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
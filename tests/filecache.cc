@@ -24,6 +24,10 @@
 
 #include "gtest/gtest.h"
 
+#include <unistd.h>
+
+#include <vector>
+
 #include <glib.h>
 
 #include "filecache.h"
@@ -48,6 +52,19 @@ class FileCacheTest : public t::Test
 		std::cerr << "released " << static_cast<void *>(fd) << " (" << fd->path << ")\n";
 	}
 
+	static void cache_release_quiet(FileData *)
+	{
+	}
+
+	static gchar *create_tmp_file()
+	{
+		gchar *path = nullptr;
+		const gint fd = g_file_open_tmp("geeqie-filecache-XXXXXX.jpg", &path, nullptr);
+		if (fd >= 0) close(fd);
+
+		return path;
+	}
+
 	FileData *fd = nullptr;
 	FileData *fd2 = nullptr;
 	FileDataContext context;
@@ -75,6 +92,88 @@ TEST_F(FileCacheTest, BasicLifecycle)
 	ASSERT_FALSE(file_cache_get(fc, fd2));
 }
 
+TEST_F(FileCacheTest, LeastRecentlyUsedIsEvicted)
+{
+	g_autofree gchar *path_a = create_tmp_file();
+	g_autofree gchar *path_b = create_tmp_file();
+	g_autofree gchar *path_c = create_tmp_file();
+	ASSERT_TRUE(path_a && path_b && path_c);
+
+	FileData *fd_a = FileData::file_data_new_simple(path_a, &context);
+	FileData *fd_b = FileData::file_data_new_simple(path_b, &context);
+	FileData *fd_c = FileData::file_data_new_simple(path_c, &context);
+	FileCacheData *fc = file_cache_new(&FileCacheTest::cache_release, /*max_size=*/2);
+
+	file_cache_put(fc, fd_a, /*size=*/1);
+	file_cache_put(fc, fd_b, /*size=*/1);
+	ASSERT_TRUE(file_cache_get(fc, fd_a));
+
+	// fd_b is now the least recently used entry.
+	file_cache_put(fc, fd_c, /*size=*/1);
+	ASSERT_FALSE(file_cache_get(fc, fd_b));
+	ASSERT_TRUE(file_cache_get(fc, fd_a));
+	ASSERT_TRUE(file_cache_get(fc, fd_c));
+
+	const FileCacheStats stats = file_cache_get_stats(fc);
+	ASSERT_EQ(3U, stats.hits);
+	ASSERT_EQ(4U, stats.misses);
+	ASSERT_EQ(1U, stats.evictions);
+
+	file_data_unref(fd_a);
+	file_data_unref(fd_b);
+	file_data_unref(fd_c);
+	unlink(path_a);
+	unlink(path_b);
+	unlink(path_c);
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST_F(FileCacheTest, DISABLED_Benchmark10kEntries)
+{
+	constexpr guint entry_count = 10000;
+
+	std::vector<FileData *> fds;
+	for (guint i = 0; i < entry_count; i++)
+		{
+		g_autofree gchar *path = g_strdup_printf("/does/not/exist/%05u.jpg", i);
+		fds.push_back(FileData::file_data_new_simple(path, &context));
+		}
+
+	FileCacheData *fc = file_cache_new(&FileCacheTest::cache_release_quiet, /*max_size=*/entry_count);
+
+	gint64 start = g_get_monotonic_time();
+	for (FileData *entry : fds)
+		{
+		file_cache_put(fc, entry, /*size=*/1);
+		}
+	const gint64 put_time = g_get_monotonic_time() - start;
+
+	// The first half was put first, so it is the least recently used.
+	start = g_get_monotonic_time();
+	file_cache_set_max_size(fc, entry_count / 2);
+	const gint64 evict_time = g_get_monotonic_time() - start;
+
+	start = g_get_monotonic_time();
+	for (guint i = 0; i < entry_count / 2; i++)
+		{
+		ASSERT_FALSE(file_cache_get(fc, fds[i]));
+		}
+	const gint64 miss_time = g_get_monotonic_time() - start;
+
+	const FileCacheStats stats = file_cache_get_stats(fc);
+	ASSERT_EQ(0U, stats.hits);
+	ASSERT_EQ(entry_count + entry_count / 2, stats.misses);
+	ASSERT_EQ(entry_count / 2, stats.evictions);
+
+	std::cerr << entry_count << " entries: put " << put_time << " us, evict half " << evict_time
+	          << " us, " << entry_count / 2 << " misses " << miss_time << " us\n";
+
+	for (FileData *entry : fds)
+		{
+		file_data_unref(entry);
+		}
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
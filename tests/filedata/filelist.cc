@@ -25,12 +25,23 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
+#include "cache.h"
 #include "filedata.h"
 #include "filefilter.h"
+#include "options.h"
 
 namespace {
 
@@ -306,6 +317,338 @@ TEST_F(FileDataSortTest, CaseSensitivity)
 	EXPECT_LT(sort_compare_filedata(fd_upper_1, fd_lower_10, &sort_by_number_with_case), 0);
 }
 
+/**
+ * @brief Sets the sortable traits of @a fd from @a seed, with many ties
+ */
+void set_sort_traits(FileData *fd, guint seed)
+{
+	static const FileFormatClass classes[] = {FORMAT_CLASS_IMAGE, FORMAT_CLASS_RAWIMAGE, FORMAT_CLASS_META};
+
+	fd->size = seed % 7 * 1000;
+	fd->date = static_cast<time_t>(seed % 5) - 2;
+	fd->cdate = seed % 3 * 1111111111;
+	fd->exifdate = seed % 11;
+	fd->exifdate_digitized = -static_cast<time_t>(seed % 4);
+	fd->rating = static_cast<gint>(seed % 7) - 1;
+	fd->format_class = classes[seed % 3];
+}
+
+TEST_F(FileDataSortTest, KeyedSortMatchesCompare)
+{
+	// Names sharing more than the 8 bytes kept in the keys, differing in
+	// case only, and with numbers of different lengths.
+	static const gchar *names[] = {"IMG_0001.jpg", "img_0001.jpg", "IMG_0001.JPG", "IMG_00010.jpg",
+	                               "IMG_001.jpg", "IMG_1.jpg", "IMG_10.jpg", "IMG_2.jpg", "a.jpg",
+	                               "B.jpg", "b.jpg", "\xc3\xa9t\xc3\xa9.jpg", "etc.jpg", "Z.jpg"};
+
+	std::vector<FileData *> fds;
+	guint seed = 0;
+	for (const gchar *dir : {"/noexist/a/", "/noexist/b/"})
+		for (const gchar *name : names)
+			{
+			g_autofree gchar *path = g_strconcat(dir, name, nullptr);
+			FileData *fd = FileData::file_data_new_simple(path, &context);
+			set_sort_traits(fd, seed++);
+			fds.push_back(fd);
+			}
+
+	for (gint method = SORT_NONE; method <= SORT_CLASS; method++)
+		for (gboolean ascending : {TRUE, FALSE})
+			for (gboolean case_sensitive : {TRUE, FALSE})
+				{
+				SCOPED_TRACE(std::to_string(method) + (ascending ? " ascending" : " descending") +
+				             (case_sensitive ? " case sensitive" : " case insensitive"));
+
+				FileData::FileList::SortSettings settings = {static_cast<SortType>(method), ascending, case_sensitive};
+
+				std::vector<FileData *> sorted(fds.rbegin(), fds.rend());
+				FileData::FileList::sort(sorted, settings);
+				for (gsize i = 1; i < sorted.size(); i++)
+					{
+					EXPECT_LT(FileData::FileList::sort_compare_filedata(sorted[i - 1], sorted[i], &settings), 0) << i;
+					}
+
+				GList *list = nullptr;
+				for (FileData *fd : fds)
+					{
+					list = g_list_prepend(list, fd);
+					}
+				list = FileData::FileList::sort(list, settings);
+				GList *work = list;
+				for (FileData *fd : sorted)
+					{
+					ASSERT_NE(nullptr, work);
+					EXPECT_EQ(fd, work->data);
+					work = work->next;
+					}
+				EXPECT_EQ(nullptr, work);
+				g_list_free(list);
+				}
+
+	for (FileData *fd : fds)
+		{
+		file_data_unref(fd);
+		}
+}
+
+TEST_F(FileDataSortTest, ParallelSortMatchesCompare)
+{
+	// Above 3 * 16384 keys, so the keys are sorted in up to 3 parts and
+	// merged when there are several cores.
+	constexpr guint file_count = 50000;
+
+	std::vector<FileData *> fds;
+	GRand *rand = g_rand_new_with_seed(25);
+	for (guint i = 0; i < file_count; i++)
+		{
+		g_autofree gchar *path = g_strdup_printf("/noexist/dir%02u/IMG_%06d_%u.jpg", i % 50, g_rand_int_range(rand, 0, 1000000), i);
+		FileData *fd = FileData::file_data_new_simple(path, &context);
+		set_sort_traits(fd, g_rand_int(rand));
+		fds.push_back(fd);
+		}
+	g_rand_free(rand);
+
+	for (gint method = SORT_NONE; method <= SORT_CLASS; method++)
+		for (gboolean ascending : {TRUE, FALSE})
+			{
+			SCOPED_TRACE(std::to_string(method) + (ascending ? " ascending" : " descending"));
+
+			FileData::FileList::SortSettings settings = {static_cast<SortType>(method), ascending, FALSE};
+
+			std::vector<FileData *> sorted(fds);
+			FileData::FileList::sort(sorted, settings);
+
+			ASSERT_EQ(fds.size(), sorted.size());
+			for (gsize i = 1; i < sorted.size(); i++)
+				{
+				ASSERT_LT(FileData::FileList::sort_compare_filedata(sorted[i - 1], sorted[i], &settings), 0) << i;
+				}
+			}
+
+	for (FileData *fd : fds)
+		{
+		file_data_unref(fd);
+		}
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST_F(FileDataSortTest, DISABLED_Benchmark200kSortByEachType)
+{
+	constexpr guint file_count = 200000;
+
+	std::vector<FileData *> fds;
+	GRand *rand = g_rand_new_with_seed(25);
+	for (guint i = 0; i < file_count; i++)
+		{
+		g_autofree gchar *path = g_strdup_printf("/noexist/dir%02u/IMG_%06d_%u.jpg", i % 50, g_rand_int_range(rand, 0, 1000000), i);
+		FileData *fd = FileData::file_data_new_simple(path, &context);
+		set_sort_traits(fd, g_rand_int(rand));
+		fds.push_back(fd);
+		}
+	g_rand_free(rand);
+
+	for (gint method = SORT_NONE; method <= SORT_CLASS; method++)
+		{
+		SCOPED_TRACE(std::to_string(method));
+
+		FileData::FileList::SortSettings settings = {static_cast<SortType>(method), TRUE, FALSE};
+
+		GList *list = nullptr;
+		for (FileData *fd : fds)
+			{
+			list = g_list_prepend(list, fd);
+			}
+		gint64 start = g_get_monotonic_time();
+		list = g_list_sort_with_data(list, [](gconstpointer a, gconstpointer b, gpointer data)
+			{
+			return FileData::FileList::sort_compare_filedata(static_cast<const FileData *>(a),
+			                                                 static_cast<const FileData *>(b),
+			                                                 static_cast<FileData::FileList::SortSettings *>(data));
+			}, &settings);
+		const gint64 list_time = g_get_monotonic_time() - start;
+		g_list_free(list);
+
+		std::vector<FileData *> sorted(fds);
+		start = g_get_monotonic_time();
+		FileData::FileList::sort(sorted, settings);
+		const gint64 keyed_time = g_get_monotonic_time() - start;
+
+		for (gsize i = 1; i < sorted.size(); i++)
+			{
+			ASSERT_LT(FileData::FileList::sort_compare_filedata(sorted[i - 1], sorted[i], &settings), 0) << i;
+			}
+
+		std::cerr << file_count << " files by sort type " << method << ": g_list_sort " << list_time
+		          << " us, keyed " << keyed_time << " us\n";
+		}
+
+	for (FileData *fd : fds)
+		{
+		file_data_unref(fd);
+		}
+}
+
+class FileListReadTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		if (!options) options = init_options(nullptr);
+		saved_file_filter_options = options->file_filter;
+		options->file_filter.show_hidden_files = FALSE;
+		options->file_filter.dot_prefix_hidden_files = FALSE;
+
+		tmp_dir = g_dir_make_tmp("geeqie-filelist-XXXXXX", nullptr);
+		ASSERT_NE(tmp_dir, nullptr);
+	}
+
+	void TearDown() override
+	{
+		if (tmp_dir) std::filesystem::remove_all(tmp_dir);
+		g_clear_pointer(&tmp_dir, g_free);
+
+		options->file_filter = saved_file_filter_options;
+	}
+
+	gchar *create_dir(const gchar *name)
+	{
+		gchar *path = g_build_filename(tmp_dir, name, NULL);
+		g_mkdir(path, 0755);
+
+		return path;
+	}
+
+	static void create_file(const gchar *dir, const gchar *name, const gchar *contents = "")
+	{
+		g_autofree gchar *path = g_build_filename(dir, name, NULL);
+		const gint fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) return;
+
+		if (write(fd, contents, strlen(contents)) < 0) std::cerr << "write failed: " << path << "\n";
+		close(fd);
+	}
+
+	static std::set<std::string> names(GList *list)
+	{
+		std::set<std::string> result;
+		for (GList *work = list; work; work = work->next)
+			{
+			result.emplace(static_cast<FileData *>(work->data)->name);
+			}
+
+		return result;
+	}
+
+	gchar *tmp_dir = nullptr;
+	decltype(ConfOptions::file_filter) saved_file_filter_options;
+};
+
+TEST_F(FileListReadTest, HiddenAndIgnoredEntriesAreSkipped)
+{
+	create_file(tmp_dir, "visible.jpg");
+	create_file(tmp_dir, ".dotted.jpg");
+	create_file(tmp_dir, "listed.jpg");
+	create_file(tmp_dir, ".hidden", "listed.jpg\n");
+	g_autofree gchar *sub = create_dir("sub");
+	g_autofree gchar *thumbs = create_dir(GQ_CACHE_LOCAL_THUMB);
+
+	FileData *dir_fd = FileData::file_data_new_dir(tmp_dir);
+	GList *files = nullptr;
+	GList *dirs = nullptr;
+	ASSERT_TRUE(FileData::FileList::read_list(dir_fd, &files, &dirs));
+
+	EXPECT_EQ(names(files), std::set<std::string>({"visible.jpg"}));
+	EXPECT_EQ(names(dirs), std::set<std::string>({"sub"}));
+	FileData::FileList::free_list(files);
+	FileData::FileList::free_list(dirs);
+
+	// With the override, only the dot prefix counts.
+	options->file_filter.dot_prefix_hidden_files = TRUE;
+	ASSERT_TRUE(FileData::FileList::read_list(dir_fd, &files, nullptr));
+	EXPECT_EQ(names(files), std::set<std::string>({"visible.jpg", "listed.jpg"}));
+	FileData::FileList::free_list(files);
+
+	file_data_unref(dir_fd);
+}
+
+TEST_F(FileListReadTest, RecursiveKeepsFolderOrder)
+{
+	g_autofree gchar *a = create_dir("a");
+	g_autofree gchar *b = create_dir("b");
+	g_autofree gchar *a_c = g_build_filename(a, "c", NULL);
+	g_mkdir(a_c, 0755);
+
+	create_file(tmp_dir, "0.jpg");
+	create_file(a, "1.jpg");
+	create_file(a_c, "2.jpg");
+	create_file(b, "3.jpg");
+
+	FileData *dir_fd = FileData::file_data_new_dir(tmp_dir);
+	GList *list = FileData::FileList::recursive(dir_fd);
+
+	std::vector<std::string> order;
+	for (GList *work = list; work; work = work->next)
+		{
+		order.emplace_back(static_cast<FileData *>(work->data)->name);
+		}
+	EXPECT_EQ(order, std::vector<std::string>({"0.jpg", "1.jpg", "2.jpg", "3.jpg"}));
+
+	FileData::FileList::free_list(list);
+	file_data_unref(dir_fd);
+}
+
+// Creates 100k files, run with --gtest_also_run_disabled_tests.
+TEST_F(FileListReadTest, DISABLED_Benchmark100kFiles)
+{
+	constexpr guint dir_count = 100;
+	constexpr guint files_per_dir = 1000;
+
+	for (guint i = 0; i < dir_count; i++)
+		{
+		g_autofree gchar *name = g_strdup_printf("%03u", i);
+		g_autofree gchar *dir = create_dir(name);
+		for (guint j = 0; j < files_per_dir; j++)
+			{
+			g_autofree gchar *file = g_strdup_printf("%04u.jpg", j);
+			create_file(dir, file);
+			}
+		}
+
+	FileData *dir_fd = FileData::file_data_new_dir(tmp_dir);
+
+	gint64 start = g_get_monotonic_time();
+	GList *list = FileData::FileList::recursive(dir_fd);
+	const gint64 recursive_time = g_get_monotonic_time() - start;
+
+	EXPECT_EQ(dir_count * files_per_dir, g_list_length(list));
+	FileData::FileList::free_list(list);
+
+	// The same folders read one after the other in this thread.
+	GList *dirs = nullptr;
+	ASSERT_TRUE(FileData::FileList::read_list(dir_fd, nullptr, &dirs));
+
+	guint count = 0;
+	start = g_get_monotonic_time();
+	for (GList *work = dirs; work; work = work->next)
+		{
+		GList *files = nullptr;
+		if (FileData::FileList::read_list(static_cast<FileData *>(work->data), &files, nullptr))
+			{
+			count += g_list_length(files);
+			FileData::FileList::free_list(files);
+			}
+		}
+	const gint64 serial_time = g_get_monotonic_time() - start;
+
+	EXPECT_EQ(dir_count * files_per_dir, count);
+
+	std::cerr << dir_count * files_per_dir << " files in " << dir_count << " folders: recursive "
+	          << recursive_time << " us, serial read_list " << serial_time << " us\n";
+
+	FileData::FileList::free_list(dirs);
+	file_data_unref(dir_fd);
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for histogram.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "histogram.h"
+
+namespace {
+
+/* red is the column, green the row, blue is constant */
+GdkPixbuf *pixbuf_new_ramp(gboolean has_alpha, gint width, gint height)
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	const gint step = has_alpha ? 4 : 3;
+	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pix = gdk_pixbuf_get_pixels(pixbuf);
+
+	for (gint y = 0; y < height; y++)
+		for (gint x = 0; x < width; x++)
+			{
+			guchar *p = pix + (y * rs) + (x * step);
+			p[0] = x;
+			p[1] = y;
+			p[2] = 100;
+			if (has_alpha) p[3] = 0;
+			}
+
+	return pixbuf;
+}
+
+TEST(HistMapTest, CountsEveryPixel)
+{
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) pixbuf = pixbuf_new_ramp(has_alpha, 37, 21);
+		HistMap *histmap = histmap_new_sync(pixbuf, 1);
+
+		EXPECT_EQ(21U, histmap_get_count(histmap, HCHAN_R, 0));
+		EXPECT_EQ(21U, histmap_get_count(histmap, HCHAN_R, 36));
+		EXPECT_EQ(0U, histmap_get_count(histmap, HCHAN_R, 37));
+		EXPECT_EQ(37U, histmap_get_count(histmap, HCHAN_G, 20));
+		EXPECT_EQ(37U * 21U, histmap_get_count(histmap, HCHAN_B, 100));
+
+		/* the value is the largest channel, blue is larger than the others */
+		EXPECT_EQ(37U * 21U, histmap_get_count(histmap, HCHAN_MAX, 100));
+		EXPECT_EQ(0U, histmap_get_count(histmap, HCHAN_MAX, 99));
+
+		histmap_free(histmap);
+		}
+}
+
+TEST(HistMapTest, SamplesWithStep)
+{
+	g_autoptr(GdkPixbuf) pixbuf = pixbuf_new_ramp(FALSE, 10, 10);
+	HistMap *histmap = histmap_new_sync(pixbuf, 3);
+
+	/* columns and rows 0, 3, 6 and 9 */
+	EXPECT_EQ(4U, histmap_get_count(histmap, HCHAN_R, 3));
+	EXPECT_EQ(0U, histmap_get_count(histmap, HCHAN_R, 4));
+	EXPECT_EQ(16U, histmap_get_count(histmap, HCHAN_B, 100));
+
+	histmap_free(histmap);
+}
+
+struct AsyncResult
+{
+	gint calls;
+	gboolean complete;
+};
+
+void async_result_cb(const HistMap *, gboolean complete, gpointer data)
+{
+	auto result = static_cast<AsyncResult *>(data);
+
+	result->calls++;
+	result->complete = complete;
+}
+
+TEST(HistMapTest, AsyncMatchesSync)
+{
+	g_autoptr(GdkPixbuf) pixbuf = pixbuf_new_ramp(TRUE, 200, 150);
+	AsyncResult result{};
+
+	HistMap *histmap = histmap_new_async(pixbuf, 1, async_result_cb, &result);
+
+	while (!result.complete) g_main_context_iteration(nullptr, TRUE);
+
+	EXPECT_GE(result.calls, 1);
+
+	HistMap *expected = histmap_new_sync(pixbuf, 1);
+	for (gint channel : {HCHAN_R, HCHAN_G, HCHAN_B, HCHAN_MAX})
+		for (gint value = 0; value < 256; value++)
+			ASSERT_EQ(histmap_get_count(expected, channel, value), histmap_get_count(histmap, channel, value));
+
+	histmap_free(expected);
+	histmap_free(histmap);
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST(HistMapTest, DISABLED_BenchmarkCount24Megapixel)
+{
+	g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, 6000, 4000);
+	gdk_pixbuf_fill(pixbuf, 0x80808000);
+
+	const gint64 start = g_get_monotonic_time();
+	HistMap *histmap = histmap_new_sync(pixbuf, 1);
+	const gint64 elapsed = g_get_monotonic_time() - start;
+
+	EXPECT_EQ(6000U * 4000U, histmap_get_count(histmap, HCHAN_R, 128));
+
+	std::cerr << "24 MP histogram: " << elapsed << " us\n";
+
+	histmap_free(histmap);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
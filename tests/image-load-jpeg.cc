@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-load-jpeg.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <config.h>
+
+#if HAVE_JPEG
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <jpeglib.h>
+
+#include "image-load-jpeg.h"
+
+namespace {
+
+constexpr gsize STREAM_HEADER_SIZE = 131072; /**< as JPEG_STREAM_HEADER_SIZE */
+
+/**
+ * @brief Encodes a noisy progressive JPEG, large enough to be streamed
+ */
+std::vector<guchar> progressive_jpeg_new(gint width, gint height)
+{
+	std::vector<guchar> pix(static_cast<gsize>(width) * height * 3);
+	guint32 seed = 12345;
+	for (guchar &p : pix)
+		{
+		seed = (seed * 1103515245) + 12345;
+		p = seed >> 24;
+		}
+
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	guchar *out = nullptr;
+	unsigned long out_size = 0;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &out, &out_size);
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 95, TRUE);
+	jpeg_simple_progression(&cinfo);
+
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < cinfo.image_height)
+		{
+		JSAMPROW row = &pix[static_cast<gsize>(cinfo.next_scanline) * width * 3];
+		jpeg_write_scanlines(&cinfo, &row, 1);
+		}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	std::vector<guchar> jpeg(out, out + out_size);
+	free(out);
+
+	return jpeg;
+}
+
+/**
+ * @brief Offsets of the SOS markers, each the start of a scan
+ */
+std::vector<gsize> scan_offsets(const std::vector<guchar> &jpeg)
+{
+	std::vector<gsize> offsets;
+	for (gsize i = 0; i + 1 < jpeg.size(); i++)
+		{
+		if (jpeg[i] == 0xff && jpeg[i + 1] == 0xda) offsets.push_back(i);
+		}
+	return offsets;
+}
+
+void area_updated_cb(gpointer, gint, gint, gint, gint, gpointer data)
+{
+	(*static_cast<gint *>(data))++;
+}
+
+void size_prepared_cb(gpointer, gint, gint, gpointer) {}
+
+void expect_same_pixels(GdkPixbuf *expected, GdkPixbuf *pixbuf)
+{
+	ASSERT_EQ(gdk_pixbuf_get_width(expected), gdk_pixbuf_get_width(pixbuf));
+	ASSERT_EQ(gdk_pixbuf_get_height(expected), gdk_pixbuf_get_height(pixbuf));
+	ASSERT_EQ(gdk_pixbuf_get_n_channels(expected), gdk_pixbuf_get_n_channels(pixbuf));
+
+	const gint row_size = gdk_pixbuf_get_width(pixbuf) * gdk_pixbuf_get_n_channels(pixbuf);
+	for (gint y = 0; y < gdk_pixbuf_get_height(pixbuf); y++)
+		{
+		const guchar *e = gdk_pixbuf_get_pixels(expected) + (y * gdk_pixbuf_get_rowstride(expected));
+		const guchar *p = gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf));
+		ASSERT_EQ(0, memcmp(e, p, row_size)) << "row " << y;
+		}
+}
+
+TEST(ImageLoaderJpegTest, ProgressiveCutAtScanBoundary)
+{
+	const std::vector<guchar> jpeg = progressive_jpeg_new(640, 480);
+	ASSERT_GT(jpeg.size(), STREAM_HEADER_SIZE);
+
+	gint whole_updates = 0;
+	std::unique_ptr<ImageLoaderBackend> whole = get_image_loader_backend_jpeg();
+	whole->init(area_updated_cb, size_prepared_cb, &whole_updates);
+	gsize whole_size = jpeg.size();
+	ASSERT_TRUE(whole->write(jpeg.data(), whole_size, jpeg.size(), nullptr));
+	ASSERT_NE(nullptr, whole->get_pixbuf());
+
+	gint cuts = 0;
+	for (gsize offset : scan_offsets(jpeg))
+		{
+		if (offset < STREAM_HEADER_SIZE) continue;
+
+		SCOPED_TRACE(testing::Message() << "cut at " << offset);
+		cuts++;
+
+		gint updates = 0;
+		std::unique_ptr<ImageLoaderBackend> loader = get_image_loader_backend_jpeg();
+		loader->init(area_updated_cb, size_prepared_cb, &updates);
+
+		/* the data ends right before a scan, so jpeg_finish_output() suspends */
+		gsize chunk_size = offset;
+		ASSERT_TRUE(loader->write(jpeg.data(), chunk_size, jpeg.size(), nullptr));
+		EXPECT_GT(updates, 0);
+
+		chunk_size = jpeg.size();
+		ASSERT_TRUE(loader->write(jpeg.data(), chunk_size, jpeg.size(), nullptr));
+		ASSERT_NE(nullptr, loader->get_pixbuf());
+
+		expect_same_pixels(whole->get_pixbuf(), loader->get_pixbuf());
+		}
+
+	EXPECT_GT(cuts, 0);
+}
+
+}  // anonymous namespace
+
+#endif /* HAVE_JPEG */
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for jpeg-parser.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "jpeg-parser.h"
+
+namespace {
+
+using Bytes = std::vector<guchar>;
+
+void append16(Bytes &b, guint v)
+{
+	b.push_back(v & 0xff);
+	b.push_back((v >> 8) & 0xff);
+}
+
+void append32(Bytes &b, guint v)
+{
+	append16(b, v & 0xffff);
+	append16(b, v >> 16);
+}
+
+void append_entry(Bytes &b, guint tag, guint format, guint count, guint value)
+{
+	append16(b, tag);
+	append16(b, format);
+	append32(b, count);
+	append32(b, value);
+}
+
+/**
+ * @brief A little endian TIFF with a rating in IFD0 and the capture date in the Exif IFD
+ */
+Bytes tiff_new(guint rating, const std::string &date)
+{
+	Bytes b{'I', 'I', 0x2a, 0x00};
+	append32(b, 8);
+
+	/* IFD0 at 8: 2 entries, the Exif IFD follows at 8 + 2 + 24 + 4 = 38 */
+	append16(b, 2);
+	append_entry(b, 0x4746, 3, 1, rating);
+	append_entry(b, 0x8769, 4, 1, 38);
+	append32(b, 0);
+
+	/* Exif IFD at 38, the date follows at 38 + 2 + 12 + 4 = 56 */
+	append16(b, 1);
+	append_entry(b, 0x9003, 2, date.size() + 1, 56);
+	append32(b, 0);
+
+	b.insert(b.end(), date.begin(), date.end());
+	b.push_back(0);
+
+	return b;
+}
+
+void append_segment(Bytes &b, guchar marker, const std::string &magic, const Bytes &data)
+{
+	const guint length = 2 + magic.size() + data.size();
+
+	b.push_back(0xff);
+	b.push_back(marker);
+	b.push_back(length >> 8);
+	b.push_back(length & 0xff);
+	b.insert(b.end(), magic.begin(), magic.end());
+	b.insert(b.end(), data.begin(), data.end());
+}
+
+Bytes jpeg_new(const Bytes &tiff, const std::string &xmp)
+{
+	Bytes b{0xff, 0xd8};
+
+	append_segment(b, 0xe0, std::string("JFIF\0", 5), {1, 1, 0, 0, 1, 0, 1, 0, 0});
+	append_segment(b, 0xe1, std::string("Exif\0\0", 6), tiff);
+	if (!xmp.empty())
+		{
+		append_segment(b, 0xe1, std::string("http://ns.adobe.com/xap/1.0/\0", 29), Bytes(xmp.begin(), xmp.end()));
+		}
+	/* the frame, its content does not matter */
+	append_segment(b, 0xdb, "", Bytes(65, 0));
+
+	return b;
+}
+
+TEST(JpegParserTest, QuickMetadataFromJpegExif)
+{
+	const Bytes jpeg = jpeg_new(tiff_new(4, "2024:05:06 07:08:09"), "");
+	QuickMetadata metadata;
+
+	ASSERT_TRUE(quick_metadata_parse(jpeg.data(), jpeg.size(), metadata));
+	EXPECT_EQ("2024:05:06 07:08:09", metadata.date_time_original);
+	EXPECT_EQ("", metadata.date_time_digitized);
+	EXPECT_EQ(4, metadata.rating);
+}
+
+TEST(JpegParserTest, QuickMetadataXmpRatingWins)
+{
+	QuickMetadata metadata;
+
+	const Bytes attribute = jpeg_new(tiff_new(4, "2024:05:06 07:08:09"), R"(<rdf:Description xmp:Rating="2"/>)");
+	ASSERT_TRUE(quick_metadata_parse(attribute.data(), attribute.size(), metadata));
+	EXPECT_EQ(2, metadata.rating);
+
+	const Bytes element = jpeg_new(tiff_new(4, "2024:05:06 07:08:09"), "<xmp:Rating>-1</xmp:Rating>");
+	ASSERT_TRUE(quick_metadata_parse(element.data(), element.size(), metadata));
+	EXPECT_EQ(-1, metadata.rating);
+	EXPECT_EQ("2024:05:06 07:08:09", metadata.date_time_original);
+}
+
+TEST(JpegParserTest, QuickMetadataFromTiff)
+{
+	const Bytes tiff = tiff_new(5, "2001:02:03 04:05:06");
+	QuickMetadata metadata;
+
+	ASSERT_TRUE(quick_metadata_parse(tiff.data(), tiff.size(), metadata));
+	EXPECT_EQ("2001:02:03 04:05:06", metadata.date_time_original);
+	EXPECT_EQ(5, metadata.rating);
+}
+
+TEST(JpegParserTest, QuickMetadataFailsWhenIncompleteOrUnknown)
+{
+	const Bytes jpeg = jpeg_new(tiff_new(4, "2024:05:06 07:08:09"), "");
+	const Bytes tiff = tiff_new(5, "2001:02:03 04:05:06");
+	const Bytes png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 0};
+	QuickMetadata metadata;
+
+	EXPECT_FALSE(quick_metadata_parse(jpeg.data(), 40, metadata));
+	EXPECT_FALSE(quick_metadata_parse(tiff.data(), tiff.size() - 4, metadata));
+	EXPECT_FALSE(quick_metadata_parse(png.data(), png.size(), metadata));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
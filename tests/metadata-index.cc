@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for metadata-index.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cache.h"
+#include "filedata.h"
+#include "metadata-index.h"
+#include "options.h"
+
+namespace {
+
+/* offsets in the file, see MetadataIndexHeader and MetadataIndexRecord */
+constexpr gsize HEADER_VERSION = 8;
+constexpr gsize HEADER_COUNT = 16;
+constexpr gsize HEADER_SIZE = 32;
+constexpr gsize RECORD_NAME = 40;
+
+/**
+ * @brief A JPEG of only an Exif segment with a DateTimeOriginal of @a second past noon
+ */
+std::string exif_jpeg_new(gint second)
+{
+	/* little endian TIFF: IFD0 at 8 points to the Exif IFD at 26, its date at 44 */
+	std::string tiff("II\x2a\x00\x08\x00\x00\x00", 8);
+	const auto put16 = [&tiff](guint16 value) { tiff += static_cast<gchar>(value & 0xff); tiff += static_cast<gchar>(value >> 8); };
+	const auto put32 = [&put16](guint32 value) { put16(value & 0xffff); put16(value >> 16); };
+
+	put16(1);
+	put16(0x8769); put16(4); put32(1); put32(26);
+	put32(0);
+
+	put16(1);
+	put16(0x9003); put16(2); put32(20); put32(44);
+	put32(0);
+
+	g_autofree gchar *date = g_strdup_printf("2024:05:01 12:%02d:%02d", (second / 60) % 60, second % 60);
+	tiff.append(date, 20);
+
+	const gsize length = 2 + 6 + tiff.size();
+	std::string jpeg("\xff\xd8\xff\xe1", 4);
+	jpeg += static_cast<gchar>(length >> 8);
+	jpeg += static_cast<gchar>(length & 0xff);
+	jpeg.append("Exif\0\0", 6);
+	jpeg += tiff;
+	jpeg.append("\xff\xd9", 2);
+
+	return jpeg;
+}
+
+class MetadataIndexTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!options) options = init_options(nullptr);
+		saved_metadata_options = options->metadata;
+		options->metadata.index_database = TRUE;
+		options->metadata.enable_metadata_dirs = TRUE;
+
+		tmp_dir = g_dir_make_tmp("geeqie-metadata-index-XXXXXX", nullptr);
+		ASSERT_NE(tmp_dir, nullptr);
+
+		fd_a = create_file("a.jpg", "a");
+		fd_b = create_file("b.jpg", "bb");
+	}
+
+	void TearDown() override
+	{
+		metadata_index_flush();
+
+		if (fd_b) file_data_unref(fd_b);
+		if (fd_a) file_data_unref(fd_a);
+
+		if (tmp_dir) std::filesystem::remove_all(tmp_dir);
+		g_clear_pointer(&tmp_dir, g_free);
+
+		options->metadata = saved_metadata_options;
+	}
+
+	FileData *create_file(const gchar *name, const gchar *contents)
+	{
+		g_autofree gchar *path = g_build_filename(tmp_dir, name, NULL);
+		g_file_set_contents(path, contents, -1, nullptr);
+
+		return FileData::file_data_new_simple(path, &context);
+	}
+
+	gchar *index_path() const
+	{
+		return g_build_filename(tmp_dir, GQ_CACHE_LOCAL_METADATA, GQ_CACHE_METADATA_INDEX, NULL);
+	}
+
+	static MetadataIndexEntry full_entry()
+	{
+		MetadataIndexEntry entry;
+		entry.fields = METADATA_INDEX_DATE | METADATA_INDEX_DATE_DIGITIZED | METADATA_INDEX_RATING |
+		               METADATA_INDEX_KEYWORDS | METADATA_INDEX_COMMENT | METADATA_INDEX_GPS;
+		entry.date = 1700000000;
+		entry.date_digitized = 1600000000;
+		entry.rating = 4;
+		entry.keywords = {"holiday", "beach", ""};
+		entry.comment = "A comment";
+		entry.latitude = "48,51.0N";
+		entry.longitude = "2,21.0E";
+
+		return entry;
+	}
+
+	/* keywords, comment and position known to be absent */
+	static MetadataIndexEntry empty_entry()
+	{
+		MetadataIndexEntry entry;
+		entry.fields = METADATA_INDEX_RATING | METADATA_INDEX_KEYWORDS | METADATA_INDEX_COMMENT | METADATA_INDEX_GPS;
+		entry.rating = -1;
+
+		return entry;
+	}
+
+	static void expect_entry_eq(const MetadataIndexEntry &expected, const MetadataIndexEntry &entry)
+	{
+		EXPECT_EQ(expected.fields, entry.fields);
+		EXPECT_EQ(expected.date, entry.date);
+		EXPECT_EQ(expected.date_digitized, entry.date_digitized);
+		EXPECT_EQ(expected.rating, entry.rating);
+		EXPECT_EQ(expected.keywords, entry.keywords);
+		EXPECT_EQ(expected.comment, entry.comment);
+		EXPECT_EQ(expected.latitude, entry.latitude);
+		EXPECT_EQ(expected.longitude, entry.longitude);
+	}
+
+	gchar *tmp_dir = nullptr;
+	FileData *fd_a = nullptr;
+	FileData *fd_b = nullptr;
+	FileDataContext context;
+	decltype(ConfOptions::metadata) saved_metadata_options;
+};
+
+TEST_F(MetadataIndexTest, PutFlushReopenGet)
+{
+	MetadataIndexEntry entry;
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+
+	metadata_index_put(fd_a, full_entry());
+	metadata_index_put(fd_b, empty_entry());
+
+	// The flush saves and closes the index, so the lookups read the file.
+	metadata_index_flush();
+
+	g_autofree gchar *path = index_path();
+	ASSERT_TRUE(g_file_test(path, G_FILE_TEST_IS_REGULAR));
+
+	ASSERT_TRUE(metadata_index_get(fd_a, entry));
+	expect_entry_eq(full_entry(), entry);
+
+	MetadataIndexEntry entry_b;
+	ASSERT_TRUE(metadata_index_get(fd_b, entry_b));
+	expect_entry_eq(empty_entry(), entry_b);
+	EXPECT_FALSE(entry_b.comment.has_value());
+	EXPECT_FALSE(entry_b.latitude.has_value());
+	EXPECT_FALSE(entry_b.longitude.has_value());
+}
+
+TEST_F(MetadataIndexTest, RemoveThenFlush)
+{
+	metadata_index_put(fd_a, full_entry());
+	metadata_index_put(fd_b, empty_entry());
+	metadata_index_flush();
+
+	metadata_index_remove(fd_a);
+
+	MetadataIndexEntry entry;
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+
+	metadata_index_flush();
+
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+	EXPECT_TRUE(metadata_index_get(fd_b, entry));
+}
+
+TEST_F(MetadataIndexTest, KeyMismatch)
+{
+	metadata_index_put(fd_a, full_entry());
+	metadata_index_flush();
+
+	MetadataIndexEntry entry;
+	ASSERT_TRUE(metadata_index_get(fd_a, entry));
+
+	fd_a->date++;
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+	fd_a->date--;
+
+	fd_a->size++;
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+	fd_a->size--;
+
+	ASSERT_TRUE(metadata_index_get(fd_a, entry));
+
+	// A legacy metadata file written later changes the stamp.
+	g_autofree gchar *legacy = cache_get_location(CacheType::METADATA, fd_a->path);
+	ASSERT_TRUE(g_file_set_contents(legacy, "", 0, nullptr));
+	EXPECT_FALSE(metadata_index_get(fd_a, entry));
+}
+
+TEST_F(MetadataIndexTest, CorruptFilesRejected)
+{
+	metadata_index_put(fd_a, full_entry());
+	metadata_index_flush();
+
+	g_autofree gchar *path = index_path();
+	g_autofree gchar *contents = nullptr;
+	gsize length = 0;
+	ASSERT_TRUE(g_file_get_contents(path, &contents, &length, nullptr));
+	ASSERT_GT(length, HEADER_SIZE + RECORD_NAME + sizeof(guint32));
+
+	const std::string valid(contents, length);
+	const auto with = [&valid](gsize offset, const auto &value)
+	{
+		std::string corrupt = valid;
+		memcpy(&corrupt[offset], &value, sizeof(value));
+		return corrupt;
+	};
+
+	const std::vector<std::pair<const gchar *, std::string>> cases = {
+		{"empty", ""},
+		{"header only", valid.substr(0, HEADER_SIZE)},
+		{"truncated", valid.substr(0, length - 1)},
+		{"extended", valid + std::string(1, '\0')},
+		{"version", with(HEADER_VERSION, guint32{2})},
+		{"count", with(HEADER_COUNT, guint64{2})},
+		{"pool end", with(length - 1, 'x')},
+		{"name offset", with(HEADER_SIZE + RECORD_NAME, guint32{0xffffffff})},
+	};
+
+	for (const auto &c : cases)
+		{
+		SCOPED_TRACE(c.first);
+
+		ASSERT_TRUE(g_file_set_contents(path, c.second.data(), c.second.size(), nullptr));
+
+		// Closes the index, so the next lookup maps the file again.
+		metadata_index_flush();
+
+		MetadataIndexEntry entry;
+		EXPECT_FALSE(metadata_index_get(fd_a, entry));
+		}
+
+	ASSERT_TRUE(g_file_set_contents(path, valid.data(), valid.size(), nullptr));
+	metadata_index_flush();
+
+	MetadataIndexEntry entry;
+	EXPECT_TRUE(metadata_index_get(fd_a, entry));
+}
+
+/**
+ * Sorting a large tree by date: read_exif_time_data() on a cold index
+ * parses the Exif data of every file, after a flush metadata_index_get()
+ * answers from the saved index of each folder.
+ *
+ * A benchmark, run with --gtest_also_run_disabled_tests.
+ */
+TEST_F(MetadataIndexTest, DISABLED_BenchmarkColdAndWarm50kImages)
+{
+	constexpr gint folders = 50;
+	constexpr gint images_per_folder = 1000;
+
+	std::vector<FileData *> files;
+	files.reserve(folders * images_per_folder);
+	for (gint f = 0; f < folders; f++)
+		{
+		g_autofree gchar *folder = g_strdup_printf("%s/%03d", tmp_dir, f);
+		ASSERT_EQ(0, g_mkdir(folder, 0755));
+
+		for (gint i = 0; i < images_per_folder; i++)
+			{
+			g_autofree gchar *path = g_strdup_printf("%s/%05d.jpg", folder, i);
+			const std::string jpeg = exif_jpeg_new(i);
+			ASSERT_TRUE(g_file_set_contents(path, jpeg.data(), jpeg.size(), nullptr));
+
+			files.push_back(FileData::file_data_new_simple(path, &context));
+			}
+		}
+
+	const gint64 cold_start = g_get_monotonic_time();
+	for (FileData *fd : files)
+		{
+		read_exif_time_data(fd);
+		}
+	const gint64 cold = g_get_monotonic_time() - cold_start;
+
+	// Saves and closes the index of each folder, so the lookups map the files.
+	metadata_index_flush();
+
+	gint found = 0;
+	const gint64 warm_start = g_get_monotonic_time();
+	for (FileData *fd : files)
+		{
+		MetadataIndexEntry entry;
+		if (metadata_index_get(fd, entry) && fd->exifdate > 0 && entry.date == fd->exifdate) found++;
+		}
+	const gint64 warm = g_get_monotonic_time() - warm_start;
+
+	EXPECT_EQ(static_cast<gint>(files.size()), found);
+
+	std::cerr << files.size() << " images in " << folders << " folders: " << cold << " us cold, "
+	          << warm << " us from the index\n";
+
+	for (FileData *fd : files)
+		{
+		file_data_unref(fd);
+		}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for pixbuf-pool.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <config.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "image-load-dds.h"
+#if HAVE_JPEG
+#include "image-load-jpeg.h"
+#endif
+#if HAVE_NPY
+#include "image-load-npy.h"
+#endif
+#if HAVE_TIFF
+#include "image-load-tiff.h"
+#endif
+#include "image-load-zxscr.h"
+#include "image-load.h"
+#include "pixbuf-pool.h"
+
+namespace {
+
+struct BenchmarkSample
+{
+	const gchar *format;
+	std::unique_ptr<ImageLoaderBackend> (*backend)();
+	std::vector<guchar> data;
+};
+
+void area_updated_cb(gpointer, gint, gint, gint, gint, gpointer) {}
+
+void size_prepared_cb(gpointer, gint, gint, gpointer) {}
+
+/**
+ * @brief A photo sized RGB image of noise
+ */
+GdkPixbuf *benchmark_pixbuf_new(gint width, gint height)
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	guint32 seed = 12345;
+	for (gint y = 0; y < height; y++)
+		{
+		guchar *p = gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf));
+		for (gint x = 0; x < width * 3; x++)
+			{
+			seed = (seed * 1103515245) + 12345;
+			p[x] = seed >> 24;
+			}
+		}
+
+	return pixbuf;
+}
+
+/**
+ * @brief An uncompressed A8R8G8B8 DDS file, see ddsGetType()
+ */
+std::vector<guchar> benchmark_dds_new(GdkPixbuf *pixbuf)
+{
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	const gint height = gdk_pixbuf_get_height(pixbuf);
+	std::vector<guchar> dds(128, 0);
+	const auto put = [&dds](gsize offset, guint32 value)
+	{
+		for (gint i = 0; i < 4; i++) dds[offset + i] = value >> (8 * i);
+	};
+
+	memcpy(dds.data(), "DDS ", 4);
+	put(4, 124);
+	put(12, height);
+	put(16, width);
+	put(80, 0x41);
+	put(88, 32);
+	put(92, 0x00ff0000);
+	put(96, 0x0000ff00);
+	put(100, 0x000000ff);
+	put(104, 0xff000000);
+
+	for (gint y = 0; y < height; y++)
+		{
+		const guchar *p = gdk_pixbuf_read_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf));
+		for (gint x = 0; x < width; x++, p += 3)
+			{
+			dds.insert(dds.end(), {p[2], p[1], p[0], 255});
+			}
+		}
+
+	return dds;
+}
+
+#if HAVE_NPY
+/**
+ * @brief A version 1.0 .npy file of an array of (height, width, 3) bytes
+ */
+std::vector<guchar> benchmark_npy_new(GdkPixbuf *pixbuf)
+{
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	const gint height = gdk_pixbuf_get_height(pixbuf);
+	std::string header = "{'descr': '|u1', 'fortran_order': False, 'shape': (" +
+	                     std::to_string(height) + ", " + std::to_string(width) + ", 3), }";
+	/* the data starts at a multiple of 64 */
+	header.append(63 - ((10 + header.size()) % 64), ' ');
+	header += '\n';
+
+	std::vector<guchar> npy = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+	                           static_cast<guchar>(header.size() & 0xff), static_cast<guchar>(header.size() >> 8)};
+	npy.insert(npy.end(), header.begin(), header.end());
+
+	for (gint y = 0; y < height; y++)
+		{
+		const guchar *p = gdk_pixbuf_read_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf));
+		npy.insert(npy.end(), p, p + (width * 3));
+		}
+
+	return npy;
+}
+#endif
+
+#if HAVE_JPEG || HAVE_TIFF
+/**
+ * @returns The pixbuf saved by gdk-pixbuf as @a type, empty if there is no such saver
+ */
+std::vector<guchar> benchmark_save(GdkPixbuf *pixbuf, const gchar *type)
+{
+	g_autofree gchar *buffer = nullptr;
+	gsize size = 0;
+	if (!gdk_pixbuf_save_to_buffer(pixbuf, &buffer, &size, type, nullptr, NULL)) return {};
+
+	return {buffer, buffer + size};
+}
+#endif
+
+/**
+ * @brief Decodes @a sample, the pixels go back to the pool when the backend is freed
+ * @returns The time taken in microseconds
+ */
+gint64 benchmark_decode(const BenchmarkSample &sample)
+{
+	const gint64 start = g_get_monotonic_time();
+
+	std::unique_ptr<ImageLoaderBackend> loader = sample.backend();
+	loader->init(area_updated_cb, size_prepared_cb, nullptr);
+
+	gsize chunk_size = sample.data.size();
+	EXPECT_TRUE(loader->write(sample.data.data(), chunk_size, sample.data.size(), nullptr));
+	EXPECT_NE(nullptr, loader->get_pixbuf());
+	loader.reset();
+
+	return g_get_monotonic_time() - start;
+}
+
+TEST(PixbufPoolTest, LayoutMatchesGdkPixbufNew)
+{
+	for (gboolean has_alpha : {FALSE, TRUE})
+		for (gint width : {1, 2, 3, 5, 127, 640})
+			{
+			g_autoptr(GdkPixbuf) expected = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, 7);
+			g_autoptr(GdkPixbuf) pixbuf = pixbuf_pool_new(has_alpha, width, 7);
+
+			ASSERT_NE(nullptr, pixbuf);
+			EXPECT_EQ(has_alpha, gdk_pixbuf_get_has_alpha(pixbuf));
+			EXPECT_EQ(gdk_pixbuf_get_n_channels(expected), gdk_pixbuf_get_n_channels(pixbuf));
+			EXPECT_EQ(width, gdk_pixbuf_get_width(pixbuf));
+			EXPECT_EQ(7, gdk_pixbuf_get_height(pixbuf));
+			EXPECT_EQ(gdk_pixbuf_get_rowstride(expected), gdk_pixbuf_get_rowstride(pixbuf)) << "width " << width;
+			EXPECT_EQ(0U, GPOINTER_TO_SIZE(gdk_pixbuf_get_pixels(pixbuf)) % 64);
+			}
+}
+
+TEST(PixbufPoolTest, ReusesReleasedBufferOfSameSize)
+{
+	pixbuf_pool_clear();
+
+	GdkPixbuf *first = pixbuf_pool_new(TRUE, 300, 200);
+	ASSERT_NE(nullptr, first);
+	const guchar *pixels = gdk_pixbuf_read_pixels(first);
+	g_object_unref(first);
+
+	g_autoptr(GdkPixbuf) other_size = pixbuf_pool_new(TRUE, 200, 300 + 1);
+	EXPECT_NE(pixels, gdk_pixbuf_read_pixels(other_size));
+
+	g_autoptr(GdkPixbuf) same_size = pixbuf_pool_new(TRUE, 300, 200);
+	EXPECT_EQ(pixels, gdk_pixbuf_read_pixels(same_size));
+
+	g_autoptr(GdkPixbuf) not_released = pixbuf_pool_new(TRUE, 300, 200);
+	EXPECT_NE(pixels, gdk_pixbuf_read_pixels(not_released));
+}
+
+TEST(PixbufPoolTest, RejectsEmptyImages)
+{
+	EXPECT_EQ(nullptr, pixbuf_pool_new(FALSE, 0, 10));
+	EXPECT_EQ(nullptr, pixbuf_pool_new(TRUE, 10, 0));
+}
+
+/**
+ * Decodes a series of images of the same size in each compiled-in format
+ * that can be generated here. Without the pool it is emptied before each
+ * image, so that every frame is allocated and faulted in again.
+ *
+ * A benchmark, run with --gtest_also_run_disabled_tests.
+ */
+TEST(PixbufPoolTest, DISABLED_BenchmarkDecodeWithAndWithoutPool)
+{
+	constexpr gint width = 4000;
+	constexpr gint height = 3000;
+	constexpr gint images = 20;
+
+	g_autoptr(GdkPixbuf) source = benchmark_pixbuf_new(width, height);
+
+	std::vector<BenchmarkSample> samples;
+	samples.push_back({"DDS", get_image_loader_backend_dds, benchmark_dds_new(source)});
+	samples.push_back({"ZX screen", get_image_loader_backend_zxscr, std::vector<guchar>(6912, 0x55)});
+#if HAVE_JPEG
+	samples.push_back({"JPEG", get_image_loader_backend_jpeg, benchmark_save(source, "jpeg")});
+#endif
+#if HAVE_NPY
+	samples.push_back({"NPY", get_image_loader_backend_npy, benchmark_npy_new(source)});
+#endif
+#if HAVE_TIFF
+	samples.push_back({"TIFF", get_image_loader_backend_tiff, benchmark_save(source, "tiff")});
+#endif
+
+	for (const BenchmarkSample &sample : samples)
+		{
+		SCOPED_TRACE(sample.format);
+
+		if (sample.data.empty())
+			{
+			std::cerr << sample.format << ": no sample, skipped\n";
+			continue;
+			}
+
+		gint64 pool_time = 0;
+		gint64 no_pool_time = 0;
+		for (gint i = 0; i < images; i++)
+			{
+			pixbuf_pool_clear();
+			no_pool_time += benchmark_decode(sample);
+			}
+
+		pixbuf_pool_clear();
+		benchmark_decode(sample);
+		for (gint i = 0; i < images; i++)
+			{
+			pool_time += benchmark_decode(sample);
+			}
+
+		std::cerr << sample.format << ", " << images << " images: " << no_pool_time / images << " us each without pool, "
+		          << pool_time / images << " us each with pool\n";
+		}
+
+	pixbuf_pool_clear();
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -24,10 +24,213 @@
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "exif.h"
 #include "pixbuf-util.h"
 
 namespace {
 
+GdkPixbuf *pixbuf_new_filled(gboolean has_alpha, gint width, gint height,
+                             guchar (*value)(gint x, gint y, gint channel))
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	const gint step = has_alpha ? 4 : 3;
+	const gint rs = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pix = gdk_pixbuf_get_pixels(pixbuf);
+
+	for (gint y = 0; y < height; y++)
+		for (gint x = 0; x < width; x++)
+			for (gint c = 0; c < step; c++)
+				pix[(y * rs) + (x * step) + c] = value(x, y, c);
+
+	return pixbuf;
+}
+
+guchar pixbuf_value(const GdkPixbuf *pixbuf, gint x, gint y, gint channel)
+{
+	const gint step = gdk_pixbuf_get_has_alpha(pixbuf) ? 4 : 3;
+	return gdk_pixbuf_read_pixels(pixbuf)[(y * gdk_pixbuf_get_rowstride(pixbuf)) + (x * step) + channel];
+}
+
+/**
+ * @brief The orientations done with gdk_pixbuf_flip() and gdk_pixbuf_rotate_simple()
+ */
+GdkPixbuf *pixbuf_apply_orientation_gdk(GdkPixbuf *pixbuf, gint orientation)
+{
+	g_autoptr(GdkPixbuf) flipped = nullptr;
+
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_TOP_RIGHT:
+			return gdk_pixbuf_flip(pixbuf, TRUE);
+		case EXIF_ORIENTATION_BOTTOM_RIGHT:
+			return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_UPSIDEDOWN);
+		case EXIF_ORIENTATION_BOTTOM_LEFT:
+			return gdk_pixbuf_flip(pixbuf, FALSE);
+		case EXIF_ORIENTATION_LEFT_TOP:
+			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
+			return gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_CLOCKWISE);
+		case EXIF_ORIENTATION_RIGHT_TOP:
+			return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_CLOCKWISE);
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+			flipped = gdk_pixbuf_flip(pixbuf, FALSE);
+			return gdk_pixbuf_rotate_simple(flipped, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			return gdk_pixbuf_rotate_simple(pixbuf, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
+		default:
+			return gdk_pixbuf_copy(pixbuf);
+		}
+}
+
+guchar pixbuf_value_noise(gint x, gint y, gint c)
+{
+	return static_cast<guchar>((x * 7) + (y * 13) + (c * 101) + ((x * y) >> 3));
+}
+
+void expect_pixbuf_equal(const GdkPixbuf *expected, const GdkPixbuf *actual)
+{
+	const gint width = gdk_pixbuf_get_width(expected);
+	const gint height = gdk_pixbuf_get_height(expected);
+	const gint step = gdk_pixbuf_get_n_channels(expected);
+
+	ASSERT_EQ(width, gdk_pixbuf_get_width(actual));
+	ASSERT_EQ(height, gdk_pixbuf_get_height(actual));
+	ASSERT_EQ(step, gdk_pixbuf_get_n_channels(actual));
+
+	for (gint y = 0; y < height; y++)
+		for (gint x = 0; x < width; x++)
+			for (gint c = 0; c < step; c++)
+				ASSERT_EQ(pixbuf_value(expected, x, y, c), pixbuf_value(actual, x, y, c))
+					<< "at " << x << "," << y << " channel " << c;
+}
+
+TEST(PixbufScaleHalfTest, AveragesBlocks)
+{
+	/* columns alternate 0 and 200, rows add 0 and 20 */
+	g_autoptr(GdkPixbuf) src = pixbuf_new_filled(FALSE, 4, 4, [](gint x, gint y, gint c) -> guchar
+	{
+		return ((x % 2) ? 200 : 0) + ((y % 2) ? 20 : 0) + c;
+	});
+
+	g_autoptr(GdkPixbuf) half = pixbuf_scale_half(src);
+
+	ASSERT_NE(nullptr, half);
+	EXPECT_EQ(2, gdk_pixbuf_get_width(half));
+	EXPECT_EQ(2, gdk_pixbuf_get_height(half));
+	EXPECT_FALSE(gdk_pixbuf_get_has_alpha(half));
+
+	for (gint y = 0; y < 2; y++)
+		for (gint x = 0; x < 2; x++)
+			for (gint c = 0; c < 3; c++)
+				EXPECT_EQ(110 + c, pixbuf_value(half, x, y, c));
+}
+
+TEST(PixbufScaleHalfTest, OddSizeKeepsEdges)
+{
+	g_autoptr(GdkPixbuf) src = pixbuf_new_filled(TRUE, 5, 3, [](gint x, gint y, gint c) -> guchar
+	{
+		return c == 3 ? 255 : (x * 10) + y;
+	});
+
+	g_autoptr(GdkPixbuf) half = pixbuf_scale_half(src);
+
+	ASSERT_NE(nullptr, half);
+	EXPECT_EQ(3, gdk_pixbuf_get_width(half));
+	EXPECT_EQ(2, gdk_pixbuf_get_height(half));
+	EXPECT_TRUE(gdk_pixbuf_get_has_alpha(half));
+
+	/* (0 + 10 + 1 + 11 + 2) / 4 */
+	EXPECT_EQ(6, pixbuf_value(half, 0, 0, 0));
+	/* last column is x = 4 only: (40 + 40 + 41 + 41 + 2) / 4 */
+	EXPECT_EQ(41, pixbuf_value(half, 2, 0, 0));
+	/* last row is y = 2 only: (22 + 32 + 22 + 32 + 2) / 4 */
+	EXPECT_EQ(27, pixbuf_value(half, 1, 1, 1));
+	EXPECT_EQ(255, pixbuf_value(half, 2, 1, 3));
+}
+
+TEST(PixbufApplyOrientationTest, MatchesGdkForAllOrientations)
+{
+	/* odd sizes, so that neither the blocks nor the 4x4 groups fit */
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) src = pixbuf_new_filled(has_alpha, 37, 21, pixbuf_value_noise);
+
+		for (gint orientation = EXIF_ORIENTATION_TOP_LEFT; orientation <= EXIF_ORIENTATION_LEFT_BOTTOM; orientation++)
+			{
+			SCOPED_TRACE(testing::Message() << "orientation " << orientation << " alpha " << has_alpha);
+
+			g_autoptr(GdkPixbuf) expected = pixbuf_apply_orientation_gdk(src, orientation);
+			g_autoptr(GdkPixbuf) actual = pixbuf_apply_orientation(src, orientation);
+
+			expect_pixbuf_equal(expected, actual);
+			}
+		}
+}
+
+TEST(PixbufApplyOrientationTest, CopyAreaOnlyWritesTheArea)
+{
+	g_autoptr(GdkPixbuf) src = pixbuf_new_filled(FALSE, 32, 32, pixbuf_value_noise);
+	g_autoptr(GdkPixbuf) expected = pixbuf_apply_orientation_gdk(src, EXIF_ORIENTATION_RIGHT_TOP);
+	g_autoptr(GdkPixbuf) dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, 32, 32);
+	gdk_pixbuf_fill(dest, 0);
+
+	const GdkRectangle area{5, 9, 20, 11};
+	pixbuf_copy_area_oriented(gdk_pixbuf_read_pixels(src), gdk_pixbuf_get_rowstride(src),
+	                          gdk_pixbuf_get_pixels(dest), gdk_pixbuf_get_rowstride(dest),
+	                          3, 32, 32, area, EXIF_ORIENTATION_RIGHT_TOP);
+
+	/* rotated clockwise, the area is at x = 32 - 9 - 11, y = 5 */
+	const GdkRectangle rotated{12, 5, 11, 20};
+	for (gint y = 0; y < 32; y++)
+		for (gint x = 0; x < 32; x++)
+			{
+			const gboolean inside = x >= rotated.x && x < rotated.x + rotated.width &&
+			                        y >= rotated.y && y < rotated.y + rotated.height;
+			const guchar value = inside ? pixbuf_value(expected, x, y, 1) : 0;
+
+			ASSERT_EQ(value, pixbuf_value(dest, x, y, 1)) << "at " << x << "," << y;
+			}
+}
+
+/**
+ * The EXIF rotation of a 24 MP camera image, as done for full size
+ * images and before scaling thumbnails.
+ *
+ * A benchmark, run with --gtest_also_run_disabled_tests.
+ */
+TEST(PixbufApplyOrientationTest, DISABLED_Benchmark24Megapixel)
+{
+	constexpr gint width = 6000;
+	constexpr gint height = 4000;
+
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) src = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+		gdk_pixbuf_fill(src, 0x20406080);
+
+		for (gint orientation : {EXIF_ORIENTATION_BOTTOM_RIGHT, EXIF_ORIENTATION_LEFT_TOP, EXIF_ORIENTATION_RIGHT_TOP})
+			{
+			gint64 start = g_get_monotonic_time();
+			g_autoptr(GdkPixbuf) expected = pixbuf_apply_orientation_gdk(src, orientation);
+			const gint64 gdk_time = g_get_monotonic_time() - start;
+
+			start = g_get_monotonic_time();
+			g_autoptr(GdkPixbuf) actual = pixbuf_apply_orientation(src, orientation);
+			const gint64 blocked_time = g_get_monotonic_time() - start;
+
+			EXPECT_EQ(gdk_pixbuf_get_width(expected), gdk_pixbuf_get_width(actual));
+			EXPECT_EQ(pixbuf_value(expected, 17, 33, 2), pixbuf_value(actual, 17, 33, 2));
+
+			std::cerr << (has_alpha ? "RGBA" : "RGB") << " orientation " << orientation
+			          << ": gdk " << gdk_time << " us, blocked " << blocked_time << " us\n";
+			}
+		}
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for render-stats.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <clocale>
+#include <cstring>
+#include <string>
+
+#include <glib.h>
+
+#include "render-stats.h"
+
+namespace {
+
+TEST(RenderStatsTest, TimersGoToPowerOfTwoBuckets)
+{
+	render_stats_reset();
+
+	render_stats_add_time(RENDER_STAT_TILE_RENDER, 1);
+	render_stats_add_time(RENDER_STAT_TILE_RENDER, 5);
+	render_stats_add_time(RENDER_STAT_TILE_RENDER, 6);
+
+	g_autofree gchar *json = render_stats_to_json();
+
+	EXPECT_NE(nullptr, strstr(json, "\"tile_render\": {\"count\": 3, \"total_us\": 12, \"mean_us\": 4, \"max_us\": 6, \"histogram\": [1, 0, 2]}"));
+	EXPECT_NE(nullptr, strstr(json, "\"load_decode\": {\"count\": 0, \"total_us\": 0, \"mean_us\": 0, \"max_us\": 0, \"histogram\": []}"));
+}
+
+TEST(RenderStatsTest, RatesAndQueues)
+{
+	render_stats_reset();
+
+	render_stats_count(RENDER_STAT_TILE_HIT);
+	render_stats_count(RENDER_STAT_TILE_HIT);
+	render_stats_count(RENDER_STAT_TILE_HIT);
+	render_stats_count(RENDER_STAT_TILE_MISS);
+	render_stats_queue_depth(RENDER_STAT_DRAW_QUEUE, 4);
+	render_stats_queue_depth(RENDER_STAT_DRAW_QUEUE, 2);
+
+	g_autofree gchar *json = render_stats_to_json();
+
+	EXPECT_NE(nullptr, strstr(json, "\"tile_cache\": {\"hits\": 3, \"misses\": 1, \"hit_rate\": 0.750}"));
+	EXPECT_NE(nullptr, strstr(json, "\"read_ahead\": {\"hits\": 0, \"misses\": 0, \"hit_rate\": -1.000}"));
+	EXPECT_NE(nullptr, strstr(json, "\"draw_queue\": {\"samples\": 2, \"last\": 2, \"max\": 4, \"mean\": 3.00}"));
+}
+
+TEST(RenderStatsTest, NumbersIgnoreTheLocale)
+{
+	const std::string saved = setlocale(LC_NUMERIC, nullptr);
+	if (!setlocale(LC_NUMERIC, "de_DE.UTF-8")) GTEST_SKIP() << "no locale with a decimal comma";
+
+	render_stats_reset();
+	render_stats_count(RENDER_STAT_TILE_HIT);
+	render_stats_count(RENDER_STAT_TILE_MISS);
+	render_stats_queue_depth(RENDER_STAT_DRAW_QUEUE, 3);
+
+	g_autofree gchar *json = render_stats_to_json();
+	setlocale(LC_NUMERIC, saved.c_str());
+
+	EXPECT_NE(nullptr, strstr(json, "\"hit_rate\": 0.500}"));
+	EXPECT_NE(nullptr, strstr(json, "\"mean\": 3.00}"));
+	EXPECT_EQ(nullptr, strstr(json, ",5"));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for tile-index.h
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <vector>
+
+#include <glib.h>
+
+#include "tile-index.h"
+
+namespace {
+
+struct Tile
+{
+	gint x;
+	gint y;
+
+	Tile *lru_prev;
+	Tile *lru_next;
+};
+
+Tile *tile_new(gint x, gint y)
+{
+	Tile *tile = g_new0(Tile, 1);
+	tile->x = x;
+	tile->y = y;
+	return tile;
+}
+
+void tile_index_free_all(TileIndex<Tile> &index)
+{
+	Tile *tile = index.first();
+	while (tile)
+		{
+		Tile *next = tile->lru_next;
+		g_free(tile);
+		tile = next;
+		}
+	index.clear();
+}
+
+std::vector<Tile *> tile_index_order(const TileIndex<Tile> &index)
+{
+	std::vector<Tile *> order;
+	for (Tile *tile = index.first(); tile; tile = tile->lru_next) order.push_back(tile);
+	return order;
+}
+
+TEST(TileIndexTest, FindInsertRemove)
+{
+	TileIndex<Tile> index;
+
+	Tile *a = tile_new(0, 0);
+	Tile *b = tile_new(128, 0);
+	Tile *c = tile_new(-128, 256);
+
+	index.insert(a);
+	index.insert(b);
+	index.insert(c);
+
+	EXPECT_EQ(3U, index.size());
+	EXPECT_EQ(a, index.find(0, 0));
+	EXPECT_EQ(b, index.find(128, 0));
+	EXPECT_EQ(c, index.find(-128, 256));
+	EXPECT_EQ(nullptr, index.find(0, 128));
+	EXPECT_EQ(nullptr, index.find(256, -128));
+
+	index.remove(b);
+	g_free(b);
+
+	EXPECT_EQ(2U, index.size());
+	EXPECT_EQ(nullptr, index.find(128, 0));
+	EXPECT_EQ((std::vector<Tile *>{c, a}), tile_index_order(index));
+
+	tile_index_free_all(index);
+	EXPECT_EQ(0U, index.size());
+	EXPECT_EQ(nullptr, index.first());
+	EXPECT_EQ(nullptr, index.last());
+}
+
+TEST(TileIndexTest, TouchKeepsMostRecentlyUsedFirst)
+{
+	TileIndex<Tile> index;
+
+	Tile *a = tile_new(0, 0);
+	Tile *b = tile_new(0, 64);
+	Tile *c = tile_new(0, 128);
+
+	index.insert(a);
+	index.insert(b);
+	index.insert(c);
+	EXPECT_EQ((std::vector<Tile *>{c, b, a}), tile_index_order(index));
+	EXPECT_EQ(a, index.last());
+
+	index.touch(a);
+	EXPECT_EQ((std::vector<Tile *>{a, c, b}), tile_index_order(index));
+	EXPECT_EQ(b, index.last());
+
+	index.touch(c);
+	EXPECT_EQ((std::vector<Tile *>{c, a, b}), tile_index_order(index));
+
+	index.touch(c);
+	EXPECT_EQ((std::vector<Tile *>{c, a, b}), tile_index_order(index));
+
+	index.remove(c);
+	g_free(c);
+	EXPECT_EQ(a, index.first());
+	EXPECT_EQ(nullptr, a->lru_prev);
+
+	tile_index_free_all(index);
+}
+
+/**
+ * The access pattern of renderer_scroll() on a large zoomed-in image:
+ * each frame the viewport moves a little and every tile under it is
+ * looked up, missing tiles are created and the least recently used
+ * ones beyond the cache size are evicted.
+ *
+ * A benchmark, run with --gtest_also_run_disabled_tests.
+ */
+TEST(TileIndexTest, DISABLED_BenchmarkPanLargeImage)
+{
+	constexpr gint tile_size = 128;
+	constexpr gint image_w = 40000;
+	constexpr gint image_h = 30000;
+	constexpr gint view_w = 1920;
+	constexpr gint view_h = 1080;
+	constexpr guint cache_tiles = 4096;
+	constexpr gint frames = 2000;
+
+	TileIndex<Tile> index;
+	guint64 lookups = 0;
+	guint64 misses = 0;
+
+	const gint64 start = g_get_monotonic_time();
+
+	for (gint frame = 0; frame < frames; frame++)
+		{
+		/* a diagonal pan, bouncing at the edges */
+		const gint x = (frame * 37) % (image_w - view_w);
+		const gint y = (frame * 23) % (image_h - view_h);
+
+		for (gint ty = (y / tile_size) * tile_size; ty < y + view_h; ty += tile_size)
+			{
+			for (gint tx = (x / tile_size) * tile_size; tx < x + view_w; tx += tile_size)
+				{
+				Tile *tile = index.find(tx, ty);
+				lookups++;
+
+				if (tile)
+					{
+					index.touch(tile);
+					continue;
+					}
+
+				misses++;
+				while (index.size() >= cache_tiles)
+					{
+					Tile *old = index.last();
+					index.remove(old);
+					g_free(old);
+					}
+				index.insert(tile_new(tx, ty));
+				}
+			}
+		}
+
+	const gint64 elapsed = g_get_monotonic_time() - start;
+
+	EXPECT_LE(index.size(), cache_tiles);
+	EXPECT_GT(lookups, misses);
+
+	std::cerr << frames << " frames, " << lookups << " lookups, " << misses << " misses, "
+	          << index.size() << " tiles cached: " << elapsed << " us\n";
+
+	tile_index_free_all(index);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */